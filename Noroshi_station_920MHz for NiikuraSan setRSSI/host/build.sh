@@ -0,0 +1,93 @@
+#!/bin/sh
+#*******************************************************************************
+# Host checks of the station modules that build under gcc on Linux. Each
+# check is a plain main() that prints its figures and exits non-zero on a
+# failure. The firmware itself builds with IAR, see ide/iar.
+#
+#   sh host/build.sh                build and run all checks
+#   sh host/build.sh ring_stress    only the named ones
+#
+# Binaries go to $OUT, /tmp/noroshi_host by default.
+#*******************************************************************************
+
+HOST=$(cd "$(dirname "$0")" && pwd)
+APP="$HOST/../source/apps/cc1200_rx_sniff_mode"
+OUT=${OUT:-/tmp/noroshi_host}
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O2 -Wall}
+FAILED=""
+
+# TrxEB flash and SPI bus headers, relative to the app directory, for the
+# checks on flash_model.c
+BSP=../../components/bsp/trxeb_msp5438a/drivers/source
+
+mkdir -p "$OUT" || exit 1
+
+# check name flags sources... : extra gcc options, then sources relative
+# to the app directory
+check() {
+    name=$1
+    flags=$2
+    shift 2
+    if [ -n "$ONLY" ] && ! echo " $ONLY " | grep -q " $name "; then
+        return
+    fi
+    echo "== $name"
+    if ! (cd "$APP" && $CC $CFLAGS -I. -I../../components/common -I"$HOST" \
+              "$HOST/$name.c" "$@" -o "$OUT/$name" $flags); then
+        FAILED="$FAILED $name"
+        return
+    fi
+    "$OUT/$name" || FAILED="$FAILED $name"
+}
+
+# stations name define count : name.c once per station of a simulation,
+# with define set to the station number, prints the object paths
+stations() {
+    i=0
+    while [ $i -lt $3 ]; do
+        (cd "$APP" && $CC $CFLAGS -I. -I../../components/common -I"$HOST" \
+             -D$2=$i -c "$HOST/$1.c" -o "$OUT/$1$i.o") || return 1
+        echo "$OUT/$1$i.o"
+        i=$((i + 1))
+    done
+}
+
+# simulation name station define count flags sources... : check with the
+# station objects added
+simulation() {
+    name=$1
+    if [ -n "$ONLY" ] && ! echo " $ONLY " | grep -q " $name "; then
+        return
+    fi
+    if objects=$(stations "$2" "$3" "$4"); then
+        shift 4
+        check "$name" "$@" $objects
+    else
+        FAILED="$FAILED $name"
+    fi
+}
+
+ONLY="$*"
+
+check ring_stress "-lpthread" cc1200_rx_sniff_mode_ring.c
+check frame_loopback "" cc1200_rx_sniff_mode_frame.c cc1200_rx_sniff_mode_crc.c
+check tag_bench "" cc1200_rx_sniff_mode_tag.c
+check metrics_check "" cc1200_rx_sniff_mode_metrics.c
+check fifo_crc "-DRX_FIFO_FRAME_CRC=1" cc1200_rx_sniff_mode_fifo.c cc1200_rx_sniff_mode_crc.c
+check tdma_slots "" cc1200_rx_sniff_mode_tdma.c cc1200_rx_sniff_mode_time.c
+check flog_model "-I$BSP" cc1200_rx_sniff_mode_flog.c cc1200_rx_sniff_mode_fio.c \
+    cc1200_rx_sniff_mode_crc.c cc1200_rx_sniff_mode_time.c "$HOST/flash_model.c"
+check query_check "-I$BSP -DFLOG_ENABLE=1 -DFLOG_HISTORY=1" cc1200_rx_sniff_mode_query.c \
+    cc1200_rx_sniff_mode_flog.c cc1200_rx_sniff_mode_fio.c cc1200_rx_sniff_mode_crc.c \
+    cc1200_rx_sniff_mode_time.c "$HOST/flash_model.c"
+simulation csma_sim csma_station CSMA_STATION 16 ""
+simulation relay_chain relay_station RELAY_STATION 3 "" cc1200_rx_sniff_mode_crc.c
+simulation sync_fit sync_station SYNC_STATION 2 "-lm" cc1200_rx_sniff_mode_time.c \
+    cc1200_rx_sniff_mode_crc.c
+
+if [ -n "$FAILED" ]; then
+    echo "FAILED:$FAILED"
+    exit 1
+fi
+echo "all passed"
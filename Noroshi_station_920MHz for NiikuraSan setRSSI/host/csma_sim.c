@@ -0,0 +1,249 @@
+//******************************************************************************
+//! @file       csma_sim.c
+//! @brief      Goodput against station count of the listen-before-talk
+//!             scheduler, cc1200_rx_sniff_mode_csma.c, next to stations
+//!             that send as soon as a packet is queued. Time runs in CSMA
+//!             ticks; every station offers SIM_LOAD of the channel, a
+//!             transmission takes SIM_AIR ticks and is lost when another
+//!             overlaps it. The clear channel assessment sees transmissions
+//!             started in earlier ticks, so stations starting in the same
+//!             tick collide. Fails if a lone station loses packets, if the
+//!             scheduler counters do not add up, if a packet saw more than
+//!             CSMA_MAX_BACKOFFS busy assessments, or if CSMA delivers less
+//!             than sending at once with the most stations. Run by
+//!             host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "csma_sim.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define SIM_TICKS               400000L // ~6.5 min
+#define SIM_AIR                 4       // ticks, 31 byte packet at 100 kbps
+#define SIM_LOAD                0.05    // of the channel, per station
+#define SIM_DEADLINE            (CSMA_TICK_HZ / 2)
+#define SIM_PKT_LEN             31      // length byte included
+
+#define SIM_MODE_AT_ONCE        0
+#define SIM_MODE_CSMA           1
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    long offered;
+    long delivered;
+    long ccaBusy;
+    long dropped;                       // refused, expired or given up
+    double goodput;                     // share of the channel carrying packets
+} simResult_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+extern const csmaSimStation_t csmaSimStation0, csmaSimStation1, csmaSimStation2,
+    csmaSimStation3, csmaSimStation4, csmaSimStation5, csmaSimStation6,
+    csmaSimStation7, csmaSimStation8, csmaSimStation9, csmaSimStation10,
+    csmaSimStation11, csmaSimStation12, csmaSimStation13, csmaSimStation14,
+    csmaSimStation15;
+
+static const csmaSimStation_t *const simStations[CSMA_SIM_STATIONS] = {
+    &csmaSimStation0, &csmaSimStation1, &csmaSimStation2, &csmaSimStation3,
+    &csmaSimStation4, &csmaSimStation5, &csmaSimStation6, &csmaSimStation7,
+    &csmaSimStation8, &csmaSimStation9, &csmaSimStation10, &csmaSimStation11,
+    &csmaSimStation12, &csmaSimStation13, &csmaSimStation14, &csmaSimStation15
+};
+
+
+/*******************************************************************************
+*   @fn         simRun
+*
+*   @brief      Runs n stations for SIM_TICKS. Stations sending at once keep
+*               a queue of CSMA_QUEUE_SLOTS packets and send its head
+*               whenever they are not transmitting
+*
+*   @param      n       - stations, at most CSMA_SIM_STATIONS
+*   @param      mode    - SIM_MODE_AT_ONCE or SIM_MODE_CSMA
+*   @param      pResult - output
+*
+*   @return     0 if the scheduler counters are consistent
+*/
+static int simRun(int n, int mode, simResult_t *pResult) {
+
+    const csmaSimStation_t *pSt;
+    const csmaStats_t *pStats;
+    long start[CSMA_SIM_STATIONS];
+    uint8 active[CSMA_SIM_STATIONS];
+    uint8 overlap[CSMA_SIM_STATIONS];
+    uint8 waiting[CSMA_SIM_STATIONS];   // SIM_MODE_AT_ONCE queue
+    uint8 starting[CSMA_SIM_STATIONS];
+    uint8 pkt[CSMA_PKT_MAX] = { SIM_PKT_LEN - 1 };
+    long offered[CSMA_SIM_STATIONS];
+    long t;
+    uint16 now;
+    int busy;
+    int on;
+    int i;
+
+    srand(12345);
+    pResult->offered = 0;
+    pResult->delivered = 0;
+    pResult->ccaBusy = 0;
+    pResult->dropped = 0;
+    for(i = 0; i < n; i++) {
+        simStations[i]->init((uint16)(0x1234 + 977 * i), 0);
+        active[i] = 0;
+        waiting[i] = 0;
+        offered[i] = 0;
+    }
+
+    for(t = 0; t < SIM_TICKS; t++) {
+        now = (uint16)t;
+
+        for(i = 0; i < n; i++) {
+            if(active[i] && (t == start[i] + SIM_AIR)) {
+                active[i] = 0;
+                if(!overlap[i]) {
+                    pResult->delivered++;
+                }
+                if(mode == SIM_MODE_CSMA) {
+                    simStations[i]->done(CSMA_SENT, now);
+                }
+            }
+        }
+
+        for(i = 0; i < n; i++) {
+            if(rand() >= (int)(RAND_MAX * (SIM_LOAD / SIM_AIR))) {
+                continue;
+            }
+            offered[i]++;
+            if(mode == SIM_MODE_CSMA) {
+                simStations[i]->put(pkt, SIM_PKT_LEN, (uint16)(now + SIM_DEADLINE), now);
+            } else if(waiting[i] < CSMA_QUEUE_SLOTS) {
+                waiting[i]++;
+            } else {
+                pResult->dropped++;
+            }
+        }
+
+        busy = 0;
+        for(i = 0; i < n; i++) {
+            busy |= active[i];
+        }
+        for(i = 0; i < n; i++) {
+            starting[i] = 0;
+            if(active[i]) {
+                continue;
+            }
+            if(mode == SIM_MODE_AT_ONCE) {
+                if(waiting[i]) {
+                    waiting[i]--;
+                    starting[i] = 1;
+                }
+            } else if(simStations[i]->next(now, pkt)) {
+                if(busy) {
+                    simStations[i]->done(CSMA_BUSY, now);
+                } else {
+                    starting[i] = 1;
+                }
+            }
+        }
+
+        on = 0;
+        for(i = 0; i < n; i++) {
+            if(starting[i]) {
+                active[i] = 1;
+                overlap[i] = 0;
+                start[i] = t;
+            }
+            on += active[i];
+        }
+        if(on > 1) {
+            for(i = 0; i < n; i++) {
+                overlap[i] |= active[i];
+            }
+        }
+    }
+
+    for(i = 0; i < n; i++) {
+        pResult->offered += offered[i];
+        if(mode != SIM_MODE_CSMA) {
+            continue;
+        }
+        pSt = simStations[i];
+        pStats = pSt->stats();
+        pResult->ccaBusy += pStats->ccaBusy;
+        pResult->dropped += pStats->queueFull + pStats->expired + pStats->accessFailures;
+        // A packet on the air is still queued until csmaDone
+        if((pStats->queued + pStats->queueFull != (uint32)offered[i]) ||
+           (pStats->queued != pStats->sent + pStats->expired + pStats->accessFailures +
+                              pSt->count())) {
+            printf("FAIL: station %d of %d, scheduler counters do not add up\n", i, n);
+            return 1;
+        }
+        if(pStats->maxBusyRun > CSMA_MAX_BACKOFFS) {
+            printf("FAIL: station %d of %d, %u busy assessments for one packet\n",
+                   i, n, pStats->maxBusyRun);
+            return 1;
+        }
+    }
+    pResult->goodput = (double)pResult->delivered * SIM_AIR / SIM_TICKS;
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs both modes for 1 to CSMA_SIM_STATIONS stations
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    simResult_t once;
+    simResult_t csma;
+    int n;
+
+    printf("offered load %.0f%% per station, airtime %d ticks, slot %d ticks, "
+           "%d busy assessments at most\n",
+           SIM_LOAD * 100, SIM_AIR, CSMA_SLOT_TICKS, CSMA_MAX_BACKOFFS);
+    printf("stations offered |  at once: goodput delivered |"
+           "     CSMA: goodput delivered busy/pkt dropped\n");
+
+    for(n = 1; n <= CSMA_SIM_STATIONS; n *= 2) {
+        if(simRun(n, SIM_MODE_AT_ONCE, &once) || simRun(n, SIM_MODE_CSMA, &csma)) {
+            return 1;
+        }
+        printf("%8d %6.0f%% |          %6.1f%%   %6.1f%%  |"
+               "           %6.1f%%   %6.1f%%   %5.2f  %5.1f%%\n",
+               n, n * SIM_LOAD * 100,
+               once.goodput * 100, 100.0 * once.delivered / once.offered,
+               csma.goodput * 100, 100.0 * csma.delivered / csma.offered,
+               (double)csma.ccaBusy / csma.offered, 100.0 * csma.dropped / csma.offered);
+
+        if((n == 1) && (csma.delivered + 1 < csma.offered)) {
+            printf("FAIL: a single station lost %ld packets\n", csma.offered - csma.delivered);
+            return 1;
+        }
+    }
+
+    if(csma.delivered <= once.delivered) {
+        printf("FAIL: CSMA delivers less than sending at once\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+//******************************************************************************
+//! @file       csma_sim.h
+//! @brief      Station instances for csma_sim.c. The CSMA scheduler keeps
+//!             its state in statics, so csma_station.c compiles it once per
+//!             station with CSMA_STATION set, under its own names, and
+//!             exports the entry points as one csmaSimStation_t.
+//
+//*****************************************************************************/
+
+#ifndef CSMA_SIM_H
+#define CSMA_SIM_H
+
+/******************************************************************************
+ * INCLUDES
+ */
+#include "cc1200_rx_sniff_mode_csma.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define CSMA_SIM_STATIONS       16      // csma_station.c objects built
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    void (*init)(uint16 seed, uint16 now);
+    uint8 (*put)(const uint8 *pPkt, uint8 len, uint16 deadline, uint16 now);
+    uint8 (*count)(void);
+    uint8 (*next)(uint16 now, uint8 *pPkt);
+    void (*done)(uint8 result, uint16 now);
+    const csmaStats_t *(*stats)(void);
+} csmaSimStation_t;
+
+#endif
@@ -0,0 +1,48 @@
+//******************************************************************************
+//! @file       csma_station.c
+//! @brief      One station of csma_sim.c: the CSMA scheduler,
+//!             cc1200_rx_sniff_mode_csma.c, with its functions renamed after
+//!             CSMA_STATION and exported as csmaSimStation<CSMA_STATION>.
+//!             host/build.sh compiles it once per station.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#ifndef CSMA_STATION
+#error "Set CSMA_STATION to the station number"
+#endif
+
+#define CSMA_PASTE(a, b)        a##b
+#define CSMA_NAME(a, b)         CSMA_PASTE(a, b)
+
+#define csmaInit                CSMA_NAME(csmaInit, CSMA_STATION)
+#define csmaQueuePut            CSMA_NAME(csmaQueuePut, CSMA_STATION)
+#define csmaQueueCount          CSMA_NAME(csmaQueueCount, CSMA_STATION)
+#define csmaDue                 CSMA_NAME(csmaDue, CSMA_STATION)
+#define csmaNext                CSMA_NAME(csmaNext, CSMA_STATION)
+#define csmaDone                CSMA_NAME(csmaDone, CSMA_STATION)
+#define csmaTake                CSMA_NAME(csmaTake, CSMA_STATION)
+#define csmaGetStats            CSMA_NAME(csmaGetStats, CSMA_STATION)
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include "cc1200_rx_sniff_mode_csma.c"
+#include "csma_sim.h"
+
+
+/*******************************************************************************
+* GLOBAL VARIABLES
+*/
+const csmaSimStation_t CSMA_NAME(csmaSimStation, CSMA_STATION) = {
+    csmaInit,
+    csmaQueuePut,
+    csmaQueueCount,
+    csmaNext,
+    csmaDone,
+    csmaGetStats
+};
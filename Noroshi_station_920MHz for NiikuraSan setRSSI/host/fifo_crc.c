@@ -0,0 +1,139 @@
+//******************************************************************************
+//! @file       fifo_crc.c
+//! @brief      Host check of the station frame CRC-16, built with
+//!             RX_FIFO_FRAME_CRC = 1 and the software CRC of
+//!             cc1200_rx_sniff_mode_crc.c. The CRC must give the CCITT check
+//!             value and the same result when chained piece by piece.
+//!             Station frames sealed the way the TX app does are put into
+//!             FIFO images with their status bytes; rxFifoParse has to keep
+//!             the good ones, drop each one with a changed byte as a frame
+//!             CRC error, and pass packets of other lengths unchecked. Run
+//!             by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define CHECK_ROUNDS            20000
+#define CHECK_OTHER_LEN         13      // tag packet, not a station frame
+#define CHECK_CCITT_VALUE       0x29B1  // CRC-16/CCITT-FALSE of "123456789"
+
+#if !RX_FIFO_FRAME_CRC
+#error "Build with -DRX_FIFO_FRAME_CRC=1"
+#endif
+
+
+/*******************************************************************************
+*   @fn         putPacket
+*
+*   @brief      Appends a packet with good radio status bytes to an image
+*
+*   @param      pImage - FIFO image
+*   @param      pLen   - bytes in it, updated
+*   @param      pPkt   - packet, length byte first
+*
+*   @return     none
+*/
+static void putPacket(uint8 *pImage, uint8 *pLen, const uint8 *pPkt) {
+
+    uint8 len = pPkt[0] + 1;
+
+    memcpy(&pImage[*pLen], pPkt, len);
+    pImage[*pLen + len] = 0xC0;                     // RSSI
+    pImage[*pLen + len + 1] = RX_FIFO_CRC_OK_BM;    // CRC_OK, LQI
+    *pLen += len + RX_FIFO_STATUS_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs the checks
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    const uint8 *pDigits = (const uint8 *)"123456789";
+    uint8 frame[RX_FIFO_STATION_LEN];
+    uint8 other[CHECK_OTHER_LEN];
+    uint8 image[RX_FIFO_SIZE];
+    rxPacket_t pool[RX_FIFO_POOL_SIZE];
+    const rxFifoStats_t *pStats;
+    unsigned long kept = 0;
+    unsigned long corrupted = 0;
+    uint8 imageLen;
+    uint8 stored;
+    uint8 pos;
+    uint16 crc;
+    int k;
+    int i;
+
+    crc = crc16Update(CRC16_INIT, pDigits, 9);
+    if((crc != CHECK_CCITT_VALUE) ||
+       (crc16Update(crc16Update(CRC16_INIT, pDigits, 4), pDigits + 4, 5) != crc)) {
+        printf("FAIL: CRC %04X\n", crc);
+        return 1;
+    }
+
+    rxFifoInit();
+    srand(8);
+    for(k = 0; k < CHECK_ROUNDS; k++) {
+        // Station frame as createPacket builds it
+        frame[0] = RX_FIFO_STATION_LEN - 1;
+        for(i = 1; i < RX_FIFO_POS_CRC; i++) {
+            frame[i] = (uint8)rand();
+        }
+        crc16Append(frame, RX_FIFO_POS_CRC);
+        if(!crc16Check(frame, RX_FIFO_STATION_LEN)) {
+            printf("FAIL: sealed frame does not check\n");
+            return 1;
+        }
+        if(k % 3 == 0) {
+            pos = (uint8)(1 + rand() % (RX_FIFO_STATION_LEN - 1));
+            frame[pos] ^= (uint8)(1 + rand() % 255);
+            corrupted++;
+        } else {
+            kept++;
+        }
+
+        other[0] = CHECK_OTHER_LEN - 1;
+        for(i = 1; i < CHECK_OTHER_LEN; i++) {
+            other[i] = (uint8)rand();
+        }
+
+        imageLen = 0;
+        putPacket(image, &imageLen, other);
+        putPacket(image, &imageLen, frame);
+        stored = rxFifoParse(image, imageLen, pool, RX_FIFO_POOL_SIZE);
+        if((stored != ((k % 3 == 0) ? 1 : 2)) ||
+           (pool[0].len != CHECK_OTHER_LEN) || memcmp(pool[0].data, other, CHECK_OTHER_LEN) ||
+           ((stored == 2) && memcmp(pool[1].data, frame, RX_FIFO_STATION_LEN))) {
+            printf("FAIL: round %d stored %u\n", k, stored);
+            return 1;
+        }
+    }
+
+    pStats = rxFifoGetStats();
+    printf("frames kept %lu, corrupted %lu; parser: packets %lu, frame CRC errors %lu\n",
+           kept, corrupted, (unsigned long)pStats->packets, (unsigned long)pStats->frameCrcErrors);
+    if((pStats->frameCrcErrors != corrupted) || (pStats->packets != kept + CHECK_ROUNDS)) {
+        printf("FAIL: counters do not add up\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,442 @@
+//******************************************************************************
+//! @file       flash_model.c
+//! @brief      RAM model of the M25PE20 SPI flash, see flash_model.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "flash_model.h"
+#include "spi_bus.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define FM_OP_NONE              0
+#define FM_OP_READ              1
+#define FM_OP_PROGRAM           2
+#define FM_OP_WRITE             3
+#define FM_OP_ERASE             4
+
+#define FM_PHASE_IDLE           0
+#define FM_PHASE_XFER           1       // bytes moving, callback at the end
+#define FM_PHASE_WIP            2       // program, write or erase running
+
+#define FM_HDR_LEN              4       // instruction and 3 address bytes
+#define FM_FRAC_HZ              32768UL
+
+// One byte per USCI_B2 interrupt, ~1.6 ms a page as flog.h estimates
+#define FM_BYTE_NS              6250UL
+
+// Busy times in 1/32768 s, M25PE20 datasheet typical and maximum
+#define FM_PROGRAM_TYP          26      // 0.8 ms
+#define FM_PROGRAM_MAX          164     // 5 ms
+#define FM_WRITE_TYP            360     // 11 ms
+#define FM_WRITE_MAX            819     // 25 ms
+#define FM_ERASE_TYP            1638    // 50 ms
+#define FM_ERASE_MAX            4915    // 150 ms
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint8 fmMemory[FLASH_MODEL_BYTES];
+
+static uint8 fmOp;
+static uint8 fmPhase;
+static uint32 fmAddr;
+static uint8 *fmpData;
+static uint16 fmLen;
+static uint8 fmBuf[FLASH_PAGE_SIZE];    // bytes shifted in for a program
+static flashCallback_t fmpfnDone;
+static uint32 fmNow;
+static uint32 fmEnd;                    // of the transfer or the busy time
+static uint32 fmRandom;
+
+static flashModelStats_t fmStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 fmStart(uint8 op, uint32 addr, uint8 *pData, uint16 len,
+                     flashCallback_t pfnDone);
+static void fmApply(uint16 len);
+static uint32 fmBusyTime(uint32 typ, uint32 max);
+
+
+/*******************************************************************************
+*   @fn         flashModelInit
+*
+*   @brief      Erases the whole flash and stops any command
+*
+*   @param      none
+*
+*   @return     none
+*/
+void flashModelInit(void) {
+
+    memset(fmMemory, 0xFF, sizeof(fmMemory));
+    fmOp = FM_OP_NONE;
+    fmPhase = FM_PHASE_IDLE;
+    fmNow = 0;
+    fmRandom = 12345;
+    memset(&fmStats, 0, sizeof(fmStats));
+}
+
+
+/*******************************************************************************
+*   @fn         flashModelRun
+*
+*   @brief      Moves the model on to a time: ends the transfer and calls its
+*               callback, as the SPI interrupt would, and ends the busy time
+*
+*   @param      now - 1/32768 s, never smaller than the last call's
+*
+*   @return     none
+*/
+void flashModelRun(uint32 now) {
+
+    fmNow = now;
+    if((fmPhase == FM_PHASE_XFER) && ((int32)(now - fmEnd) >= 0)) {
+        switch(fmOp) {
+        case FM_OP_READ:
+            memcpy(fmpData, &fmMemory[fmAddr], fmLen);
+            fmPhase = FM_PHASE_IDLE;
+            break;
+        case FM_OP_PROGRAM:
+            memcpy(fmBuf, fmpData, fmLen);
+            fmPhase = FM_PHASE_WIP;
+            fmEnd = now + fmBusyTime(FM_PROGRAM_TYP, FM_PROGRAM_MAX);
+            break;
+        case FM_OP_WRITE:
+            memcpy(fmBuf, fmpData, fmLen);
+            fmPhase = FM_PHASE_WIP;
+            fmEnd = now + fmBusyTime(FM_WRITE_TYP, FM_WRITE_MAX);
+            break;
+        default:
+            fmPhase = FM_PHASE_WIP;
+            fmEnd = now + fmBusyTime(FM_ERASE_TYP, FM_ERASE_MAX);
+            break;
+        }
+        if(fmpfnDone != NULL) {
+            fmpfnDone();
+        }
+    }
+    if((fmPhase == FM_PHASE_WIP) && ((int32)(now - fmEnd) >= 0)) {
+        fmApply(fmLen);
+        fmPhase = FM_PHASE_IDLE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flashModelPowerLoss
+*
+*   @brief      Cuts the power: a transfer is lost, a program or page write
+*               keeps only its first half, an erase clears only the first
+*               half of the sub-sector
+*
+*   @param      none
+*
+*   @return     none
+*/
+void flashModelPowerLoss(void) {
+
+    if(fmPhase == FM_PHASE_WIP) {
+        if(fmOp == FM_OP_ERASE) {
+            memset(&fmMemory[fmAddr], 0xFF, FLASH_SUBSECTOR_SIZE / 2);
+        } else {
+            fmApply(fmLen / 2);
+        }
+        fmStats.cut++;
+    } else if(fmPhase == FM_PHASE_XFER) {
+        fmStats.cut++;
+    }
+    fmOp = FM_OP_NONE;
+    fmPhase = FM_PHASE_IDLE;
+}
+
+
+/*******************************************************************************
+*   @fn         flashModelIdle
+*
+*   @brief      Checks whether no transfer runs and the flash is not busy
+*
+*   @param      none
+*
+*   @return     TRUE if idle
+*/
+uint8 flashModelIdle(void) {
+
+    return fmPhase == FM_PHASE_IDLE;
+}
+
+
+/*******************************************************************************
+*   @fn         flashModelMemory
+*
+*   @brief      Returns the flash contents, FLASH_MODEL_BYTES
+*
+*   @param      none
+*
+*   @return     pointer to the bytes
+*/
+uint8 *flashModelMemory(void) {
+
+    return fmMemory;
+}
+
+
+/*******************************************************************************
+*   @fn         flashModelGetStats
+*
+*   @brief      Returns the model counters, the caller may clear them
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+flashModelStats_t *flashModelGetStats(void) {
+
+    return &fmStats;
+}
+
+
+/*******************************************************************************
+*   @fn         flashRead
+*
+*   @brief      Blocking read of the driver, used by flogInit
+*
+*   @param      ui32Addr  - flash byte address
+*   @param      pui8Data  - output
+*   @param      ui32Bytes - bytes
+*
+*   @return     bytes read
+*/
+uint32_t flashRead(uint32_t ui32Addr, uint8_t *pui8Data, uint32_t ui32Bytes) {
+
+    if(fmPhase != FM_PHASE_IDLE) {
+        fmStats.busyStarts++;
+    }
+    if(ui32Addr + ui32Bytes > FLASH_MODEL_BYTES) {
+        return 0;
+    }
+    memcpy(pui8Data, &fmMemory[ui32Addr], ui32Bytes);
+    fmStats.reads++;
+    fmStats.readBytes += ui32Bytes;
+    return ui32Bytes;
+}
+
+
+/*******************************************************************************
+*   @fn         flashReadStart
+*
+*   @brief      Read on the SPI interrupt, as the driver's
+*
+*   @param      ui32Addr  - flash byte address
+*   @param      pui8Data  - output, filled at the end of the transfer
+*   @param      ui16Bytes - bytes
+*   @param      pfnDone   - called at the end of the transfer
+*
+*   @return     0 when started, 1 if ui16Bytes is 0
+*/
+uint8_t flashReadStart(uint32_t ui32Addr, uint8_t *pui8Data,
+                       uint16_t ui16Bytes, flashCallback_t pfnDone) {
+
+    if((ui16Bytes == 0) || (ui32Addr + ui16Bytes > FLASH_MODEL_BYTES)) {
+        return 1;
+    }
+    fmStats.reads++;
+    fmStats.readBytes += ui16Bytes;
+    return fmStart(FM_OP_READ, ui32Addr, pui8Data, ui16Bytes, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         flashPageProgramStart
+*
+*   @brief      Page program on the SPI interrupt, as the driver's
+*
+*   @param      ui16Page  - flash page
+*   @param      pui8Data  - bytes
+*   @param      ui16Bytes - bytes, 1..256
+*   @param      pfnDone   - called at the end of the transfer
+*
+*   @return     0 when started, 1 if ui16Bytes is invalid
+*/
+uint8_t flashPageProgramStart(uint16_t ui16Page, uint8_t *pui8Data,
+                              uint16_t ui16Bytes, flashCallback_t pfnDone) {
+
+    if((ui16Bytes == 0) || (ui16Bytes > FLASH_PAGE_SIZE) || (ui16Page >= FLASH_MODEL_PAGES)) {
+        return 1;
+    }
+    fmStats.programs++;
+    return fmStart(FM_OP_PROGRAM, FLASH_PAGE_TO_ADDR(ui16Page), pui8Data, ui16Bytes, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         flashPageWriteStart
+*
+*   @brief      Page write on the SPI interrupt, as the driver's
+*
+*   @param      ui16Page  - flash page
+*   @param      pui8Data  - bytes
+*   @param      ui16Bytes - bytes, 1..256
+*   @param      pfnDone   - called at the end of the transfer
+*
+*   @return     0 when started, 1 if ui16Bytes is invalid
+*/
+uint8_t flashPageWriteStart(uint16_t ui16Page, uint8_t *pui8Data,
+                            uint16_t ui16Bytes, flashCallback_t pfnDone) {
+
+    if((ui16Bytes == 0) || (ui16Bytes > FLASH_PAGE_SIZE) || (ui16Page >= FLASH_MODEL_PAGES)) {
+        return 1;
+    }
+    fmStats.writes++;
+    return fmStart(FM_OP_WRITE, FLASH_PAGE_TO_ADDR(ui16Page), pui8Data, ui16Bytes, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         flashSubSectorEraseStart
+*
+*   @brief      Sub-sector erase on the SPI interrupt, as the driver's
+*
+*   @param      ui8SubSector - sub-sector of 16 pages
+*   @param      pfnDone      - called at the end of the transfer
+*
+*   @return     0 when started, 1 if past the device
+*/
+uint8_t flashSubSectorEraseStart(uint8_t ui8SubSector, flashCallback_t pfnDone) {
+
+    if(FLASH_SUBSECTOR_TO_ADDR(ui8SubSector) >= FLASH_MODEL_BYTES) {
+        return 1;
+    }
+    fmStats.erases++;
+    return fmStart(FM_OP_ERASE, FLASH_SUBSECTOR_TO_ADDR(ui8SubSector), NULL, 0, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         flashWriteInProgress
+*
+*   @brief      Status register WIP bit
+*
+*   @param      none
+*
+*   @return     1 while the flash is busy, 0 when it is ready
+*/
+uint8_t flashWriteInProgress(void) {
+
+    return (fmPhase == FM_PHASE_WIP) ? 1 : 0;
+}
+
+
+/*******************************************************************************
+*   @fn         spiBusBusy
+*
+*   @brief      The flash has the bus to itself
+*
+*   @param      none
+*
+*   @return     0
+*/
+uint8_t spiBusBusy(void) {
+
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         fmStart
+*
+*   @brief      Starts the transfer of a command
+*
+*   @param      op      - FM_OP_*
+*   @param      addr    - flash byte address
+*   @param      pData   - bytes in or out
+*   @param      len     - bytes
+*   @param      pfnDone - called at the end of the transfer
+*
+*   @return     0
+*/
+static uint8 fmStart(uint8 op, uint32 addr, uint8 *pData, uint16 len,
+                     flashCallback_t pfnDone) {
+
+    uint32 xfer = ((FM_HDR_LEN + len) * FM_BYTE_NS * FM_FRAC_HZ + 999999999UL) / 1000000000UL;
+
+    if(fmPhase != FM_PHASE_IDLE) {
+        fmStats.busyStarts++;
+    }
+    fmOp = op;
+    fmPhase = FM_PHASE_XFER;
+    fmAddr = addr;
+    fmpData = pData;
+    fmLen = len;
+    fmpfnDone = pfnDone;
+    fmEnd = fmNow + xfer;
+    fmStats.xferFrac += xfer;
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         fmApply
+*
+*   @brief      Puts the first bytes of the running program, page write or
+*               erase into the memory. A program past the end of the page
+*               wraps to its start, as on the device
+*
+*   @param      len - bytes of fmBuf applied
+*
+*   @return     none
+*/
+static void fmApply(uint16 len) {
+
+    uint32 page = fmAddr & ~(uint32)(FLASH_PAGE_SIZE - 1);
+    uint16 i;
+    uint8 *pByte;
+
+    switch(fmOp) {
+    case FM_OP_PROGRAM:
+        for(i = 0; i < len; i++) {
+            pByte = &fmMemory[page + ((fmAddr + i) & (FLASH_PAGE_SIZE - 1))];
+            if((*pByte & fmBuf[i]) != fmBuf[i]) {
+                fmStats.dirtyPrograms++;
+            }
+            *pByte &= fmBuf[i];
+        }
+        break;
+    case FM_OP_WRITE:
+        memset(&fmMemory[page], 0xFF, FLASH_PAGE_SIZE);
+        memcpy(&fmMemory[page], fmBuf, len);
+        break;
+    case FM_OP_ERASE:
+        memset(&fmMemory[fmAddr], 0xFF, FLASH_SUBSECTOR_SIZE);
+        break;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         fmBusyTime
+*
+*   @brief      Draws a busy time, the model's own generator so the callers'
+*               rand() sequence is not disturbed
+*
+*   @param      typ - typical time
+*   @param      max - maximum time
+*
+*   @return     1/32768 s between typ and max
+*/
+static uint32 fmBusyTime(uint32 typ, uint32 max) {
+
+    fmRandom = fmRandom * 1103515245UL + 12345;
+    return typ + ((fmRandom >> 16) % (max - typ + 1));
+}
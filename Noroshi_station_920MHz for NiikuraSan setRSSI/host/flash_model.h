@@ -0,0 +1,60 @@
+//******************************************************************************
+//! @file       flash_model.h
+//! @brief      RAM model of the M25PE20 SPI flash for flog_model.c and
+//!             query_check.c. It stands in for the TrxEB flash driver under
+//!             cc1200_rx_sniff_mode_fio.c: the *Start calls move their bytes
+//!             at ~6 us each, one USCI_B2 interrupt per byte at 8 MHz SPI,
+//!             and call back at the end of the transfer, then the flash
+//!             stays busy for a program, page write or sub-sector erase time
+//!             drawn between the datasheet's typical and maximum.
+//!             Page program only clears bits, page write replaces the page,
+//!             erase sets 4 kB to 0xFF. A power loss leaves the running
+//!             command half done. The SPI bus is never shared.
+//
+//*****************************************************************************/
+
+#ifndef FLASH_MODEL_H
+#define FLASH_MODEL_H
+
+/******************************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+#include "hal_types.h"
+#include "flash_m25pex0.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define FLASH_MODEL_PAGES       1024
+#define FLASH_MODEL_BYTES       ((uint32)FLASH_MODEL_PAGES * FLASH_PAGE_SIZE)
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 reads;
+    uint32 readBytes;
+    uint32 programs;
+    uint32 writes;
+    uint32 erases;
+    uint32 xferFrac;                    // 1/32768 s the SPI moved bytes
+    uint32 dirtyPrograms;               // programs that needed a 0 bit set
+    uint32 busyStarts;                  // commands started while busy
+    uint32 cut;                         // commands cut by a power loss
+} flashModelStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void flashModelInit(void);
+void flashModelRun(uint32 now);
+void flashModelPowerLoss(void);
+uint8 flashModelIdle(void);
+uint8 *flashModelMemory(void);
+flashModelStats_t *flashModelGetStats(void);
+
+#endif
@@ -0,0 +1,473 @@
+//******************************************************************************
+//! @file       flog_model.c
+//! @brief      Host simulation of the flash log, cc1200_rx_sniff_mode_flog.c
+//!             over cc1200_rx_sniff_mode_fio.c and the RAM flash of
+//!             flash_model.c. The main loop runs every 1/32768 s as rx.c's
+//!             does: fioPoll when fioReady, flogTask when flogReady, tag
+//!             records put to the uplink as uplinkPut does, and a gateway
+//!             that takes records from the ring, then from flogGet, at a
+//!             fixed rate while the link is up. Each run starts with the
+//!             link down. Fails if a record comes back changed, twice or out
+//!             of order, if one is lost without a reason, if flogReady
+//!             stays TRUE after flogTask, or if the log programs a page that
+//!             is not erased. An overflow may only lose records of the
+//!             outage, in the pages the log counts as lost; a power loss
+//!             only the records not yet on the flash, and
+//!             replay may then resume up to FLOG_CURSOR_SAVE_PAGES early.
+//!             One run keeps the fio queue full with reads of another
+//!             client. Run by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_flog.h"
+#include "cc1200_rx_sniff_mode_fio.h"
+#include "cc1200_rx_sniff_mode_ring.h"
+#include "cc1200_rx_sniff_mode_tag.h"
+#include "flash_model.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define SIM_FRAC_HZ             32768UL
+#define SIM_EPOCH               1700000000UL
+#define SIM_REC_LEN             17      // bytes, length byte included
+#define SIM_POS_SEQ             (TAG_POS_ID + TAG_ID_LEN)
+#define SIM_TAGS                200
+#define SIM_RECORDS_MAX         25000
+#define SIM_SPILL_LEVEL         (RX_RING_SLOTS / 2)
+#define SIM_CUTS_MAX            4
+
+// Records of SIM_REC_LEN in a page, and the most replay may resume early
+#define SIM_PAGE_RECORDS        (FLOG_RECORDS_MAX / (FLOG_REC_POS_DATA + SIM_REC_LEN))
+#define SIM_EARLY_MAX           ((FLOG_CURSOR_SAVE_PAGES + 1) * SIM_PAGE_RECORDS)
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    const char *pName;
+    long records;
+    uint32 rate;                        // records per second
+    uint32 downS;                       // link down from the start
+    uint32 drain;                       // records per second, link up
+    uint8 overflow;                     // the outage overruns the ring
+    uint8 readers;                      // another client fills the fio queue
+    uint32 cutS[SIM_CUTS_MAX];          // power losses, 0 ends the list
+} simCase_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static const simCase_t simCases[] = {
+    { "steady",   25000, 100, 60,  300, 0, 0, { 0 } },
+    { "overflow", 25000, 100, 150, 300, 1, 0, { 0 } },
+    { "reboot",   25000, 100, 60,  300, 0, 0, { 30, 75, 110, 200 } },
+    { "shared",   25000, 100, 60,  300, 0, 1, { 0 } }
+};
+
+static rxPacket_t simRing[RX_RING_SLOTS];
+static uint8 simRingHead;
+static uint8 simRingCount;
+
+static uint32 simGenTick[SIM_RECORDS_MAX];
+static uint8 simSeen[SIM_RECORDS_MAX];
+static long simLast;
+static long simDelivered;
+static long simDuplicates;
+static long simReordered;
+static long simDamaged;
+static long simEarly;                   // most records replayed again
+static uint8 simRebooted;               // replay may resume before simLast
+
+static uint8 simReadBuf[FIO_QUEUE_LEN][FLOG_PAGE_SIZE];
+static uint8 simReads;                  // queued by the other client
+
+
+/*******************************************************************************
+*   @fn         simMakeRecord
+*
+*   @brief      Builds tag record seq: TagID from SIM_TAGS, the sequence
+*               number after it, the UTC time it was heard
+*
+*   @param      seq     - record number
+*   @param      tick    - 1/32768 s since the start
+*   @param      pPacket - output
+*
+*   @return     none
+*/
+static void simMakeRecord(long seq, uint32 tick, rxPacket_t *pPacket) {
+
+    uint32 tagId = 0x00A10000UL + (uint32)(seq % SIM_TAGS);
+
+    memset(pPacket, 0, sizeof(*pPacket));
+    pPacket->len = SIM_REC_LEN;
+    pPacket->data[0] = SIM_REC_LEN - 1;
+    pPacket->data[TAG_POS_ID] = (uint8)(tagId >> 24);
+    pPacket->data[TAG_POS_ID + 1] = (uint8)(tagId >> 16);
+    pPacket->data[TAG_POS_ID + 2] = (uint8)(tagId >> 8);
+    pPacket->data[TAG_POS_ID + 3] = (uint8)tagId;
+    pPacket->data[SIM_POS_SEQ] = (uint8)(seq >> 16);
+    pPacket->data[SIM_POS_SEQ + 1] = (uint8)(seq >> 8);
+    pPacket->data[SIM_POS_SEQ + 2] = (uint8)seq;
+    pPacket->channel = (uint8)(seq % 5);
+    pPacket->stamp.sec = SIM_EPOCH + tick / SIM_FRAC_HZ;
+    pPacket->stamp.frac = (uint16)(tick % SIM_FRAC_HZ);
+}
+
+
+/*******************************************************************************
+*   @fn         simDeliver
+*
+*   @brief      Gateway: checks a record against the one that was made
+*
+*   @param      pPacket - record from the ring or the log
+*
+*   @return     none
+*/
+static void simDeliver(const rxPacket_t *pPacket) {
+
+    rxPacket_t made;
+    long seq = ((long)pPacket->data[SIM_POS_SEQ] << 16) |
+               ((long)pPacket->data[SIM_POS_SEQ + 1] << 8) | pPacket->data[SIM_POS_SEQ + 2];
+
+    if(seq >= SIM_RECORDS_MAX) {
+        simDamaged++;
+        return;
+    }
+    simMakeRecord(seq, simGenTick[seq], &made);
+    if((pPacket->len != made.len) || memcmp(pPacket->data, made.data, made.len) ||
+       (pPacket->channel != made.channel) || (pPacket->stamp.sec != made.stamp.sec) ||
+       (pPacket->stamp.frac != made.stamp.frac)) {
+        simDamaged++;
+        return;
+    }
+
+    if(simSeen[seq]) {
+        simDuplicates++;
+    } else {
+        simSeen[seq] = 1;
+        simDelivered++;
+    }
+    if(seq <= simLast) {
+        if(simRebooted) {
+            if(simLast - seq + 1 > simEarly) {
+                simEarly = simLast - seq + 1;
+            }
+        } else {
+            simReordered++;
+        }
+    }
+    simRebooted = FALSE;
+    simLast = seq;
+}
+
+
+/*******************************************************************************
+*   @fn         simPut
+*
+*   @brief      uplinkPut of rx.c: to the log while it holds older records,
+*               the link is down or the ring is backed up, else to the ring
+*
+*   @param      pPacket - record
+*   @param      sec     - uptime seconds
+*   @param      linkUp  - gateway there
+*
+*   @return     TRUE if queued
+*/
+static uint8 simPut(const rxPacket_t *pPacket, uint32 sec, uint8 linkUp) {
+
+    if(flogPending() || !linkUp || (simRingCount >= SIM_SPILL_LEVEL)) {
+        if(flogAppend(pPacket, sec, FALSE)) {
+            return TRUE;
+        }
+    }
+    if(simRingCount >= RX_RING_SLOTS) {
+        return FALSE;
+    }
+    simRing[(simRingHead + simRingCount) % RX_RING_SLOTS] = *pPacket;
+    simRingCount++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         simAddStats
+*
+*   @brief      Adds the log counters of one boot to the run's
+*
+*   @param      pTotal - run counters
+*
+*   @return     none
+*/
+static void simAddStats(flogStats_t *pTotal) {
+
+    const flogStats_t *pStats = flogGetStats();
+
+    pTotal->pagesWritten += pStats->pagesWritten;
+    pTotal->erases += pStats->erases;
+    pTotal->cursorWrites += pStats->cursorWrites;
+    pTotal->lostPages += pStats->lostPages;
+    pTotal->badPages += pStats->badPages;
+    pTotal->badRecords += pStats->badRecords;
+    pTotal->flashErrors += pStats->flashErrors;
+}
+
+
+/*******************************************************************************
+*   @fn         simReadDone
+*
+*   @brief      A read of the other client is done
+*
+*   @param      result - FIO_OK, FIO_TIMEOUT or FIO_FAILED
+*
+*   @return     none
+*/
+static void simReadDone(uint8 result) {
+
+    (void)result;
+    simReads--;
+}
+
+
+/*******************************************************************************
+*   @fn         simRun
+*
+*   @brief      Runs a case until every record was made and the log is
+*               empty, then prints a row
+*
+*   @param      pCase - rates, outage, power losses
+*
+*   @return     0 if passed
+*/
+static int simRun(const simCase_t *pCase) {
+
+    flogStats_t total;
+    flashModelStats_t *pFlash;
+    rxPacket_t packet;
+    uint32 interval = SIM_FRAC_HZ / pCase->rate;
+    uint32 upTick = pCase->downS * SIM_FRAC_HZ;
+    uint32 stop = (uint32)pCase->records * interval + 600 * SIM_FRAC_HZ;
+    uint32 bootTick = 0;
+    uint32 cutTick[SIM_CUTS_MAX];
+    uint32 credit = 0;
+    uint32 tick;
+    uint32 sec;
+    long made = 0;
+    long dropped = 0;
+    long missing = 0;
+    long unexplained = 0;
+    long spins = 0;
+    long full = 0;
+    long seq;
+    uint8 cuts = 0;
+    uint8 planned = 0;
+    uint8 linkUp;
+    int i;
+
+    while((planned < SIM_CUTS_MAX) && (pCase->cutS[planned] > 0)) {
+        planned++;
+    }
+    memset(&total, 0, sizeof(total));
+    flashModelInit();
+    fioInit();
+    flogInit();
+    memset(simSeen, 0, sizeof(simSeen));
+    simRingHead = 0;
+    simRingCount = 0;
+    simLast = -1;
+    simDelivered = 0;
+    simDuplicates = 0;
+    simReordered = 0;
+    simDamaged = 0;
+    simEarly = 0;
+    simRebooted = FALSE;
+    simReads = 0;
+
+    for(tick = 0; tick < stop; tick++) {
+        sec = (tick - bootTick) / SIM_FRAC_HZ;
+        linkUp = (tick >= upTick);
+
+        // Power loss, while the flash works if it does within a second:
+        // RAM is gone, the flash keeps what it has
+        if((cuts < SIM_CUTS_MAX) && (pCase->cutS[cuts] > 0) &&
+           (tick >= pCase->cutS[cuts] * SIM_FRAC_HZ) &&
+           (!flashModelIdle() || (tick >= (pCase->cutS[cuts] + 1) * SIM_FRAC_HZ))) {
+            cutTick[cuts++] = tick;
+            flashModelPowerLoss();
+            simAddStats(&total);
+            simRingCount = 0;
+            credit = 0;
+            bootTick = tick;
+            sec = 0;
+            fioInit();
+            flogInit();
+            simRebooted = TRUE;
+        }
+
+        flashModelRun(tick);
+        if(fioReady((uint16)tick)) {
+            fioPoll((uint16)tick);
+        }
+        // The other client, as a query in rx.c before flogTask: a burst of
+        // reads that fills the queue, the next once all are done
+        if(pCase->readers && (simReads == 0)) {
+            while(fioRead((uint32)(rand() % FLASH_MODEL_PAGES) * FLOG_PAGE_SIZE,
+                          simReadBuf[simReads], FLOG_PAGE_SIZE, &simReadDone)) {
+                simReads++;
+            }
+        }
+        if(fioFull()) {
+            full++;
+        }
+        if(flogReady(sec)) {
+            flogTask(sec);
+            if(flogReady(sec)) {
+                spins++;
+            }
+        }
+
+        if((made < pCase->records) && (tick == (uint32)made * interval)) {
+            simGenTick[made] = tick;
+            simMakeRecord(made, tick, &packet);
+            if(!simPut(&packet, sec, linkUp)) {
+                dropped++;
+            }
+            made++;
+        }
+
+        // Gateway, ring first, then the log
+        if(linkUp) {
+            credit += pCase->drain;
+        }
+        while(credit >= SIM_FRAC_HZ) {
+            if(simRingCount > 0) {
+                simDeliver(&simRing[simRingHead]);
+                simRingHead = (simRingHead + 1) % RX_RING_SLOTS;
+                simRingCount--;
+            } else if(flogGet(&packet)) {
+                simDeliver(&packet);
+            } else {
+                credit = 0;
+                break;
+            }
+            credit -= SIM_FRAC_HZ;
+        }
+
+        if((made == pCase->records) && (tick > upTick) && !flogPending() &&
+           !flogReady(sec) && (simRingCount == 0) &&
+           (pCase->readers || (!fioBusy() && flashModelIdle()))) {
+            break;
+        }
+    }
+
+    // Losses: records of the outage on an overflow, else only what was in
+    // RAM at a power loss, collected in the last FLOG_FLUSH_S or programmed
+    // then
+    for(seq = 0; seq < made; seq++) {
+        if(simSeen[seq]) {
+            continue;
+        }
+        missing++;
+        if(pCase->overflow) {
+            unexplained += (simGenTick[seq] >= upTick);
+            continue;
+        }
+        for(i = 0; i < cuts; i++) {
+            if((simGenTick[seq] <= cutTick[i]) &&
+               (cutTick[i] - simGenTick[seq] <= (FLOG_FLUSH_S + 1) * SIM_FRAC_HZ)) {
+                break;
+            }
+        }
+        unexplained += (i == cuts);
+    }
+
+    simAddStats(&total);
+    pFlash = flashModelGetStats();
+    printf("%-8s  %5ld  %5ld  %5ld  %4ld  %5ld  %5lu  %4lu  %4lu  %4lu  %4u  %5.1f s\n",
+           pCase->pName, made, simDelivered, missing, simDuplicates, simEarly,
+           (unsigned long)total.pagesWritten, (unsigned long)total.erases,
+           (unsigned long)total.cursorWrites, (unsigned long)total.lostPages,
+           (unsigned int)cuts, (double)tick / SIM_FRAC_HZ);
+
+    if((simDamaged > 0) || (simReordered > 0) || (unexplained > 0) || (dropped > 0)) {
+        printf("FAIL: %ld damaged, %ld out of order, %ld lost, %ld dropped\n",
+               simDamaged, simReordered, unexplained, dropped);
+        return 1;
+    }
+    if((simDuplicates > 0) && (cuts == 0)) {
+        printf("FAIL: %ld records replayed twice without a power loss\n", simDuplicates);
+        return 1;
+    }
+    if(simEarly > SIM_EARLY_MAX) {
+        printf("FAIL: replay resumed %ld records early, at most %d\n", simEarly, SIM_EARLY_MAX);
+        return 1;
+    }
+    if(pCase->overflow && (missing > (long)total.lostPages * SIM_PAGE_RECORDS)) {
+        printf("FAIL: %ld records lost in %lu lost pages\n",
+               missing, (unsigned long)total.lostPages);
+        return 1;
+    }
+    if(pCase->overflow && (missing == 0)) {
+        printf("FAIL: the outage did not overrun the log\n");
+        return 1;
+    }
+    if(cuts != planned) {
+        printf("FAIL: %u of %u power losses\n", (unsigned int)cuts, (unsigned int)planned);
+        return 1;
+    }
+    if(spins > 0) {
+        printf("FAIL: flogReady still TRUE after flogTask %ld times\n", spins);
+        return 1;
+    }
+    if(pCase->readers && (full == 0)) {
+        printf("FAIL: the other client never filled the fio queue\n");
+        return 1;
+    }
+    if((pFlash->dirtyPrograms > 0) || (pFlash->busyStarts > 0) ||
+       (total.badRecords > 0) || (total.badPages > cuts) || (total.flashErrors > 0)) {
+        printf("FAIL: %lu programs of unerased bytes, %lu commands while busy, "
+               "%lu bad pages, %lu flash errors\n",
+               (unsigned long)pFlash->dirtyPrograms, (unsigned long)pFlash->busyStarts,
+               (unsigned long)total.badPages, (unsigned long)total.flashErrors);
+        return 1;
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs every case of simCases
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    unsigned int i;
+
+    srand(31337);
+    printf("%d byte records, %d per page, %d ring pages, %d page cursor interval\n",
+           SIM_REC_LEN, SIM_PAGE_RECORDS, FLOG_PAGES, FLOG_CURSOR_SAVE_PAGES);
+    printf("case       made  deliv   lost  dups  early  pages  ersd  curs  lstp  cuts"
+           "     time\n");
+
+    for(i = 0; i < sizeof(simCases) / sizeof(simCases[0]); i++) {
+        if(simRun(&simCases[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+//******************************************************************************
+//! @file       frame_loopback.c
+//! @brief      Loopback test of the binary uplink framing,
+//!             cc1200_rx_sniff_mode_frame.c. Records are encoded as the
+//!             station sends them and fed to the gateway stream decoder in
+//!             chunks of random size, the way a serial port delivers them.
+//!             Some frames are left out to simulate loss and some get one
+//!             byte corrupted; the decoder must return every other record
+//!             unchanged, count each corrupted frame as an error and every
+//!             frame it did not return as lost. Also prints the wire size of
+//!             a 28 byte record against the hex ASCII format. Run by
+//!             host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_frame.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define LOOP_FRAMES             50000
+#define LOOP_LOSS_EVERY         97      // frame left out of the stream
+#define LOOP_CORRUPT_EVERY      251     // frame with one byte changed
+#define LOOP_CHUNK_MAX          64
+#define LOOP_STREAM_SIZE        (LOOP_CHUNK_MAX * FRAME_MAX_WIRE)
+#define LOOP_RECORD_LEN         28      // station record without channel and time
+#define LOOP_HEX_LEN            (LOOP_RECORD_LEN * 2 + 2)
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint8 sent[LOOP_FRAMES][FRAME_MAX_PAYLOAD];
+static uint8 sentLen[LOOP_FRAMES];
+static uint8 stream[LOOP_STREAM_SIZE];
+
+
+/*******************************************************************************
+*   @fn         corrupt
+*
+*   @brief      Changes one encoded byte, never into the delimiter and never
+*               the delimiter itself, so the frame stays one frame
+*
+*   @param      pWire - encoded frame
+*   @param      len   - its bytes, delimiter last
+*
+*   @return     none
+*/
+static void corrupt(uint8 *pWire, uint8 len) {
+
+    uint8 pos = (uint8)(rand() % (len - 1));
+    uint8 mask = (uint8)(1 + rand() % 255);
+
+    if((pWire[pos] ^ mask) == FRAME_DELIMITER) {
+        mask ^= 0x01;
+    }
+    pWire[pos] ^= mask;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Encodes, damages and decodes LOOP_FRAMES records
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    frameDecoder_t dec;
+    frame_t frame;
+    uint8 wire[FRAME_MAX_WIRE];
+    unsigned long streamLen = 0;
+    unsigned long pos;
+    unsigned long chunk;
+    unsigned long returned = 0;
+    unsigned long skipped = 0;
+    unsigned long corrupted = 0;
+    unsigned long next = 0;             // first frame not yet returned
+    unsigned long seq;
+    uint8 n;
+    int k;
+    int i;
+
+    srand(6);
+    frameDecoderInit(&dec);
+
+    for(k = 0; k < LOOP_FRAMES; k++) {
+        sentLen[k] = (uint8)(rand() % (FRAME_MAX_PAYLOAD + 1));
+        for(i = 0; i < sentLen[k]; i++) {
+            // Many zero bytes, the case COBS has to get right
+            sent[k][i] = (rand() % 4 == 0) ? 0 : (uint8)rand();
+        }
+        n = frameEncode((uint8)k, sent[k], sentLen[k], wire);
+        if((n == 0) || (n > FRAME_MAX_WIRE) || (wire[n - 1] != FRAME_DELIMITER)) {
+            printf("FAIL: frame %d encoded to %u bytes\n", k, n);
+            return 1;
+        }
+        if(k % LOOP_LOSS_EVERY == LOOP_LOSS_EVERY - 1) {
+            skipped++;
+            continue;
+        }
+        if(k % LOOP_CORRUPT_EVERY == LOOP_CORRUPT_EVERY - 1) {
+            corrupt(wire, n);
+            corrupted++;
+        }
+        memcpy(&stream[streamLen], wire, n);
+        streamLen += n;
+
+        // Hand the stream over in chunks once enough has piled up, the
+        // rest stays for the next round
+        if((streamLen < LOOP_STREAM_SIZE - FRAME_MAX_WIRE) && (k < LOOP_FRAMES - 1)) {
+            continue;
+        }
+        for(pos = 0; pos < streamLen; pos += chunk) {
+            chunk = 1 + rand() % LOOP_CHUNK_MAX;
+            if(chunk > streamLen - pos) {
+                chunk = streamLen - pos;
+            }
+            for(i = 0; i < (int)chunk; i++) {
+                if(!frameDecodeByte(&dec, stream[pos + i], &frame)) {
+                    continue;
+                }
+                // The 8 bit SEQ of the nearest record not yet returned
+                seq = next + (uint8)(frame.seq - (uint8)next);
+                if((seq >= LOOP_FRAMES) || (frame.len != sentLen[seq]) ||
+                   memcmp(frame.data, sent[seq], frame.len)) {
+                    printf("FAIL: frame SEQ %u does not match record %lu\n", frame.seq, seq);
+                    return 1;
+                }
+                next = seq + 1;
+                returned++;
+            }
+        }
+        streamLen = 0;
+    }
+
+    printf("frames %d, returned %lu, left out %lu, corrupted %lu\n",
+           LOOP_FRAMES, returned, skipped, corrupted);
+    printf("decoder: frames %lu, errors %lu, lost %lu\n",
+           (unsigned long)dec.frames, (unsigned long)dec.errors, (unsigned long)dec.lost);
+
+    if((returned != LOOP_FRAMES - skipped - corrupted) || (dec.frames != returned) ||
+       (dec.errors != corrupted) || (dec.lost != skipped + corrupted)) {
+        printf("FAIL: counters do not add up\n");
+        return 1;
+    }
+
+    memset(sent[0], 0x5A, LOOP_RECORD_LEN);
+    n = frameEncode(0, sent[0], LOOP_RECORD_LEN, wire);
+    printf("%d byte record: %u bytes framed, %d bytes hex ASCII\n",
+           LOOP_RECORD_LEN, n, LOOP_HEX_LEN);
+    return 0;
+}
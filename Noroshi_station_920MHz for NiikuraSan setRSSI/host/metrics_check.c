@@ -0,0 +1,133 @@
+//******************************************************************************
+//! @file       metrics_check.c
+//! @brief      Host check of the metrics registry,
+//!             cc1200_rx_sniff_mode_metrics.c: histogram bucket placement,
+//!             stamps out of order or on either side of the first epoch,
+//!             the heartbeat period, and the snapshot pages, which must
+//!             carry every counter once, fit an uplink record and start a
+//!             new histogram window. Run by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include "cc1200_rx_sniff_mode_metrics.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define CHECK(cond)             do { if(!(cond)) { printf("FAIL: line %d: %s\n", __LINE__, #cond); return 1; } } while(0)
+
+
+/*******************************************************************************
+*   @fn         getBucket
+*
+*   @brief      Reads a bucket from a histogram page
+*
+*   @param      pPacket - histogram page
+*   @param      bucket  - bucket number
+*
+*   @return     count
+*/
+static unsigned int getBucket(const rxPacket_t *pPacket, int bucket) {
+
+    return (pPacket->data[METRICS_POS_DATA + 2 * bucket] << 8) |
+           pPacket->data[METRICS_POS_DATA + 2 * bucket + 1];
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs the checks
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    rxPacket_t page;
+    timeStamp_t from = { 100, 0x1000 };
+    timeStamp_t to3 = { 100, 0x1000 + (3 << METRICS_LATENCY_SHIFT) };
+    timeStamp_t toNext = { 101, 0x0010 };
+    timeStamp_t local = { 5, TIME_FRAC_NO_EPOCH };
+    timeStamp_t now = { 200, 5 };
+    unsigned long value;
+    int counter = 0;
+    int pages = 0;
+    int i;
+
+    metricsInit(7);
+    CHECK(!metricsAvailable());
+
+    for(i = 0; i < METRICS_COUNTERS; i++) {
+        metricsSet((uint8)i, 0x01000000UL * (uint32)i + 1);
+    }
+    metricsCount(METRICS_RX_PACKETS);
+    metricsAdd(METRICS_RX_PACKETS, 4);
+
+    metricsHistTime(METRICS_HIST_LATENCY, &from, &to3);     // 3 units, bucket 2
+    metricsHistTime(METRICS_HIST_LATENCY, &to3, &from);     // out of order
+    metricsHistTime(METRICS_HIST_LATENCY, &from, &toNext);  // 897 units, bucket 10
+    metricsHistTime(METRICS_HIST_LATENCY, &local, &from);   // before the epoch
+    metricsHist(METRICS_HIST_SPI, 0);
+    metricsHist(METRICS_HIST_SPI, 1);
+    metricsHist(METRICS_HIST_SPI, 100000UL);                // last bucket
+
+    CHECK(!metricsReportDue(METRICS_REPORT_SEC - 1));
+    CHECK(metricsReportDue(METRICS_REPORT_SEC));
+    CHECK(!metricsReportDue(METRICS_REPORT_SEC + 1));
+
+    metricsSnapshot(1, &now);
+    metricsCount(METRICS_RX_PACKETS);                       // after the snapshot
+    while(metricsGet(&page)) {
+        CHECK(page.len <= RX_FIFO_STATION_LEN);
+        CHECK(page.data[0] == page.len - 1);
+        CHECK(page.data[METRICS_POS_TYPE] == METRICS_TYPE_SNAPSHOT);
+        CHECK(page.data[METRICS_POS_SRC] == 7);
+        CHECK(page.data[METRICS_POS_CODE] == 1);
+        CHECK(page.data[METRICS_POS_PAGE] == pages);
+        CHECK(page.stamp.sec == now.sec);
+        if(pages < METRICS_COUNTER_PAGES) {
+            for(i = METRICS_POS_DATA; i < page.len; i += 4) {
+                value = ((unsigned long)page.data[i] << 24) | ((unsigned long)page.data[i + 1] << 16) |
+                        ((unsigned long)page.data[i + 2] << 8) | page.data[i + 3];
+                CHECK(value == 0x01000000UL * counter + ((counter == METRICS_RX_PACKETS) ? 6 : 1));
+                counter++;
+            }
+        } else if(pages == METRICS_COUNTER_PAGES + METRICS_HIST_LATENCY) {
+            CHECK(getBucket(&page, 2) == 1);
+            CHECK(getBucket(&page, 10) == 1);
+            for(i = 0, value = 0; i < METRICS_BUCKETS; i++) {
+                value += getBucket(&page, i);
+            }
+            CHECK(value == 2);
+        } else {
+            CHECK(getBucket(&page, 0) == 1);
+            CHECK(getBucket(&page, 1) == 1);
+            CHECK(getBucket(&page, METRICS_BUCKETS - 1) == 1);
+        }
+        pages++;
+    }
+    CHECK(pages == METRICS_PAGES);
+    CHECK(counter == METRICS_COUNTERS);
+
+    // New window: the next snapshot has empty histograms
+    metricsSnapshot(0, &now);
+    for(i = 0; i <= METRICS_COUNTER_PAGES; i++) {
+        CHECK(metricsGet(&page));
+    }
+    CHECK(page.data[METRICS_POS_SEQ] == 2);
+    for(i = 0; i < METRICS_BUCKETS; i++) {
+        CHECK(getBucket(&page, i) == 0);
+    }
+
+    printf("%d counters, %d histograms, %d pages of at most %d bytes\n",
+           METRICS_COUNTERS, METRICS_HISTS, METRICS_PAGES, METRICS_RECORD_LEN);
+    return 0;
+}
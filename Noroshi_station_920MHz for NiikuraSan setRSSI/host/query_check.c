@@ -0,0 +1,444 @@
+//******************************************************************************
+//! @file       query_check.c
+//! @brief      Host check of the flash log query, cc1200_rx_sniff_mode_query.c
+//!             on cc1200_rx_sniff_mode_flog.c, cc1200_rx_sniff_mode_fio.c and
+//!             the RAM flash of flash_model.c, built with FLOG_HISTORY. The
+//!             log is filled past the end of the ring with SIM_RECORDS tag
+//!             records of SIM_TAGS TagIDs, SIM_ACTIVE of them heard at a
+//!             time, every other one logged as already sent. Then each
+//!             query of simQueries and one per TagID runs as rx.c drives
+//!             it, with the results taken as soon as they are available.
+//!             Fails if a query does not return exactly the records, in
+//!             the same order, of a brute-force scan of every valid page
+//!             on the flash, or if its done record does not add up. Prints
+//!             the index pages, sub-sectors and pages read and the latency
+//!             of the done record. Run by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_query.h"
+#include "cc1200_rx_sniff_mode_flog.h"
+#include "cc1200_rx_sniff_mode_fio.h"
+#include "cc1200_rx_sniff_mode_tag.h"
+#include "flash_model.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define SIM_FRAC_HZ             32768UL
+#define SIM_EPOCH               1700000000UL
+#define SIM_REC_LEN             17      // bytes, length byte included
+#define SIM_POS_SEQ             (TAG_POS_ID + TAG_ID_LEN)
+#define SIM_RECORDS             10000
+#define SIM_RATE                10      // records per second
+#define SIM_TAGS                200
+#define SIM_ACTIVE              20      // TagIDs heard at a time
+#define SIM_ACTIVE_RECORDS      400     // records before the set moves on
+#define SIM_TAG_BASE            0x00A10000UL
+#define SIM_MY_ID               1
+#define SIM_QUERY_LIMIT_S       10
+
+#if !FLOG_HISTORY
+#error "Build with -DFLOG_ENABLE=1 -DFLOG_HISTORY=1"
+#endif
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    const char *pName;
+    uint32 tagId;
+    uint32 fromS;                       // seconds from the start, or the
+    uint32 toS;                         // FLOG_TIME_* values
+} simQuery_t;
+
+typedef struct {
+    uint32 seq;
+    const uint8 *pPage;
+} simPage_t;
+
+typedef struct {
+    uint16 indexes;
+    uint8 sectors;
+    uint16 pages;
+    uint16 matches;
+    uint16 latencyMs;
+} simResult_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static const simQuery_t simQueries[] = {
+    { "all",          FLOG_TAG_ANY,               FLOG_TIME_FIRST, FLOG_TIME_LAST },
+    { "absent tag",   SIM_TAG_BASE + SIM_TAGS,    FLOG_TIME_FIRST, FLOG_TIME_LAST },
+    { "after the log", FLOG_TAG_ANY,              2000,            3000 },
+    { "last 60 s",    FLOG_TAG_ANY,               940,             1000 },
+    { "tag, 100 s",   SIM_TAG_BASE + 100,         500,             600 }
+};
+
+static uint32 simTick;
+static long simFound[SIM_RECORDS];
+static long simFoundCount;
+static long simExpect[SIM_RECORDS];
+static long simExpectCount;
+static simPage_t simPages[FLOG_PAGES];
+
+
+/*******************************************************************************
+*   @fn         simMakeRecord
+*
+*   @brief      Builds tag record seq: a TagID of the active set, the
+*               sequence number after it, the UTC time it was heard
+*
+*   @param      seq     - record number
+*   @param      pPacket - output
+*
+*   @return     none
+*/
+static void simMakeRecord(long seq, rxPacket_t *pPacket) {
+
+    uint32 tagId = SIM_TAG_BASE +
+                   (uint32)((seq / SIM_ACTIVE_RECORDS * 7 + rand() % SIM_ACTIVE) % SIM_TAGS);
+    uint32 tick = (uint32)seq * (SIM_FRAC_HZ / SIM_RATE);
+
+    memset(pPacket, 0, sizeof(*pPacket));
+    pPacket->len = SIM_REC_LEN;
+    pPacket->data[0] = SIM_REC_LEN - 1;
+    pPacket->data[TAG_POS_ID] = (uint8)(tagId >> 24);
+    pPacket->data[TAG_POS_ID + 1] = (uint8)(tagId >> 16);
+    pPacket->data[TAG_POS_ID + 2] = (uint8)(tagId >> 8);
+    pPacket->data[TAG_POS_ID + 3] = (uint8)tagId;
+    pPacket->data[SIM_POS_SEQ] = (uint8)(seq >> 16);
+    pPacket->data[SIM_POS_SEQ + 1] = (uint8)(seq >> 8);
+    pPacket->data[SIM_POS_SEQ + 2] = (uint8)seq;
+    pPacket->stamp.sec = SIM_EPOCH + tick / SIM_FRAC_HZ;
+    pPacket->stamp.frac = (uint16)(tick % SIM_FRAC_HZ);
+}
+
+
+/*******************************************************************************
+*   @fn         simSeq
+*
+*   @brief      Reads the sequence number of a record
+*
+*   @param      pPacket - record
+*
+*   @return     record number
+*/
+static long simSeq(const rxPacket_t *pPacket) {
+
+    return ((long)pPacket->data[SIM_POS_SEQ] << 16) |
+           ((long)pPacket->data[SIM_POS_SEQ + 1] << 8) | pPacket->data[SIM_POS_SEQ + 2];
+}
+
+
+/*******************************************************************************
+*   @fn         simStep
+*
+*   @brief      One 1/32768 s of the main loop: the flash, fioPoll, the
+*               query and flogTask
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void simStep(void) {
+
+    timeStamp_t now;
+    uint32 sec = simTick / SIM_FRAC_HZ;
+
+    flashModelRun(simTick);
+    if(fioReady((uint16)simTick)) {
+        fioPoll((uint16)simTick);
+    }
+    if(queryDue()) {
+        now.sec = SIM_EPOCH + sec;
+        now.frac = (uint16)(simTick % SIM_FRAC_HZ);
+        queryPoll(&now);
+    }
+    if(flogReady(sec)) {
+        flogTask(sec);
+    }
+    simTick++;
+}
+
+
+/*******************************************************************************
+*   @fn         simFill
+*
+*   @brief      Logs SIM_RECORDS records at SIM_RATE, every other one as
+*               sent, then runs until the last page is programmed
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void simFill(void) {
+
+    rxPacket_t packet;
+    long seq;
+
+    for(seq = 0; seq < SIM_RECORDS; seq++) {
+        while(simTick < (uint32)seq * (SIM_FRAC_HZ / SIM_RATE)) {
+            simStep();
+        }
+        simMakeRecord(seq, &packet);
+        flogAppend(&packet, simTick / SIM_FRAC_HZ, (uint8)(seq & 1));
+    }
+    while((simTick < (uint32)SIM_RECORDS * (SIM_FRAC_HZ / SIM_RATE) +
+                     (FLOG_FLUSH_S + 2) * SIM_FRAC_HZ) ||
+          fioBusy() || flogReady(simTick / SIM_FRAC_HZ)) {
+        simStep();
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         simPageSeq
+*
+*   @brief      Checks a flash page for records and reads its sequence
+*
+*   @param      pPage - FLOG_PAGE_SIZE bytes
+*   @param      pSeq  - output
+*
+*   @return     TRUE if a valid record page
+*/
+static uint8 simPageSeq(const uint8 *pPage, uint32 *pSeq) {
+
+    uint8 used = pPage[FLOG_POS_USED];
+
+    if((pPage[FLOG_POS_MAGIC] != FLOG_PAGE_MAGIC) || (used > FLOG_RECORDS_MAX) ||
+       !crc16Check(pPage, FLOG_POS_RECORDS + used + CRC16_LEN)) {
+        return FALSE;
+    }
+    *pSeq = flogGet32(&pPage[FLOG_POS_SEQ]);
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         simPageOrder
+*
+*   @brief      qsort order of record pages by sequence number
+*
+*   @param      pA - page
+*   @param      pB - page
+*
+*   @return     <0, 0 or >0
+*/
+static int simPageOrder(const void *pA, const void *pB) {
+
+    const simPage_t *pPageA = (const simPage_t *)pA;
+    const simPage_t *pPageB = (const simPage_t *)pB;
+
+    return (pPageA->seq > pPageB->seq) - (pPageA->seq < pPageB->seq);
+}
+
+
+/*******************************************************************************
+*   @fn         simScan
+*
+*   @brief      Brute force: every valid record page on the flash in page
+*               sequence order, every record of it checked against the query
+*
+*   @param      tagId - TagID or FLOG_TAG_ANY
+*   @param      from  - first UTC second or FLOG_TIME_FIRST
+*   @param      to    - last UTC second or FLOG_TIME_LAST
+*
+*   @return     none, the records are in simExpect
+*/
+static void simScan(uint32 tagId, uint32 from, uint32 to) {
+
+    const uint8 *pFlash = flashModelMemory();
+    const uint8 *pPage;
+    rxPacket_t packet;
+    uint16 count = 0;
+    uint16 page;
+    uint16 pos;
+    uint16 i;
+    uint8 len;
+
+    for(page = 0; page < FLOG_PAGES; page++) {
+        pPage = &pFlash[(uint32)(FLOG_FIRST_PAGE + page) * FLOG_PAGE_SIZE];
+        if(simPageSeq(pPage, &simPages[count].seq)) {
+            simPages[count++].pPage = pPage;
+        }
+    }
+    qsort(simPages, count, sizeof(simPages[0]), &simPageOrder);
+
+    simExpectCount = 0;
+    for(i = 0; i < count; i++) {
+        pPage = simPages[i].pPage;
+        for(pos = 0; pos < pPage[FLOG_POS_USED]; pos += len) {
+            len = flogParseRecord(&pPage[FLOG_POS_RECORDS + pos], pPage[FLOG_POS_USED] - pos,
+                                  &packet);
+            if(len == 0) {
+                break;
+            }
+            if(flogRecordMatch(&packet, tagId, from, to)) {
+                simExpect[simExpectCount++] = simSeq(&packet);
+            }
+        }
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         simQuery
+*
+*   @brief      Runs a query to its done record and checks it against the
+*               brute-force scan
+*
+*   @param      tagId   - TagID or FLOG_TAG_ANY
+*   @param      from    - first UTC second or FLOG_TIME_FIRST
+*   @param      to      - last UTC second or FLOG_TIME_LAST
+*   @param      pResult - output, from the done record
+*
+*   @return     0 if passed
+*/
+static int simQuery(uint32 tagId, uint32 from, uint32 to, simResult_t *pResult) {
+
+    rxPacket_t packet;
+    timeStamp_t now;
+    uint32 stop = simTick + SIM_QUERY_LIMIT_S * SIM_FRAC_HZ;
+    uint8 done = FALSE;
+    long i;
+
+    simScan(tagId, from, to);
+    simFoundCount = 0;
+    now.sec = SIM_EPOCH + simTick / SIM_FRAC_HZ;
+    now.frac = (uint16)(simTick % SIM_FRAC_HZ);
+    queryStart(tagId, from, to, &now);
+
+    while(!done && (simTick < stop)) {
+        simStep();
+        while(!done && queryAvailable() && queryGet(&packet)) {
+            if((packet.len == QUERY_DONE_LEN) && (packet.data[QUERY_POS_TYPE] == QUERY_TYPE_DONE)) {
+                pResult->indexes = packet.data[QUERY_POS_INDEXES];
+                pResult->sectors = packet.data[QUERY_POS_SECTORS];
+                pResult->pages = BUILD_UINT16(packet.data[QUERY_POS_PAGES + 1],
+                                              packet.data[QUERY_POS_PAGES]);
+                pResult->matches = BUILD_UINT16(packet.data[QUERY_POS_MATCHES + 1],
+                                                packet.data[QUERY_POS_MATCHES]);
+                pResult->latencyMs = BUILD_UINT16(packet.data[QUERY_POS_LATENCY + 1],
+                                                  packet.data[QUERY_POS_LATENCY]);
+                done = TRUE;
+            } else if(simFoundCount < SIM_RECORDS) {
+                simFound[simFoundCount++] = simSeq(&packet);
+            }
+        }
+    }
+
+    if(!done) {
+        printf("FAIL: no done record after %d s\n", SIM_QUERY_LIMIT_S);
+        return 1;
+    }
+    if(simFoundCount != simExpectCount) {
+        printf("FAIL: %ld records found, the scan has %ld\n", simFoundCount, simExpectCount);
+        return 1;
+    }
+    for(i = 0; i < simFoundCount; i++) {
+        if(simFound[i] != simExpect[i]) {
+            printf("FAIL: record %ld is %ld, the scan has %ld\n", i, simFound[i], simExpect[i]);
+            return 1;
+        }
+    }
+    if((pResult->matches != simFoundCount) || (pResult->indexes > FLOG_SUBSECTORS) ||
+       (pResult->sectors > pResult->indexes) ||
+       (pResult->pages > pResult->sectors * FLOG_INDEX_SLOT)) {
+        printf("FAIL: done record of %u matches, %u indexes, %u sectors, %u pages\n",
+               pResult->matches, pResult->indexes, pResult->sectors, pResult->pages);
+        return 1;
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         simTime
+*
+*   @brief      Query time bound as a UTC second
+*
+*   @param      s - seconds from the start, or a FLOG_TIME_* value
+*
+*   @return     UTC second or the FLOG_TIME_* value
+*/
+static uint32 simTime(uint32 s) {
+
+    return ((s == FLOG_TIME_FIRST) || (s == FLOG_TIME_LAST)) ? s : SIM_EPOCH + s;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Fills the log, then runs simQueries and a query per TagID
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    const simQuery_t *pQuery;
+    const flogStats_t *pStats;
+    simResult_t result;
+    simResult_t worst;
+    uint32 sectors = 0;
+    uint32 latency = 0;
+    uint32 matches = 0;
+    unsigned int i;
+
+    srand(2718);
+    flashModelInit();
+    fioInit();
+    flogInit();
+    queryInit(SIM_MY_ID);
+    simFill();
+
+    pStats = flogGetStats();
+    printf("%d records of %d TagIDs, %lu pages written, %lu lost to the ring, %d sub-sectors\n",
+           SIM_RECORDS, SIM_TAGS, (unsigned long)pStats->pagesWritten,
+           (unsigned long)pStats->lostPages, FLOG_SUBSECTORS);
+    printf("query          matches  indexes  sectors  pages  latency\n");
+
+    for(i = 0; i < sizeof(simQueries) / sizeof(simQueries[0]); i++) {
+        pQuery = &simQueries[i];
+        if(simQuery(pQuery->tagId, simTime(pQuery->fromS), simTime(pQuery->toS), &result)) {
+            printf("in query %s\n", pQuery->pName);
+            return 1;
+        }
+        printf("%-13s  %7u  %7u  %7u  %5u  %4u ms\n", pQuery->pName, result.matches,
+               result.indexes, result.sectors, result.pages, result.latencyMs);
+    }
+
+    memset(&worst, 0, sizeof(worst));
+    for(i = 0; i < SIM_TAGS; i++) {
+        if(simQuery(SIM_TAG_BASE + i, FLOG_TIME_FIRST, FLOG_TIME_LAST, &result)) {
+            printf("in the query of TagID %u\n", i);
+            return 1;
+        }
+        matches += result.matches;
+        sectors += result.sectors;
+        latency += result.latencyMs;
+        if(result.sectors > worst.sectors) {
+            worst = result;
+        }
+    }
+    printf("per TagID      %7lu  %7u  %7lu  %5s  %4lu ms mean\n",
+           (unsigned long)(matches / SIM_TAGS), FLOG_SUBSECTORS,
+           (unsigned long)(sectors / SIM_TAGS), "", (unsigned long)(latency / SIM_TAGS));
+    printf("worst TagID    %7u  %7u  %7u  %5u  %4u ms\n", worst.matches, worst.indexes,
+           worst.sectors, worst.pages, worst.latencyMs);
+    return 0;
+}
@@ -0,0 +1,268 @@
+//******************************************************************************
+//! @file       relay_chain.c
+//! @brief      Host simulation of a 3-station relay chain, 2 -> 1 -> 0, on
+//!             cc1200_rx_sniff_mode_relay.c. Time runs in 50 ms ticks; the
+//!             slaves each hear a tag record every SIM_GAP ticks and every
+//!             station may start one exchange per tick, as the TDMA
+//!             schedule allows. Each frame and each ACK is lost
+//!             independently with the given probability. The master hands
+//!             records to a SIM_UPLINK_SLOTS deep uplink drained every tick;
+//!             one run stalls it now and then so the master must refuse
+//!             frames. Fails if a record reaches the uplink twice or out of
+//!             order, if the master refuses a record it said it had room
+//!             for, or if records are lost on a lossless link. Prints the
+//!             records refused by a full slave queue, the frames the master
+//!             refused and the frames dropped after RELAY_MAX_RETRIES. Run
+//!             by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "relay_sim.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define SIM_GAP                 2       // ticks between records at a slave
+#define SIM_RECORDS             4800    // per slave
+#define SIM_DRAIN_TICKS         2000    // after the last record
+#define SIM_UPLINK_SLOTS        8
+#define SIM_UPLINK_RATE         3       // records drained per tick
+#define SIM_STALL_PERIOD        200     // ticks, stalling run only
+#define SIM_STALL_TICKS         12      // uplink drains nothing, 0.6 s
+#define SIM_TICK_S              0.05
+
+#define SIM_POS_ORIGIN          1       // in the record, after the RSSI
+#define SIM_POS_SEQ             2       // 2 bytes big endian
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    double loss;                        // per frame and per ACK
+    int stall;                          // uplink stalls now and then
+} simCase_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+extern const relaySimStation_t relaySimStation0, relaySimStation1, relaySimStation2;
+
+static const relaySimStation_t *const simStations[RELAY_SIM_STATIONS] = {
+    &relaySimStation0, &relaySimStation1, &relaySimStation2
+};
+
+static const simCase_t simCases[] = {
+    { 0.0, 0 }, { 0.1, 0 }, { 0.2, 0 }, { 0.0, 1 }, { 0.1, 1 }
+};
+
+static uint8 simSeen[RELAY_SIM_STATIONS][SIM_RECORDS];
+static int simLast[RELAY_SIM_STATIONS];
+static long simDelivered;
+static long simDuplicates;
+static long simReordered;
+static long simOverrun;
+static int simUplink;                   // records in the uplink
+
+
+/*******************************************************************************
+*   @fn         simDeliver
+*
+*   @brief      Master uplink: checks the record and queues it
+*
+*   @param      pRecord - tag record
+*   @param      origin  - station that received it
+*   @param      hops    - relay hops it travelled
+*
+*   @return     TRUE if queued, FALSE if the uplink is full
+*/
+static uint8 simDeliver(const uint8 *pRecord, uint8 origin, uint8 hops) {
+
+    int seq = (pRecord[SIM_POS_SEQ] << 8) | pRecord[SIM_POS_SEQ + 1];
+
+    if(simUplink >= SIM_UPLINK_SLOTS) {
+        simOverrun++;
+        return FALSE;
+    }
+    simUplink++;
+    if((origin != pRecord[SIM_POS_ORIGIN]) || (hops != origin) || (seq >= SIM_RECORDS)) {
+        simReordered++;
+    } else if(simSeen[origin][seq]) {
+        simDuplicates++;
+    } else {
+        simSeen[origin][seq] = 1;
+        if(seq < simLast[origin]) {
+            simReordered++;
+        }
+        simLast[origin] = seq;
+        simDelivered++;
+    }
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         simLost
+*
+*   @brief      Draws whether one transmission is lost
+*
+*   @param      loss - probability
+*
+*   @return     TRUE if lost
+*/
+static int simLost(double loss) {
+
+    return rand() < (int)(RAND_MAX * loss);
+}
+
+
+/*******************************************************************************
+*   @fn         simRun
+*
+*   @brief      Runs the chain until the slaves have sent SIM_RECORDS each and
+*               the queues had SIM_DRAIN_TICKS to empty, then prints a row
+*
+*   @param      pCase - loss and uplink
+*
+*   @return     0 if passed
+*/
+static int simRun(const simCase_t *pCase) {
+
+    const relaySimStation_t *pSt;
+    const relayStats_t *pMaster;
+    uint8 frame[RELAY_FRAME_MAX];
+    uint8 ack[RELAY_ACK_LEN];
+    uint8 reply[RELAY_ACK_LEN];
+    uint8 record[RELAY_RECORD_LEN];
+    long generated = 0;
+    long refused = 0;
+    long t;
+    uint16 now;
+    uint8 len;
+    uint8 dst;
+    int drain;
+    int s;
+
+    srand(4711);
+    memset(simSeen, 0, sizeof(simSeen));
+    for(s = 0; s < RELAY_SIM_STATIONS; s++) {
+        simStations[s]->init((uint8)s, (uint8)(s > 0 ? s - 1 : RELAY_ID_NONE));
+        simLast[s] = -1;
+    }
+    simDelivered = 0;
+    simDuplicates = 0;
+    simReordered = 0;
+    simOverrun = 0;
+    simUplink = 0;
+    memset(record, 0, sizeof(record));
+
+    for(t = 0; t < (long)SIM_RECORDS * SIM_GAP + SIM_DRAIN_TICKS; t++) {
+        now = (uint16)t;
+
+        for(s = 1; s < RELAY_SIM_STATIONS; s++) {
+            if((t % SIM_GAP != s - 1) || (t >= (long)SIM_RECORDS * SIM_GAP)) {
+                continue;
+            }
+            record[0] = (uint8)-60;
+            record[SIM_POS_ORIGIN] = (uint8)s;
+            record[SIM_POS_SEQ] = HI_UINT16(t / SIM_GAP);
+            record[SIM_POS_SEQ + 1] = LO_UINT16(t / SIM_GAP);
+            generated++;
+            if(!simStations[s]->add(record, now)) {
+                refused++;
+            }
+        }
+
+        drain = SIM_UPLINK_RATE;
+        if(pCase->stall && (t % SIM_STALL_PERIOD < SIM_STALL_TICKS)) {
+            drain = 0;
+        }
+        simUplink = (simUplink > drain) ? simUplink - drain : 0;
+
+        for(s = RELAY_SIM_STATIONS - 1; s > 0; s--) {
+            pSt = simStations[s];
+            pSt->tick(now);
+            len = pSt->next(now, frame);
+            if(len == 0) {
+                continue;
+            }
+            dst = frame[RELAY_POS_DST];
+            if((dst >= RELAY_SIM_STATIONS) || simLost(pCase->loss)) {
+                pSt->timeout(now);
+                continue;
+            }
+            len = simStations[dst]->receive(frame, len, now, ack,
+                                            (uint8)(SIM_UPLINK_SLOTS - simUplink),
+                                            &simDeliver);
+            if((len == 0) || simLost(pCase->loss)) {
+                pSt->timeout(now);
+            } else {
+                pSt->receive(ack, len, now, reply, 0, NULL);
+            }
+        }
+    }
+
+    pMaster = simStations[0]->stats();
+    printf("%3.0f%%  %-6s  %5ld / %5ld  %10ld  %10ld  %7lu  %7lu  %10.2f s  %5.2f s\n",
+           pCase->loss * 100, pCase->stall ? "stalls" : "steady",
+           simDelivered, generated, simDuplicates, refused,
+           (unsigned long)pMaster->framesRefused,
+           (unsigned long)(simStations[1]->stats()->framesDropped +
+                           simStations[2]->stats()->framesDropped),
+           pMaster->latencyCount ? SIM_TICK_S * pMaster->latencySum / pMaster->latencyCount : 0.0,
+           SIM_TICK_S * pMaster->latencyMax);
+
+    if((simDuplicates > 0) || (simReordered > 0)) {
+        printf("FAIL: %ld duplicates, %ld out of order\n", simDuplicates, simReordered);
+        return 1;
+    }
+    if((simOverrun > 0) || (pMaster->recordsRefused > 0)) {
+        printf("FAIL: the master took a frame the uplink had no room for\n");
+        return 1;
+    }
+    if((pCase->loss == 0.0) && ((simDelivered != generated) || (refused > 0))) {
+        printf("FAIL: %ld records lost without link loss\n", generated - simDelivered);
+        return 1;
+    }
+    if(pCase->stall && (pMaster->framesRefused == 0)) {
+        printf("FAIL: the uplink stalls were never seen by the master\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs every case of simCases
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    unsigned int i;
+
+    printf("%d records per slave, one every %d ticks, %d records per frame\n",
+           SIM_RECORDS, SIM_GAP, RELAY_RECORDS_MAX);
+    printf("loss uplink      delivered  duplicates  slave full  refused  dropped"
+           "  mean latency    max\n");
+
+    for(i = 0; i < sizeof(simCases) / sizeof(simCases[0]); i++) {
+        if(simRun(&simCases[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
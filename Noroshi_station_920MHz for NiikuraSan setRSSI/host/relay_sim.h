@@ -0,0 +1,39 @@
+//******************************************************************************
+//! @file       relay_sim.h
+//! @brief      Station instances for relay_chain.c. The relay keeps its
+//!             state in statics, so relay_station.c compiles it once per
+//!             station with RELAY_STATION set, under its own names, and
+//!             exports the entry points as one relaySimStation_t.
+//
+//*****************************************************************************/
+
+#ifndef RELAY_SIM_H
+#define RELAY_SIM_H
+
+/******************************************************************************
+ * INCLUDES
+ */
+#include "cc1200_rx_sniff_mode_relay.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define RELAY_SIM_STATIONS      3       // relay_station.c objects built
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    void (*init)(uint8 myId, uint8 nextHop);
+    uint8 (*add)(const uint8 *pRecord, uint16 now);
+    void (*tick)(uint16 now);
+    uint8 (*next)(uint16 now, uint8 *pFrame);
+    void (*timeout)(uint16 now);
+    uint8 (*receive)(const uint8 *pData, uint8 len, uint16 now, uint8 *pAck,
+                     uint8 room, relayDeliver_t pfnDeliver);
+    const relayStats_t *(*stats)(void);
+} relaySimStation_t;
+
+#endif
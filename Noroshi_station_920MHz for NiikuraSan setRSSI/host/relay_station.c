@@ -0,0 +1,52 @@
+//******************************************************************************
+//! @file       relay_station.c
+//! @brief      One station of relay_chain.c: the relay,
+//!             cc1200_rx_sniff_mode_relay.c, with its functions renamed after
+//!             RELAY_STATION and exported as relaySimStation<RELAY_STATION>.
+//!             host/build.sh compiles it once per station.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#ifndef RELAY_STATION
+#error "Set RELAY_STATION to the station number"
+#endif
+
+#define RELAY_PASTE(a, b)       a##b
+#define RELAY_NAME(a, b)        RELAY_PASTE(a, b)
+
+#define relayInit               RELAY_NAME(relayInit, RELAY_STATION)
+#define relaySetRoute           RELAY_NAME(relaySetRoute, RELAY_STATION)
+#define relayIsMaster           RELAY_NAME(relayIsMaster, RELAY_STATION)
+#define relayIsFrame            RELAY_NAME(relayIsFrame, RELAY_STATION)
+#define relayAddRecord          RELAY_NAME(relayAddRecord, RELAY_STATION)
+#define relayTick               RELAY_NAME(relayTick, RELAY_STATION)
+#define relayDue                RELAY_NAME(relayDue, RELAY_STATION)
+#define relayNextTx             RELAY_NAME(relayNextTx, RELAY_STATION)
+#define relayAckTimeout         RELAY_NAME(relayAckTimeout, RELAY_STATION)
+#define relayReceive            RELAY_NAME(relayReceive, RELAY_STATION)
+#define relayGetStats           RELAY_NAME(relayGetStats, RELAY_STATION)
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include "cc1200_rx_sniff_mode_relay.c"
+#include "relay_sim.h"
+
+
+/*******************************************************************************
+* GLOBAL VARIABLES
+*/
+const relaySimStation_t RELAY_NAME(relaySimStation, RELAY_STATION) = {
+    relayInit,
+    relayAddRecord,
+    relayTick,
+    relayNextTx,
+    relayAckTimeout,
+    relayReceive,
+    relayGetStats
+};
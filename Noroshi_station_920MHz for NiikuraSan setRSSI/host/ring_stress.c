@@ -0,0 +1,203 @@
+//******************************************************************************
+//! @file       ring_stress.c
+//! @brief      Host stress test of the SPSC packet ring,
+//!             cc1200_rx_sniff_mode_ring.c. A producer thread puts numbered
+//!             packets in bursts of random length, the way RX_STATE_QUEUE
+//!             does after a FIFO drain, and a consumer thread takes them out
+//!             at its own pace like uplinkTask. The consumer checks that
+//!             every packet it gets is whole and newer than the last one;
+//!             with drops the sequence may skip, never repeat or go back.
+//!             At the end the counters must add up. Run by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "cc1200_rx_sniff_mode_ring.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define STRESS_PACKETS          2000000UL
+#define STRESS_BURST_MAX        (RX_RING_SLOTS + 4)
+#define STRESS_FILL             0xA5
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static volatile int producerDone;
+static unsigned long produced;
+static unsigned long consumed;
+static unsigned long skipped;           // sequence gaps seen by the consumer
+static unsigned long nextSeq;           // one past the last packet taken
+static int failed;
+
+
+/*******************************************************************************
+*   @fn         fillPacket
+*
+*   @brief      Numbers a packet and fills it with a pattern derived from the
+*               number, so a torn copy is caught
+*
+*   @param      pPacket - output
+*   @param      seq     - packet number
+*
+*   @return     none
+*/
+static void fillPacket(rxPacket_t *pPacket, unsigned long seq) {
+
+    uint8 i;
+
+    pPacket->len = (uint8)(1 + seq % RX_FIFO_STATION_LEN);
+    memcpy(pPacket->data, &seq, sizeof(seq));
+    for(i = sizeof(seq); i < RX_FIFO_SLOT_SIZE; i++) {
+        pPacket->data[i] = (uint8)(STRESS_FILL ^ seq ^ i);
+    }
+    pPacket->channel = (uint8)seq;
+    pPacket->stamp.sec = (uint32)seq;
+    pPacket->stamp.frac = (uint16)~seq;
+}
+
+
+/*******************************************************************************
+*   @fn         checkPacket
+*
+*   @brief      Checks a packet against the pattern of its number
+*
+*   @param      pPacket - packet taken from the ring
+*   @param      pSeq    - output, its number
+*
+*   @return     1 if whole, 0 if torn
+*/
+static int checkPacket(const rxPacket_t *pPacket, unsigned long *pSeq) {
+
+    rxPacket_t expect;
+
+    memcpy(pSeq, pPacket->data, sizeof(*pSeq));
+    fillPacket(&expect, *pSeq);
+    return (pPacket->len == expect.len) &&
+           !memcmp(pPacket->data, expect.data, RX_FIFO_SLOT_SIZE) &&
+           (pPacket->channel == expect.channel) &&
+           (pPacket->stamp.sec == expect.stamp.sec) &&
+           (pPacket->stamp.frac == expect.stamp.frac);
+}
+
+
+/*******************************************************************************
+*   @fn         producer
+*
+*   @brief      Radio side: bursts of packets, never waits for the ring
+*
+*   @param      pArg - unused
+*
+*   @return     NULL
+*/
+static void *producer(void *pArg) {
+
+    rxPacket_t packet;
+    unsigned long seq = 0;
+    unsigned int seed = 1;
+    int burst;
+
+    (void)pArg;
+    while(seq < STRESS_PACKETS) {
+        burst = 1 + rand_r(&seed) % STRESS_BURST_MAX;
+        while((burst-- > 0) && (seq < STRESS_PACKETS)) {
+            fillPacket(&packet, seq++);
+            rxRingPut(&packet);
+        }
+        if(rand_r(&seed) % 4 == 0) {
+            sched_yield();
+        }
+    }
+    produced = seq;
+    producerDone = 1;
+    return NULL;
+}
+
+
+/*******************************************************************************
+*   @fn         consumer
+*
+*   @brief      Uplink side: takes packets while there are any
+*
+*   @param      pArg - unused
+*
+*   @return     NULL
+*/
+static void *consumer(void *pArg) {
+
+    rxPacket_t packet;
+    unsigned long seq;
+    unsigned int seed = 2;
+
+    (void)pArg;
+    for(;;) {
+        if(!rxRingGet(&packet)) {
+            if(producerDone && (rxRingCount() == 0)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if(!checkPacket(&packet, &seq) || (seq < nextSeq)) {
+            printf("FAIL: packet %lu after %lu\n", seq, nextSeq);
+            failed = 1;
+            break;
+        }
+        skipped += seq - nextSeq;
+        nextSeq = seq + 1;
+        consumed++;
+        if(rand_r(&seed) % 64 == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs both threads and checks the counters
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    pthread_t prod;
+    pthread_t cons;
+    const rxRingStats_t *pStats;
+
+    rxRingInit();
+    pthread_create(&cons, NULL, consumer, NULL);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    // Packets dropped after the last one taken leave no gap behind them
+    skipped += produced - nextSeq;
+    pStats = rxRingGetStats();
+    printf("put %lu, got %lu, enqueued %lu, dropped %lu, high water %u of %u\n",
+           produced, consumed, (unsigned long)pStats->enqueued,
+           (unsigned long)pStats->dropped, pStats->highWater, RX_RING_SLOTS);
+
+    if(failed || (pStats->enqueued + pStats->dropped != produced) ||
+       (pStats->enqueued != consumed) || (skipped != pStats->dropped) ||
+       (pStats->highWater > RX_RING_SLOTS)) {
+        printf("FAIL: counters do not add up\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+//******************************************************************************
+//! @file       sync_fit.c
+//! @brief      Host simulation of the time sync, cc1200_rx_sniff_mode_sync.c
+//!             and cc1200_rx_sniff_mode_time.c: a master sends a beacon every
+//!             SYNC_PERIOD seconds, a slave whose crystal is off by the
+//!             case's drift receives each one unless it is lost, and applies
+//!             every new fit with timeSetModel. Both sides capture the sync
+//!             word on their own 32768 Hz clock, so each capture is
+//!             quantized to one tick. SIM_PROBE_S after each beacon the
+//!             slave's timeToUtc is compared with the master's clock. One
+//!             case moves the master onto a new UTC mid-run, the fit must
+//!             restart. Fails if the mean or maximum error or the fitted
+//!             skew are off by more than SIM_MEAN_US, SIM_MAX_US and
+//!             SIM_SKEW_PPB. Run by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "sync_sim.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define SIM_BEACONS             400     // ~1.8 h
+#define SIM_EPOCH               1700000000.0    // master UTC at the start
+#define SIM_SLAVE_BOOT          3.25    // slave uptime at the start, s
+#define SIM_PHASE               0.37    // beacon offset within the second, s
+#define SIM_PROBE_S             8       // error measured after each beacon
+#define SIM_JUMP_BEACON         200     // jump case: master takes a new UTC
+#define SIM_JUMP_S              7.5
+
+#define SIM_MEAN_US             50
+#define SIM_MAX_US              150
+#define SIM_SKEW_PPB            200
+
+#define SIM_MASTER              0
+#define SIM_SLAVE               1
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    double driftPpm;                    // slave crystal against the master
+    double loss;                        // per beacon
+    int jump;                           // master UTC jumps mid-run
+} simCase_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+extern const syncSimStation_t syncSimStation0, syncSimStation1;
+
+static const syncSimStation_t *const simStations[SYNC_SIM_STATIONS] = {
+    &syncSimStation0, &syncSimStation1
+};
+
+static const simCase_t simCases[] = {
+    { 20.0, 0.0, 0 }, { 20.0, 0.3, 0 }, { -40.0, 0.0, 0 }, { -40.0, 0.3, 0 },
+    { -40.0, 0.1, 1 }
+};
+
+
+/*******************************************************************************
+*   @fn         simStamp
+*
+*   @brief      Reads a clock: seconds as a stamp, the fraction cut to the
+*               tick
+*
+*   @param      t      - seconds
+*   @param      pStamp - output
+*
+*   @return     none
+*/
+static void simStamp(double t, timeStamp_t *pStamp) {
+
+    double ticks = floor(t * TIME_FRAC_HZ);
+
+    pStamp->sec = (uint32)(ticks / TIME_FRAC_HZ);
+    pStamp->frac = (uint16)(ticks - (double)pStamp->sec * TIME_FRAC_HZ);
+}
+
+
+/*******************************************************************************
+*   @fn         simRun
+*
+*   @brief      Runs SIM_BEACONS beacon periods and prints a row
+*
+*   @param      pCase - drift, loss and jump
+*
+*   @return     0 if passed
+*/
+static int simRun(const simCase_t *pCase) {
+
+    const syncSimStation_t *pMaster = simStations[SIM_MASTER];
+    const syncSimStation_t *pSlave = simStations[SIM_SLAVE];
+    const syncStats_t *pStats;
+    uint8 frame[SYNC_BEACON_MAX];
+    timeStamp_t stamp;
+    timeStamp_t utc;
+    timeStamp_t refLocal;
+    timeStamp_t refMaster;
+    int32 skew;
+    double rate = 1.0 + pCase->driftPpm * 1e-6;
+    double epoch = SIM_EPOCH;
+    double t;
+    double error;
+    double errorSum = 0;
+    double errorMax = 0;
+    double skewError;
+    long probes = 0;
+    int jumped = 0;                     // waiting for the fit to restart
+    uint8 len;
+    int k;
+
+    srand(2024);
+    timeInit();
+    pMaster->init(SYNC_MASTER_ID, (uint32)(epoch - SYNC_PERIOD));
+    pSlave->init(SYNC_MASTER_ID + 1, 0);
+
+    for(k = 0; k < SIM_BEACONS; k++) {
+        t = (double)k * SYNC_PERIOD + SIM_PHASE;
+        if(pCase->jump && (k == SIM_JUMP_BEACON)) {
+            epoch += SIM_JUMP_S;
+            jumped = 1;
+        }
+
+        if(!pMaster->due((uint32)(epoch + t))) {
+            printf("FAIL: beacon %d not due\n", k);
+            return 1;
+        }
+        len = pMaster->build(frame, (uint32)(epoch + t), NULL, 0);
+        if(rand() >= (int)(RAND_MAX * pCase->loss)) {
+            simStamp(SIM_SLAVE_BOOT + t * rate, &stamp);
+            if(pSlave->receive(frame, len, &stamp)) {
+                pSlave->model(&refLocal, &refMaster, &skew);
+                timeSetModel(&refLocal, &refMaster, skew);
+            }
+        }
+        simStamp(epoch + t, &stamp);
+        pMaster->sent(&stamp);
+
+        // Once the slave has a slope on the master's current time, see how
+        // far its clock is off
+        if(jumped && (pSlave->stats()->resets > 0)) {
+            jumped = (pSlave->stats()->points < 2);
+        }
+        if(jumped || (pSlave->stats()->points < 2)) {
+            continue;
+        }
+        simStamp(SIM_SLAVE_BOOT + (t + SIM_PROBE_S) * rate, &stamp);
+        timeToUtc(&stamp, &utc);
+        error = (timeToFrac(&utc) - (epoch + t + SIM_PROBE_S) * TIME_FRAC_HZ) *
+                1e6 / TIME_FRAC_HZ;
+        errorSum += fabs(error);
+        if(fabs(error) > errorMax) {
+            errorMax = fabs(error);
+        }
+        probes++;
+    }
+
+    // The offset falls by drift / (1 + drift) per local second
+    pStats = pSlave->stats();
+    skewError = pStats->skewPpb + pCase->driftPpm * 1e3 / rate;
+    printf("%+5.0f ppm  %3.0f%%  %-4s  %5lu  %5lu  %6ld  %7.1f us  %6.1f us  %+7.1f ppb\n",
+           pCase->driftPpm, pCase->loss * 100, pCase->jump ? "jump" : "",
+           (unsigned long)pStats->beaconsReceived, (unsigned long)pStats->pairs,
+           (long)pStats->resets, probes ? errorSum / probes : 0.0, errorMax, skewError);
+
+    if((probes == 0) || (errorSum / probes > SIM_MEAN_US) || (errorMax > SIM_MAX_US)) {
+        printf("FAIL: sync error beyond %d us mean, %d us max\n", SIM_MEAN_US, SIM_MAX_US);
+        return 1;
+    }
+    if(fabs(skewError) > SIM_SKEW_PPB) {
+        printf("FAIL: fitted skew off by more than %d ppb\n", SIM_SKEW_PPB);
+        return 1;
+    }
+    if(pStats->resets != (uint32)(pCase->jump ? 1 : 0)) {
+        printf("FAIL: %lu fit restarts\n", (unsigned long)pStats->resets);
+        return 1;
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs every case of simCases
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    unsigned int i;
+
+    printf("%d beacons every %d s, %d pairs in the fit, error %d s after each\n",
+           SIM_BEACONS, SYNC_PERIOD, SYNC_POINTS, SIM_PROBE_S);
+    printf("    drift  loss           rx  pairs  resets  mean error  max error"
+           "   skew error\n");
+
+    for(i = 0; i < sizeof(simCases) / sizeof(simCases[0]); i++) {
+        if(simRun(&simCases[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+//******************************************************************************
+//! @file       sync_sim.h
+//! @brief      Station instances for sync_fit.c. The sync module keeps its
+//!             state in statics, so sync_station.c compiles it once per
+//!             station with SYNC_STATION set, under its own names, and
+//!             exports the entry points as one syncSimStation_t.
+//
+//*****************************************************************************/
+
+#ifndef SYNC_SIM_H
+#define SYNC_SIM_H
+
+/******************************************************************************
+ * INCLUDES
+ */
+#include "cc1200_rx_sniff_mode_sync.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define SYNC_SIM_STATIONS       2       // sync_station.c objects built
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    void (*init)(uint8 myId, uint32 now);
+    uint8 (*due)(uint32 now);
+    uint8 (*build)(uint8 *pFrame, uint32 now, const uint8 *pExtra, uint8 extraLen);
+    void (*sent)(const timeStamp_t *pTime);
+    uint8 (*receive)(const uint8 *pData, uint8 len, const timeStamp_t *pLocal);
+    void (*model)(timeStamp_t *pRefLocal, timeStamp_t *pRefMaster, int32 *pSkew);
+    const syncStats_t *(*stats)(void);
+} syncSimStation_t;
+
+#endif
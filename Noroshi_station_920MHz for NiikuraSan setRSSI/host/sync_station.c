@@ -0,0 +1,53 @@
+//******************************************************************************
+//! @file       sync_station.c
+//! @brief      One station of sync_fit.c: the time sync module,
+//!             cc1200_rx_sniff_mode_sync.c, with its functions renamed after
+//!             SYNC_STATION and exported as syncSimStation<SYNC_STATION>.
+//!             host/build.sh compiles it once per station.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#ifndef SYNC_STATION
+#error "Set SYNC_STATION to the station number"
+#endif
+
+#define SYNC_PASTE(a, b)        a##b
+#define SYNC_NAME(a, b)         SYNC_PASTE(a, b)
+
+#define syncInit                SYNC_NAME(syncInit, SYNC_STATION)
+#define syncIsMaster            SYNC_NAME(syncIsMaster, SYNC_STATION)
+#define syncBeaconDue           SYNC_NAME(syncBeaconDue, SYNC_STATION)
+#define syncIsSynced            SYNC_NAME(syncIsSynced, SYNC_STATION)
+#define syncBuildBeacon         SYNC_NAME(syncBuildBeacon, SYNC_STATION)
+#define syncBeaconSent          SYNC_NAME(syncBeaconSent, SYNC_STATION)
+#define syncIsBeacon            SYNC_NAME(syncIsBeacon, SYNC_STATION)
+#define syncReceive             SYNC_NAME(syncReceive, SYNC_STATION)
+#define syncBeaconExtra         SYNC_NAME(syncBeaconExtra, SYNC_STATION)
+#define syncGetModel            SYNC_NAME(syncGetModel, SYNC_STATION)
+#define syncBuildStatus         SYNC_NAME(syncBuildStatus, SYNC_STATION)
+#define syncGetStats            SYNC_NAME(syncGetStats, SYNC_STATION)
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include "cc1200_rx_sniff_mode_sync.c"
+#include "sync_sim.h"
+
+
+/*******************************************************************************
+* GLOBAL VARIABLES
+*/
+const syncSimStation_t SYNC_NAME(syncSimStation, SYNC_STATION) = {
+    syncInit,
+    syncBeaconDue,
+    syncBuildBeacon,
+    syncBeaconSent,
+    syncReceive,
+    syncGetModel,
+    syncGetStats
+};
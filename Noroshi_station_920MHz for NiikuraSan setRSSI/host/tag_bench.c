@@ -0,0 +1,181 @@
+//******************************************************************************
+//! @file       tag_bench.c
+//! @brief      Host benchmark of the per-tag aggregation table,
+//!             cc1200_rx_sniff_mode_tag.c. For a range of tags in range it
+//!             times TAG_BENCH_UPDATES calls of tagAggUpdate with a sweep
+//!             once per simulated second, as tickTask does. Below
+//!             TAG_TABLE_SIZE tags updates find their entry, above it the
+//!             table fills up and passes packets on. Every sample has to
+//!             come out in exactly one summary or be passed on, also when
+//!             the emit callback refuses records now and then, and each
+//!             summary's RSSI statistics must be consistent. The uplink
+//!             bytes of summaries and passed packets must never exceed
+//!             those of the raw packets, and summaries must fold more than
+//!             TAG_BENCH_FOLD_MIN packets each on average while the tags
+//!             fit the table. Run by host/build.sh; the MSP430 cost is not
+//!             measured here.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cc1200_rx_sniff_mode_tag.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define TAG_BENCH_UPDATES       2000000UL
+#define TAG_BENCH_PER_SEC       1000    // updates between sweeps
+#define TAG_BENCH_WINDOW        10      // seconds
+#define TAG_BENCH_REFUSE_EVERY  37      // seconds whose sweep the uplink refuses
+#define TAG_BENCH_ID_BASE       0x00A10000UL    // tags are numbered in sequence
+#define TAG_BENCH_FOLD_MIN      4       // packets per summary, tags fitting the table
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static const int benchTags[] = { 20, 48, TAG_TABLE_SIZE / 2, 200, 1000, 5000 };
+
+static unsigned long emittedSamples;
+static unsigned long emittedBytes;
+static int refuse;
+static int badSummary;
+
+
+/*******************************************************************************
+*   @fn         emit
+*
+*   @brief      Uplink stand-in, checks and counts a summary
+*
+*   @param      pSummary - closed window of one tag
+*
+*   @return     TRUE if taken, FALSE while refusing
+*/
+static uint8 emit(const tagSummary_t *pSummary) {
+
+    uint8 record[TAG_SUMMARY_LEN];
+
+    if(refuse) {
+        return FALSE;
+    }
+    if((pSummary->count == 0) || (pSummary->rssiMin > pSummary->rssiMax) ||
+       (pSummary->rssiMean < pSummary->rssiMin) || (pSummary->rssiMean > pSummary->rssiMax) ||
+       (pSummary->firstSeen > pSummary->lastSeen)) {
+        badSummary = 1;
+    }
+    emittedSamples += pSummary->count;
+    emittedBytes += tagAggSerialize(pSummary, record);
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         bench
+*
+*   @brief      One run
+*
+*   @param      tags        - distinct TagIDs in range
+*   @param      withRefusal - refuse the sweep every TAG_BENCH_REFUSE_EVERY s
+*
+*   @return     0 if passed
+*/
+static int bench(int tags, int withRefusal) {
+
+    uint8 pkt[TAG_PKT_LEN] = { 0 };
+    const tagAggStats_t *pStats;
+    struct timespec t0;
+    struct timespec t1;
+    unsigned long k;
+    unsigned long passed = 0;
+    unsigned long rawBytes;
+    uint32 now = 0;
+    uint32 id;
+    double ns;
+
+    tagAggInit(TAG_BENCH_WINDOW);
+    emittedSamples = 0;
+    emittedBytes = 0;
+    badSummary = 0;
+    srand(7);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(k = 0; k < TAG_BENCH_UPDATES; k++) {
+        id = TAG_BENCH_ID_BASE + (uint32)(rand() % tags);
+        pkt[TAG_POS_ID] = BREAK_UINT32(id, 3);
+        pkt[TAG_POS_ID + 1] = BREAK_UINT32(id, 2);
+        pkt[TAG_POS_ID + 2] = BREAK_UINT32(id, 1);
+        pkt[TAG_POS_ID + 3] = BREAK_UINT32(id, 0);
+        if(k % TAG_BENCH_PER_SEC == 0) {
+            now++;
+            refuse = withRefusal && (now % TAG_BENCH_REFUSE_EVERY == 0);
+            tagAggExpire(now, &emit);
+        }
+        if(!tagAggUpdate(pkt, (int8)-(rand() % 100), now, &emit)) {
+            passed++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / TAG_BENCH_UPDATES;
+
+    // Close all windows
+    refuse = 0;
+    tagAggExpire(now + TAG_BENCH_WINDOW + 1, &emit);
+
+    pStats = tagAggGetStats();
+    rawBytes = TAG_BENCH_UPDATES * TAG_PKT_LEN;
+    printf("%5d tags%s: %6.1f ns/update, summaries %7lu, passed %7lu, refused %5lu, "
+           "high water %3u, uplink %5.1f%% of raw\n",
+           tags, withRefusal ? " refusing" : "         ", ns,
+           (unsigned long)pStats->summaries, (unsigned long)pStats->passed,
+           (unsigned long)pStats->emitRefused, pStats->usedHighWater,
+           100.0 * (emittedBytes + passed * TAG_PKT_LEN) / rawBytes);
+
+    if(badSummary || (pStats->used != 0) || (pStats->updates != TAG_BENCH_UPDATES) ||
+       (pStats->passed != passed) || (emittedSamples + passed != TAG_BENCH_UPDATES)) {
+        printf("FAIL: samples %lu summarized, %lu passed, of %lu\n",
+               emittedSamples, passed, TAG_BENCH_UPDATES);
+        return 1;
+    }
+    if(emittedBytes + passed * TAG_PKT_LEN > rawBytes) {
+        printf("FAIL: aggregation makes the uplink bigger\n");
+        return 1;
+    }
+    if((tags <= TAG_TABLE_SIZE / 2) &&
+       (pStats->summaries * TAG_BENCH_FOLD_MIN > TAG_BENCH_UPDATES)) {
+        printf("FAIL: %lu summaries for %lu packets\n",
+               (unsigned long)pStats->summaries, TAG_BENCH_UPDATES);
+        return 1;
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs all tag counts with and without refusals
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    int failed = 0;
+    unsigned int i;
+
+    printf("table %d entries, probe %d, window %d s, %lu updates\n",
+           TAG_TABLE_SIZE, TAG_MAX_PROBE, TAG_BENCH_WINDOW, TAG_BENCH_UPDATES);
+    for(i = 0; i < sizeof(benchTags) / sizeof(benchTags[0]); i++) {
+        failed |= bench(benchTags[i], 0);
+        failed |= bench(benchTags[i], 1);
+    }
+    return failed;
+}
@@ -0,0 +1,271 @@
+//******************************************************************************
+//! @file       tdma_slots.c
+//! @brief      Host simulation of one station on the TDMA schedule,
+//!             cc1200_rx_sniff_mode_tdma.c and cc1200_rx_sniff_mode_time.c.
+//!             The station's clock runs SIM_SKEW_PPM off the master's and is
+//!             mapped onto it with timeSetModel. Relay frames come in bursts;
+//!             the station wakes for each burst, every 50 ms tick and at the
+//!             Timer A0 CCR3 count rx.c's tdmaTask sets from tdmaNextOpen and
+//!             timeFromUtc, and sends while tdmaTxOpen allows. An exchange
+//!             takes up to TDMA_TX_FRAC. Fails if an exchange starts outside
+//!             the station's slot or in its guard, or runs past the slot's
+//!             end, if a CCR3 wake finds the slot still closed, if
+//!             timeFromUtc does not give the first local tick at or after a
+//!             master time, if the peak
+//!             utilization differs from the airtime counted here, or if
+//!             traffic is left over. Run by host/build.sh.
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "cc1200_rx_sniff_mode_tdma.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define SIM_SECONDS             600
+#define SIM_MY_ID               3       // owns slot 3 in the default map
+#define SIM_SKEW_PPM            (-40)
+#define SIM_EPOCH               1700000000UL    // master UTC at local 0
+#define SIM_BOOT_S              5       // local uptime at the start
+#define SIM_TICK_FRAC           1638    // Timer B0, 50 ms
+#define SIM_BURST_GAP_S         6       // mean seconds between bursts
+#define SIM_BURST_MAX           6       // frames in a burst
+#define SIM_EXCHANGE_MIN        655     // 20 ms, shortest exchange
+
+#define SIM_FOREVER             0x7FFFFFFFFFFFFFFFLL
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint32 simAir[SIM_SECONDS * TIME_FRAC_HZ / TDMA_SUPERFRAME_FRAC + 2];
+
+
+/*******************************************************************************
+*   @fn         simStamp
+*
+*   @brief      Count of 1/32768 s as a stamp
+*
+*   @param      t      - fractions
+*   @param      pStamp - output
+*
+*   @return     none
+*/
+static void simStamp(signed long long t, timeStamp_t *pStamp) {
+
+    pStamp->sec = (uint32)(t >> TIME_FRAC_BITS);
+    pStamp->frac = (uint16)(t & TIME_FRAC_BM);
+}
+
+
+/*******************************************************************************
+*   @fn         simUtc
+*
+*   @brief      Local count to master time, as the station sees it
+*
+*   @param      local - fractions
+*   @param      pUtc  - output
+*
+*   @return     master time in fractions
+*/
+static signed long long simUtc(signed long long local, timeStamp_t *pUtc) {
+
+    timeStamp_t stamp;
+
+    simStamp(local, &stamp);
+    timeToUtc(&stamp, pUtc);
+    return timeToFrac(pUtc);
+}
+
+
+/*******************************************************************************
+*   @fn         simRoundTrip
+*
+*   @brief      Maps master times onto the local clock with timeFromUtc and
+*               back with timeToUtc
+*
+*   @param      none
+*
+*   @return     0 if every time came back as the first local tick at or
+*               after it
+*/
+static int simRoundTrip(void) {
+
+    timeStamp_t utc;
+    timeStamp_t stamp;
+    signed long long target;
+    signed long long local;
+    long i;
+
+    for(i = 0; i < 100000; i++) {
+        target = ((signed long long)SIM_EPOCH << TIME_FRAC_BITS) + i * 197L;
+        simStamp(target, &utc);
+        timeFromUtc(&utc, &stamp);
+        local = timeToFrac(&stamp);
+        if((simUtc(local, &stamp) < target) || (simUtc(local - 1, &stamp) >= target)) {
+            printf("FAIL: master time %lld came back at local %lld\n", target, local);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs the station for SIM_SECONDS
+*
+*   @param      none
+*
+*   @return     0 if passed
+*/
+int main(void) {
+
+    const tdmaStats_t *pStats;
+    timeStamp_t refLocal = { SIM_BOOT_S, 0 };
+    timeStamp_t refUtc = { SIM_EPOCH, 0 };
+    timeStamp_t now;
+    timeStamp_t start;
+    timeStamp_t end;
+    timeStamp_t wakeAt;
+    uint8 status[TDMA_STATUS_LEN];
+    signed long long firstSf;
+    signed long long local = (signed long long)SIM_BOOT_S << TIME_FRAC_BITS;
+    signed long long stop = local + ((signed long long)SIM_SECONDS << TIME_FRAC_BITS);
+    signed long long nextBurst = local;
+    signed long long nextTick = local;
+    signed long long nextWake = SIM_FOREVER;
+    signed long long t;
+    signed long long tEnd;
+    signed long long offset;
+    uint32 exchange;
+    uint32 peak = 0;
+    uint32 util;
+    long queued = 0;
+    long sent = 0;
+    long offered = 0;
+    long outside = 0;
+    long missed = 0;
+    long reports = 0;
+    long i;
+    uint8 byWake;
+
+    srand(99);
+    timeInit();
+    timeSetModel(&refLocal, &refUtc,
+                 (int32)(((signed long long)SIM_SKEW_PPM << TIME_SKEW_BITS) / 1000000));
+    if(simRoundTrip()) {
+        return 1;
+    }
+    tdmaInit(SIM_MY_ID);
+    firstSf = simUtc(local, &now) / TDMA_SUPERFRAME_FRAC;
+
+    while(local < stop) {
+        byWake = (local == nextWake);
+        if(local >= nextBurst) {
+            i = 1 + rand() % SIM_BURST_MAX;
+            queued += i;
+            offered += i;
+            nextBurst = local + 1 + rand() % (2 * SIM_BURST_GAP_S * TIME_FRAC_HZ);
+        }
+        while(nextTick <= local) {
+            nextTick += SIM_TICK_FRAC;
+        }
+
+        // tdmaTask, then the relay exchanges txSlotOpen lets through
+        t = simUtc(local, &now);
+        if(tdmaTick(&now) && (tdmaBuildStatus(status) == TDMA_STATUS_LEN)) {
+            reports++;
+        }
+        if(queued > 0) {
+            tdmaWait(&now);
+        }
+        if(byWake && (queued > 0) && !tdmaTxOpen(&now)) {
+            missed++;
+        }
+        while((queued > 0) && tdmaTxOpen(&now)) {
+            exchange = SIM_EXCHANGE_MIN + rand() % (TDMA_TX_FRAC - SIM_EXCHANGE_MIN + 1);
+            offset = t % TDMA_SLOT_FRAC;
+            if((((t % TDMA_SUPERFRAME_FRAC) / TDMA_SLOT_FRAC) != SIM_MY_ID) ||
+               (offset < TDMA_GUARD_FRAC)) {
+                outside++;
+            }
+            start = now;
+            local += exchange;
+            tEnd = simUtc(local, &end);
+            if((tEnd / TDMA_SLOT_FRAC) != (t / TDMA_SLOT_FRAC)) {
+                outside++;
+            }
+            tdmaTxDone(&start, &end, TRUE);
+            simAir[t / TDMA_SUPERFRAME_FRAC - firstSf] += (uint32)(tEnd - t);
+            queued--;
+            sent++;
+            t = tEnd;
+            now = end;
+        }
+
+        nextWake = SIM_FOREVER;
+        if(tdmaNextOpen(&now, &start)) {
+            timeFromUtc(&start, &wakeAt);
+            nextWake = timeToFrac(&wakeAt);
+            if(nextWake <= local) {
+                nextWake = local + 1;
+            }
+        }
+        if(nextBurst <= local) {
+            nextBurst = local + 1;
+        }
+        local = nextTick;
+        if(nextBurst < local) {
+            local = nextBurst;
+        }
+        if(nextWake < local) {
+            local = nextWake;
+        }
+    }
+
+    // The last superframe may still be open
+    for(i = 0; i + 1 < (long)(sizeof(simAir) / sizeof(simAir[0])); i++) {
+        util = (uint32)((simAir[i] * 1000ULL) / TDMA_SUPERFRAME_FRAC);
+        if(util > peak) {
+            peak = util;
+        }
+    }
+    pStats = tdmaGetStats();
+    printf("%d s, slot %d of %d, %u/%u fractions guard/window, %+d ppm\n",
+           SIM_SECONDS, SIM_MY_ID, TDMA_SLOTS, TDMA_GUARD_FRAC,
+           (unsigned int)TDMA_TX_FRAC, SIM_SKEW_PPM);
+    printf("frames %ld of %ld, superframes %lu used %lu, reports %ld\n",
+           sent, offered, (unsigned long)pStats->superframes,
+           (unsigned long)pStats->slotsUsed, reports);
+    printf("peak utilization %u permille (counted %u), worst wait %u ms\n",
+           pStats->utilMax, (unsigned int)peak, pStats->latencyMaxMs);
+    printf("outside the slot %ld, CCR3 wakes into a closed slot %ld\n", outside, missed);
+
+    if(outside > 0) {
+        printf("FAIL: exchanges outside the own slot\n");
+        return 1;
+    }
+    if(missed > 0) {
+        printf("FAIL: the slot wake-up came too early\n");
+        return 1;
+    }
+    if((pStats->utilMax + 1 < peak) || (pStats->utilMax > peak + 1)) {
+        printf("FAIL: peak utilization does not match the airtime\n");
+        return 1;
+    }
+    if((sent != offered - queued) || (queued > SIM_BURST_MAX) ||
+       (pStats->frames != (uint32)sent) || (reports == 0)) {
+        printf("FAIL: traffic or counters do not add up\n");
+        return 1;
+    }
+    return 0;
+}
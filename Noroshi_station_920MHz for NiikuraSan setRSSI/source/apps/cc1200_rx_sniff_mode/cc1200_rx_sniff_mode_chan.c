@@ -0,0 +1,301 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_chan.c
+//! @brief      Channel switching with calibration cache, see
+//!             cc1200_rx_sniff_mode_chan.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "msp430.h"
+#include "hal_spi_rf_trxeb.h"
+#include "cc120x_spi.h"
+#include "cc1200_rx_sniff_mode_chan.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+// FREQ = f * 2^18 / 40 MHz (LO divider 4), kept in 1/100 for rounding:
+// channel 24 is 920.6 MHz = 6033244.16, a 200 kHz step is 1310.72
+#define CHAN_FREQ_BASE_X100     603324416UL
+#define CHAN_FREQ_STEP_X100     131072UL
+
+#define CHAN_MARC_STATE_IDLE    0x41
+#define CHAN_FS_AUTOCAL_BM      0x18    // SETTLING_CFG bits 4:3
+#define CHAN_VCO_LEN            3       // FS_VCO4, FS_VCO3, FS_VCO2
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8  valid;
+    uint8  chp;                         // FS_CHP
+    uint8  vco[CHAN_VCO_LEN];           // FS_VCO4..FS_VCO2
+    uint16 calTime;                     // seconds, wraps
+} chanCal_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static chanCal_t chanCal[CHAN_COUNT];
+static uint8 chanCurrent = CHAN_NONE;
+static chanStats_t chanStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 chanCalibrate(chanCal_t *pCal, uint16 now);
+static void chanRestore(const chanCal_t *pCal);
+#if CHAN_MEASURE
+static void chanMeasureStart(void);
+static uint16 chanMeasureStop(void);
+#endif
+
+
+/*******************************************************************************
+*   @fn         chanInit
+*
+*   @brief      Turns off automatic calibration and empties the cache. Call
+*               after every PHY profile write, SRES restores FS_AUTOCAL
+*
+*   @param      none
+*
+*   @return     none
+*/
+void chanInit(void) {
+
+    uint8 temp;
+
+    cc120xSpiReadReg(CC120X_SETTLING_CFG, &temp, 1);
+    temp &= ~CHAN_FS_AUTOCAL_BM;
+    cc120xSpiWriteReg(CC120X_SETTLING_CFG, &temp, 1);
+
+    chanInvalidate();
+    chanCurrent = CHAN_NONE;
+}
+
+
+/*******************************************************************************
+*   @fn         chanInvalidate
+*
+*   @brief      Drops all stored calibrations
+*
+*   @param      none
+*
+*   @return     none
+*/
+void chanInvalidate(void) {
+
+    memset(chanCal, 0, sizeof(chanCal));
+}
+
+
+/*******************************************************************************
+*   @fn         chanSet
+*
+*   @brief      Tunes the synthesizer to a channel. The radio must be in IDLE.
+*               A fresh cache entry costs three register accesses, otherwise
+*               SCAL runs and its result is stored
+*
+*   @param      channel - CHAN_FIRST..CHAN_LAST
+*   @param      now     - seconds, for the cache age
+*
+*   @return     CHAN_SET_CACHED, CHAN_SET_CALIBRATED or CHAN_SET_FAILED
+*/
+uint8 chanSet(uint8 channel, uint16 now) {
+
+    chanCal_t *pCal;
+    uint32 freq;
+    uint8  regs[3];
+    uint8  result;
+#if CHAN_MEASURE
+    uint16 us;
+#endif
+
+    if((channel < CHAN_FIRST) || (channel > CHAN_LAST)) {
+        return CHAN_SET_FAILED;
+    }
+#if CHAN_MEASURE
+    chanMeasureStart();
+#endif
+    pCal = &chanCal[channel - CHAN_FIRST];
+
+    freq = (CHAN_FREQ_BASE_X100 +
+            (uint32)(channel - CHAN_FIRST) * CHAN_FREQ_STEP_X100 + 50) / 100;
+    regs[0] = (uint8)(freq >> 16);
+    regs[1] = (uint8)(freq >> 8);
+    regs[2] = (uint8)freq;
+    cc120xSpiWriteReg(CC120X_FREQ2, regs, 3);
+
+    if(pCal->valid && ((uint16)(now - pCal->calTime) < CHAN_CAL_MAX_AGE)) {
+        chanRestore(pCal);
+        chanStats.cached++;
+        result = CHAN_SET_CACHED;
+    } else {
+        if(pCal->valid) {
+            chanStats.expired++;
+        }
+        result = chanCalibrate(pCal, now);
+        chanStats.calibrated++;
+    }
+    chanCurrent = channel;
+
+#if CHAN_MEASURE
+    us = chanMeasureStop();
+    if(result == CHAN_SET_CACHED) {
+        chanStats.lastCachedUs = us;
+        if(us > chanStats.maxCachedUs) {
+            chanStats.maxCachedUs = us;
+        }
+    } else {
+        chanStats.lastCalibratedUs = us;
+        if(us > chanStats.maxCalibratedUs) {
+            chanStats.maxCalibratedUs = us;
+        }
+    }
+#endif
+    return result;
+}
+
+
+/*******************************************************************************
+*   @fn         chanGetCurrent
+*
+*   @brief      Returns the channel last set
+*
+*   @param      none
+*
+*   @return     channel, CHAN_NONE before the first chanSet
+*/
+uint8 chanGetCurrent(void) {
+
+    return chanCurrent;
+}
+
+
+/*******************************************************************************
+*   @fn         chanCalDue
+*
+*   @brief      Checks whether the current channel's calibration has aged
+*               out. The radio keeps its calibration while sniffing, so the
+*               caller re-tunes with chanSet to refresh it
+*
+*   @param      now - seconds
+*
+*   @return     TRUE if the current channel should be calibrated again
+*/
+uint8 chanCalDue(uint16 now) {
+
+    const chanCal_t *pCal;
+
+    if(chanCurrent == CHAN_NONE) {
+        return FALSE;
+    }
+    pCal = &chanCal[chanCurrent - CHAN_FIRST];
+    return !pCal->valid || ((uint16)(now - pCal->calTime) >= CHAN_CAL_MAX_AGE);
+}
+
+
+/*******************************************************************************
+*   @fn         chanGetStats
+*
+*   @brief      Returns the cache counters and, with CHAN_MEASURE, the switch
+*               latencies
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const chanStats_t *chanGetStats(void) {
+
+    return &chanStats;
+}
+
+
+/*******************************************************************************
+*   @fn         chanCalibrate
+*
+*   @brief      Runs SCAL on the programmed frequency and stores the result
+*
+*   @param      pCal - cache entry of the channel
+*   @param      now  - seconds
+*
+*   @return     CHAN_SET_CALIBRATED
+*/
+static uint8 chanCalibrate(chanCal_t *pCal, uint16 now) {
+
+    uint8 marcState;
+
+    trxSpiCmdStrobe(CC120X_SCAL);
+    do {
+        cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+    } while (marcState != CHAN_MARC_STATE_IDLE);
+
+    cc120xSpiReadReg(CC120X_FS_CHP, &pCal->chp, 1);
+    cc120xSpiReadReg(CC120X_FS_VCO4, pCal->vco, CHAN_VCO_LEN);
+    pCal->calTime = now;
+    pCal->valid = TRUE;
+    return CHAN_SET_CALIBRATED;
+}
+
+
+/*******************************************************************************
+*   @fn         chanRestore
+*
+*   @brief      Writes a stored calibration back
+*
+*   @param      pCal - cache entry of the channel
+*
+*   @return     none
+*/
+static void chanRestore(const chanCal_t *pCal) {
+
+    uint8 regs[CHAN_VCO_LEN];
+
+    regs[0] = pCal->chp;
+    cc120xSpiWriteReg(CC120X_FS_CHP, regs, 1);
+    memcpy(regs, pCal->vco, CHAN_VCO_LEN);
+    cc120xSpiWriteReg(CC120X_FS_VCO4, regs, CHAN_VCO_LEN);
+}
+
+
+#if CHAN_MEASURE
+/*******************************************************************************
+*   @fn         chanMeasureStart
+*
+*   @brief      Starts Timer A1 from zero on SMCLK, continuous mode
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void chanMeasureStart(void) {
+
+    TA1CTL = TASSEL_2 + MC_2 + TACLR;
+}
+
+
+/*******************************************************************************
+*   @fn         chanMeasureStop
+*
+*   @brief      Stops Timer A1. Wraps after 8 ms, well above one switch
+*
+*   @param      none
+*
+*   @return     microseconds since chanMeasureStart
+*/
+static uint16 chanMeasureStop(void) {
+
+    uint16 ticks = TA1R;
+
+    TA1CTL = 0;
+    return ticks / CHAN_MEASURE_TICKS_US;
+}
+#endif
@@ -0,0 +1,83 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_chan.h
+//! @brief      ARIB 920 MHz channel switching with a per-channel frequency
+//!             synthesizer calibration cache. The first switch to a channel
+//!             runs SCAL and stores FS_CHP and FS_VCO4..FS_VCO2; later
+//!             switches write the stored values back instead. Entries older
+//!             than CHAN_CAL_MAX_AGE are calibrated again. Automatic
+//!             calibration (SETTLING_CFG.FS_AUTOCAL) is turned off, so the
+//!             radio no longer calibrates on each sniff wake-up either.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_CHAN_H
+#define CC1200_RX_SNIFF_MODE_CHAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// ARIB STD-T108 unit channels, 920.6 MHz + 200 kHz * (channel - 24). The
+// PHY profiles' FREQ (0x5C0F5C) is channel 24
+#define CHAN_FIRST              24
+#define CHAN_LAST               61
+#define CHAN_COUNT              (CHAN_LAST - CHAN_FIRST + 1)
+#ifndef CHAN_DEFAULT
+#define CHAN_DEFAULT            24
+#endif
+#define CHAN_NONE               0xFF
+
+#ifndef CHAN_CAL_MAX_AGE
+#define CHAN_CAL_MAX_AGE        600     // seconds, then calibrate again
+#endif
+
+// chanSet() results
+#define CHAN_SET_FAILED         0
+#define CHAN_SET_CACHED         1       // calibration restored from the cache
+#define CHAN_SET_CALIBRATED     2       // SCAL was run
+
+// CHAN_MEASURE = 1 times each switch with Timer A1 on SMCLK
+#ifndef CHAN_MEASURE
+#define CHAN_MEASURE            0
+#endif
+#define CHAN_MEASURE_TICKS_US   8       // SMCLK 8 MHz
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 cached;                      // switches served from the cache
+    uint32 calibrated;                  // switches that ran SCAL
+    uint32 expired;                     // of those, because the entry aged out
+    uint16 lastCachedUs;                // CHAN_MEASURE only
+    uint16 maxCachedUs;
+    uint16 lastCalibratedUs;
+    uint16 maxCalibratedUs;
+} chanStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void chanInit(void);
+void chanInvalidate(void);
+uint8 chanSet(uint8 channel, uint16 now);
+uint8 chanGetCurrent(void);
+uint8 chanCalDue(uint16 now);
+const chanStats_t *chanGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
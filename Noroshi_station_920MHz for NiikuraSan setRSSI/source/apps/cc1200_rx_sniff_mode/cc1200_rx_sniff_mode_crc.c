@@ -0,0 +1,100 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_crc.c
+//! @brief      CRC-16/CCITT, see cc1200_rx_sniff_mode_crc.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include "cc1200_rx_sniff_mode_crc.h"
+
+#if defined(__MSP430_HAS_CRC__) && !defined(CRC16_SOFTWARE)
+#define CRC16_HW
+#include "crc.h"
+#endif
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define CRC16_POLY              0x1021
+
+
+/*******************************************************************************
+*   @fn         crc16Update
+*
+*   @brief      Continues a CRC over more bytes. Start with CRC16_INIT.
+*               The CRC16 module shifts CRCDI LSB first; bytes written to
+*               CRCDIRB are bit reversed first, which gives the MSB first
+*               CCITT result in CRCINIRES, the same as the software loop
+*
+*   @param      crc   - CRC of the bytes so far
+*   @param      pData - next bytes
+*   @param      len   - number of bytes
+*
+*   @return     updated CRC
+*/
+uint16 crc16Update(uint16 crc, const uint8 *pData, uint8 len) {
+
+#ifdef CRC16_HW
+    CRC_setSeed(CRC_BASE, crc);
+    while(len--) {
+        CRC_set8BitDataReversed(CRC_BASE, *pData++);
+    }
+    return CRC_getResult(CRC_BASE);
+#else
+    uint8 i;
+
+    while(len--) {
+        crc ^= (uint16)(*pData++) << 8;
+        for(i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16)((crc << 1) ^ CRC16_POLY) : (uint16)(crc << 1);
+        }
+    }
+    return crc;
+#endif
+}
+
+
+/*******************************************************************************
+*   @fn         crc16Append
+*
+*   @brief      Writes the CRC of the first len bytes behind them
+*
+*   @param      pData - frame, len + CRC16_LEN bytes
+*   @param      len   - bytes covered by the CRC
+*
+*   @return     none
+*/
+void crc16Append(uint8 *pData, uint8 len) {
+
+    uint16 crc = crc16Update(CRC16_INIT, pData, len);
+
+    pData[len]     = HI_UINT16(crc);
+    pData[len + 1] = LO_UINT16(crc);
+}
+
+
+/*******************************************************************************
+*   @fn         crc16Check
+*
+*   @brief      Checks a frame that ends with its CRC
+*
+*   @param      pData - frame
+*   @param      len   - frame length including the CRC16_LEN CRC bytes
+*
+*   @return     TRUE if the CRC matches
+*/
+uint8 crc16Check(const uint8 *pData, uint8 len) {
+
+    uint16 crc;
+
+    if(len < CRC16_LEN) {
+        return FALSE;
+    }
+
+    crc = crc16Update(CRC16_INIT, pData, len - CRC16_LEN);
+    return (pData[len - 2] == HI_UINT16(crc)) && (pData[len - 1] == LO_UINT16(crc));
+}
@@ -0,0 +1,42 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_crc.h
+//! @brief      CRC-16/CCITT (polynomial 0x1021, MSB first, no final XOR).
+//!             Runs on the F5xx CRC16 module when the device has one, and on
+//!             a bit-identical software loop otherwise (host builds, or with
+//!             CRC16_SOFTWARE defined). Calls chain, so a frame can be
+//!             checked piece by piece.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_CRC_H
+#define CC1200_RX_SNIFF_MODE_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define CRC16_INIT              0xFFFF
+#define CRC16_LEN               2       // appended big endian
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+uint16 crc16Update(uint16 crc, const uint8 *pData, uint8 len);
+void crc16Append(uint8 *pData, uint8 len);
+uint8 crc16Check(const uint8 *pData, uint8 len);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
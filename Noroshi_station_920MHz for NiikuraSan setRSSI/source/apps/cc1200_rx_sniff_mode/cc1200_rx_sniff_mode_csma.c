@@ -0,0 +1,333 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_csma.c
+//! @brief      Listen-before-talk transmit scheduler, see
+//!             cc1200_rx_sniff_mode_csma.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_csma.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#if (CSMA_MIN_BE > CSMA_MAX_BE) || (CSMA_MAX_BE > 8)
+#error "CSMA backoff exponents must satisfy MIN_BE <= MAX_BE <= 8"
+#endif
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8  data[CSMA_PKT_MAX];
+    uint8  len;
+    uint16 deadline;                    // ticks
+} csmaEntry_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+// Sorted by deadline, csmaQueue[0] is sent next
+static csmaEntry_t csmaQueue[CSMA_QUEUE_SLOTS];
+static uint8 csmaCount;
+
+static uint8  csmaBe;
+static uint8  csmaBusyRun;              // busy CCAs for the head packet
+static uint16 csmaNotBefore;            // end of the current backoff
+static uint16 csmaRandom;
+static csmaStats_t csmaStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void csmaBackoff(uint16 now);
+static void csmaPop(void);
+static uint16 csmaRand(void);
+
+
+/*******************************************************************************
+*   @fn         csmaInit
+*
+*   @brief      Empties the queue and seeds the backoff generator. Stations
+*               sharing a channel must use different seeds
+*
+*   @param      seed - any value, 0 is replaced
+*   @param      now  - ticks
+*
+*   @return     none
+*/
+void csmaInit(uint16 seed, uint16 now) {
+
+    csmaCount = 0;
+    csmaBe = CSMA_MIN_BE;
+    csmaBusyRun = 0;
+    csmaNotBefore = now;
+    csmaRandom = (seed != 0) ? seed : 0xACE1;
+    memset(&csmaStats, 0, sizeof(csmaStats));
+}
+
+
+/*******************************************************************************
+*   @fn         csmaQueuePut
+*
+*   @brief      Queues a packet in deadline order, behind packets with the
+*               same deadline. A packet arriving at an empty queue starts
+*               with a random backoff, so stations triggered by the same
+*               event do not all assess the channel in the same slot
+*
+*   @param      pPkt     - packet, length byte first
+*   @param      len      - bytes in pPkt, at most CSMA_PKT_MAX
+*   @param      deadline - ticks, latest start of transmission
+*   @param      now      - ticks
+*
+*   @return     TRUE if queued, FALSE if the queue is full or len too long
+*/
+uint8 csmaQueuePut(const uint8 *pPkt, uint8 len, uint16 deadline, uint16 now) {
+
+    uint8 pos;
+    uint8 i;
+
+    if((len == 0) || (len > CSMA_PKT_MAX) || (csmaCount >= CSMA_QUEUE_SLOTS)) {
+        csmaStats.queueFull++;
+        return FALSE;
+    }
+
+    pos = csmaCount;
+    while((pos > 0) &&
+          ((int16)(deadline - csmaQueue[pos - 1].deadline) < 0)) {
+        pos--;
+    }
+    for(i = csmaCount; i > pos; i--) {
+        csmaQueue[i] = csmaQueue[i - 1];
+    }
+    memcpy(csmaQueue[pos].data, pPkt, len);
+    csmaQueue[pos].len = len;
+    csmaQueue[pos].deadline = deadline;
+
+    if(csmaCount++ == 0) {
+        csmaBe = CSMA_MIN_BE;
+        csmaBusyRun = 0;
+        csmaBackoff(now);
+    }
+    csmaStats.queued++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaQueueCount
+*
+*   @brief      Returns the number of packets waiting
+*
+*   @param      none
+*
+*   @return     packets in the queue
+*/
+uint8 csmaQueueCount(void) {
+
+    return csmaCount;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaDue
+*
+*   @brief      Checks whether the backoff is over and a packet is waiting
+*
+*   @param      now - ticks
+*
+*   @return     TRUE if csmaNext should be called
+*/
+uint8 csmaDue(uint16 now) {
+
+    return (csmaCount > 0) && ((int16)(now - csmaNotBefore) >= 0);
+}
+
+
+/*******************************************************************************
+*   @fn         csmaNext
+*
+*   @brief      Hands out the packet with the earliest deadline for one
+*               attempt, after dropping those whose deadline has passed. The
+*               packet stays queued until csmaDone reports the outcome of
+*               the caller's CCA
+*
+*   @param      now  - ticks
+*   @param      pPkt - output, CSMA_PKT_MAX bytes
+*
+*   @return     bytes in pPkt, 0 if nothing is due
+*/
+uint8 csmaNext(uint16 now, uint8 *pPkt) {
+
+    while((csmaCount > 0) && ((int16)(now - csmaQueue[0].deadline) > 0)) {
+        csmaStats.expired++;
+        csmaPop();
+        csmaBe = CSMA_MIN_BE;
+        csmaBusyRun = 0;
+    }
+    if(!csmaDue(now)) {
+        return 0;
+    }
+
+    memcpy(pPkt, csmaQueue[0].data, csmaQueue[0].len);
+    return csmaQueue[0].len;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaDone
+*
+*   @brief      Reports the attempt started by csmaNext. A sent packet leaves
+*               the queue and the next one gets a fresh minimum-window
+*               backoff. A busy channel widens the window and draws a new
+*               backoff, or gives the packet up after CSMA_MAX_BACKOFFS
+*
+*   @param      result - CSMA_SENT or CSMA_BUSY
+*   @param      now    - ticks
+*
+*   @return     none
+*/
+void csmaDone(uint8 result, uint16 now) {
+
+    if(csmaCount == 0) {
+        return;
+    }
+
+    if(result == CSMA_BUSY) {
+        csmaStats.ccaBusy++;
+        if(++csmaBusyRun > csmaStats.maxBusyRun) {
+            csmaStats.maxBusyRun = csmaBusyRun;
+        }
+        if(csmaBusyRun < CSMA_MAX_BACKOFFS) {
+            if(csmaBe < CSMA_MAX_BE) {
+                csmaBe++;
+            }
+            csmaBackoff(now);
+            return;
+        }
+        csmaStats.accessFailures++;
+    } else {
+        csmaStats.sent++;
+    }
+
+    csmaPop();
+    csmaBe = CSMA_MIN_BE;
+    csmaBusyRun = 0;
+    csmaBackoff(now);
+}
+
+
+/*******************************************************************************
+*   @fn         csmaTake
+*
+*   @brief      Removes the packet with the earliest deadline without a CCA
+*               or backoff, for a burst that already holds the channel. It
+*               counts as sent
+*
+*   @param      now  - ticks
+*   @param      pPkt - output, CSMA_PKT_MAX bytes
+*
+*   @return     bytes in pPkt, 0 if the queue is empty
+*/
+uint8 csmaTake(uint16 now, uint8 *pPkt) {
+
+    uint8 len;
+
+    while((csmaCount > 0) && ((int16)(now - csmaQueue[0].deadline) > 0)) {
+        csmaStats.expired++;
+        csmaPop();
+    }
+    if(csmaCount == 0) {
+        return 0;
+    }
+
+    len = csmaQueue[0].len;
+    memcpy(pPkt, csmaQueue[0].data, len);
+    csmaPop();
+    csmaStats.sent++;
+    return len;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaGetStats
+*
+*   @brief      Returns the scheduler counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const csmaStats_t *csmaGetStats(void) {
+
+    return &csmaStats;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaBackoff
+*
+*   @brief      Draws a backoff of 0..2^BE-1 slots
+*
+*   @param      now - ticks
+*
+*   @return     none
+*/
+static void csmaBackoff(uint16 now) {
+
+    uint16 ticks;
+
+    ticks = (csmaRand() & ((1 << csmaBe) - 1)) * CSMA_SLOT_TICKS;
+    csmaNotBefore = now + ticks;
+    csmaStats.backoffs++;
+    csmaStats.backoffTicks += ticks;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaPop
+*
+*   @brief      Removes the packet at the head of the queue
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void csmaPop(void) {
+
+    uint8 i;
+
+    for(i = 1; i < csmaCount; i++) {
+        csmaQueue[i - 1] = csmaQueue[i];
+    }
+    csmaCount--;
+}
+
+
+/*******************************************************************************
+*   @fn         csmaRand
+*
+*   @brief      16 bit Galois LFSR, period 65535
+*
+*   @param      none
+*
+*   @return     next pseudo random value
+*/
+static uint16 csmaRand(void) {
+
+    uint8 i;
+
+    // Eight steps per draw so the low bits used for the window are fresh
+    for(i = 0; i < 8; i++) {
+        csmaRandom = (csmaRandom >> 1) ^ ((csmaRandom & 1) ? 0xB400 : 0);
+    }
+    return csmaRandom;
+}
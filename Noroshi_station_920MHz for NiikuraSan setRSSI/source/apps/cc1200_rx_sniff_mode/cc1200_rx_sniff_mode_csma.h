@@ -0,0 +1,89 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_csma.h
+//! @brief      Listen-before-talk transmit scheduler. Packets wait in a
+//!             bounded queue ordered by deadline, the earliest is sent
+//!             first and one whose deadline passes is dropped. Before each
+//!             attempt the scheduler waits a random number of slots drawn
+//!             from 0..2^BE-1; when the caller's clear channel assessment
+//!             finds the channel busy, BE grows by one up to CSMA_MAX_BE
+//!             and the packet is given up after CSMA_MAX_BACKOFFS busy
+//!             assessments. A caller that holds the channel after a clear
+//!             assessment can take further packets with csmaTake and send
+//!             them back to back. Decides only, the caller runs CCA and the
+//!             radio. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_CSMA_H
+#define CC1200_RX_SNIFF_MODE_CSMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// Time base of now, deadlines and slots: ACLK / 32
+#define CSMA_TICK_HZ            1024
+
+#ifndef CSMA_SLOT_TICKS
+#define CSMA_SLOT_TICKS         1       // ~1 ms, covers CCA and RX-to-TX turn
+#endif
+#ifndef CSMA_MIN_BE
+#define CSMA_MIN_BE             2
+#endif
+#ifndef CSMA_MAX_BE
+#define CSMA_MAX_BE             5
+#endif
+#ifndef CSMA_MAX_BACKOFFS
+#define CSMA_MAX_BACKOFFS       5
+#endif
+
+#define CSMA_QUEUE_SLOTS        4
+#define CSMA_PKT_MAX            32      // length byte included
+
+// csmaDone() results of an attempt
+#define CSMA_SENT               0       // channel clear, packet transmitted
+#define CSMA_BUSY               1       // CCA found the channel busy
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 queued;
+    uint32 queueFull;                   // refused by csmaQueuePut
+    uint32 expired;                     // deadline passed in the queue
+    uint32 sent;
+    uint32 ccaBusy;                     // assessments that found a carrier
+    uint32 accessFailures;              // given up after CSMA_MAX_BACKOFFS
+    uint32 backoffs;                    // random waits started
+    uint32 backoffTicks;                // total time spent backing off
+    uint8  maxBusyRun;                  // most busy CCAs for one packet
+} csmaStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void csmaInit(uint16 seed, uint16 now);
+uint8 csmaQueuePut(const uint8 *pPkt, uint8 len, uint16 deadline, uint16 now);
+uint8 csmaQueueCount(void);
+uint8 csmaDue(uint16 now);
+uint8 csmaNext(uint16 now, uint8 *pPkt);
+void csmaDone(uint8 result, uint16 now);
+uint8 csmaTake(uint16 now, uint8 *pPkt);
+const csmaStats_t *csmaGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
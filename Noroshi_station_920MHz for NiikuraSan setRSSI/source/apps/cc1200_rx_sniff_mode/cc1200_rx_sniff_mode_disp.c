@@ -0,0 +1,372 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_disp.c
+//! @brief      Retained display on the LCD, see cc1200_rx_sniff_mode_disp.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_disp.h"
+#include "spi_bus.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define DISP_ITEM_TEXT          0
+#define DISP_ITEM_INT           1
+#define DISP_ITEM_HLINE         2       // full width, at row y
+#define DISP_ITEM_INVERT        3       // whole page
+
+#define DISP_PAGES_ALL          0xFF
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8 type;
+    uint8 x;                            // column, row for DISP_ITEM_HLINE
+    uint8 page;
+    const char *pStr;
+    int32 value;
+} dispItem_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static dispItem_t dispItems[DISP_ITEMS_MAX];
+static uint8 dispCount;
+
+// Pages to redraw, and pages to send whole since the LCD content is unknown
+static uint8 dispDirtyPages;
+static uint8 dispFullPages;
+
+static uint8 dispFrameTicks;
+static uint8 dispFirst;                 // no frame sent yet
+static uint8 dispPartial;               // frame goes on, the bus queue was full
+static uint16 dispLast;                 // tick of the last frame
+
+static dispStats_t dispStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 dispAdd(uint8 type, uint8 x, uint8 page, const char *pStr, int32 value);
+static void dispDrawPage(uint8 page);
+
+
+/*******************************************************************************
+*   @fn         dispInit
+*
+*   @brief      Empties the screen and the item list. The first refresh sends
+*               all pages, whatever the LCD showed before
+*
+*   @param      frameTicks - 50 ms ticks between frames, DISP_FRAME_TICKS
+*
+*   @return     none
+*/
+void dispInit(uint8 frameTicks) {
+
+    dispCount = 0;
+    dispFrameTicks = frameTicks;
+    dispFirst = TRUE;
+    dispPartial = FALSE;
+    dispDirtyPages = DISP_PAGES_ALL;
+    dispFullPages = DISP_PAGES_ALL;
+    lcdBufferClear(0);
+    memset(&dispStats, 0, sizeof(dispStats));
+}
+
+
+/*******************************************************************************
+*   @fn         dispText
+*
+*   @brief      Adds a text
+*
+*   @param      x    - first column
+*   @param      page - LCD page
+*   @param      pStr - text, must stay valid, it is drawn again on each
+*                      refresh of the page
+*
+*   @return     item for dispSetText, DISP_ITEM_NONE if the list is full
+*/
+uint8 dispText(uint8 x, tLcdPage page, const char *pStr) {
+
+    return dispAdd(DISP_ITEM_TEXT, x, (uint8)page, pStr, 0);
+}
+
+
+/*******************************************************************************
+*   @fn         dispInt
+*
+*   @brief      Adds a number
+*
+*   @param      x     - first column
+*   @param      page  - LCD page
+*   @param      value - number shown
+*
+*   @return     item for dispSetInt, DISP_ITEM_NONE if the list is full
+*/
+uint8 dispInt(uint8 x, tLcdPage page, int32 value) {
+
+    return dispAdd(DISP_ITEM_INT, x, (uint8)page, NULL, value);
+}
+
+
+/*******************************************************************************
+*   @fn         dispHLine
+*
+*   @brief      Adds a line across the screen
+*
+*   @param      y - pixel row, 0..63
+*
+*   @return     item, DISP_ITEM_NONE if the list is full
+*/
+uint8 dispHLine(uint8 y) {
+
+    return dispAdd(DISP_ITEM_HLINE, y, y / LCD_PAGE_ROWS, NULL, 0);
+}
+
+
+/*******************************************************************************
+*   @fn         dispInvert
+*
+*   @brief      Inverts a page, over the items added to it before
+*
+*   @param      page - LCD page
+*
+*   @return     item, DISP_ITEM_NONE if the list is full
+*/
+uint8 dispInvert(tLcdPage page) {
+
+    return dispAdd(DISP_ITEM_INVERT, 0, (uint8)page, NULL, 0);
+}
+
+
+/*******************************************************************************
+*   @fn         dispSetText
+*
+*   @brief      Changes a text, its page is redrawn with the next frame
+*
+*   @param      item - from dispText
+*   @param      pStr - text, must stay valid
+*
+*   @return     none
+*/
+void dispSetText(uint8 item, const char *pStr) {
+
+    if((item >= dispCount) || (dispItems[item].type != DISP_ITEM_TEXT)) {
+        return;
+    }
+    dispItems[item].pStr = pStr;
+    dispDirtyPages |= BV(dispItems[item].page);
+}
+
+
+/*******************************************************************************
+*   @fn         dispSetInt
+*
+*   @brief      Changes a number, its page is redrawn with the next frame if
+*               the value differs
+*
+*   @param      item  - from dispInt
+*   @param      value - number shown
+*
+*   @return     none
+*/
+void dispSetInt(uint8 item, int32 value) {
+
+    if((item >= dispCount) || (dispItems[item].type != DISP_ITEM_INT) ||
+       (dispItems[item].value == value)) {
+        return;
+    }
+    dispItems[item].value = value;
+    dispDirtyPages |= BV(dispItems[item].page);
+}
+
+
+/*******************************************************************************
+*   @fn         dispDirty
+*
+*   @brief      Checks whether pages wait for a frame
+*
+*   @param      none
+*
+*   @return     TRUE if a page changed since the last frame
+*/
+uint8 dispDirty(void) {
+
+    return dispDirtyPages != 0;
+}
+
+
+/*******************************************************************************
+*   @fn         dispDue
+*
+*   @brief      Checks whether a frame is due: a page changed, the last
+*               frame has left the SPI bus and is DISP_FRAME_TICKS old, or
+*               did not fit in the bus queue
+*
+*   @param      now - 50 ms ticks
+*
+*   @return     TRUE if dispRefresh should run
+*/
+uint8 dispDue(uint16 now) {
+
+    return (dispDirtyPages != 0) && !spiBusPending(SPI_BUS_CLIENT_LCD) &&
+           (dispFirst || dispPartial || ((uint16)(now - dispLast) >= dispFrameTicks));
+}
+
+
+/*******************************************************************************
+*   @fn         dispRefresh
+*
+*   @brief      Sends a frame when due: redraws each dirty page and queues
+*               the columns from the first to the last that changed on the
+*               SPI bus, the SPI interrupt sends them. Pages left when the
+*               bus queue is full go with the next call, once it is empty
+*
+*   @param      now - 50 ms ticks
+*
+*   @return     none
+*/
+void dispRefresh(uint16 now) {
+
+    char old[LCD_COLS];
+    const char *pPage;
+    uint8 page;
+    uint8 first;
+    uint8 last;
+
+    if(!dispDue(now)) {
+        return;
+    }
+    if(!dispPartial) {
+        dispFirst = FALSE;
+        dispLast = now;
+        dispStats.frames++;
+    }
+
+    for(page = 0; page < LCD_PAGES; page++) {
+        if(!(dispDirtyPages & BV(page))) {
+            continue;
+        }
+        if(spiBusFree(SPI_BUS_CLIENT_LCD) < 2) {
+            break;
+        }
+        pPage = &lcdDefaultBuffer[page * LCD_COLS];
+        memcpy(old, pPage, LCD_COLS);
+        dispDrawPage(page);
+        dispDirtyPages &= ~BV(page);
+
+        if(dispFullPages & BV(page)) {
+            dispFullPages &= ~BV(page);
+            first = 0;
+            last = LCD_COLS - 1;
+        } else {
+            for(first = 0; (first < LCD_COLS) && (old[first] == pPage[first]); first++);
+            if(first == LCD_COLS) {
+                dispStats.pagesSame++;
+                continue;
+            }
+            for(last = LCD_COLS - 1; old[last] == pPage[last]; last--);
+        }
+        lcdSendPageStart(0, first, last, (tLcdPage)page, NULL);
+        dispStats.pagesSent++;
+        dispStats.bytesSent += last - first + 1;
+    }
+    dispPartial = (dispDirtyPages != 0);
+}
+
+
+/*******************************************************************************
+*   @fn         dispGetStats
+*
+*   @brief      Returns the display counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const dispStats_t *dispGetStats(void) {
+
+    return &dispStats;
+}
+
+
+/*******************************************************************************
+*   @fn         dispAdd
+*
+*   @brief      Appends an item and marks its page dirty
+*
+*   @param      type  - DISP_ITEM_x
+*   @param      x     - column, or row for a line
+*   @param      page  - LCD page
+*   @param      pStr  - text
+*   @param      value - number
+*
+*   @return     item, DISP_ITEM_NONE if the list is full
+*/
+static uint8 dispAdd(uint8 type, uint8 x, uint8 page, const char *pStr, int32 value) {
+
+    dispItem_t *pItem;
+
+    if((dispCount >= DISP_ITEMS_MAX) || (page >= LCD_PAGES)) {
+        return DISP_ITEM_NONE;
+    }
+    pItem = &dispItems[dispCount];
+    pItem->type = type;
+    pItem->x = x;
+    pItem->page = page;
+    pItem->pStr = pStr;
+    pItem->value = value;
+    dispDirtyPages |= BV(page);
+    return dispCount++;
+}
+
+
+/*******************************************************************************
+*   @fn         dispDrawPage
+*
+*   @brief      Clears a page in the LCD buffer and draws its items in the
+*               order they were added
+*
+*   @param      page - LCD page
+*
+*   @return     none
+*/
+static void dispDrawPage(uint8 page) {
+
+    const dispItem_t *pItem;
+    uint8 i;
+
+    lcdBufferClearPage(0, (tLcdPage)page);
+    for(i = 0; i < dispCount; i++) {
+        pItem = &dispItems[i];
+        if(pItem->page != page) {
+            continue;
+        }
+        switch(pItem->type) {
+        case DISP_ITEM_TEXT:
+            if(pItem->pStr != NULL) {
+                lcdBufferPrintString(0, pItem->pStr, pItem->x, (tLcdPage)page);
+            }
+            break;
+        case DISP_ITEM_INT:
+            lcdBufferPrintInt(0, pItem->value, pItem->x, (tLcdPage)page);
+            break;
+        case DISP_ITEM_HLINE:
+            lcdBufferSetHLine(0, 0, LCD_COLS - 1, pItem->x);
+            break;
+        case DISP_ITEM_INVERT:
+            lcdBufferInvertPage(0, 0, LCD_COLS, (tLcdPage)page);
+            break;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_disp.h
+//! @brief      Retained display on the DOGM128-6 LCD. The screen is a list
+//!             of items, texts, numbers, lines and inverted pages, set up
+//!             once; the application only changes their values. A change
+//!             marks the item's 8 pixel page dirty. At most DISP_FPS times
+//!             a second dispRefresh redraws the dirty pages in the LCD
+//!             buffer and queues, per page, only the columns that differ
+//!             from what the LCD shows, with lcdSendPageStart(). A packet
+//!             counter going from 1234 to 1235 sends 6 bytes instead of the
+//!             1 KB frame. The bytes go on the SPI bus shared with the flash
+//!             (spi_bus.h), after any queued flash transfer; a page is not
+//!             redrawn while the last frame is still queued. Builds under
+//!             gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_DISP_H
+#define CC1200_RX_SNIFF_MODE_DISP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "lcd_dogm128_6.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// Frames per second at most, 1..20 with the 50 ms tick
+#ifndef DISP_FPS
+#define DISP_FPS                4
+#endif
+#if (DISP_FPS < 1) || (DISP_FPS > 20)
+#error "DISP_FPS must be 1..20"
+#endif
+#define DISP_FRAME_TICKS        (20 / DISP_FPS)
+
+#define DISP_ITEMS_MAX          12
+#define DISP_ITEM_NONE          0xFF    // item table full
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 frames;                      // refreshes that sent or compared pages
+    uint32 pagesSent;
+    uint32 pagesSame;                   // redrawn but unchanged, not sent
+    uint32 bytesSent;                   // display data bytes
+} dispStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void dispInit(uint8 frameTicks);
+uint8 dispText(uint8 x, tLcdPage page, const char *pStr);
+uint8 dispInt(uint8 x, tLcdPage page, int32 value);
+uint8 dispHLine(uint8 y);
+uint8 dispInvert(tLcdPage page);
+void dispSetText(uint8 item, const char *pStr);
+void dispSetInt(uint8 item, int32 value);
+uint8 dispDirty(void);
+uint8 dispDue(uint16 now);
+void dispRefresh(uint16 now);
+const dispStats_t *dispGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
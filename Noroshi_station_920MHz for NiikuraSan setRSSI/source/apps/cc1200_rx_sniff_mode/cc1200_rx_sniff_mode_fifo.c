@@ -0,0 +1,132 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_fifo.c
+//! @brief      RX FIFO parser, see cc1200_rx_sniff_mode_fifo.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static rxFifoStats_t rxFifoStats;
+
+
+/*******************************************************************************
+*   @fn         rxFifoInit
+*
+*   @brief      Clears the parser counters
+*
+*   @param      none
+*
+*   @return     none
+*/
+void rxFifoInit(void) {
+
+    memset(&rxFifoStats, 0, sizeof(rxFifoStats));
+}
+
+
+/*******************************************************************************
+*   @fn         rxFifoParse
+*
+*   @brief      Walks the FIFO image packet by packet using the length byte.
+*               Each packet occupies 1 + length + RX_FIFO_STATUS_LEN bytes.
+*               Packets that fit a pool slot are copied into the pool, the
+*               rest are counted as dropped. A packet cut off at the end of
+*               the image (overflow) is dropped as well, since the caller
+*               flushes the FIFO afterwards. Packets the radio flagged with a
+*               bad CRC, and with RX_FIFO_FRAME_CRC station frames whose
+*               CRC-16 does not match, are rejected before they are copied.
+*               The image arrives in one DMA burst while the MCU sleeps, so
+*               the CRC runs over it here, no byte is used before the check
+*
+*   @param      pFifo    - bytes read from the RX FIFO
+*   @param      len      - number of bytes in pFifo (NUM_RXBYTES)
+*   @param      pPool    - packet pool to fill from index 0
+*   @param      poolSize - number of slots in pPool
+*
+*   @return     number of packets stored in pPool
+*/
+uint8 rxFifoParse(const uint8 *pFifo, uint8 len, rxPacket_t *pPool, uint8 poolSize) {
+
+    uint8  pos = 0;
+    uint8  stored = 0;
+    uint8  pktLen;
+    uint16 need;
+
+    while(pos < len) {
+
+        pktLen = pFifo[pos];
+        need = (uint16)pktLen + 1 + RX_FIFO_STATUS_LEN;
+
+        // Incomplete tail, lost with the flush that follows
+        if(need > (uint16)(len - pos)) {
+            rxFifoStats.droppedPackets++;
+            rxFifoStats.droppedBytes += len - pos;
+            break;
+        }
+
+        if(!(pFifo[pos + pktLen + RX_FIFO_STATUS_LEN] & RX_FIFO_CRC_OK_BM)) {
+            rxFifoStats.radioCrcErrors++;
+            rxFifoStats.droppedPackets++;
+            rxFifoStats.droppedBytes += need;
+        } else if(RX_FIFO_FRAME_CRC && (pktLen + 1 == RX_FIFO_STATION_LEN) &&
+                  !crc16Check(&pFifo[pos], pktLen + 1)) {
+            rxFifoStats.frameCrcErrors++;
+            rxFifoStats.droppedPackets++;
+            rxFifoStats.droppedBytes += need;
+        } else if((pktLen == 0) || (pktLen >= RX_FIFO_SLOT_SIZE) || (stored >= poolSize)) {
+            rxFifoStats.droppedPackets++;
+            rxFifoStats.droppedBytes += need;
+        } else {
+            pPool[stored].len = pktLen + 1;
+            memcpy(pPool[stored].data, &pFifo[pos], pktLen + 1);
+            memcpy(pPool[stored].status, &pFifo[pos + pktLen + 1], RX_FIFO_STATUS_LEN);
+            stored++;
+            rxFifoStats.packets++;
+        }
+
+        pos += (uint8)need;
+    }
+
+    return stored;
+}
+
+
+/*******************************************************************************
+*   @fn         rxFifoCountOverflow
+*
+*   @brief      Records an RX FIFO overflow (MARCSTATE RX_FIFO_ERR). The bytes
+*               lost are accounted for by rxFifoParse on the truncated image
+*
+*   @param      none
+*
+*   @return     none
+*/
+void rxFifoCountOverflow(void) {
+
+    rxFifoStats.overflows++;
+}
+
+
+/*******************************************************************************
+*   @fn         rxFifoGetStats
+*
+*   @brief      Returns the parser counters
+*
+*   @param      none
+*
+*   @return     pointer to the counters
+*/
+const rxFifoStats_t *rxFifoGetStats(void) {
+
+    return &rxFifoStats;
+}
@@ -0,0 +1,78 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_fifo.h
+//! @brief      RX FIFO parser. Splits the bytes drained from the CC1200 RX
+//!             FIFO into packets (length byte, payload, 2 appended status
+//!             bytes) and stores them in a caller supplied packet pool.
+//!             Corrupted packets are rejected on the way.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_FIFO_H
+#define CC1200_RX_SNIFF_MODE_FIFO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "cc1200_rx_sniff_mode_time.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define RX_FIFO_SIZE            128     // CC1200 RX FIFO depth
+#define RX_FIFO_STATUS_LEN      2       // appended RSSI, CRC_OK|LQI
+#define RX_FIFO_SLOT_SIZE       52      // length byte + payload (relay frame)
+#define RX_FIFO_POOL_SIZE       4       // packets kept per wake-up
+#define RX_FIFO_CRC_OK_BM       0x80    // status[1], radio CRC check passed
+
+// Station frames, also the longest record sent to the gateway. With
+// RX_FIFO_FRAME_CRC = 1 they end with a CRC-16 over the bytes before it
+// at RX_FIFO_POS_CRC, see cc1200_rx_sniff_mode_crc.h, senders seal them
+// with crc16Append and frames that fail it are dropped. With 0 the last
+// byte is the XOR parity of older senders and is not checked
+#define RX_FIFO_STATION_LEN     30
+#define RX_FIFO_POS_CRC         (RX_FIFO_STATION_LEN - CRC16_LEN)
+#ifndef RX_FIFO_FRAME_CRC
+#define RX_FIFO_FRAME_CRC       0
+#endif
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint8  len;                         // bytes used in data[] incl. length byte
+    uint8  data[RX_FIFO_SLOT_SIZE];     // data[0] is the length byte
+    uint8  status[RX_FIFO_STATUS_LEN];  // appended status bytes
+    uint8  channel;                     // set by the application
+    timeStamp_t stamp;                  // set by the application, UTC arrival
+} rxPacket_t;
+
+typedef struct {
+    uint32 packets;                     // complete packets stored in the pool
+    uint32 droppedPackets;              // all drops below, plus truncated, pool full
+    uint32 droppedBytes;                // FIFO bytes discarded with them
+    uint32 overflows;                   // RX_FIFO_ERR recoveries
+    uint32 radioCrcErrors;              // CRC_OK clear in the status byte
+    uint32 frameCrcErrors;              // station frame CRC-16 mismatch
+} rxFifoStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void rxFifoInit(void);
+uint8 rxFifoParse(const uint8 *pFifo, uint8 len, rxPacket_t *pPool, uint8 poolSize);
+void rxFifoCountOverflow(void);
+const rxFifoStats_t *rxFifoGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
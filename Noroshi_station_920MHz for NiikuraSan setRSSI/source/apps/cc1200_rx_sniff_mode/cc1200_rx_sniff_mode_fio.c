@@ -0,0 +1,431 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_fio.c
+//! @brief      Asynchronous SPI flash access, see cc1200_rx_sniff_mode_fio.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdint.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_fio.h"
+#include "flash_m25pex0.h"
+#include "spi_bus.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define FIO_OP_READ             0
+#define FIO_OP_PROGRAM          1
+#define FIO_OP_WRITE            2
+#define FIO_OP_ERASE            3
+
+#define FIO_PHASE_IDLE          0       // head command not started
+#define FIO_PHASE_XFER          1       // bytes moving in the SPI interrupt
+#define FIO_PHASE_WAIT          2       // flash programming or erasing
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8 op;
+    uint32 addr;                        // byte, page or sub-sector by op
+    uint8 *pData;
+    uint16 len;
+    fioCallback_t pfnDone;
+} fioCmd_t;
+
+typedef struct {
+    uint16 first;
+    uint16 retry;
+    uint16 limit;
+} fioTiming_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+// Poll times by op, reads are done when their transfer is
+static const fioTiming_t fioTiming[] = {
+    { 0, 0, 0 },
+    { FIO_PROGRAM_FIRST_FRAC, FIO_PROGRAM_RETRY_FRAC, FIO_PROGRAM_LIMIT_FRAC },
+    { FIO_WRITE_FIRST_FRAC, FIO_WRITE_RETRY_FRAC, FIO_WRITE_LIMIT_FRAC },
+    { FIO_ERASE_FIRST_FRAC, FIO_ERASE_RETRY_FRAC, FIO_ERASE_LIMIT_FRAC }
+};
+
+static fioCmd_t fioQueue[FIO_QUEUE_LEN];
+static uint8 fioHead;
+static uint8 fioCount;
+
+// Head command
+static uint8 fioPhase;
+static volatile uint8 fioXferDone;      // set by the SPI interrupt
+static uint16 fioStart;
+static uint16 fioPollAt;
+
+static fioStats_t fioStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 fioSubmit(uint8 op, uint32 addr, uint8 *pData, uint16 len,
+                       fioCallback_t pfnDone);
+static uint8 fioStartCmd(const fioCmd_t *pCmd);
+static void fioComplete(uint8 result, uint16 now);
+static void fioXferIsr(void);
+
+
+/*******************************************************************************
+*   @fn         fioInit
+*
+*   @brief      Empties the queue. The flash must be powered and its SPI set
+*               up, no transfer may be running
+*
+*   @param      none
+*
+*   @return     none
+*/
+void fioInit(void) {
+
+    fioHead = 0;
+    fioCount = 0;
+    fioPhase = FIO_PHASE_IDLE;
+    fioXferDone = FALSE;
+    memset(&fioStats, 0, sizeof(fioStats));
+}
+
+
+/*******************************************************************************
+*   @fn         fioRead
+*
+*   @brief      Queues a read
+*
+*   @param      addr    - flash byte address
+*   @param      pData   - output, untouched until the read starts
+*   @param      len     - bytes
+*   @param      pfnDone - called when the bytes are in pData, or NULL
+*
+*   @return     TRUE if queued, FALSE if the queue is full
+*/
+uint8 fioRead(uint32 addr, uint8 *pData, uint16 len, fioCallback_t pfnDone) {
+
+    return fioSubmit(FIO_OP_READ, addr, pData, len, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         fioProgram
+*
+*   @brief      Queues a page program, the page must be erased
+*
+*   @param      page    - flash page
+*   @param      pData   - bytes, must stay unchanged until the callback
+*   @param      len     - bytes, 1..256
+*   @param      pfnDone - called when programmed, or NULL
+*
+*   @return     TRUE if queued, FALSE if the queue is full
+*/
+uint8 fioProgram(uint16 page, uint8 *pData, uint16 len, fioCallback_t pfnDone) {
+
+    return fioSubmit(FIO_OP_PROGRAM, page, pData, len, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         fioWrite
+*
+*   @brief      Queues a page write, erase and program of the page in one
+*
+*   @param      page    - flash page
+*   @param      pData   - bytes, must stay unchanged until the callback
+*   @param      len     - bytes, 1..256
+*   @param      pfnDone - called when written, or NULL
+*
+*   @return     TRUE if queued, FALSE if the queue is full
+*/
+uint8 fioWrite(uint16 page, uint8 *pData, uint16 len, fioCallback_t pfnDone) {
+
+    return fioSubmit(FIO_OP_WRITE, page, pData, len, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         fioErase
+*
+*   @brief      Queues a sub-sector erase
+*
+*   @param      subSector - flash sub-sector of 16 pages
+*   @param      pfnDone   - called when erased, or NULL
+*
+*   @return     TRUE if queued, FALSE if the queue is full
+*/
+uint8 fioErase(uint8 subSector, fioCallback_t pfnDone) {
+
+    return fioSubmit(FIO_OP_ERASE, subSector, NULL, 0, pfnDone);
+}
+
+
+/*******************************************************************************
+*   @fn         fioPoll
+*
+*   @brief      Moves the queue on: starts the head command, reads the flash
+*               status when its poll is due and completes commands through
+*               their callbacks. Never waits. Call from the main loop when
+*               fioReady, the SPI interrupt wakes it after a transfer, the
+*               caller's timer after the returned delay
+*
+*   @param      now - 1/32768 s, wraps every 2 s
+*
+*   @return     1/32768 s to the next status poll, 0 if none is due
+*/
+uint16 fioPoll(uint16 now) {
+
+    const fioCmd_t *pCmd;
+    const fioTiming_t *pTiming;
+
+    while(fioCount > 0) {
+        pCmd = &fioQueue[fioHead];
+        pTiming = &fioTiming[pCmd->op];
+
+        if(fioPhase == FIO_PHASE_IDLE) {
+            fioXferDone = FALSE;
+            fioStart = now;
+            if(!fioStartCmd(pCmd)) {
+                fioStats.failed++;
+                fioComplete(FIO_FAILED, now);
+                continue;
+            }
+            fioPhase = FIO_PHASE_XFER;
+        }
+
+        if(fioPhase == FIO_PHASE_XFER) {
+            if(!fioXferDone) {
+                return 0;
+            }
+            if(pCmd->op == FIO_OP_READ) {
+                fioComplete(FIO_OK, now);
+                continue;
+            }
+            fioStart = now;
+            fioPhase = FIO_PHASE_WAIT;
+            fioPollAt = now + pTiming->first;
+        }
+
+        if((int16)(now - fioPollAt) < 0) {
+            return fioPollAt - now;
+        }
+        if(spiBusBusy()) {
+            fioPollAt = now + FIO_BUS_RETRY_FRAC;
+            return FIO_BUS_RETRY_FRAC;
+        }
+        fioStats.polls++;
+        if(!flashWriteInProgress()) {
+            fioComplete(FIO_OK, now);
+        } else if((uint16)(now - fioStart) >= pTiming->limit) {
+            fioStats.timeouts++;
+            fioComplete(FIO_TIMEOUT, now);
+        } else {
+            fioPollAt = now + pTiming->retry;
+            return pTiming->retry;
+        }
+    }
+    return 0;
+}
+
+
+/*******************************************************************************
+*   @fn         fioReady
+*
+*   @brief      Checks whether fioPoll has something to do now
+*
+*   @param      now - 1/32768 s, wraps every 2 s
+*
+*   @return     TRUE if fioPoll should run
+*/
+uint8 fioReady(uint16 now) {
+
+    if(fioCount == 0) {
+        return FALSE;
+    }
+    return (fioPhase == FIO_PHASE_IDLE) ||
+           ((fioPhase == FIO_PHASE_XFER) && fioXferDone) ||
+           ((fioPhase == FIO_PHASE_WAIT) && ((int16)(now - fioPollAt) >= 0));
+}
+
+
+/*******************************************************************************
+*   @fn         fioBusy
+*
+*   @brief      Checks whether commands are queued or running
+*
+*   @param      none
+*
+*   @return     TRUE if the queue is not empty
+*/
+uint8 fioBusy(void) {
+
+    return fioCount > 0;
+}
+
+
+/*******************************************************************************
+*   @fn         fioFull
+*
+*   @brief      Checks whether the queue refuses commands. It has room again
+*               once fioPoll finishes one, when fioReady wakes
+*
+*   @param      none
+*
+*   @return     TRUE if FIO_QUEUE_LEN commands are queued
+*/
+uint8 fioFull(void) {
+
+    return fioCount >= FIO_QUEUE_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         fioGetStats
+*
+*   @brief      Returns the flash access counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const fioStats_t *fioGetStats(void) {
+
+    return &fioStats;
+}
+
+
+/*******************************************************************************
+*   @fn         fioSubmit
+*
+*   @brief      Appends a command to the queue
+*
+*   @param      op      - FIO_OP_x
+*   @param      addr    - byte address, page or sub-sector
+*   @param      pData   - data
+*   @param      len     - bytes
+*   @param      pfnDone - callback, or NULL
+*
+*   @return     TRUE if queued
+*/
+static uint8 fioSubmit(uint8 op, uint32 addr, uint8 *pData, uint16 len,
+                       fioCallback_t pfnDone) {
+
+    fioCmd_t *pCmd;
+
+    if(fioCount >= FIO_QUEUE_LEN) {
+        fioStats.refused++;
+        return FALSE;
+    }
+    pCmd = &fioQueue[(fioHead + fioCount) % FIO_QUEUE_LEN];
+    pCmd->op = op;
+    pCmd->addr = addr;
+    pCmd->pData = pData;
+    pCmd->len = len;
+    pCmd->pfnDone = pfnDone;
+    fioCount++;
+    if(fioCount > fioStats.depthMax) {
+        fioStats.depthMax = fioCount;
+    }
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         fioStartCmd
+*
+*   @brief      Starts a command on the flash
+*
+*   @param      pCmd - command
+*
+*   @return     TRUE if started
+*/
+static uint8 fioStartCmd(const fioCmd_t *pCmd) {
+
+    switch(pCmd->op) {
+    case FIO_OP_READ:
+        return flashReadStart(pCmd->addr, pCmd->pData, pCmd->len, &fioXferIsr) == 0;
+    case FIO_OP_PROGRAM:
+        return flashPageProgramStart((uint16)pCmd->addr, pCmd->pData, pCmd->len,
+                                     &fioXferIsr) == 0;
+    case FIO_OP_WRITE:
+        return flashPageWriteStart((uint16)pCmd->addr, pCmd->pData, pCmd->len,
+                                   &fioXferIsr) == 0;
+    case FIO_OP_ERASE:
+        return flashSubSectorEraseStart((uint8)pCmd->addr, &fioXferIsr) == 0;
+    default:
+        return FALSE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         fioComplete
+*
+*   @brief      Removes the head command and calls its callback, which may
+*               queue the next command
+*
+*   @param      result - FIO_OK, FIO_TIMEOUT or FIO_FAILED
+*   @param      now    - 1/32768 s
+*
+*   @return     none
+*/
+static void fioComplete(uint8 result, uint16 now) {
+
+    const fioCmd_t *pCmd = &fioQueue[fioHead];
+    fioCallback_t pfnDone = pCmd->pfnDone;
+    uint16 took = now - fioStart;
+
+    switch(pCmd->op) {
+    case FIO_OP_READ:
+        fioStats.reads++;
+        break;
+    case FIO_OP_PROGRAM:
+        fioStats.programs++;
+        if(took > fioStats.programMaxFrac) {
+            fioStats.programMaxFrac = took;
+        }
+        break;
+    case FIO_OP_WRITE:
+        fioStats.writes++;
+        break;
+    case FIO_OP_ERASE:
+        fioStats.erases++;
+        if(took > fioStats.eraseMaxFrac) {
+            fioStats.eraseMaxFrac = took;
+        }
+        break;
+    }
+
+    fioHead = (fioHead + 1) % FIO_QUEUE_LEN;
+    fioCount--;
+    fioPhase = FIO_PHASE_IDLE;
+    if(pfnDone != NULL) {
+        pfnDone(result);
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         fioXferIsr
+*
+*   @brief      Called from the SPI interrupt when a transfer has ended, the
+*               interrupt then wakes the main loop
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void fioXferIsr(void) {
+
+    fioXferDone = TRUE;
+}
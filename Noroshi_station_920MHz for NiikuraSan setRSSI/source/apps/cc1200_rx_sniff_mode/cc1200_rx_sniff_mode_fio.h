@@ -0,0 +1,97 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_fio.h
+//! @brief      Asynchronous access to the M25PE20 SPI flash. Reads, page
+//!             programs, page writes and sub-sector erases are queued and
+//!             started from fioPoll, which returns at once. Bytes move in
+//!             the background in the USCI_B2 interrupt, see flashReadStart()
+//!             (the F5438A has no DMA trigger for USCI_B2 and DMA channels
+//!             0 and 1 belong to the radio). A program, write or erase is
+//!             then polled for its end, one status read per poll, after
+//!             its typical time and then every retry time; fioPoll returns
+//!             the delay to the next poll for the caller's timer. A poll
+//!             that finds the SPI bus in use by the LCD (spi_bus.h) is put
+//!             off rather than waiting for the bus. Each command completes
+//!             through its callback, called from fioPoll in the main loop,
+//!             never from an interrupt. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_FIO_H
+#define CC1200_RX_SNIFF_MODE_FIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define FIO_QUEUE_LEN           4
+
+// Command results passed to the callback
+#define FIO_OK                  0
+#define FIO_TIMEOUT             1       // still busy after the timeout
+#define FIO_FAILED              2       // not started, bad length
+
+// Poll times in 1/32768 s, from the M25PE20 datasheet: first poll at the
+// typical time, then every retry time, given up at twice the maximum
+#define FIO_PROGRAM_FIRST_FRAC  27      // 0.8 ms
+#define FIO_PROGRAM_RETRY_FRAC  33      // 1 ms
+#define FIO_PROGRAM_LIMIT_FRAC  328     // 10 ms
+#define FIO_WRITE_FIRST_FRAC    360     // 11 ms
+#define FIO_WRITE_RETRY_FRAC    66      // 2 ms
+#define FIO_WRITE_LIMIT_FRAC    1638    // 50 ms
+#define FIO_ERASE_FIRST_FRAC    1638    // 50 ms
+#define FIO_ERASE_RETRY_FRAC    164     // 5 ms
+#define FIO_ERASE_LIMIT_FRAC    9830    // 300 ms
+
+// Status poll put off while the SPI bus, shared with the LCD, is in use
+#define FIO_BUS_RETRY_FRAC      8       // 0.25 ms
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+// Called from fioPoll with FIO_OK, FIO_TIMEOUT or FIO_FAILED
+typedef void (*fioCallback_t)(uint8 result);
+
+typedef struct {
+    uint32 reads;
+    uint32 programs;
+    uint32 writes;
+    uint32 erases;
+    uint32 polls;                       // status reads
+    uint32 timeouts;
+    uint32 failed;
+    uint32 refused;                     // queue full
+    uint16 programMaxFrac;              // longest program, transfer to ready
+    uint16 eraseMaxFrac;
+    uint8  depthMax;
+} fioStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void fioInit(void);
+uint8 fioRead(uint32 addr, uint8 *pData, uint16 len, fioCallback_t pfnDone);
+uint8 fioProgram(uint16 page, uint8 *pData, uint16 len, fioCallback_t pfnDone);
+uint8 fioWrite(uint16 page, uint8 *pData, uint16 len, fioCallback_t pfnDone);
+uint8 fioErase(uint8 subSector, fioCallback_t pfnDone);
+uint16 fioPoll(uint16 now);
+uint8 fioReady(uint16 now);
+uint8 fioBusy(void);
+uint8 fioFull(void);
+const fioStats_t *fioGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1103 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_flog.c
+//! @brief      Store-and-forward log on the SPI flash, see
+//!             cc1200_rx_sniff_mode_flog.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdint.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_flog.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+#include "cc1200_rx_sniff_mode_fio.h"
+#include "cc1200_rx_sniff_mode_tag.h"
+#include "flash_m25pex0.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define FLOG_REC_MAX            (FLOG_REC_POS_DATA + RX_FIFO_SLOT_SIZE)
+#if FLOG_REC_MAX > FLOG_RECORDS_MAX
+#error "Flash log record does not fit a page"
+#endif
+#if FLOG_INDEX_LEN > FLOG_PAGE_SIZE
+#error "Flash log index does not fit a page"
+#endif
+#define FLOG_NEXT(page)         (((page) + 1 < FLOG_PAGES) ? (page) + 1 : 0)
+#define FLOG_SLOT(page)         ((page) % FLOG_SUBSECTOR_PAGES)
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8  data[FLOG_PAGE_SIZE];        // page image, records from FLOG_POS_RECORDS
+    uint8  used;                        // record bytes
+    uint8  unsent;                      // records without FLOG_REC_SENT
+    uint8  ready;                       // waits for flogTask to program it
+    uint8  writing;                     // being programmed, until flogPageDone
+    uint32 since;                       // seconds, first record
+} flogBuf_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+// Records not yet on the flash. Appends go to flogBuf[flogActive]; when
+// both are ready the other one is older
+static flogBuf_t flogBuf[2];
+static uint8 flogActive;
+
+// Ring: pages [tail, head) wait for replay. A page's sequence number is
+// its position in the ring, counted from the first page ever written
+static uint16 flogHead;
+static uint32 flogHeadSeq;
+static uint8 flogErased;                // erased pages from the head on
+static uint16 flogTail;
+static uint32 flogTailSeq;
+
+// Page being replayed
+static uint8 flogRead[FLOG_PAGE_SIZE];
+static uint16 flogReadPos;
+static uint16 flogReadEnd;
+static uint8 flogReadFlash;             // from the flash, not a RAM buffer
+static uint32 flogReadSeq;
+
+// Read cursor: sequence after the last page replayed completely
+static uint32 flogDoneSeq;
+static uint32 flogCursorGen;
+static uint8 flogCursorDirty;
+static uint8 flogDonePages;             // since the last save
+static uint8 flogCursor[FLOG_CURSOR_LEN];
+
+// A flash command of the log is queued or running, one at a time
+static uint8 flogBusy;
+
+// Index of the sub-sector of the head, the bloom filter is kept in place
+static uint8 flogIndex[FLOG_INDEX_LEN];
+static uint16 flogIndexRecords;
+static uint32 flogIndexMin;
+static uint32 flogIndexMax;
+
+static flogStats_t flogStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void flogWritePage(flogBuf_t *pBuf);
+static void flogErase(void);
+static void flogWriteCursor(void);
+static void flogLoadPage(void);
+static void flogPageDone(uint8 result);
+static void flogEraseDone(uint8 result);
+static void flogCursorDone(uint8 result);
+static void flogLoadDone(uint8 result);
+static void flogWriteIndex(void);
+static void flogIndexDone(uint8 result);
+static void flogIndexReset(void);
+static void flogIndexAdd(const uint8 *pRecords, uint8 used);
+static void flogIndexFinish(void);
+static void flogBloomBits(uint32 tagId, uint16 *pBits);
+static uint32 flogRecordTag(const rxPacket_t *pPacket);
+static void flogTake(flogBuf_t *pBuf);
+static uint8 flogPageBlank(uint16 page);
+static void flogPut32(uint8 *pOut, uint32 value);
+
+
+/*******************************************************************************
+*   @fn         flogInit
+*
+*   @brief      Finds the ring on the flash: the newest valid cursor and the
+*               page headers. The write position follows the page with the
+*               highest sequence number, past pages a power loss left half
+*               written. Reads the flash directly, the flash must be
+*               powered, its SPI set up and no fio command queued
+*
+*   @param      none
+*
+*   @return     none
+*/
+void flogInit(void) {
+
+    uint8 buf[FLOG_CURSOR_LEN];
+    uint8 cursorValid = FALSE;
+    uint32 cursorSeq = 0;
+    uint32 gen;
+    uint32 seq;
+    uint32 maxSeq = 0;
+    uint32 minSeq = 0;
+    uint16 maxPage = 0;
+    uint8 found = FALSE;
+    uint16 page;
+
+    memset(flogBuf, 0, sizeof(flogBuf));
+    flogActive = 0;
+    flogReadPos = 0;
+    flogReadEnd = 0;
+    flogReadFlash = FALSE;
+    flogCursorDirty = FALSE;
+    flogDonePages = 0;
+    flogCursorGen = 0;
+    flogBusy = FALSE;
+    flogIndexReset();
+    memset(&flogStats, 0, sizeof(flogStats));
+
+    // Newest cursor
+    for(page = 0; page < FLOG_SUBSECTOR_PAGES; page++) {
+        flashRead((uint32)(FLOG_CURSOR_PAGE + page) * FLOG_PAGE_SIZE, buf, FLOG_CURSOR_LEN);
+        if((buf[0] != FLOG_CURSOR_MAGIC) || !crc16Check(buf, FLOG_CURSOR_LEN)) {
+            continue;
+        }
+        gen = flogGet32(&buf[1]);
+        if(!cursorValid || ((int32)(gen - flogCursorGen) > 0)) {
+            flogCursorGen = gen;
+            cursorSeq = flogGet32(&buf[5]);
+            cursorValid = TRUE;
+        }
+    }
+
+    // Newest page
+    for(page = 0; page < FLOG_PAGES; page++) {
+        flashRead((uint32)(FLOG_FIRST_PAGE + page) * FLOG_PAGE_SIZE, buf, FLOG_POS_RECORDS);
+        seq = flogGet32(&buf[FLOG_POS_SEQ]);
+        if((buf[FLOG_POS_MAGIC] != FLOG_PAGE_MAGIC) ||
+           (buf[FLOG_POS_USED] > FLOG_RECORDS_MAX) || (seq == 0xFFFFFFFF)) {
+            continue;
+        }
+        if(!found || ((int32)(seq - maxSeq) > 0)) {
+            maxSeq = seq;
+            maxPage = page;
+            found = TRUE;
+        }
+    }
+
+    if(!found) {
+        flogHead = 0;
+        flogHeadSeq = cursorValid ? cursorSeq : 1;
+        flogErased = 0;
+        flogTail = flogHead;
+        flogTailSeq = flogHeadSeq;
+        flogDoneSeq = flogTailSeq;
+        return;
+    }
+
+    // Oldest page still in sequence with the newest one
+    minSeq = maxSeq;
+    for(page = 0; page < FLOG_PAGES; page++) {
+        flashRead((uint32)(FLOG_FIRST_PAGE + page) * FLOG_PAGE_SIZE, buf, FLOG_POS_RECORDS);
+        seq = flogGet32(&buf[FLOG_POS_SEQ]);
+        if((buf[FLOG_POS_MAGIC] != FLOG_PAGE_MAGIC) || ((int32)(maxSeq - seq) < 0) ||
+           (maxSeq - seq >= FLOG_PAGES)) {
+            continue;
+        }
+        if(((uint32)((maxPage + FLOG_PAGES - page) % FLOG_PAGES) == maxSeq - seq) &&
+           ((int32)(seq - minSeq) < 0)) {
+            minSeq = seq;
+        }
+    }
+
+    flogHead = FLOG_NEXT(maxPage);
+    flogHeadSeq = maxSeq + 1;
+    while(((flogHead % FLOG_SUBSECTOR_PAGES) != 0) && !flogPageBlank(flogHead)) {
+        flogHead = FLOG_NEXT(flogHead);
+        flogHeadSeq++;
+    }
+    flogErased = (FLOG_SUBSECTOR_PAGES - FLOG_SLOT(flogHead)) % FLOG_SUBSECTOR_PAGES;
+
+    // Index of the pages already in the head's sub-sector
+    for(page = flogHead - FLOG_SLOT(flogHead); page != flogHead; page++) {
+        flashRead((uint32)(FLOG_FIRST_PAGE + page) * FLOG_PAGE_SIZE, flogRead, FLOG_PAGE_SIZE);
+        if((flogRead[FLOG_POS_MAGIC] == FLOG_PAGE_MAGIC) &&
+           (flogRead[FLOG_POS_USED] <= FLOG_RECORDS_MAX) &&
+           crc16Check(flogRead, FLOG_POS_RECORDS + flogRead[FLOG_POS_USED] + CRC16_LEN)) {
+            flogIndexAdd(&flogRead[FLOG_POS_RECORDS], flogRead[FLOG_POS_USED]);
+        }
+    }
+
+    flogTailSeq = minSeq;
+    if(cursorValid && ((int32)(cursorSeq - minSeq) > 0) &&
+       ((int32)(cursorSeq - flogHeadSeq) <= 0)) {
+        flogTailSeq = cursorSeq;
+    }
+    if((int32)(flogTailSeq - (maxSeq + 1)) >= 0) {
+        flogTailSeq = flogHeadSeq;      // all replayed
+    }
+    flogTail = (uint16)((maxPage + FLOG_PAGES - (maxSeq - flogTailSeq) % FLOG_PAGES) % FLOG_PAGES);
+    if(flogTailSeq == flogHeadSeq) {
+        flogTail = flogHead;
+    }
+    flogDoneSeq = flogTailSeq;
+}
+
+
+/*******************************************************************************
+*   @fn         flogAppend
+*
+*   @brief      Adds a record to the page being collected. A full page waits
+*               for flogTask, collection goes on in the other buffer. A
+*               record already sent is kept for the history only, flogGet
+*               passes over it
+*
+*   @param      pPacket - record, its len, data, channel and stamp are kept
+*   @param      now     - seconds
+*   @param      sent    - TRUE if the gateway has the record already
+*
+*   @return     TRUE if taken, FALSE if too long or both buffers wait
+*/
+uint8 flogAppend(const rxPacket_t *pPacket, uint32 now, uint8 sent) {
+
+    flogBuf_t *pBuf = &flogBuf[flogActive];
+    uint8 size = FLOG_REC_POS_DATA + pPacket->len;
+    uint8 *pRec;
+
+    if((pPacket->len == 0) || (pPacket->len > RX_FIFO_SLOT_SIZE)) {
+        flogStats.refused++;
+        return FALSE;
+    }
+
+    if(pBuf->ready || (pBuf->used + size > FLOG_RECORDS_MAX)) {
+        pBuf->ready = TRUE;
+        if(flogBuf[flogActive ^ 1].ready) {
+            flogStats.refused++;
+            return FALSE;
+        }
+        flogActive ^= 1;
+        pBuf = &flogBuf[flogActive];
+        pBuf->used = 0;
+        pBuf->unsent = 0;
+    }
+    if(pBuf->used == 0) {
+        pBuf->since = now;
+    }
+
+    pRec = &pBuf->data[FLOG_POS_RECORDS + pBuf->used];
+    pRec[FLOG_REC_POS_LEN] = sent ? (pPacket->len | FLOG_REC_SENT) : pPacket->len;
+    pRec[FLOG_REC_POS_CHANNEL] = pPacket->channel;
+    timeSerialize(&pPacket->stamp, &pRec[FLOG_REC_POS_STAMP]);
+    memcpy(&pRec[FLOG_REC_POS_DATA], pPacket->data, pPacket->len);
+    pBuf->used += size;
+    if(!sent) {
+        pBuf->unsent++;
+    }
+    flogStats.appended++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogGet
+*
+*   @brief      Returns the oldest record: from the flash pages first, then
+*               from the page buffers, which are then not programmed at all.
+*               When the loaded page is used up the next one is queued for
+*               reading and FALSE returned until it is in, see flogAvailable
+*
+*   @param      pPacket - output, len, data, channel and stamp
+*
+*   @return     TRUE if a record was returned, FALSE if the log is empty or
+*               waits for the flash
+*/
+uint8 flogGet(rxPacket_t *pPacket) {
+
+    const uint8 *pRec;
+    uint16 len;
+
+    while(TRUE) {
+        while(flogReadPos >= flogReadEnd) {
+            if(flogReadFlash) {
+                flogReadFlash = FALSE;
+                flogDoneSeq = flogReadSeq + 1;
+                if((++flogDonePages >= FLOG_CURSOR_SAVE_PAGES) ||
+                   (flogTailSeq == flogHeadSeq)) {
+                    flogCursorDirty = TRUE;
+                }
+            }
+            if(flogBusy) {
+                return FALSE;
+            } else if(flogTailSeq != flogHeadSeq) {
+                flogLoadPage();
+                return FALSE;
+            } else if(flogBuf[flogActive ^ 1].unsent > 0) {
+                flogTake(&flogBuf[flogActive ^ 1]);
+            } else if(flogBuf[flogActive].unsent > 0) {
+                flogTake(&flogBuf[flogActive]);
+            } else {
+                return FALSE;
+            }
+        }
+
+        pRec = &flogRead[flogReadPos];
+        len = flogParseRecord(pRec, flogReadEnd - flogReadPos, pPacket);
+        if(len == 0) {
+            flogStats.badRecords++;
+            flogReadPos = flogReadEnd;
+        } else {
+            flogReadPos += len;
+            if(!(pRec[FLOG_REC_POS_LEN] & FLOG_REC_SENT)) {
+                break;
+            }
+        }
+    }
+
+    flogStats.replayed++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogRoom
+*
+*   @brief      Counts the records of a length flogAppend takes before it
+*               refuses, in the page being collected and the other buffer
+*
+*   @param      len - record bytes
+*
+*   @return     records, at most 255
+*/
+uint8 flogRoom(uint8 len) {
+
+    const flogBuf_t *pBuf = &flogBuf[flogActive];
+    uint8 size = FLOG_REC_POS_DATA + len;
+    uint16 room = 0;
+
+    if(!pBuf->ready) {
+        room = (FLOG_RECORDS_MAX - pBuf->used) / size;
+    }
+    if(!flogBuf[flogActive ^ 1].ready) {
+        room += FLOG_RECORDS_MAX / size;
+    }
+    return (room > 0xFF) ? 0xFF : (uint8)room;
+}
+
+
+/*******************************************************************************
+*   @fn         flogPending
+*
+*   @brief      Checks whether unsent records wait in the log, on the flash
+*               or in RAM. New records must then go to the log too, to keep
+*               the order
+*
+*   @param      none
+*
+*   @return     TRUE if flogGet has records
+*/
+uint8 flogPending(void) {
+
+    return (flogTailSeq != flogHeadSeq) || (flogReadPos < flogReadEnd) ||
+           (flogBuf[0].unsent > 0) || (flogBuf[1].unsent > 0);
+}
+
+
+/*******************************************************************************
+*   @fn         flogAvailable
+*
+*   @brief      Checks whether flogGet can go on now: a record is loaded, or
+*               no flash command runs, the fio queue has room and the log
+*               holds records
+*
+*   @param      none
+*
+*   @return     TRUE if flogGet returns a record or queues the next page
+*/
+uint8 flogAvailable(void) {
+
+    return (flogReadPos < flogReadEnd) || (!flogBusy && !fioFull() && flogPending());
+}
+
+
+/*******************************************************************************
+*   @fn         flogReady
+*
+*   @brief      Checks whether flogTask has flash work to queue. While the
+*               fio queue is full it waits for fioReady instead
+*
+*   @param      now - seconds
+*
+*   @return     TRUE if flogTask should run
+*/
+uint8 flogReady(uint32 now) {
+
+    const flogBuf_t *pBuf = &flogBuf[flogActive];
+
+    return !flogBusy && !fioFull() &&
+           (flogBuf[0].ready || flogBuf[1].ready || flogCursorDirty ||
+            ((FLOG_SLOT(flogHead) == FLOG_INDEX_SLOT) && (flogErased > 0)) ||
+            ((pBuf->used > 0) && (now - pBuf->since >= FLOG_FLUSH_S)) ||
+            ((flogErased <= FLOG_ERASE_AHEAD_PAGES) && (pBuf->used > 0)));
+}
+
+
+/*******************************************************************************
+*   @fn         flogTask
+*
+*   @brief      Queues one flash command: writes the index of a full
+*               sub-sector, else programs the oldest waiting page into an
+*               erased one, else erases the next sub-sector once
+*               FLOG_ERASE_AHEAD_PAGES or fewer erased pages are left while
+*               records come in, else saves the cursor. A page collected for
+*               FLOG_FLUSH_S is closed first. Never waits, the command
+*               completes in fioPoll
+*
+*   @param      now - seconds
+*
+*   @return     none
+*/
+void flogTask(uint32 now) {
+
+    flogBuf_t *pBuf = &flogBuf[flogActive];
+    flogBuf_t *pReady = NULL;
+
+    if(flogBusy || fioFull()) {
+        return;
+    }
+
+    if(!pBuf->ready && (pBuf->used > 0) && (now - pBuf->since >= FLOG_FLUSH_S)) {
+        pBuf->ready = TRUE;
+        flogStats.partialPages++;
+    }
+
+    if(flogBuf[flogActive ^ 1].ready) {
+        pReady = &flogBuf[flogActive ^ 1];
+    } else if(pBuf->ready) {
+        pReady = pBuf;
+    }
+
+    if((FLOG_SLOT(flogHead) == FLOG_INDEX_SLOT) && (flogErased > 0)) {
+        flogWriteIndex();
+    } else if((pReady != NULL) && (flogErased > 0)) {
+        flogWritePage(pReady);
+    } else if((pReady != NULL) ||
+              ((flogErased <= FLOG_ERASE_AHEAD_PAGES) && (pBuf->used > 0))) {
+        flogErase();
+    } else if(flogCursorDirty) {
+        flogWriteCursor();
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogGetStats
+*
+*   @brief      Returns the log counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const flogStats_t *flogGetStats(void) {
+
+    return &flogStats;
+}
+
+
+/*******************************************************************************
+*   @fn         flogHeadPage
+*
+*   @brief      Returns the ring page the next page is programmed to
+*
+*   @param      none
+*
+*   @return     ring page, 0..FLOG_PAGES-1
+*/
+uint16 flogHeadPage(void) {
+
+    return flogHead;
+}
+
+
+/*******************************************************************************
+*   @fn         flogOpenIndex
+*
+*   @brief      Returns the index of the sub-sector of the head, as it will
+*               be written, for the pages programmed so far
+*
+*   @param      none
+*
+*   @return     FLOG_INDEX_LEN bytes, valid until the next flogTask
+*/
+const uint8 *flogOpenIndex(void) {
+
+    flogIndexFinish();
+    return flogIndex;
+}
+
+
+/*******************************************************************************
+*   @fn         flogIndexMatch
+*
+*   @brief      Checks an index page against a query. A TagID that is not in
+*               the bloom filter is surely not in the sub-sector; one that is
+*               may be, ~2 % false hits for 100 TagIDs in the sub-sector
+*
+*   @param      pIndex - FLOG_INDEX_LEN bytes, from the flash or flogOpenIndex
+*   @param      tagId  - TagID or FLOG_TAG_ANY
+*   @param      from   - first UTC second or FLOG_TIME_FIRST
+*   @param      to     - last UTC second or FLOG_TIME_LAST
+*
+*   @return     TRUE if the sub-sector may hold matching records
+*/
+uint8 flogIndexMatch(const uint8 *pIndex, uint32 tagId, uint32 from, uint32 to) {
+
+    uint16 bits[FLOG_BLOOM_HASHES];
+    uint8 i;
+
+    if((pIndex[0] != FLOG_INDEX_MAGIC) || !crc16Check(pIndex, FLOG_INDEX_LEN)) {
+        return FALSE;
+    }
+    if(((pIndex[FLOG_IDX_POS_RECORDS] | pIndex[FLOG_IDX_POS_RECORDS + 1]) == 0) ||
+       (((from != FLOG_TIME_FIRST) || (to != FLOG_TIME_LAST)) &&
+        ((flogGet32(&pIndex[FLOG_IDX_POS_MAX]) < from) ||
+         (flogGet32(&pIndex[FLOG_IDX_POS_MIN]) > to)))) {
+        return FALSE;
+    }
+    if(tagId != FLOG_TAG_ANY) {
+        flogBloomBits(tagId, bits);
+        for(i = 0; i < FLOG_BLOOM_HASHES; i++) {
+            if(!(pIndex[FLOG_IDX_POS_BLOOM + (bits[i] >> 3)] & BV(bits[i] & 7))) {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogParseRecord
+*
+*   @brief      Reads a record of a page
+*
+*   @param      pRec    - record
+*   @param      left    - bytes from the record to the end of the records
+*   @param      pPacket - output, len, data, channel and stamp
+*
+*   @return     bytes of the record, 0 if it is damaged
+*/
+uint8 flogParseRecord(const uint8 *pRec, uint16 left, rxPacket_t *pPacket) {
+
+    uint8 len = pRec[FLOG_REC_POS_LEN] & FLOG_REC_LEN_BM;
+
+    if((len == 0) || (len > RX_FIFO_SLOT_SIZE) || (FLOG_REC_POS_DATA + len > left)) {
+        return 0;
+    }
+    pPacket->len = len;
+    pPacket->channel = pRec[FLOG_REC_POS_CHANNEL];
+    timeParse(&pRec[FLOG_REC_POS_STAMP], &pPacket->stamp);
+    memcpy(pPacket->data, &pRec[FLOG_REC_POS_DATA], len);
+    return FLOG_REC_POS_DATA + len;
+}
+
+
+/*******************************************************************************
+*   @fn         flogRecordMatch
+*
+*   @brief      Checks a record against a query. Records without UTC time
+*               only match when the whole time is asked for
+*
+*   @param      pPacket - record
+*   @param      tagId   - TagID or FLOG_TAG_ANY
+*   @param      from    - first UTC second or FLOG_TIME_FIRST
+*   @param      to      - last UTC second or FLOG_TIME_LAST
+*
+*   @return     TRUE if the record matches
+*/
+uint8 flogRecordMatch(const rxPacket_t *pPacket, uint32 tagId, uint32 from, uint32 to) {
+
+    if((tagId != FLOG_TAG_ANY) && (flogRecordTag(pPacket) != tagId)) {
+        return FALSE;
+    }
+    if((from == FLOG_TIME_FIRST) && (to == FLOG_TIME_LAST)) {
+        return TRUE;
+    }
+    return !(pPacket->stamp.frac & TIME_FRAC_NO_EPOCH) &&
+           (pPacket->stamp.sec >= from) && (pPacket->stamp.sec <= to);
+}
+
+
+/*******************************************************************************
+*   @fn         flogWritePage
+*
+*   @brief      Queues the program of a page buffer at the head, which is
+*               erased. The buffer is kept until flogPageDone
+*
+*   @param      pBuf - ready page buffer
+*
+*   @return     none
+*/
+static void flogWritePage(flogBuf_t *pBuf) {
+
+    uint16 len;
+
+    len = FLOG_POS_RECORDS + pBuf->used;
+    pBuf->data[FLOG_POS_MAGIC] = FLOG_PAGE_MAGIC;
+    pBuf->data[FLOG_POS_USED] = pBuf->used;
+    flogPut32(&pBuf->data[FLOG_POS_SEQ], flogHeadSeq);
+    crc16Append(pBuf->data, len);
+    if(fioProgram(FLOG_FIRST_PAGE + flogHead, pBuf->data, len + CRC16_LEN, &flogPageDone)) {
+        pBuf->writing = TRUE;
+        flogBusy = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogPageDone
+*
+*   @brief      The head page is programmed: adds it to the index, moves
+*               the head on and frees the buffer. A page that timed out is
+*               passed over, its CRC tells on replay. A page of sent records
+*               only is not replayed when nothing else waits
+*
+*   @param      result - FIO_OK, FIO_TIMEOUT or FIO_FAILED
+*
+*   @return     none
+*/
+static void flogPageDone(uint8 result) {
+
+    flogBuf_t *pBuf = flogBuf[0].writing ? &flogBuf[0] : &flogBuf[1];
+
+    if(result != FIO_OK) {
+        flogStats.flashErrors++;
+    }
+    flogIndexAdd(&pBuf->data[FLOG_POS_RECORDS], pBuf->used);
+    flogStats.pagesWritten++;
+    flogStats.bytesWritten += pBuf->used;
+    if((pBuf->unsent == 0) && (flogTailSeq == flogHeadSeq)) {
+        flogTail = FLOG_NEXT(flogTail);
+        flogTailSeq++;
+    }
+    flogHead = FLOG_NEXT(flogHead);
+    flogHeadSeq++;
+    flogErased--;
+    pBuf->used = 0;
+    pBuf->unsent = 0;
+    pBuf->ready = FALSE;
+    pBuf->writing = FALSE;
+    flogBusy = FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogErase
+*
+*   @brief      Queues the erase of the sub-sector after the erased pages
+*               ahead of the head. Pages in it that were not replayed are
+*               lost, the tail moves past them
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void flogErase(void) {
+
+    uint16 start = (flogHead + flogErased) % FLOG_PAGES;
+    uint16 ahead;
+    uint16 skip;
+
+    if(!fioErase((uint8)((FLOG_FIRST_PAGE + start) / FLOG_SUBSECTOR_PAGES), &flogEraseDone)) {
+        return;
+    }
+    flogBusy = TRUE;
+
+    if(flogTailSeq != flogHeadSeq) {
+        ahead = (flogTail + FLOG_PAGES - start) % FLOG_PAGES;
+        if(ahead < FLOG_SUBSECTOR_PAGES) {
+            skip = FLOG_SUBSECTOR_PAGES - ahead;
+            flogTail = (flogTail + skip) % FLOG_PAGES;
+            flogTailSeq += skip;
+            flogStats.lostPages += skip;
+            if(!flogReadFlash && ((int32)(flogDoneSeq - flogTailSeq) < 0)) {
+                flogDoneSeq = flogTailSeq;
+                flogCursorDirty = TRUE;
+            }
+        }
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogEraseDone
+*
+*   @brief      The sub-sector is erased, its pages can be programmed. After
+*               a timeout the erase is tried again
+*
+*   @param      result - FIO_OK, FIO_TIMEOUT or FIO_FAILED
+*
+*   @return     none
+*/
+static void flogEraseDone(uint8 result) {
+
+    if(result == FIO_OK) {
+        flogStats.erases++;
+        flogErased += FLOG_SUBSECTOR_PAGES;
+    } else {
+        flogStats.flashErrors++;
+    }
+    flogBusy = FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogWriteIndex
+*
+*   @brief      Queues the program of the index into the last page of the
+*               head's sub-sector
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void flogWriteIndex(void) {
+
+    flogIndexFinish();
+    if(fioProgram(FLOG_FIRST_PAGE + flogHead, flogIndex, FLOG_INDEX_LEN, &flogIndexDone)) {
+        flogBusy = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogIndexDone
+*
+*   @brief      The index page is programmed, the head moves on to the next
+*               sub-sector with an empty index
+*
+*   @param      result - FIO_OK, FIO_TIMEOUT or FIO_FAILED
+*
+*   @return     none
+*/
+static void flogIndexDone(uint8 result) {
+
+    if(result == FIO_OK) {
+        flogStats.indexWrites++;
+    } else {
+        flogStats.flashErrors++;
+    }
+    if(flogTailSeq == flogHeadSeq) {
+        flogTail = FLOG_NEXT(flogTail);
+        flogTailSeq++;
+    }
+    flogHead = FLOG_NEXT(flogHead);
+    flogHeadSeq++;
+    flogErased--;
+    flogIndexReset();
+    flogBusy = FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogIndexReset
+*
+*   @brief      Empties the index for the sub-sector of the head
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void flogIndexReset(void) {
+
+    memset(flogIndex, 0, sizeof(flogIndex));
+    flogIndexRecords = 0;
+    flogIndexMin = 0xFFFFFFFF;
+    flogIndexMax = 0;
+}
+
+
+/*******************************************************************************
+*   @fn         flogIndexAdd
+*
+*   @brief      Adds the records of a page to the index
+*
+*   @param      pRecords - records of the page
+*   @param      used     - record bytes
+*
+*   @return     none
+*/
+static void flogIndexAdd(const uint8 *pRecords, uint8 used) {
+
+    rxPacket_t packet;
+    uint16 bits[FLOG_BLOOM_HASHES];
+    uint16 pos = 0;
+    uint8 len;
+    uint8 i;
+
+    while((pos < used) && ((len = flogParseRecord(&pRecords[pos], used - pos, &packet)) > 0)) {
+        pos += len;
+        flogIndexRecords++;
+        if(!(packet.stamp.frac & TIME_FRAC_NO_EPOCH)) {
+            if(packet.stamp.sec < flogIndexMin) {
+                flogIndexMin = packet.stamp.sec;
+            }
+            if(packet.stamp.sec > flogIndexMax) {
+                flogIndexMax = packet.stamp.sec;
+            }
+        }
+        if(packet.len >= TAG_POS_ID + TAG_ID_LEN) {
+            flogBloomBits(flogRecordTag(&packet), bits);
+            for(i = 0; i < FLOG_BLOOM_HASHES; i++) {
+                flogIndex[FLOG_IDX_POS_BLOOM + (bits[i] >> 3)] |= BV(bits[i] & 7);
+            }
+        }
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogIndexFinish
+*
+*   @brief      Fills in the header and CRC of the index of the head's
+*               sub-sector
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void flogIndexFinish(void) {
+
+    flogIndex[0] = FLOG_INDEX_MAGIC;
+    flogPut32(&flogIndex[FLOG_IDX_POS_SEQ], flogHeadSeq - FLOG_SLOT(flogHead));
+    flogIndex[FLOG_IDX_POS_RECORDS] = HI_UINT16(flogIndexRecords);
+    flogIndex[FLOG_IDX_POS_RECORDS + 1] = LO_UINT16(flogIndexRecords);
+    flogPut32(&flogIndex[FLOG_IDX_POS_MIN], flogIndexMin);
+    flogPut32(&flogIndex[FLOG_IDX_POS_MAX], flogIndexMax);
+    crc16Append(flogIndex, FLOG_INDEX_LEN - CRC16_LEN);
+}
+
+
+/*******************************************************************************
+*   @fn         flogBloomBits
+*
+*   @brief      Bloom filter bits of a TagID, from a 32 bit mix of it
+*
+*   @param      tagId - TagID
+*   @param      pBits - output, FLOG_BLOOM_HASHES bit numbers
+*
+*   @return     none
+*/
+static void flogBloomBits(uint32 tagId, uint16 *pBits) {
+
+    uint32 h = tagId;
+    uint8 i;
+
+    h ^= h >> 16;
+    h *= 0x7FEB352DUL;
+    h ^= h >> 15;
+    h *= 0x846CA68BUL;
+    h ^= h >> 16;
+    for(i = 0; i < FLOG_BLOOM_HASHES; i++) {
+        pBits[i] = (uint16)(h >> (i * FLOG_BLOOM_BITS_LOG2)) & ((1 << FLOG_BLOOM_BITS_LOG2) - 1);
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogRecordTag
+*
+*   @brief      Reads the TagID of a record
+*
+*   @param      pPacket - record
+*
+*   @return     TagID, FLOG_TAG_ANY if the record is too short for one
+*/
+static uint32 flogRecordTag(const rxPacket_t *pPacket) {
+
+    if(pPacket->len < TAG_POS_ID + TAG_ID_LEN) {
+        return FLOG_TAG_ANY;
+    }
+    return flogGet32(&pPacket->data[TAG_POS_ID]);
+}
+
+
+/*******************************************************************************
+*   @fn         flogWriteCursor
+*
+*   @brief      Queues the save of the read cursor in the next slot of
+*               sub-sector 0
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void flogWriteCursor(void) {
+
+    flogCursor[0] = FLOG_CURSOR_MAGIC;
+    flogPut32(&flogCursor[1], flogCursorGen + 1);
+    flogPut32(&flogCursor[5], flogDoneSeq);
+    crc16Append(flogCursor, FLOG_CURSOR_LEN - CRC16_LEN);
+    if(fioWrite(FLOG_CURSOR_PAGE + (uint16)((flogCursorGen + 1) % FLOG_SUBSECTOR_PAGES),
+                flogCursor, FLOG_CURSOR_LEN, &flogCursorDone)) {
+        flogCursorGen++;
+        flogCursorDirty = FALSE;
+        flogDonePages = 0;
+        flogBusy = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogCursorDone
+*
+*   @brief      The cursor is saved. After a timeout it is saved again, in
+*               the next slot
+*
+*   @param      result - FIO_OK, FIO_TIMEOUT or FIO_FAILED
+*
+*   @return     none
+*/
+static void flogCursorDone(uint8 result) {
+
+    if(result == FIO_OK) {
+        flogStats.cursorWrites++;
+    } else {
+        flogStats.flashErrors++;
+        flogCursorDirty = TRUE;
+    }
+    flogBusy = FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogLoadPage
+*
+*   @brief      Queues the read of the tail page for replay
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void flogLoadPage(void) {
+
+    if(fioRead((uint32)(FLOG_FIRST_PAGE + flogTail) * FLOG_PAGE_SIZE, flogRead,
+               FLOG_PAGE_SIZE, &flogLoadDone)) {
+        flogBusy = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogLoadDone
+*
+*   @brief      The tail page is read, its records are replayed from
+*               flogRead. Index pages have none, a page that fails its CRC or
+*               holds another sequence number is skipped
+*
+*   @param      result - FIO_OK or FIO_FAILED
+*
+*   @return     none
+*/
+static void flogLoadDone(uint8 result) {
+
+    uint8 used = flogRead[FLOG_POS_USED];
+
+    flogReadPos = FLOG_POS_RECORDS;
+    flogReadEnd = FLOG_POS_RECORDS;
+    flogReadFlash = TRUE;
+    flogReadSeq = flogTailSeq;
+    if((result == FIO_OK) &&
+       (flogRead[FLOG_POS_MAGIC] == FLOG_PAGE_MAGIC) && (used <= FLOG_RECORDS_MAX) &&
+       (flogGet32(&flogRead[FLOG_POS_SEQ]) == flogTailSeq) &&
+       crc16Check(flogRead, FLOG_POS_RECORDS + used + CRC16_LEN)) {
+        flogReadEnd = FLOG_POS_RECORDS + used;
+    } else if((result != FIO_OK) || (flogRead[FLOG_POS_MAGIC] != FLOG_INDEX_MAGIC)) {
+        flogStats.badPages++;
+    }
+
+    flogTail = FLOG_NEXT(flogTail);
+    flogTailSeq++;
+    flogBusy = FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogTake
+*
+*   @brief      Replays a page buffer directly. It is not programmed, with
+*               FLOG_HISTORY its records are flagged as sent instead and it
+*               is programmed as usual
+*
+*   @param      pBuf - page buffer with records
+*
+*   @return     none
+*/
+static void flogTake(flogBuf_t *pBuf) {
+
+    uint8 pos;
+
+    memcpy(&flogRead[FLOG_POS_RECORDS], &pBuf->data[FLOG_POS_RECORDS], pBuf->used);
+    flogReadPos = FLOG_POS_RECORDS;
+    flogReadEnd = FLOG_POS_RECORDS + pBuf->used;
+    flogReadFlash = FALSE;
+    pBuf->unsent = 0;
+    if(FLOG_HISTORY) {
+        for(pos = 0; pos < pBuf->used;
+            pos += FLOG_REC_POS_DATA + (pBuf->data[FLOG_POS_RECORDS + pos] & FLOG_REC_LEN_BM)) {
+            pBuf->data[FLOG_POS_RECORDS + pos] |= FLOG_REC_SENT;
+        }
+    } else {
+        pBuf->used = 0;
+        pBuf->ready = FALSE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         flogPageBlank
+*
+*   @brief      Checks whether a page is erased and can be programmed
+*
+*   @param      page - ring page
+*
+*   @return     TRUE if all bytes are 0xFF
+*/
+static uint8 flogPageBlank(uint16 page) {
+
+    uint16 i;
+
+    flashRead((uint32)(FLOG_FIRST_PAGE + page) * FLOG_PAGE_SIZE, flogRead, FLOG_PAGE_SIZE);
+    for(i = 0; i < FLOG_PAGE_SIZE; i++) {
+        if(flogRead[i] != 0xFF) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         flogGet32
+*
+*   @brief      Reads 4 bytes big endian
+*
+*   @param      pIn - bytes
+*
+*   @return     value
+*/
+uint32 flogGet32(const uint8 *pIn) {
+
+    return ((uint32)pIn[0] << 24) | ((uint32)pIn[1] << 16) | ((uint32)pIn[2] << 8) | pIn[3];
+}
+
+
+/*******************************************************************************
+*   @fn         flogPut32
+*
+*   @brief      Writes 4 bytes big endian
+*
+*   @param      pOut  - output
+*   @param      value - value
+*
+*   @return     none
+*/
+static void flogPut32(uint8 *pOut, uint32 value) {
+
+    pOut[0] = (uint8)(value >> 24);
+    pOut[1] = (uint8)(value >> 16);
+    pOut[2] = (uint8)(value >> 8);
+    pOut[3] = (uint8)value;
+}
@@ -0,0 +1,183 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_flog.h
+//! @brief      Store-and-forward log of uplink records on the M25PE20 SPI
+//!             flash of the TrxEB. While the gateway is gone or slower than
+//!             the radio, records go to a ring of 256 byte pages instead of
+//!             being dropped, and are replayed in order once the uplink has
+//!             room again.
+//!
+//!             Sub-sector 0 holds the read cursor, rewritten in turn in its
+//!             16 pages with a generation count. Pages 16..1023 are the ring.
+//!             Each page carries a sequence number and a CRC-16, so after a
+//!             power loss the ring is found again by scanning the page
+//!             headers; replay resumes at the cursor, records after the last
+//!             saved cursor may be sent twice. The sub-sector after the write
+//!             position is erased ahead of time, so a page never waits for
+//!             an erase; unreplayed pages in it are lost (newest data wins).
+//!             Records are collected in RAM and a page is programmed once
+//!             full, or after FLOG_FLUSH_S seconds; up to that much data is
+//!             lost on a power loss. All flash access after flogInit goes
+//!             through the queue of cc1200_rx_sniff_mode_fio.h, one command
+//!             at a time, so the main loop never waits for the flash.
+//!
+//!             The last page of each ring sub-sector is its index: the
+//!             range of the UTC seconds of its records and a bloom filter
+//!             over their TagIDs, written when the sub-sector is full. The
+//!             index of the sub-sector being filled is kept in RAM. With
+//!             FLOG_HISTORY records sent to the gateway at once are logged
+//!             too, flagged as sent, so the log holds the whole tag history
+//!             for cc1200_rx_sniff_mode_query.h.
+//!
+//!             Estimates from the M25PE20 datasheet and an 8 MHz SPI moved
+//!             by the USCI_B2 interrupt, not measured: a page costs ~1.6 ms
+//!             transfer + 0.8 ms program (5 ms max) + 1/16 of a 50 ms
+//!             sub-sector erase (150 ms max), ~5.5 ms per 248 record bytes,
+//!             ~45 kB/s on average. While an erase runs only the two page
+//!             buffers take records, ~18 tag records, so bursts above ~120
+//!             records per second may be refused (host/flog_model.c). Replay
+//!             reads a page in ~1.6 ms, ~150 kB/s, far above the gateway
+//!             UART. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_FLOG_H
+#define CC1200_RX_SNIFF_MODE_FLOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// FLOG_ENABLE = 1 spills the uplink to the SPI flash
+#ifndef FLOG_ENABLE
+#define FLOG_ENABLE             0
+#endif
+
+// FLOG_HISTORY = 1 also logs the records sent to the gateway at once
+#ifndef FLOG_HISTORY
+#define FLOG_HISTORY            0
+#endif
+#if FLOG_HISTORY && !FLOG_ENABLE
+#error "The tag history needs the flash log, set FLOG_ENABLE"
+#endif
+
+// M25PE20: 1024 pages of 256 bytes, erased in sub-sectors of 16 pages
+#define FLOG_PAGE_SIZE          256
+#define FLOG_SUBSECTOR_PAGES    16
+#define FLOG_DEVICE_PAGES       1024
+#define FLOG_CURSOR_PAGE        0       // sub-sector 0, FLOG_SUBSECTOR_PAGES slots
+#define FLOG_FIRST_PAGE         FLOG_SUBSECTOR_PAGES
+#define FLOG_PAGES              (FLOG_DEVICE_PAGES - FLOG_FIRST_PAGE)
+#define FLOG_SUBSECTORS         (FLOG_PAGES / FLOG_SUBSECTOR_PAGES)
+#define FLOG_INDEX_SLOT         (FLOG_SUBSECTOR_PAGES - 1)  // last page
+
+// The next sub-sector is erased once this many erased pages or fewer are
+// left ahead of the write position while records come in: ~90 records of
+// room for the 150 ms worst case erase
+#define FLOG_ERASE_AHEAD_PAGES  8
+
+// A partly filled page is programmed after this many seconds
+#define FLOG_FLUSH_S            5
+
+// The cursor is saved after this many replayed pages and when the log runs
+// empty. Each save is a ~11 ms page write, the flash is busy meanwhile
+#define FLOG_CURSOR_SAVE_PAGES  16
+
+// Page layout: MAGIC, USED (record bytes), SEQ (4 bytes big endian), the
+// records, then a CRC-16 over the bytes before it
+#define FLOG_PAGE_MAGIC         0x5A
+#define FLOG_POS_MAGIC          0
+#define FLOG_POS_USED           1
+#define FLOG_POS_SEQ            2
+#define FLOG_POS_RECORDS        6
+#define FLOG_RECORDS_MAX        (FLOG_PAGE_SIZE - FLOG_POS_RECORDS - 2)
+
+// Record layout: LEN, CHANNEL, STAMP (TIME_STAMP_LEN bytes), LEN data bytes.
+// LEN carries FLOG_REC_SENT for records the gateway already has
+#define FLOG_REC_SENT           0x80
+#define FLOG_REC_LEN_BM         0x7F
+#define FLOG_REC_POS_LEN        0
+#define FLOG_REC_POS_CHANNEL    1
+#define FLOG_REC_POS_STAMP      2
+#define FLOG_REC_POS_DATA       (FLOG_REC_POS_STAMP + TIME_STAMP_LEN)
+
+// Cursor layout: MAGIC, GEN (4 bytes), SEQ of the next page to replay (4
+// bytes), CRC-16
+#define FLOG_CURSOR_MAGIC       0xC5
+#define FLOG_CURSOR_LEN         11
+
+// Index page layout: MAGIC, SEQ of the first page of the sub-sector (4
+// bytes), RECORDS (2 bytes), MIN and MAX of the UTC seconds of the records
+// (4 bytes each, records without UTC time are left out), the TagID bloom
+// filter with FLOG_BLOOM_HASHES bits per TagID, CRC-16. All big endian
+#define FLOG_INDEX_MAGIC        0x1D
+#define FLOG_IDX_POS_SEQ        1
+#define FLOG_IDX_POS_RECORDS    5
+#define FLOG_IDX_POS_MIN        7
+#define FLOG_IDX_POS_MAX        11
+#define FLOG_IDX_POS_BLOOM      15
+#define FLOG_BLOOM_BITS_LOG2    10
+#define FLOG_BLOOM_BYTES        ((1 << FLOG_BLOOM_BITS_LOG2) / 8)
+#define FLOG_BLOOM_HASHES       3
+#define FLOG_INDEX_LEN          (FLOG_IDX_POS_BLOOM + FLOG_BLOOM_BYTES + CRC16_LEN)
+
+// Match arguments: any TagID, any time (records without UTC time too)
+#define FLOG_TAG_ANY            0xFFFFFFFF
+#define FLOG_TIME_FIRST         0
+#define FLOG_TIME_LAST          0xFFFFFFFF
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 appended;                    // records taken by flogAppend
+    uint32 refused;                     // both page buffers waiting
+    uint32 replayed;                    // records returned by flogGet
+    uint32 pagesWritten;
+    uint32 partialPages;                // written before they were full
+    uint32 bytesWritten;                // record bytes in written pages
+    uint32 erases;
+    uint32 cursorWrites;
+    uint32 indexWrites;
+    uint32 lostPages;                   // erased before they were replayed
+    uint32 badPages;                    // CRC or sequence mismatch on replay
+    uint32 badRecords;
+    uint32 flashErrors;                 // flash commands timed out or failed
+} flogStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void flogInit(void);
+uint8 flogAppend(const rxPacket_t *pPacket, uint32 now, uint8 sent);
+uint8 flogGet(rxPacket_t *pPacket);
+uint8 flogRoom(uint8 len);
+uint8 flogPending(void);
+uint8 flogAvailable(void);
+uint8 flogReady(uint32 now);
+void flogTask(uint32 now);
+const flogStats_t *flogGetStats(void);
+uint16 flogHeadPage(void);
+const uint8 *flogOpenIndex(void);
+uint8 flogIndexMatch(const uint8 *pIndex, uint32 tagId, uint32 from, uint32 to);
+uint8 flogParseRecord(const uint8 *pRec, uint16 left, rxPacket_t *pPacket);
+uint8 flogRecordMatch(const rxPacket_t *pPacket, uint32 tagId, uint32 from, uint32 to);
+uint32 flogGet32(const uint8 *pIn);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,226 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_frame.c
+//! @brief      Binary uplink framing, see cc1200_rx_sniff_mode_frame.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_frame.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 cobsEncode(const uint8 *pIn, uint8 len, uint8 *pOut);
+static uint8 cobsDecode(const uint8 *pIn, uint8 len, uint8 *pOut);
+static uint8 frameCheck(frameDecoder_t *pDec, frame_t *pFrame);
+
+
+/*******************************************************************************
+*   @fn         frameEncode
+*
+*   @brief      Builds one wire frame: header, payload and CRC, COBS encoded
+*               and followed by the delimiter
+*
+*   @param      seq   - sequence number, incremented by the caller per frame
+*   @param      pData - payload
+*   @param      len   - payload length, at most FRAME_MAX_PAYLOAD
+*   @param      pOut  - output, at least FRAME_MAX_WIRE bytes
+*
+*   @return     number of bytes in pOut, 0 if the payload is too long
+*/
+uint8 frameEncode(uint8 seq, const uint8 *pData, uint8 len, uint8 *pOut) {
+
+    uint8  raw[FRAME_MAX_RAW];
+    uint8  n;
+
+    if(len > FRAME_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    raw[0] = seq;
+    raw[1] = len;
+    memcpy(&raw[FRAME_HEADER_LEN], pData, len);
+    crc16Append(raw, FRAME_HEADER_LEN + len);
+
+    n = cobsEncode(raw, FRAME_HEADER_LEN + len + FRAME_CRC_LEN, pOut);
+    pOut[n++] = FRAME_DELIMITER;
+    return n;
+}
+
+
+/*******************************************************************************
+*   @fn         frameDecoderInit
+*
+*   @brief      Resets a stream decoder. The first frame seen resynchronizes
+*               the sequence check
+*
+*   @param      pDec - decoder state
+*
+*   @return     none
+*/
+void frameDecoderInit(frameDecoder_t *pDec) {
+
+    memset(pDec, 0, sizeof(frameDecoder_t));
+}
+
+
+/*******************************************************************************
+*   @fn         frameDecodeByte
+*
+*   @brief      Feeds one received byte to the decoder. On a delimiter the
+*               collected bytes are decoded and checked. Gaps in SEQ are added
+*               to the lost counter
+*
+*   @param      pDec   - decoder state
+*   @param      byte   - received byte
+*   @param      pFrame - filled in when a valid frame completes
+*
+*   @return     TRUE when pFrame holds a new valid frame
+*/
+uint8 frameDecodeByte(frameDecoder_t *pDec, uint8 byte, frame_t *pFrame) {
+
+    uint8 valid;
+
+    if(byte != FRAME_DELIMITER) {
+        if(pDec->pos < FRAME_MAX_WIRE) {
+            pDec->buf[pDec->pos++] = byte;
+        } else {
+            pDec->overrun = TRUE;
+        }
+        return FALSE;
+    }
+
+    // Back-to-back delimiters carry no frame
+    if((pDec->pos == 0) && !pDec->overrun) {
+        return FALSE;
+    }
+
+    valid = !pDec->overrun && frameCheck(pDec, pFrame);
+    if(!valid) {
+        pDec->errors++;
+    }
+
+    pDec->pos = 0;
+    pDec->overrun = FALSE;
+    return valid;
+}
+
+
+/*******************************************************************************
+*   @fn         frameCheck
+*
+*   @brief      Decodes the collected bytes and validates length and CRC
+*
+*   @param      pDec   - decoder state, buf/pos hold one encoded frame
+*   @param      pFrame - output frame
+*
+*   @return     TRUE if the frame is valid
+*/
+static uint8 frameCheck(frameDecoder_t *pDec, frame_t *pFrame) {
+
+    uint8  raw[FRAME_MAX_WIRE];
+    uint8  n;
+    uint8  len;
+
+    n = cobsDecode(pDec->buf, pDec->pos, raw);
+    if(n < FRAME_HEADER_LEN + FRAME_CRC_LEN) {
+        return FALSE;
+    }
+
+    len = raw[1];
+    if((len > FRAME_MAX_PAYLOAD) || (n != FRAME_HEADER_LEN + len + FRAME_CRC_LEN)) {
+        return FALSE;
+    }
+
+    if(!crc16Check(raw, n)) {
+        return FALSE;
+    }
+
+    pFrame->seq = raw[0];
+    pFrame->len = len;
+    memcpy(pFrame->data, &raw[FRAME_HEADER_LEN], len);
+
+    if(pDec->synced) {
+        pDec->lost += (uint8)(pFrame->seq - pDec->lastSeq - 1);
+    }
+    pDec->synced = TRUE;
+    pDec->lastSeq = pFrame->seq;
+    pDec->frames++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         cobsEncode
+*
+*   @brief      Consistent Overhead Byte Stuffing, removes all 0x00 bytes
+*
+*   @param      pIn  - bytes to encode
+*   @param      len  - number of bytes, below 254
+*   @param      pOut - output, len + 1 bytes
+*
+*   @return     number of bytes in pOut
+*/
+static uint8 cobsEncode(const uint8 *pIn, uint8 len, uint8 *pOut) {
+
+    uint8 codePos = 0;
+    uint8 code = 1;
+    uint8 out = 1;
+    uint8 i;
+
+    for(i = 0; i < len; i++) {
+        if(pIn[i] == 0) {
+            pOut[codePos] = code;
+            codePos = out++;
+            code = 1;
+        } else {
+            pOut[out++] = pIn[i];
+            code++;
+        }
+    }
+    pOut[codePos] = code;
+    return out;
+}
+
+
+/*******************************************************************************
+*   @fn         cobsDecode
+*
+*   @brief      Reverses cobsEncode
+*
+*   @param      pIn  - encoded bytes, without the delimiter
+*   @param      len  - number of bytes
+*   @param      pOut - output, at least len bytes
+*
+*   @return     number of bytes in pOut, 0 if the input is malformed
+*/
+static uint8 cobsDecode(const uint8 *pIn, uint8 len, uint8 *pOut) {
+
+    uint8 in = 0;
+    uint8 out = 0;
+    uint8 code;
+    uint8 i;
+
+    while(in < len) {
+        code = pIn[in++];
+        if(code == 0) {
+            return 0;
+        }
+        for(i = 1; i < code; i++) {
+            if(in >= len) {
+                return 0;
+            }
+            pOut[out++] = pIn[in++];
+        }
+        if((code < 0xFF) && (in < len)) {
+            pOut[out++] = 0;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,68 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_frame.h
+//! @brief      Binary uplink framing. A frame is SEQ, LEN, LEN payload bytes
+//!             and a CRC-16/CCITT (big endian) over SEQ..payload, COBS
+//!             encoded and terminated by a 0x00 delimiter. The encoder runs
+//!             on the station, the stream decoder is meant for the gateway
+//!             and builds under gcc on Linux with cc1200_rx_sniff_mode_crc.c.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_FRAME_H
+#define CC1200_RX_SNIFF_MODE_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define FRAME_MAX_PAYLOAD       40      // uplink record with channel and time
+#define FRAME_HEADER_LEN        2       // SEQ, LEN
+#define FRAME_CRC_LEN           2       // CRC16_LEN, cc1200_rx_sniff_mode_crc.h
+#define FRAME_DELIMITER         0x00
+// COBS adds one code byte per 254 bytes, plus the delimiter
+#define FRAME_MAX_RAW           (FRAME_HEADER_LEN + FRAME_MAX_PAYLOAD + FRAME_CRC_LEN)
+#define FRAME_MAX_WIRE          (FRAME_MAX_RAW + 2)
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint8  seq;
+    uint8  len;
+    uint8  data[FRAME_MAX_PAYLOAD];
+} frame_t;
+
+typedef struct {
+    uint8  buf[FRAME_MAX_WIRE];         // encoded bytes since the last delimiter
+    uint8  pos;
+    uint8  overrun;                     // current frame too long, skip to delimiter
+    uint8  synced;                      // lastSeq is valid
+    uint8  lastSeq;
+    uint32 frames;                      // valid frames returned
+    uint32 errors;                      // bad COBS, length or CRC
+    uint32 lost;                        // frames missing according to SEQ
+} frameDecoder_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+uint8 frameEncode(uint8 seq, const uint8 *pData, uint8 len, uint8 *pOut);
+void frameDecoderInit(frameDecoder_t *pDec);
+uint8 frameDecodeByte(frameDecoder_t *pDec, uint8 byte, frame_t *pFrame);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,292 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_metrics.c
+//! @brief      Runtime metrics, see cc1200_rx_sniff_mode_metrics.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdint.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_metrics.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define METRICS_BUCKET_MAX      0xFFFF
+#define METRICS_ELAPSED_MAX_SEC 0xFFFF  // longer times all go to the last bucket
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint8 metricsMyId;
+static uint32 metricsLastReport;        // seconds
+
+// Live values
+static uint32 metricsCounters[METRICS_COUNTERS];
+static uint16 metricsBuckets[METRICS_HISTS][METRICS_BUCKETS];
+
+static const uint8 metricsShift[METRICS_HISTS] = {
+    METRICS_LATENCY_SHIFT,
+    METRICS_SPI_SHIFT
+};
+
+// Snapshot being sent, pages from metricsPage on
+static uint32 metricsSnapCounters[METRICS_COUNTERS];
+static uint16 metricsSnapBuckets[METRICS_HISTS][METRICS_BUCKETS];
+static timeStamp_t metricsSnapTime;
+static uint8 metricsSnapCode;
+static uint8 metricsSeq;
+static uint8 metricsPage;
+
+
+/*******************************************************************************
+*   @fn         metricsInit
+*
+*   @brief      Clears the counters and histograms, no snapshot is pending
+*
+*   @param      myId - this station's ID, for the snapshot records
+*
+*   @return     none
+*/
+void metricsInit(uint8 myId) {
+
+    metricsMyId = myId;
+    metricsLastReport = 0;
+    metricsSeq = 0;
+    metricsPage = METRICS_PAGES;
+    memset(metricsCounters, 0, sizeof(metricsCounters));
+    memset(metricsBuckets, 0, sizeof(metricsBuckets));
+}
+
+
+/*******************************************************************************
+*   @fn         metricsCount
+*
+*   @brief      Counts one event
+*
+*   @param      counter - METRICS_RX_PACKETS ...
+*
+*   @return     none
+*/
+void metricsCount(uint8 counter) {
+
+    metricsCounters[counter]++;
+}
+
+
+/*******************************************************************************
+*   @fn         metricsAdd
+*
+*   @brief      Counts n events or bytes
+*
+*   @param      counter - METRICS_RX_PACKETS ...
+*   @param      n       - to add
+*
+*   @return     none
+*/
+void metricsAdd(uint8 counter, uint32 n) {
+
+    metricsCounters[counter] += n;
+}
+
+
+/*******************************************************************************
+*   @fn         metricsSet
+*
+*   @brief      Sets a counter kept elsewhere, e.g. by a driver, before a
+*               snapshot
+*
+*   @param      counter - METRICS_BUS_FLASH_TIME ...
+*   @param      value   - its current value
+*
+*   @return     none
+*/
+void metricsSet(uint8 counter, uint32 value) {
+
+    metricsCounters[counter] = value;
+}
+
+
+/*******************************************************************************
+*   @fn         metricsGetCounter
+*
+*   @brief      Reads a counter
+*
+*   @param      counter - METRICS_RX_PACKETS ...
+*
+*   @return     value
+*/
+uint32 metricsGetCounter(uint8 counter) {
+
+    return metricsCounters[counter];
+}
+
+
+/*******************************************************************************
+*   @fn         metricsHist
+*
+*   @brief      Counts a value in its bucket, at most METRICS_BUCKETS - 1
+*               shifts
+*
+*   @param      hist  - METRICS_HIST_LATENCY or METRICS_HIST_SPI
+*   @param      value - 1/32768 s
+*
+*   @return     none
+*/
+void metricsHist(uint8 hist, uint32 value) {
+
+    uint8 bucket = 0;
+
+    value >>= metricsShift[hist];
+    while(value && (bucket < METRICS_BUCKETS - 1)) {
+        value >>= 1;
+        bucket++;
+    }
+    if(metricsBuckets[hist][bucket] < METRICS_BUCKET_MAX) {
+        metricsBuckets[hist][bucket]++;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         metricsHistTime
+*
+*   @brief      Counts the time between two stamps. Stamps on either side of
+*               the first epoch or out of order are not counted
+*
+*   @param      hist  - METRICS_HIST_LATENCY or METRICS_HIST_SPI
+*   @param      pFrom - start, UTC
+*   @param      pTo   - end, UTC
+*
+*   @return     none
+*/
+void metricsHistTime(uint8 hist, const timeStamp_t *pFrom, const timeStamp_t *pTo) {
+
+    uint32 sec;
+    uint16 fromFrac = pFrom->frac & TIME_FRAC_BM;
+    uint16 toFrac = pTo->frac & TIME_FRAC_BM;
+
+    if(((pFrom->frac ^ pTo->frac) & TIME_FRAC_NO_EPOCH) || (pTo->sec < pFrom->sec) ||
+       ((pTo->sec == pFrom->sec) && (toFrac < fromFrac))) {
+        return;
+    }
+
+    sec = pTo->sec - pFrom->sec;
+    if(sec > METRICS_ELAPSED_MAX_SEC) {
+        sec = METRICS_ELAPSED_MAX_SEC;
+    }
+    metricsHist(hist, (sec << TIME_FRAC_BITS) + toFrac - fromFrac);
+}
+
+
+/*******************************************************************************
+*   @fn         metricsReportDue
+*
+*   @brief      Checks whether the heartbeat report is due, once per
+*               METRICS_REPORT_SEC
+*
+*   @param      now - seconds
+*
+*   @return     TRUE if metricsSnapshot should be called
+*/
+uint8 metricsReportDue(uint32 now) {
+
+    if((METRICS_REPORT_SEC == 0) || ((now - metricsLastReport) < METRICS_REPORT_SEC)) {
+        return FALSE;
+    }
+    metricsLastReport = now;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         metricsSnapshot
+*
+*   @brief      Takes a snapshot and starts a new histogram window. Pages of
+*               an earlier snapshot not yet sent are given up
+*
+*   @param      code - CODE_HEARTBEAT or 0 on request, goes out with it
+*   @param      pNow - UTC, stamp of its records
+*
+*   @return     none
+*/
+void metricsSnapshot(uint8 code, const timeStamp_t *pNow) {
+
+    memcpy(metricsSnapCounters, metricsCounters, sizeof(metricsCounters));
+    memcpy(metricsSnapBuckets, metricsBuckets, sizeof(metricsBuckets));
+    memset(metricsBuckets, 0, sizeof(metricsBuckets));
+    metricsSnapTime = *pNow;
+    metricsSnapCode = code;
+    metricsSeq++;
+    metricsPage = 0;
+}
+
+
+/*******************************************************************************
+*   @fn         metricsAvailable
+*
+*   @brief      Checks whether metricsGet may return a record
+*
+*   @param      none
+*
+*   @return     TRUE if pages of a snapshot wait
+*/
+uint8 metricsAvailable(void) {
+
+    return metricsPage < METRICS_PAGES;
+}
+
+
+/*******************************************************************************
+*   @fn         metricsGet
+*
+*   @brief      Returns the next page of the snapshot: the counter pages,
+*               then one page per histogram
+*
+*   @param      pPacket - output, len, data, channel and stamp
+*
+*   @return     TRUE if a record was returned
+*/
+uint8 metricsGet(rxPacket_t *pPacket) {
+
+    uint8 *pOut = &pPacket->data[METRICS_POS_DATA];
+    uint8 first;
+    uint8 i;
+
+    if(!metricsAvailable()) {
+        return FALSE;
+    }
+
+    if(metricsPage < METRICS_COUNTER_PAGES) {
+        first = metricsPage * METRICS_PAGE_COUNTERS;
+        for(i = 0; (i < METRICS_PAGE_COUNTERS) && (first + i < METRICS_COUNTERS); i++) {
+            *pOut++ = BREAK_UINT32(metricsSnapCounters[first + i], 3);
+            *pOut++ = BREAK_UINT32(metricsSnapCounters[first + i], 2);
+            *pOut++ = BREAK_UINT32(metricsSnapCounters[first + i], 1);
+            *pOut++ = BREAK_UINT32(metricsSnapCounters[first + i], 0);
+        }
+    } else {
+        first = metricsPage - METRICS_COUNTER_PAGES;
+        for(i = 0; i < METRICS_BUCKETS; i++) {
+            *pOut++ = HI_UINT16(metricsSnapBuckets[first][i]);
+            *pOut++ = LO_UINT16(metricsSnapBuckets[first][i]);
+        }
+    }
+
+    pPacket->len = (uint8)(pOut - pPacket->data);
+    pPacket->data[0] = pPacket->len - 1;
+    pPacket->data[METRICS_POS_TYPE] = METRICS_TYPE_SNAPSHOT;
+    pPacket->data[METRICS_POS_SRC] = metricsMyId;
+    pPacket->data[METRICS_POS_CODE] = metricsSnapCode;
+    pPacket->data[METRICS_POS_SEQ] = metricsSeq;
+    pPacket->data[METRICS_POS_PAGE] = metricsPage;
+    pPacket->channel = 0;
+    pPacket->stamp = metricsSnapTime;
+    metricsPage++;
+    return TRUE;
+}
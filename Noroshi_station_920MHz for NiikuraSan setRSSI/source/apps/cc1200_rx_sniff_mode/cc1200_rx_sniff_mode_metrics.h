@@ -0,0 +1,163 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_metrics.h
+//! @brief      Runtime metrics of the station: a fixed set of 32-bit
+//!             counters and of histograms with METRICS_BUCKETS buckets of
+//!             doubling width. The receive path counts into them as it
+//!             goes; all updates come from the main loop, so a counter is a
+//!             plain add without locking and a histogram update a few
+//!             shifts, cheap enough to stay on in production builds. The
+//!             statistics the other modules keep are not counted twice,
+//!             the caller copies them in with metricsSet before a snapshot.
+//!
+//!             A snapshot copies all counters and histograms and is sent to
+//!             the gateway as METRICS_PAGES records of the same SEQ, handed
+//!             out one at a time through metricsGet so the uplink paces
+//!             them. Counters run from start-up, the gateway takes the
+//!             difference of two snapshots; histograms count since the
+//!             previous snapshot. Snapshots are taken every
+//!             METRICS_REPORT_SEC seconds as the heartbeat report and when
+//!             the gateway asks for one. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_METRICS_H
+#define CC1200_RX_SNIFF_MODE_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_time.h"
+#include "cc1200_rx_sniff_mode_scan.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// Heartbeat report period in seconds, 0 sends snapshots on request only
+#ifndef METRICS_REPORT_SEC
+#define METRICS_REPORT_SEC      60
+#endif
+
+// Counters, counted on the hot path
+#define METRICS_RX_PACKETS      0       // split from the RX FIFO
+#define METRICS_RX_CRC_ERRORS   1       // radio CRC or station frame CRC-16
+#define METRICS_FIFO_OVERFLOWS  2       // RX_FIFO_ERR recoveries
+#define METRICS_FIFO_LOST       3       // dropped by the FIFO split, not CRC
+#define METRICS_QUEUE_DROPS     4       // refused by the uplink ring and flash log
+#define METRICS_UPLINK_RECORDS  5       // handed to the gateway UART
+#define METRICS_UART_TX_BYTES   6       // gateway UART, on the wire
+#define METRICS_UART_TX_DROPS   7       // frames refused, UART TX ring full
+#define METRICS_UART_RX_BYTES   8
+#define METRICS_DOWNLINK_ERRORS 9       // bad COBS, length or CRC
+
+// Counters collected from the module statistics, set before a snapshot
+#define METRICS_BUS_FLASH_TIME  10      // flash on the shared SPI bus, 1/32768 s
+#define METRICS_BUS_LCD_TIME    11      // LCD on the shared SPI bus, 1/32768 s
+#define METRICS_RING_HIGH_WATER 12      // uplink ring, most records queued
+#define METRICS_TAG_SUMMARIES   13      // tag summary records emitted
+#define METRICS_TAG_PASSED      14      // tag packets sent raw, table full
+#define METRICS_TAG_REFUSED     15      // tag summaries the uplink refused, retried
+#define METRICS_TAG_HIGH_WATER  16      // tag table, most entries used
+#define METRICS_FIO_READS       17      // flash queue commands
+#define METRICS_FIO_PROGRAMS    18
+#define METRICS_FIO_ERASES      19
+#define METRICS_FIO_ERRORS      20      // timed out or failed
+#define METRICS_FIO_REFUSED     21      // flash queue full
+#define METRICS_DISP_FRAMES     22      // LCD refreshes
+#define METRICS_DISP_BYTES      23      // LCD display data bytes sent
+#define METRICS_WOR_WAKEUPS     24      // sniff mode end-of-packet interrupts
+#define METRICS_WOR_FALSE       25      // wake-ups that delivered nothing
+#define METRICS_WOR_MISSES      26      // packets lost to overflow or load
+#define METRICS_WOR_RETUNES     27      // sniff settings written to the radio
+#define METRICS_WOR_SETTINGS    28      // WOR_EVENT0 << 16 | PQT, current
+#define METRICS_WOR_DUTY        29      // estimated RX duty cycle, 1/1000
+#define METRICS_CHAN_CACHED     30      // channel switches served from the cache
+#define METRICS_CHAN_CALIBRATED 31      // channel switches that ran SCAL
+#define METRICS_CHAN_EXPIRED    32      // of those, cache entry aged out
+#define METRICS_CHAN_CACHED_US  33      // last << 16 | max switch time, us,
+#define METRICS_CHAN_CAL_US     34      // 0 unless built with CHAN_MEASURE
+#define METRICS_RELAY_QUEUED    35      // local records accepted for relaying
+#define METRICS_RELAY_REFUSED   36      // refused, forward queue full
+#define METRICS_RELAY_SENT      37      // frames sent, retries included
+#define METRICS_RELAY_RETRIES   38
+#define METRICS_RELAY_ACKED     39      // hops confirmed by the next station
+#define METRICS_RELAY_DROPPED   40      // gave up after RELAY_MAX_RETRIES
+#define METRICS_RELAY_RECEIVED  41      // frames addressed to this station
+#define METRICS_RELAY_FORWARDED 42      // queued for the next hop
+#define METRICS_RELAY_DELIVERED 43      // master: records handed to the uplink
+#define METRICS_RELAY_LAT_SUM   44      // master: end to end, 50 ms ticks
+#define METRICS_RELAY_LAT_COUNT 45      // frames in METRICS_RELAY_LAT_SUM
+#define METRICS_RELAY_LAT_MAX   46
+
+// Then METRICS_SCAN_STRIDE counters per entry of the scan channel list
+#define METRICS_SCAN_FIRST      47
+#define METRICS_SCAN_STRIDE     4
+#define METRICS_SCAN_VISITS(i)  (METRICS_SCAN_FIRST + METRICS_SCAN_STRIDE * (i))
+#define METRICS_SCAN_PACKETS(i) (METRICS_SCAN_VISITS(i) + 1)
+#define METRICS_SCAN_CRC(i)     (METRICS_SCAN_VISITS(i) + 2)
+#define METRICS_SCAN_NOISE(i)   (METRICS_SCAN_VISITS(i) + 3)   // channel << 8 | noise floor, dBm as int8
+#define METRICS_COUNTERS        METRICS_SCAN_VISITS(SCAN_CHANNEL_COUNT)
+
+// Histograms of times in 1/32768 s. Bucket 0 counts values below one
+// unit of 1 << shift, bucket b values from 2^(b-1) to 2^b units, the
+// last bucket everything above
+#define METRICS_HIST_LATENCY    0       // uplink ring, arrival to gateway UART
+#define METRICS_HIST_SPI        1       // radio SPI time of a FIFO drain per packet
+#define METRICS_HISTS           2
+#define METRICS_BUCKETS         12
+#define METRICS_LATENCY_SHIFT   5       // units of ~1 ms, last bucket >= 1 s
+#define METRICS_SPI_SHIFT       0       // units of ~31 us, last bucket >= 62 ms
+
+// Snapshot record for the uplink, stamped with the time it was taken.
+// CODE is CODE_HEARTBEAT for the heartbeat report, 0 on request. Pages
+// of counters carry METRICS_PAGE_COUNTERS counters of 4 bytes, pages of
+// a histogram its buckets of 2 bytes, all big endian. Bucket counts stop
+// at 0xFFFF
+#define METRICS_TYPE_SNAPSHOT   0xB9
+#define METRICS_POS_TYPE        1
+#define METRICS_POS_SRC         2
+#define METRICS_POS_CODE        3
+#define METRICS_POS_SEQ         4
+#define METRICS_POS_PAGE        5
+#define METRICS_POS_DATA        6
+#define METRICS_PAGE_COUNTERS   6
+#define METRICS_COUNTER_PAGES   ((METRICS_COUNTERS + METRICS_PAGE_COUNTERS - 1) / METRICS_PAGE_COUNTERS)
+#define METRICS_PAGES           (METRICS_COUNTER_PAGES + METRICS_HISTS)
+#define METRICS_RECORD_LEN      (METRICS_POS_DATA + 4 * METRICS_PAGE_COUNTERS)
+#if METRICS_COUNTERS > 0xFF
+#error "Too many metrics counters, shorten SCAN_CHANNEL_LIST"
+#endif
+#if METRICS_RECORD_LEN > RX_FIFO_STATION_LEN
+#error "Metrics record does not fit an uplink record"
+#endif
+#if METRICS_POS_DATA + 2 * METRICS_BUCKETS > METRICS_RECORD_LEN
+#error "Metrics histogram does not fit a metrics record"
+#endif
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void metricsInit(uint8 myId);
+void metricsCount(uint8 counter);
+void metricsAdd(uint8 counter, uint32 n);
+void metricsSet(uint8 counter, uint32 value);
+uint32 metricsGetCounter(uint8 counter);
+void metricsHist(uint8 hist, uint32 value);
+void metricsHistTime(uint8 hist, const timeStamp_t *pFrom, const timeStamp_t *pTo);
+uint8 metricsReportDue(uint32 now);
+void metricsSnapshot(uint8 code, const timeStamp_t *pNow);
+uint8 metricsAvailable(void);
+uint8 metricsGet(rxPacket_t *pPacket);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
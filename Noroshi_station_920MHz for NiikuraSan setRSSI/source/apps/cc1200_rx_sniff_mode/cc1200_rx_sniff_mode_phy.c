@@ -0,0 +1,164 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_phy.c
+//! @brief      Named PHY profiles, see cc1200_rx_sniff_mode_phy.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include "cc1200_rx_sniff_mode_phy.h"
+#include "cc1200_rx_sniff_mode_reg_config.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+// Status registers from here on are read-only, SmartRF Studio exports
+// some of them (PARTNUMBER, PARTVERSION, MODEM_STATUS1)
+#define PHY_STATUS_REG_FIRST    CC120X_WOR_TIME1
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    const char *pName;                  // LCD, at most 16 characters
+    const registerSetting_t *pSettings;
+    uint8  count;
+} phyProfile_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static const phyProfile_t phyProfiles[PHY_PROFILE_COUNT] = {
+    {"920MHz 100kbps", phySettings920MHz100k,
+     sizeof(phySettings920MHz100k)/sizeof(registerSetting_t)},
+    {"920MHz 38.4kbps", phySettings920MHz38k4,
+     sizeof(phySettings920MHz38k4)/sizeof(registerSetting_t)},
+};
+
+static uint8 phyProfile = PHY_PROFILE_DEFAULT;
+static phyWriteStats_t phyWriteStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void phyWriteSettings(const registerSetting_t *pSettings, uint8 count);
+
+
+/*******************************************************************************
+*   @fn         phyWriteProfile
+*
+*   @brief      Resets the radio and writes a profile. The radio is left in
+*               IDLE, uncalibrated
+*
+*   @param      profile - PHY_PROFILE_xxx
+*
+*   @return     TRUE if written, FALSE for an unknown profile
+*/
+uint8 phyWriteProfile(uint8 profile) {
+
+    if(profile >= PHY_PROFILE_COUNT) {
+        return FALSE;
+    }
+
+    trxSpiCmdStrobe(CC120X_SRES);
+    phyWriteSettings(phyProfiles[profile].pSettings, phyProfiles[profile].count);
+    phyProfile = profile;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         phyGetProfile
+*
+*   @brief      Returns the profile last written
+*
+*   @param      none
+*
+*   @return     PHY_PROFILE_xxx
+*/
+uint8 phyGetProfile(void) {
+
+    return phyProfile;
+}
+
+
+/*******************************************************************************
+*   @fn         phyGetName
+*
+*   @brief      Returns a profile's display name
+*
+*   @param      profile - PHY_PROFILE_xxx
+*
+*   @return     name, "?" for an unknown profile
+*/
+const char *phyGetName(uint8 profile) {
+
+    if(profile >= PHY_PROFILE_COUNT) {
+        return "?";
+    }
+    return phyProfiles[profile].pName;
+}
+
+
+/*******************************************************************************
+*   @fn         phyGetWriteStats
+*
+*   @brief      Returns the transaction count of the last profile write
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const phyWriteStats_t *phyGetWriteStats(void) {
+
+    return &phyWriteStats;
+}
+
+
+/*******************************************************************************
+*   @fn         phyWriteSettings
+*
+*   @brief      Writes a table with one burst per run of consecutive
+*               addresses. cc120xSpiWriteReg picks the 8 bit or the 0x2F
+*               extended access from the address, a run never crosses from
+*               one space into the other since 0x002E + 1 != 0x2F00
+*
+*   @param      pSettings - table in ascending address order
+*   @param      count     - number of entries
+*
+*   @return     none
+*/
+static void phyWriteSettings(const registerSetting_t *pSettings, uint8 count) {
+
+    uint8  burst[PHY_MAX_BURST];
+    uint16 addr;
+    uint8  len;
+    uint8  i = 0;
+
+    phyWriteStats.bursts = 0;
+    phyWriteStats.registers = 0;
+
+    while(i < count) {
+        addr = pSettings[i].addr;
+        if(addr >= PHY_STATUS_REG_FIRST) {
+            i++;
+            continue;
+        }
+
+        len = 0;
+        do {
+            burst[len++] = pSettings[i++].data;
+        } while((i < count) && (len < PHY_MAX_BURST) &&
+                (pSettings[i].addr == addr + len));
+
+        cc120xSpiWriteReg(addr, burst, len);
+        phyWriteStats.bursts++;
+        phyWriteStats.registers += len;
+    }
+}
@@ -0,0 +1,58 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_phy.h
+//! @brief      Named PHY profiles for the CC1200. A profile is one of the
+//!             SmartRF Studio tables in cc1200_rx_sniff_mode_reg_config.h,
+//!             written after SRES with one burst access per run of
+//!             consecutive register addresses.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_PHY_H
+#define CC1200_RX_SNIFF_MODE_PHY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define PHY_PROFILE_920MHZ_100K 0
+#define PHY_PROFILE_920MHZ_38K4 1
+#define PHY_PROFILE_COUNT       2
+
+#ifndef PHY_PROFILE_DEFAULT
+#define PHY_PROFILE_DEFAULT     PHY_PROFILE_920MHZ_100K
+#endif
+
+#define PHY_MAX_BURST           32      // longest single burst access
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint8  bursts;                      // SPI transactions, SRES excluded
+    uint8  registers;                   // registers written
+} phyWriteStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+uint8 phyWriteProfile(uint8 profile);
+uint8 phyGetProfile(void);
+const char *phyGetName(uint8 profile);
+const phyWriteStats_t *phyGetWriteStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,379 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_query.c
+//! @brief      Query of the flash tag log, see cc1200_rx_sniff_mode_query.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <stdint.h>
+#include <string.h>
+#include "cc1200_rx_sniff_mode_query.h"
+#include "cc1200_rx_sniff_mode_flog.h"
+#include "cc1200_rx_sniff_mode_fio.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define QUERY_PHASE_IDLE        0
+#define QUERY_PHASE_INDEX       1       // next: index of the next sub-sector
+#define QUERY_PHASE_PAGES       2       // next: record page querySlot
+#define QUERY_PHASE_DONE        3       // done record waits for queryGet
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint8 queryMyId;
+
+// Query
+static uint8 queryPhase;
+static uint32 queryTag;
+static uint32 queryFrom;
+static uint32 queryTo;
+static timeStamp_t queryStartTime;
+
+// Position: sub-sectors visited since the oldest, record pages of the
+// current one
+static uint8 queryFirstSub;
+static uint8 querySub;
+static uint8 querySlot;
+static uint8 querySlotEnd;
+static uint32 queryFirstSeq;
+static uint8 queryBusy;                 // a read is queued
+static uint8 queryStale;                // of a query given up, ignored
+
+// Page or index being worked on, records from queryPos to queryEnd
+static uint8 queryBuf[FLOG_PAGE_SIZE];
+static uint16 queryPos;
+static uint16 queryEnd;
+
+// Counts of this query for its done record
+static uint8 queryIndexes;
+static uint8 querySectors;
+static uint16 queryPages;
+static uint16 queryMatches;
+static uint16 queryLatencyMs;
+
+static queryStats_t queryStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void queryIndexDone(uint8 result);
+static void queryPageDone(uint8 result);
+static void queryFinish(const timeStamp_t *pNow);
+
+
+/*******************************************************************************
+*   @fn         queryInit
+*
+*   @brief      Clears the query state and counters
+*
+*   @param      myId - this station's ID, for the done record
+*
+*   @return     none
+*/
+void queryInit(uint8 myId) {
+
+    queryMyId = myId;
+    queryPhase = QUERY_PHASE_IDLE;
+    queryBusy = FALSE;
+    queryStale = FALSE;
+    queryPos = 0;
+    queryEnd = 0;
+    memset(&queryStats, 0, sizeof(queryStats));
+}
+
+
+/*******************************************************************************
+*   @fn         queryStart
+*
+*   @brief      Starts a query, a running one is given up without a done
+*               record. A read still queued for it completes into the page
+*               buffer and is ignored
+*
+*   @param      tagId - TagID or FLOG_TAG_ANY
+*   @param      from  - first UTC second or FLOG_TIME_FIRST
+*   @param      to    - last UTC second or FLOG_TIME_LAST
+*   @param      pNow  - UTC time
+*
+*   @return     none
+*/
+void queryStart(uint32 tagId, uint32 from, uint32 to, const timeStamp_t *pNow) {
+
+    if((queryPhase == QUERY_PHASE_INDEX) || (queryPhase == QUERY_PHASE_PAGES)) {
+        queryStats.aborted++;
+    }
+    queryStale = queryBusy;
+    queryTag = tagId;
+    queryFrom = from;
+    queryTo = to;
+    queryStartTime = *pNow;
+    queryFirstSub = (uint8)((flogHeadPage() / FLOG_SUBSECTOR_PAGES + 1) % FLOG_SUBSECTORS);
+    querySub = 0;
+    queryPos = 0;
+    queryEnd = 0;
+    queryIndexes = 0;
+    querySectors = 0;
+    queryPages = 0;
+    queryMatches = 0;
+    queryPhase = QUERY_PHASE_INDEX;
+    queryStats.queries++;
+}
+
+
+/*******************************************************************************
+*   @fn         queryPoll
+*
+*   @brief      Moves the query on once the records of the last page are
+*               used up: queues the read of the next index or record page,
+*               or takes the index of the open sub-sector from RAM. Never
+*               waits, the read completes in fioPoll
+*
+*   @param      pNow - UTC time
+*
+*   @return     none
+*/
+void queryPoll(const timeStamp_t *pNow) {
+
+    uint16 head;
+    uint8 sub;
+
+    while(!queryBusy && (queryPos >= queryEnd)) {
+        if(queryPhase == QUERY_PHASE_INDEX) {
+            if(querySub >= FLOG_SUBSECTORS) {
+                queryFinish(pNow);
+                return;
+            }
+            sub = (uint8)((queryFirstSub + querySub) % FLOG_SUBSECTORS);
+            head = flogHeadPage();
+            if(sub == head / FLOG_SUBSECTOR_PAGES) {
+                querySlotEnd = (uint8)(head % FLOG_SUBSECTOR_PAGES);
+                memcpy(queryBuf, flogOpenIndex(), FLOG_INDEX_LEN);
+                queryIndexDone(FIO_OK);
+            } else {
+                querySlotEnd = FLOG_INDEX_SLOT;
+                if(!fioRead((uint32)(FLOG_FIRST_PAGE + (uint16)sub * FLOG_SUBSECTOR_PAGES +
+                                     FLOG_INDEX_SLOT) * FLOG_PAGE_SIZE,
+                            queryBuf, FLOG_INDEX_LEN, &queryIndexDone)) {
+                    return;
+                }
+                queryBusy = TRUE;
+            }
+        } else if(queryPhase == QUERY_PHASE_PAGES) {
+            if(querySlot >= querySlotEnd) {
+                querySub++;
+                queryPhase = QUERY_PHASE_INDEX;
+                continue;
+            }
+            sub = (uint8)((queryFirstSub + querySub) % FLOG_SUBSECTORS);
+            if(!fioRead((uint32)(FLOG_FIRST_PAGE + (uint16)sub * FLOG_SUBSECTOR_PAGES +
+                                 querySlot) * FLOG_PAGE_SIZE,
+                        queryBuf, FLOG_PAGE_SIZE, &queryPageDone)) {
+                return;
+            }
+            queryBusy = TRUE;
+        } else {
+            return;
+        }
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         queryDue
+*
+*   @brief      Checks whether queryPoll has a read to queue
+*
+*   @param      none
+*
+*   @return     TRUE if queryPoll should run
+*/
+uint8 queryDue(void) {
+
+    return ((queryPhase == QUERY_PHASE_INDEX) || (queryPhase == QUERY_PHASE_PAGES)) &&
+           !queryBusy && (queryPos >= queryEnd);
+}
+
+
+/*******************************************************************************
+*   @fn         queryAvailable
+*
+*   @brief      Checks whether queryGet may return a record
+*
+*   @param      none
+*
+*   @return     TRUE if records of a page or the done record wait
+*/
+uint8 queryAvailable(void) {
+
+    return (queryPos < queryEnd) || (queryPhase == QUERY_PHASE_DONE);
+}
+
+
+/*******************************************************************************
+*   @fn         queryGet
+*
+*   @brief      Returns the next matching record, or the done record once
+*               the scan has ended. Records are returned as logged: len,
+*               data, channel and UTC stamp
+*
+*   @param      pPacket - output
+*
+*   @return     TRUE if a record was returned
+*/
+uint8 queryGet(rxPacket_t *pPacket) {
+
+    uint8 len;
+
+    while(queryPos < queryEnd) {
+        len = flogParseRecord(&queryBuf[queryPos], queryEnd - queryPos, pPacket);
+        if(len == 0) {
+            queryPos = queryEnd;
+            break;
+        }
+        queryPos += len;
+        if(flogRecordMatch(pPacket, queryTag, queryFrom, queryTo)) {
+            queryMatches++;
+            queryStats.matches++;
+            return TRUE;
+        }
+    }
+
+    if(queryPhase != QUERY_PHASE_DONE) {
+        return FALSE;
+    }
+    pPacket->len = QUERY_DONE_LEN;
+    pPacket->data[0] = QUERY_DONE_LEN - 1;
+    pPacket->data[QUERY_POS_TYPE] = QUERY_TYPE_DONE;
+    pPacket->data[QUERY_POS_SRC] = queryMyId;
+    pPacket->data[QUERY_POS_INDEXES] = queryIndexes;
+    pPacket->data[QUERY_POS_SECTORS] = querySectors;
+    pPacket->data[QUERY_POS_PAGES] = HI_UINT16(queryPages);
+    pPacket->data[QUERY_POS_PAGES + 1] = LO_UINT16(queryPages);
+    pPacket->data[QUERY_POS_MATCHES] = HI_UINT16(queryMatches);
+    pPacket->data[QUERY_POS_MATCHES + 1] = LO_UINT16(queryMatches);
+    pPacket->data[QUERY_POS_LATENCY] = HI_UINT16(queryLatencyMs);
+    pPacket->data[QUERY_POS_LATENCY + 1] = LO_UINT16(queryLatencyMs);
+    pPacket->channel = 0;
+    pPacket->stamp = queryStartTime;
+    queryPhase = QUERY_PHASE_IDLE;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         queryGetStats
+*
+*   @brief      Returns the query counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const queryStats_t *queryGetStats(void) {
+
+    return &queryStats;
+}
+
+
+/*******************************************************************************
+*   @fn         queryIndexDone
+*
+*   @brief      The index of a sub-sector is in: its record pages are read
+*               next if it may hold matches, else the next sub-sector is
+*
+*   @param      result - FIO_OK or FIO_FAILED
+*
+*   @return     none
+*/
+static void queryIndexDone(uint8 result) {
+
+    queryBusy = FALSE;
+    if(queryStale) {
+        queryStale = FALSE;
+        return;
+    }
+    queryIndexes++;
+    queryStats.indexReads++;
+    if((result == FIO_OK) && (querySlotEnd > 0) &&
+       flogIndexMatch(queryBuf, queryTag, queryFrom, queryTo)) {
+        queryFirstSeq = flogGet32(&queryBuf[FLOG_IDX_POS_SEQ]);
+        querySlot = 0;
+        querySectors++;
+        queryStats.sectorsRead++;
+        queryPhase = QUERY_PHASE_PAGES;
+    } else {
+        querySub++;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         queryPageDone
+*
+*   @brief      A record page is in, its records are offered to queryGet. A
+*               page that fails its CRC or holds another sequence number,
+*               rewritten since the index was read, is skipped
+*
+*   @param      result - FIO_OK or FIO_FAILED
+*
+*   @return     none
+*/
+static void queryPageDone(uint8 result) {
+
+    uint8 used = queryBuf[FLOG_POS_USED];
+
+    queryBusy = FALSE;
+    if(queryStale) {
+        queryStale = FALSE;
+        return;
+    }
+    queryPages++;
+    queryStats.pagesRead++;
+    if((result == FIO_OK) &&
+       (queryBuf[FLOG_POS_MAGIC] == FLOG_PAGE_MAGIC) && (used <= FLOG_RECORDS_MAX) &&
+       (flogGet32(&queryBuf[FLOG_POS_SEQ]) == queryFirstSeq + querySlot) &&
+       crc16Check(queryBuf, FLOG_POS_RECORDS + used + CRC16_LEN)) {
+        queryPos = FLOG_POS_RECORDS;
+        queryEnd = FLOG_POS_RECORDS + used;
+    } else {
+        queryStats.badPages++;
+    }
+    querySlot++;
+}
+
+
+/*******************************************************************************
+*   @fn         queryFinish
+*
+*   @brief      The scan has ended, the done record waits for queryGet
+*
+*   @param      pNow - UTC time
+*
+*   @return     none
+*/
+static void queryFinish(const timeStamp_t *pNow) {
+
+    int32 ms;
+
+    ms = (int32)(pNow->sec - queryStartTime.sec) * 1000 +
+         ((int32)(pNow->frac & TIME_FRAC_BM) - (int32)(queryStartTime.frac & TIME_FRAC_BM)) *
+         1000 / TIME_FRAC_HZ;
+    if(ms < 0) {
+        ms = 0;
+    } else if(ms > 0xFFFF) {
+        ms = 0xFFFF;
+    }
+    queryLatencyMs = (uint16)ms;
+    queryStats.latencyLastMs = queryLatencyMs;
+    if(queryLatencyMs > queryStats.latencyMaxMs) {
+        queryStats.latencyMaxMs = queryLatencyMs;
+    }
+    queryPhase = QUERY_PHASE_DONE;
+}
@@ -0,0 +1,88 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_query.h
+//! @brief      Query of the flash tag log (cc1200_rx_sniff_mode_flog.h) by
+//!             TagID and a range of UTC seconds. The sub-sectors are visited
+//!             oldest first; for each, its index page is read and only if
+//!             its time range and TagID bloom filter may match are its 15
+//!             record pages read. The sub-sector being filled is checked
+//!             against the index kept in RAM. Matching records are returned
+//!             one at a time through queryGet, a page is read only once the
+//!             previous one is used up, so the uplink paces the query. The
+//!             query ends with a done record: index pages read, sub-sectors
+//!             read, pages read, matches and the time from the start to the
+//!             end of the scan. Records still collected in RAM are not
+//!             seen, and without FLOG_HISTORY the log holds only the records
+//!             that were spilled. All flash reads go through the queue of
+//!             cc1200_rx_sniff_mode_fio.h, nothing waits.
+//!
+//!             Estimates, not measured: a full device query reads 63 index
+//!             pages of 145 bytes, ~1 ms each at 8 MHz SPI, ~60 ms in all;
+//!             a sub-sector that matches adds 15 pages of ~1.6 ms. A scan
+//!             of all 945 record pages takes ~1.5 s. Builds under gcc on
+//!             Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_QUERY_H
+#define CC1200_RX_SNIFF_MODE_QUERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_time.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// Done record for the uplink, ends a query, stamped with the start of the
+// query. LATENCY in ms from the start to the end of the scan, big endian
+#define QUERY_TYPE_DONE         0xB8
+#define QUERY_POS_TYPE          1
+#define QUERY_POS_SRC           2
+#define QUERY_POS_INDEXES       3       // index pages read
+#define QUERY_POS_SECTORS       4       // sub-sectors whose pages were read
+#define QUERY_POS_PAGES         5       // 2 bytes
+#define QUERY_POS_MATCHES       7       // 2 bytes
+#define QUERY_POS_LATENCY       9       // 2 bytes
+#define QUERY_DONE_LEN          11
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 queries;
+    uint32 aborted;                     // replaced by a new query
+    uint32 indexReads;
+    uint32 sectorsRead;
+    uint32 pagesRead;
+    uint32 badPages;                    // CRC or sequence mismatch
+    uint32 matches;
+    uint16 latencyLastMs;
+    uint16 latencyMaxMs;
+} queryStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void queryInit(uint8 myId);
+void queryStart(uint32 tagId, uint32 from, uint32 to, const timeStamp_t *pNow);
+void queryPoll(const timeStamp_t *pNow);
+uint8 queryDue(void);
+uint8 queryAvailable(void);
+uint8 queryGet(rxPacket_t *pPacket);
+const queryStats_t *queryGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -48,6 +48,10 @@ extern "C" {
 /******************************************************************************
  * VARIABLES
  */
+// Live tables are selected through cc1200_rx_sniff_mode_phy.h and must stay
+// in ascending address order: phyWriteProfile() writes each run of
+// consecutive addresses as one burst. Commented-out exports are kept for
+// reference only
 // RX filter BW = 104.166667
 // Address config = No address check
 // Packet length = 125
@@ -185,9 +189,8 @@ static const registerSetting_t preferredSettings[] = {
 };
 */
 
-// 920MHz 38.4kbps Perfect
-/*
-static const registerSetting_t preferredSettings[] = {
+// 920MHz 38.4kbps Perfect, PHY_PROFILE_920MHZ_38K4
+static const registerSetting_t phySettings920MHz38k4[] = {
     {CC120X_IOCFG2,         0x06},
     {CC120X_SYNC_CFG1,      0xA9},
     {CC120X_MODCFG_DEV_E,   0x0B},
@@ -241,7 +244,6 @@ static const registerSetting_t preferredSettings[] = {
     {CC120X_PARTVERSION,    0x11},
     {CC120X_MODEM_STATUS1,  0x10},
 };
-*/
 
 // 920MHz ???
 /*
@@ -347,8 +349,8 @@ static const registerSetting_t preferredSettings[] = {
 */
 
 
-// 920MHz 100kbps
-static const registerSetting_t preferredSettings[] = {
+// 920MHz 100kbps, PHY_PROFILE_920MHZ_100K
+static const registerSetting_t phySettings920MHz100k[] = {
     {CC120X_IOCFG2,         0x06},
     {CC120X_SYNC_CFG1,      0xA8},
     {CC120X_SYNC_CFG0,      0x23},
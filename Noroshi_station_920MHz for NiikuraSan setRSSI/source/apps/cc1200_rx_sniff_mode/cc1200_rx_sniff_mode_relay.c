@@ -0,0 +1,636 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_relay.c
+//! @brief      Store-and-forward relay, see cc1200_rx_sniff_mode_relay.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_relay.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#if RELAY_RECORDS_MAX < 1
+#error "RX_FIFO_SLOT_SIZE is too small for a relay frame"
+#endif
+#if (RELAY_QUEUE_SLOTS < 1) || (RELAY_QUEUE_SLOTS > 255)
+#error "RELAY_QUEUE_SLOTS must be 1..255"
+#endif
+
+#define RELAY_AGE_MAX           0xFFFF
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8  frame[RELAY_FRAME_MAX];
+    uint8  len;
+    uint8  retries;
+    uint16 ageIn;                       // AGE when it arrived here
+    uint16 arrival;                     // ticks, when it arrived or was opened
+    uint16 notBefore;                   // ticks, earliest next attempt
+} relayEntry_t;
+
+typedef struct {
+    uint8 id;
+    uint8 seq;                          // last SEQ accepted from it
+} relayNeighbor_t;
+
+typedef struct {
+    uint8 dest;
+    uint8 nextHop;
+} relayRoute_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static relayEntry_t relayQueue[RELAY_QUEUE_SLOTS];
+static uint8 relayHead;
+static uint8 relayCount;
+static uint8 relayInFlight;             // head sent, waiting for its ACK
+
+static relayEntry_t relayOpen;          // local records being collected
+static uint8 relayOpenCount;
+
+static relayNeighbor_t relayNeighbors[RELAY_NEIGHBORS];
+static uint8 relayNeighborNext;
+static relayRoute_t relayRoutes[RELAY_ROUTES];
+
+static uint8 relayMyId;
+static uint8 relayDefaultHop;
+static uint8 relaySeq;
+static relayStats_t relayStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 relayRouteTo(uint8 dest);
+static uint8 relayClose(void);
+static relayEntry_t *relayPush(void);
+static void relayPop(void);
+static relayNeighbor_t *relayFindNeighbor(uint8 id);
+static uint8 relayMakeAck(const uint8 *pData, uint8 *pAck);
+
+
+/*******************************************************************************
+*   @fn         relayInit
+*
+*   @brief      Empties the queues and the route table
+*
+*   @param      myId    - this station's ID, RELAY_MASTER_ID for the master
+*   @param      nextHop - default route, station one hop closer to the master
+*
+*   @return     none
+*/
+void relayInit(uint8 myId, uint8 nextHop) {
+
+    uint8 i;
+
+    relayHead = 0;
+    relayCount = 0;
+    relayInFlight = FALSE;
+    relayOpenCount = 0;
+    relayNeighborNext = 0;
+    relaySeq = 0;
+
+    for(i = 0; i < RELAY_NEIGHBORS; i++) {
+        relayNeighbors[i].id = RELAY_ID_NONE;
+        relayNeighbors[i].seq = 0;
+    }
+    for(i = 0; i < RELAY_ROUTES; i++) {
+        relayRoutes[i].dest = RELAY_ID_NONE;
+        relayRoutes[i].nextHop = RELAY_ID_NONE;
+    }
+
+    relayMyId = myId;
+    relayDefaultHop = nextHop;
+    memset(&relayStats, 0, sizeof(relayStats));
+}
+
+
+/*******************************************************************************
+*   @fn         relaySetRoute
+*
+*   @brief      Sets the next hop toward one station, overriding the default
+*               route. RELAY_ID_NONE as next hop removes the entry
+*
+*   @param      dest    - destination station
+*   @param      nextHop - station to hand its frames to
+*
+*   @return     TRUE if stored, FALSE if the route table is full
+*/
+uint8 relaySetRoute(uint8 dest, uint8 nextHop) {
+
+    uint8 i;
+    uint8 free = RELAY_ROUTES;
+
+    for(i = 0; i < RELAY_ROUTES; i++) {
+        if(relayRoutes[i].dest == dest) {
+            break;
+        }
+        if((free == RELAY_ROUTES) && (relayRoutes[i].dest == RELAY_ID_NONE)) {
+            free = i;
+        }
+    }
+    if(i == RELAY_ROUTES) {
+        if(nextHop == RELAY_ID_NONE) {
+            return TRUE;
+        }
+        if(free == RELAY_ROUTES) {
+            return FALSE;
+        }
+        i = free;
+    }
+
+    relayRoutes[i].dest = (nextHop == RELAY_ID_NONE) ? RELAY_ID_NONE : dest;
+    relayRoutes[i].nextHop = nextHop;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         relayIsMaster
+*
+*   @brief      Checks whether this station ends the relay path
+*
+*   @param      none
+*
+*   @return     TRUE for the master
+*/
+uint8 relayIsMaster(void) {
+
+    return relayMyId == RELAY_MASTER_ID;
+}
+
+
+/*******************************************************************************
+*   @fn         relayIsFrame
+*
+*   @brief      Tells relay frames from tag packets and station frames by the
+*               type byte and a length no other packet uses. The CRC-16 is
+*               checked by relayReceive
+*
+*   @param      pData - packet, length byte first
+*   @param      len   - bytes in pData
+*
+*   @return     TRUE for a relay DATA or ACK frame
+*/
+uint8 relayIsFrame(const uint8 *pData, uint8 len) {
+
+    uint8 count;
+
+    if((len < RELAY_ACK_LEN) || (pData[0] != len - 1)) {
+        return FALSE;
+    }
+    if(pData[RELAY_POS_TYPE] == RELAY_TYPE_ACK) {
+        return len == RELAY_ACK_LEN;
+    }
+    if(pData[RELAY_POS_TYPE] == RELAY_TYPE_DATA) {
+        count = pData[RELAY_POS_COUNT];
+        return (count >= 1) && (count <= RELAY_RECORDS_MAX) &&
+               (len == RELAY_HDR_LEN + count * RELAY_RECORD_LEN + RELAY_CRC_LEN);
+    }
+    return FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         relayAddRecord
+*
+*   @brief      Adds a tag packet received by this station to the frame being
+*               collected. The frame is queued once it is full or has waited
+*               RELAY_AGG_HOLD ticks
+*
+*   @param      pRecord - tag packet, RELAY_RECORD_LEN bytes, RSSI in byte 0
+*   @param      now     - Timer B0 ticks
+*
+*   @return     TRUE if taken, FALSE if the forward queue is full
+*/
+uint8 relayAddRecord(const uint8 *pRecord, uint16 now) {
+
+    if((relayOpenCount >= RELAY_RECORDS_MAX) && !relayClose()) {
+        relayStats.recordsRefused++;
+        return FALSE;
+    }
+
+    if(relayOpenCount == 0) {
+        relayOpen.arrival = now;
+    }
+    memcpy(&relayOpen.frame[RELAY_POS_RECORDS + relayOpenCount * RELAY_RECORD_LEN],
+           pRecord, RELAY_RECORD_LEN);
+    relayOpenCount++;
+    relayStats.recordsQueued++;
+
+    if(relayOpenCount >= RELAY_RECORDS_MAX) {
+        relayClose();
+    }
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         relayTick
+*
+*   @brief      Queues the frame being collected once it has waited
+*               RELAY_AGG_HOLD ticks
+*
+*   @param      now - Timer B0 ticks
+*
+*   @return     none
+*/
+void relayTick(uint16 now) {
+
+    if((relayOpenCount > 0) &&
+       ((uint16)(now - relayOpen.arrival) >= RELAY_AGG_HOLD)) {
+        relayClose();
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         relayDue
+*
+*   @brief      Checks whether relayTick or relayNextTx has work to do
+*
+*   @param      now - Timer B0 ticks
+*
+*   @return     TRUE if a frame can be queued or sent
+*/
+uint8 relayDue(uint16 now) {
+
+    if((relayOpenCount > 0) && (relayCount < RELAY_QUEUE_SLOTS) &&
+       ((uint16)(now - relayOpen.arrival) >= RELAY_AGG_HOLD)) {
+        return TRUE;
+    }
+    return (relayCount > 0) && !relayInFlight &&
+           ((int16)(now - relayQueue[relayHead].notBefore) >= 0);
+}
+
+
+/*******************************************************************************
+*   @fn         relayNextTx
+*
+*   @brief      Takes the frame at the head of the forward queue for one
+*               attempt. Addresses it to the next hop, adds the time it spent
+*               here to its age and seals it with the CRC-16. A retry keeps
+*               its sequence number, so the next hop can discard it when only
+*               the ACK was lost. Report the outcome with relayReceive (ACK)
+*               or relayAckTimeout
+*
+*   @param      now    - Timer B0 ticks
+*   @param      pFrame - output, RELAY_FRAME_MAX bytes
+*
+*   @return     bytes to send, 0 if nothing is due
+*/
+uint8 relayNextTx(uint16 now, uint8 *pFrame) {
+
+    relayEntry_t *pEntry;
+    uint32 age;
+    uint8 nextHop;
+
+    if(!relayDue(now) || (relayCount == 0)) {
+        return 0;
+    }
+    pEntry = &relayQueue[relayHead];
+    if((int16)(now - pEntry->notBefore) < 0) {
+        return 0;
+    }
+
+    nextHop = relayRouteTo(pEntry->frame[RELAY_POS_FINAL]);
+    if(nextHop == RELAY_ID_NONE) {
+        relayStats.framesDropped++;
+        relayPop();
+        return 0;
+    }
+
+    if(pEntry->retries == 0) {
+        pEntry->frame[RELAY_POS_SEQ] = relaySeq++;
+    }
+    pEntry->frame[RELAY_POS_SRC] = relayMyId;
+    pEntry->frame[RELAY_POS_DST] = nextHop;
+
+    age = (uint32)pEntry->ageIn + (uint16)(now - pEntry->arrival);
+    if(age > RELAY_AGE_MAX) {
+        age = RELAY_AGE_MAX;
+    }
+    pEntry->frame[RELAY_POS_AGE] = HI_UINT16(age);
+    pEntry->frame[RELAY_POS_AGE + 1] = LO_UINT16(age);
+    crc16Append(pEntry->frame, pEntry->len - RELAY_CRC_LEN);
+
+    memcpy(pFrame, pEntry->frame, pEntry->len);
+    relayInFlight = TRUE;
+    relayStats.framesSent++;
+    return pEntry->len;
+}
+
+
+/*******************************************************************************
+*   @fn         relayAckTimeout
+*
+*   @brief      Ends an attempt that got no ACK: the frame is tried again
+*               after RELAY_BACKOFF << retries ticks plus a per-station offset
+*               that keeps two neighbours from colliding twice, or dropped
+*               after RELAY_MAX_RETRIES. No-op if the ACK already arrived
+*
+*   @param      now - Timer B0 ticks
+*
+*   @return     none
+*/
+void relayAckTimeout(uint16 now) {
+
+    relayEntry_t *pEntry;
+
+    if(!relayInFlight) {
+        return;
+    }
+    relayInFlight = FALSE;
+    pEntry = &relayQueue[relayHead];
+
+    if(pEntry->retries >= RELAY_MAX_RETRIES) {
+        relayStats.framesDropped++;
+        relayPop();
+        return;
+    }
+    pEntry->retries++;
+    relayStats.retries++;
+    pEntry->notBefore = now + (RELAY_BACKOFF << (pEntry->retries - 1)) +
+                        (relayMyId & 0x03);
+}
+
+
+/*******************************************************************************
+*   @fn         relayReceive
+*
+*   @brief      Handles a relay frame from the radio. An ACK for the frame in
+*               flight removes it from the queue. A DATA frame addressed to
+*               this station is delivered (master) or queued for the next hop
+*               and acknowledged; a repeat of the last frame from the same
+*               station is acknowledged again but not passed on. A frame the
+*               queue or the uplink has no room for is not acknowledged, the
+*               sender tries it again. Frames for other stations are ignored
+*
+*   @param      pData      - frame, length byte first
+*   @param      len        - bytes in pData
+*   @param      now        - Timer B0 ticks
+*   @param      pAck       - output, RELAY_ACK_LEN bytes
+*   @param      room       - master: records pfnDeliver takes at least
+*   @param      pfnDeliver - master: receives each record
+*
+*   @return     bytes of ACK to send back at once, 0 for none
+*/
+uint8 relayReceive(const uint8 *pData, uint8 len, uint16 now, uint8 *pAck,
+                   uint8 room, relayDeliver_t pfnDeliver) {
+
+    relayNeighbor_t *pNeighbor;
+    relayEntry_t *pEntry;
+    uint16 age;
+    uint8 count;
+    uint8 i;
+
+    if(!relayIsFrame(pData, len) || (pData[RELAY_POS_DST] != relayMyId)) {
+        return 0;
+    }
+    if(!crc16Check(pData, len)) {
+        relayStats.badFrames++;
+        return 0;
+    }
+    count = pData[RELAY_POS_COUNT];
+
+    if(pData[RELAY_POS_TYPE] == RELAY_TYPE_ACK) {
+        pEntry = &relayQueue[relayHead];
+        if(relayInFlight &&
+           (pData[RELAY_POS_SRC] == pEntry->frame[RELAY_POS_DST]) &&
+           (pData[RELAY_POS_SEQ] == pEntry->frame[RELAY_POS_SEQ])) {
+            relayStats.framesAcked++;
+            relayStats.recordsAcked += pEntry->frame[RELAY_POS_COUNT];
+            relayInFlight = FALSE;
+            relayPop();
+        }
+        return 0;
+    }
+
+    pNeighbor = relayFindNeighbor(pData[RELAY_POS_SRC]);
+    if((pNeighbor != NULL) && (pNeighbor->seq == pData[RELAY_POS_SEQ])) {
+        relayStats.duplicates++;
+        return relayMakeAck(pData, pAck);
+    }
+
+    age = BUILD_UINT16(pData[RELAY_POS_AGE + 1], pData[RELAY_POS_AGE]);
+    if(pData[RELAY_POS_FINAL] == relayMyId) {
+        if(count > room) {
+            relayStats.framesRefused++;
+            return 0;
+        }
+        for(i = 0; i < count; i++) {
+            if((pfnDeliver != NULL) &&
+               pfnDeliver(&pData[RELAY_POS_RECORDS + i * RELAY_RECORD_LEN],
+                          pData[RELAY_POS_ORIGIN], pData[RELAY_POS_HOPS] + 1)) {
+                relayStats.recordsDelivered++;
+            } else {
+                relayStats.recordsRefused++;
+            }
+        }
+        relayStats.latencySum += age;
+        relayStats.latencyCount++;
+        if(age > relayStats.latencyMax) {
+            relayStats.latencyMax = age;
+        }
+    } else {
+        pEntry = relayPush();
+        if(pEntry == NULL) {
+            relayStats.framesRefused++;
+            return 0;
+        }
+        memcpy(pEntry->frame, pData, len);
+        pEntry->frame[RELAY_POS_HOPS]++;
+        pEntry->len = len;
+        pEntry->ageIn = age;
+        pEntry->arrival = now;
+        pEntry->notBefore = now;
+        relayStats.framesForwarded++;
+    }
+    relayStats.framesReceived++;
+
+    if(pNeighbor == NULL) {
+        pNeighbor = &relayNeighbors[relayNeighborNext];
+        relayNeighborNext = (relayNeighborNext + 1) % RELAY_NEIGHBORS;
+        pNeighbor->id = pData[RELAY_POS_SRC];
+    }
+    pNeighbor->seq = pData[RELAY_POS_SEQ];
+
+    return relayMakeAck(pData, pAck);
+}
+
+
+/*******************************************************************************
+*   @fn         relayGetStats
+*
+*   @brief      Returns the relay counters. Mean end-to-end latency is
+*               latencySum / latencyCount ticks of 50 ms, hop throughput is
+*               the change of recordsAcked over time
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const relayStats_t *relayGetStats(void) {
+
+    return &relayStats;
+}
+
+
+/*******************************************************************************
+*   @fn         relayRouteTo
+*
+*   @brief      Looks up the next hop toward a station
+*
+*   @param      dest - destination station
+*
+*   @return     next hop, the default route if dest has no entry
+*/
+static uint8 relayRouteTo(uint8 dest) {
+
+    uint8 i;
+
+    for(i = 0; i < RELAY_ROUTES; i++) {
+        if(relayRoutes[i].dest == dest) {
+            return relayRoutes[i].nextHop;
+        }
+    }
+    return relayDefaultHop;
+}
+
+
+/*******************************************************************************
+*   @fn         relayClose
+*
+*   @brief      Moves the frame being collected into the forward queue. The
+*               per-hop fields are filled in by relayNextTx
+*
+*   @param      none
+*
+*   @return     TRUE if queued, FALSE if the queue is full or nothing is open
+*/
+static uint8 relayClose(void) {
+
+    relayEntry_t *pEntry;
+
+    if(relayOpenCount == 0) {
+        return FALSE;
+    }
+    pEntry = relayPush();
+    if(pEntry == NULL) {
+        return FALSE;
+    }
+
+    pEntry->len = RELAY_HDR_LEN + relayOpenCount * RELAY_RECORD_LEN + RELAY_CRC_LEN;
+    memcpy(&pEntry->frame[RELAY_POS_RECORDS], &relayOpen.frame[RELAY_POS_RECORDS],
+           relayOpenCount * RELAY_RECORD_LEN);
+    pEntry->frame[0] = pEntry->len - 1;
+    pEntry->frame[RELAY_POS_TYPE] = RELAY_TYPE_DATA;
+    pEntry->frame[RELAY_POS_ORIGIN] = relayMyId;
+    pEntry->frame[RELAY_POS_FINAL] = RELAY_MASTER_ID;
+    pEntry->frame[RELAY_POS_HOPS] = 0;
+    pEntry->frame[RELAY_POS_COUNT] = relayOpenCount;
+    pEntry->ageIn = 0;
+    pEntry->arrival = relayOpen.arrival;
+    pEntry->notBefore = relayOpen.arrival;
+
+    relayOpenCount = 0;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         relayPush
+*
+*   @brief      Claims the tail slot of the forward queue
+*
+*   @param      none
+*
+*   @return     the slot with retries cleared, NULL if the queue is full
+*/
+static relayEntry_t *relayPush(void) {
+
+    relayEntry_t *pEntry;
+
+    if(relayCount >= RELAY_QUEUE_SLOTS) {
+        return NULL;
+    }
+    pEntry = &relayQueue[(relayHead + relayCount) % RELAY_QUEUE_SLOTS];
+    pEntry->retries = 0;
+    relayCount++;
+    return pEntry;
+}
+
+
+/*******************************************************************************
+*   @fn         relayPop
+*
+*   @brief      Releases the head slot of the forward queue
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void relayPop(void) {
+
+    relayHead = (relayHead + 1) % RELAY_QUEUE_SLOTS;
+    relayCount--;
+}
+
+
+/*******************************************************************************
+*   @fn         relayFindNeighbor
+*
+*   @brief      Looks up the last sequence number seen from a previous hop
+*
+*   @param      id - station ID
+*
+*   @return     the entry, NULL if the station is not remembered
+*/
+static relayNeighbor_t *relayFindNeighbor(uint8 id) {
+
+    uint8 i;
+
+    for(i = 0; i < RELAY_NEIGHBORS; i++) {
+        if(relayNeighbors[i].id == id) {
+            return &relayNeighbors[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*******************************************************************************
+*   @fn         relayMakeAck
+*
+*   @brief      Builds the ACK for a DATA frame
+*
+*   @param      pData - DATA frame being acknowledged
+*   @param      pAck  - output, RELAY_ACK_LEN bytes
+*
+*   @return     RELAY_ACK_LEN
+*/
+static uint8 relayMakeAck(const uint8 *pData, uint8 *pAck) {
+
+    memset(pAck, 0, RELAY_ACK_LEN);
+    pAck[0] = RELAY_ACK_LEN - 1;
+    pAck[RELAY_POS_TYPE] = RELAY_TYPE_ACK;
+    pAck[RELAY_POS_SRC] = relayMyId;
+    pAck[RELAY_POS_DST] = pData[RELAY_POS_SRC];
+    pAck[RELAY_POS_SEQ] = pData[RELAY_POS_SEQ];
+    pAck[RELAY_POS_ORIGIN] = pData[RELAY_POS_ORIGIN];
+    pAck[RELAY_POS_FINAL] = pData[RELAY_POS_FINAL];
+    pAck[RELAY_POS_CREDIT] = RELAY_QUEUE_SLOTS - relayCount;
+    crc16Append(pAck, RELAY_ACK_LEN - RELAY_CRC_LEN);
+    return RELAY_ACK_LEN;
+}
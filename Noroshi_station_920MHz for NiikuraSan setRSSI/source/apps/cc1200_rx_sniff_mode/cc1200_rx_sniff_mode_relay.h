@@ -0,0 +1,129 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_relay.h
+//! @brief      Store-and-forward relay between stations. A slave station
+//!             packs the tag packets it receives into relay frames of up to
+//!             RELAY_RECORDS_MAX records and sends them one hop toward the
+//!             master (station ID 0), which hands the records to its uplink.
+//!             Each hop is acknowledged; a frame that is not is sent again
+//!             after a growing back-off, at most RELAY_MAX_RETRIES times.
+//!             Frames wait in a bounded forward queue, and a station whose
+//!             queue is full does not acknowledge, so the previous hop keeps
+//!             the frame. The next hop is looked up by destination station
+//!             ID. Decides only, the caller drives the radio. Builds under
+//!             gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_RELAY_H
+#define CC1200_RX_SNIFF_MODE_RELAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_tag.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// RELAY_ENABLE = 1 turns the station into a relay node, uiMyStID 0 is the
+// master, any other ID forwards to uiToStID
+#ifndef RELAY_ENABLE
+#define RELAY_ENABLE            0
+#endif
+#define RELAY_MASTER_ID         0
+#define RELAY_ID_NONE           0xFF    // station IDs are 0..254
+
+// Relay frame layout, byte 0 is the length byte. SRC, DST and SEQ describe
+// the current hop, ORIGIN and FINAL the whole path. The frame ends with a
+// CRC-16 over the bytes before it, see cc1200_rx_sniff_mode_crc.h
+#define RELAY_POS_TYPE          1
+#define RELAY_POS_SRC           2
+#define RELAY_POS_DST           3
+#define RELAY_POS_SEQ           4
+#define RELAY_POS_ORIGIN        5
+#define RELAY_POS_FINAL         6
+#define RELAY_POS_HOPS          7
+#define RELAY_POS_AGE           8       // 2 bytes big endian, 50 ms ticks
+#define RELAY_POS_COUNT         10      // records that follow
+#define RELAY_POS_RECORDS       11      // DATA: tag packets, RSSI in byte 0
+#define RELAY_POS_CREDIT        11      // ACK: free forward queue slots
+#define RELAY_HDR_LEN           11
+#define RELAY_CRC_LEN           CRC16_LEN
+
+#define RELAY_TYPE_DATA         0xA5
+#define RELAY_TYPE_ACK          0x5A
+
+#define RELAY_RECORD_LEN        TAG_PKT_LEN
+#define RELAY_RECORDS_MAX       ((RX_FIFO_SLOT_SIZE - RELAY_HDR_LEN - RELAY_CRC_LEN) / RELAY_RECORD_LEN)
+#define RELAY_FRAME_MAX         (RELAY_HDR_LEN + RELAY_RECORDS_MAX * RELAY_RECORD_LEN + RELAY_CRC_LEN)
+#define RELAY_ACK_LEN           (RELAY_HDR_LEN + 1 + RELAY_CRC_LEN)
+
+#ifndef RELAY_QUEUE_SLOTS
+#define RELAY_QUEUE_SLOTS       4       // frames waiting for the next hop
+#endif
+#ifndef RELAY_MAX_RETRIES
+#define RELAY_MAX_RETRIES       4
+#endif
+#ifndef RELAY_AGG_HOLD
+#define RELAY_AGG_HOLD          20      // 50 ms ticks a frame waits to fill up
+#endif
+#define RELAY_BACKOFF           2       // 50 ms ticks, doubled on each retry
+#define RELAY_ROUTES            4       // entries besides the default route
+#define RELAY_NEIGHBORS         4       // previous hops remembered for duplicates
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 recordsQueued;               // local tag records accepted
+    uint32 recordsRefused;              // refused, forward queue full
+    uint32 framesSent;                  // transmissions, retries included
+    uint32 retries;
+    uint32 framesAcked;                 // hops confirmed by the next station
+    uint32 recordsAcked;                // records carried by those frames
+    uint32 framesDropped;               // gave up after RELAY_MAX_RETRIES
+    uint32 framesReceived;              // DATA frames addressed to us
+    uint32 framesRefused;               // not acknowledged, queue or uplink full
+    uint32 duplicates;                  // repeats after a lost ACK
+    uint32 badFrames;                   // CRC-16 mismatch
+    uint32 framesForwarded;             // queued for the next hop
+    uint32 recordsDelivered;            // master: handed to the uplink
+    uint32 latencySum;                  // master: end to end, 50 ms ticks
+    uint32 latencyCount;                // frames in latencySum
+    uint16 latencyMax;
+} relayStats_t;
+
+// Hands one record to the uplink, returns FALSE if it had no room
+typedef uint8 (*relayDeliver_t)(const uint8 *pRecord, uint8 origin, uint8 hops);
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void relayInit(uint8 myId, uint8 nextHop);
+uint8 relaySetRoute(uint8 dest, uint8 nextHop);
+uint8 relayIsMaster(void);
+uint8 relayIsFrame(const uint8 *pData, uint8 len);
+uint8 relayAddRecord(const uint8 *pRecord, uint16 now);
+void relayTick(uint16 now);
+uint8 relayDue(uint16 now);
+uint8 relayNextTx(uint16 now, uint8 *pFrame);
+void relayAckTimeout(uint16 now);
+uint8 relayReceive(const uint8 *pData, uint8 len, uint16 now, uint8 *pAck,
+                   uint8 room, relayDeliver_t pfnDeliver);
+const relayStats_t *relayGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
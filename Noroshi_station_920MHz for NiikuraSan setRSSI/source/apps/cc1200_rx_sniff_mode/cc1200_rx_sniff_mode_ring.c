@@ -0,0 +1,174 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_ring.c
+//! @brief      SPSC packet ring, see cc1200_rx_sniff_mode_ring.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_ring.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define RX_RING_MASK            (RX_RING_SLOTS - 1)
+
+#if (RX_RING_SLOTS & RX_RING_MASK) || (RX_RING_SLOTS > 128)
+#error "RX_RING_SLOTS must be a power of two, at most 128"
+#endif
+
+// Slot contents must be visible before the index that publishes them. On the
+// MSP430 the volatile slot copy is enough, on a multi-core host add a fence
+#if defined(__linux) && defined(__GNUC__)
+#define RX_RING_BARRIER()       __sync_synchronize()
+#else
+#define RX_RING_BARRIER()
+#endif
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static rxPacket_t rxRing[RX_RING_SLOTS];
+static volatile uint8 rxRingHead;       // written by the producer only
+static volatile uint8 rxRingTail;       // written by the consumer only
+static rxRingStats_t rxRingStats;       // written by the producer only
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void copySlot(volatile uint8 *pDst, const volatile uint8 *pSrc);
+
+
+/*******************************************************************************
+*   @fn         rxRingInit
+*
+*   @brief      Empties the ring and clears the counters. Call before either
+*               side is running
+*
+*   @param      none
+*
+*   @return     none
+*/
+void rxRingInit(void) {
+
+    rxRingHead = 0;
+    rxRingTail = 0;
+    memset(&rxRingStats, 0, sizeof(rxRingStats));
+}
+
+
+/*******************************************************************************
+*   @fn         rxRingPut
+*
+*   @brief      Producer side. Copies a packet into the next free slot. When
+*               the ring is full the packet is dropped and counted, the
+*               producer never waits for the consumer
+*
+*   @param      pPacket - packet to enqueue
+*
+*   @return     TRUE if stored, FALSE if dropped
+*/
+uint8 rxRingPut(const rxPacket_t *pPacket) {
+
+    uint8 head = rxRingHead;
+    uint8 used = (uint8)(head - rxRingTail);
+
+    if(used >= RX_RING_SLOTS) {
+        rxRingStats.dropped++;
+        return FALSE;
+    }
+
+    copySlot((volatile uint8 *)&rxRing[head & RX_RING_MASK], (const volatile uint8 *)pPacket);
+    RX_RING_BARRIER();
+    rxRingHead = head + 1;
+
+    rxRingStats.enqueued++;
+    if(used + 1 > rxRingStats.highWater) {
+        rxRingStats.highWater = used + 1;
+    }
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         rxRingGet
+*
+*   @brief      Consumer side. Copies the oldest packet out and frees its slot
+*
+*   @param      pPacket - destination of the dequeued packet
+*
+*   @return     TRUE if a packet was dequeued, FALSE if the ring is empty
+*/
+uint8 rxRingGet(rxPacket_t *pPacket) {
+
+    uint8 tail = rxRingTail;
+
+    if(tail == rxRingHead) {
+        return FALSE;
+    }
+
+    RX_RING_BARRIER();
+    copySlot((volatile uint8 *)pPacket, (const volatile uint8 *)&rxRing[tail & RX_RING_MASK]);
+    RX_RING_BARRIER();
+    rxRingTail = tail + 1;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         rxRingCount
+*
+*   @brief      Returns the ring occupancy. Exact on the consumer side, a
+*               lower bound of the free space on the producer side
+*
+*   @param      none
+*
+*   @return     number of queued packets
+*/
+uint8 rxRingCount(void) {
+
+    return (uint8)(rxRingHead - rxRingTail);
+}
+
+
+/*******************************************************************************
+*   @fn         rxRingGetStats
+*
+*   @brief      Returns the producer counters. Read them from the producer
+*               context, the 32 bit fields are not updated atomically
+*
+*   @param      none
+*
+*   @return     pointer to the counters
+*/
+const rxRingStats_t *rxRingGetStats(void) {
+
+    return &rxRingStats;
+}
+
+
+/*******************************************************************************
+*   @fn         copySlot
+*
+*   @brief      Copies one rxPacket_t through volatile pointers so the
+*               compiler keeps it ordered with the index update
+*
+*   @param      pDst - destination slot
+*   @param      pSrc - source slot
+*
+*   @return     none
+*/
+static void copySlot(volatile uint8 *pDst, const volatile uint8 *pSrc) {
+
+    uint8 i;
+
+    for(i = 0; i < sizeof(rxPacket_t); i++) {
+        pDst[i] = pSrc[i];
+    }
+}
@@ -0,0 +1,53 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_ring.h
+//! @brief      Single-producer/single-consumer packet ring between the radio
+//!             RX path and the gateway uplink. The producer only writes the
+//!             head index and the consumer only writes the tail index, so no
+//!             interrupt locking is needed. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_RING_H
+#define CC1200_RX_SNIFF_MODE_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define RX_RING_SLOTS           8       // power of two, at most 128
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 enqueued;                    // packets accepted by rxRingPut
+    uint32 dropped;                     // packets refused, ring full
+    uint8  highWater;                   // maximum occupancy seen
+} rxRingStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void rxRingInit(void);
+uint8 rxRingPut(const rxPacket_t *pPacket);
+uint8 rxRingGet(rxPacket_t *pPacket);
+uint8 rxRingCount(void);
+const rxRingStats_t *rxRingGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -17,11 +17,29 @@
 #include "bsp_key.h"
 #include "io_pin_int.h"
 #include "bsp_led.h"
-#include "cc1200_rx_sniff_mode_reg_config.h"
+#include "flash_m25pex0.h"
+#include "spi_bus.h"
+#include "cc1200_rx_sniff_mode_phy.h"
+#include "cc1200_rx_sniff_mode_chan.h"
+#include "cc1200_rx_sniff_mode_scan.h"
 #include <string.h>
 #include "driverlib.h"
 #include "uart.h"
 #include "uart2.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_ring.h"
+#include "cc1200_rx_sniff_mode_frame.h"
+#include "cc1200_rx_sniff_mode_tag.h"
+#include "cc1200_rx_sniff_mode_wor.h"
+#include "cc1200_rx_sniff_mode_relay.h"
+#include "cc1200_rx_sniff_mode_time.h"
+#include "cc1200_rx_sniff_mode_sync.h"
+#include "cc1200_rx_sniff_mode_tdma.h"
+#include "cc1200_rx_sniff_mode_flog.h"
+#include "cc1200_rx_sniff_mode_fio.h"
+#include "cc1200_rx_sniff_mode_query.h"
+#include "cc1200_rx_sniff_mode_disp.h"
+#include "cc1200_rx_sniff_mode_metrics.h"
 
 
 /*******************************************************************************
@@ -36,6 +54,10 @@
 #define GPIO2                   0x08
 #define GPIO0                   0x80
 
+#define MARC_STATE_BM           0x1F
+#define MARC_STATE_IDLE         0x41
+#define MARC_STATE_RX_FIFO_ERR  0x11
+
 #define TXLED                   BIT0
 #define RXLED                   BIT6
 #define TXD                     BIT2
@@ -44,15 +66,89 @@
 #define SAVE_DATA_LIMIT         1
 #define LEN_TAG_DATA            12
 #define LEN_STATION_DATA        30
-#define POS_PARITY              29
 #define LIST_SIZE               3000
 #define INF                     -99999999
 #define UART_DELAY              1000000
 // RSSI : Low=102/Middle=84/High=84
 #define RSSI_OFFSET             84
+#define RSSI_INVALID            0x80    // appended RSSI byte, no valid value
+
+// 1: per packet RSSI from the appended status byte
+// 0: read RSSI1/RSSI0 after the packet (two more SPI transactions)
+#ifndef RSSI_FROM_STATUS
+#define RSSI_FROM_STATUS        1
+#endif
 #define LIST_SIZE_TAG           10
 #define SIZE_GET_BLE            28
 #define SIZE_UART_BUFFER        13
+#define SIZE_UART_TX_BUF        256     // gateway TX ring, ~4 hex frames
+
+// Uplink format to the gateway, override in the project options
+#define UPLINK_FORMAT_HEX       0       // hex ASCII + CRLF
+#define UPLINK_FORMAT_COBS      1       // binary, see cc1200_rx_sniff_mode_frame.h
+#ifndef UPLINK_FORMAT
+#define UPLINK_FORMAT           UPLINK_FORMAT_HEX
+#endif
+
+// Per-tag aggregation window in seconds, 0 forwards every tag packet
+#ifndef TAG_AGG_WINDOW
+#define TAG_AGG_WINDOW          0
+#endif
+
+#if TAG_SUMMARY_LEN > RX_FIFO_STATION_LEN
+#error "Tag summary record does not fit an uplink record"
+#endif
+
+// Scanning builds append the receive channel to every uplink record
+#if SCAN_CHANNEL_COUNT > 1
+#define UPLINK_CHANNEL_LEN      1
+#else
+#define UPLINK_CHANNEL_LEN      0
+#endif
+// Every uplink record ends with the UTC arrival time of its packet
+#define UPLINK_STAMP_LEN        TIME_STAMP_LEN
+#define SIZE_UPLINK_RECORD      (RX_FIFO_STATION_LEN + UPLINK_CHANNEL_LEN + UPLINK_STAMP_LEN)
+
+// With FLOG_ENABLE records go to the flash log while it holds older ones,
+// while UPLINK_SPILL_LEVEL records wait in the uplink ring and while the
+// gateway is gone: UPLINK_LINK_TIMEOUT seconds after its last downlink
+// frame, never with 0 for gateways that send none
+#define UPLINK_SPILL_LEVEL      (RX_RING_SLOTS / 2)
+#ifndef UPLINK_LINK_TIMEOUT
+#define UPLINK_LINK_TIMEOUT     0
+#endif
+
+#if UPLINK_FORMAT == UPLINK_FORMAT_COBS
+#if SIZE_UPLINK_RECORD > FRAME_MAX_PAYLOAD
+#error "Uplink record does not fit a frame"
+#endif
+#define SIZE_UPLINK_FRAME       FRAME_MAX_WIRE
+#else
+#define SIZE_UPLINK_FRAME       (SIZE_UPLINK_RECORD * 2 + 2) // hex + CRLF
+#endif
+#define NOISE_SAMPLE_POLLS      50      // RSSI0 reads before giving up
+
+// Gateway to station commands, framed like the binary uplink
+#define DOWNLINK_CMD_TIME       0x01    // UTC time, TIME_STAMP_LEN bytes follow
+#define DOWNLINK_CMD_SLOTS      0x02    // TDMA slot owners, TDMA_SLOTS bytes follow
+#define DOWNLINK_CMD_QUERY      0x03    // TagID, from, to: 4 bytes each, big endian
+#define DOWNLINK_QUERY_LEN      13
+#define DOWNLINK_CMD_METRICS    0x04    // metrics snapshot, nothing follows
+#define SIZE_DOWNLINK_BUF       64
+
+// Sync word edges latched by Timer A0 CCR2 (P1.3 = TA0.2) per wake-up
+#define RX_STAMP_SLOTS          RX_FIFO_POOL_SIZE
+
+// Relay transmissions (RELAY_ENABLE), timed by Timer A0 CCR1. The wake-up
+// preamble covers the longest sniff interval of the next hop
+#define RADIO_MS_FRAC(ms)       ((uint16)((ms) * (uint32)TIME_FRAC_HZ / 1000))
+#define RELAY_WAKE_MS           (WOR_EVENT0_MAX * 1000UL / 32768 + 3)
+#define RELAY_TX_TIMEOUT_MS     30      // end of packet after the FIFO write
+#define RELAY_ACK_TIMEOUT_MS    20      // ACK from the next hop
+#define RELAY_EXCHANGE_MS       (RELAY_WAKE_MS + RELAY_TX_TIMEOUT_MS + RELAY_ACK_TIMEOUT_MS)
+#if TDMA_ENABLE && (RELAY_EXCHANGE_MS * TIME_FRAC_HZ > TDMA_TX_FRAC * 1000UL)
+#error "TDMA_TX_FRAC is shorter than the longest relay exchange"
+#endif
 #define SIZE_LOG                30
 #define SIZE_LOG_LIST           300
 
@@ -63,250 +159,1829 @@
 #define CODE_PARITY_CHECK       4
 #define CODE_TRANSMIT_DATA      5
 
-// end   add 2015.11.11 nishiyama
+// end   add 2015.11.11 nishiyama
+
+
+/*
+ * revision:
+ * 2015/11/20 01/01 First
+ * 2015/11/25 01/02 Add UART To GW
+ * 2015/12/16 01/03 Add UART From BLE(NORDIC)
+ */
+typedef unsigned char byte;
+typedef unsigned int word;
+
+// RX state machine, advanced by radio events instead of polling
+typedef enum {
+    RX_STATE_ARM,                       // strobe SWOR (RX Sniff Mode)
+    RX_STATE_SLEEP,                     // LPM until end of packet on GPIO2
+    RX_STATE_READ,                      // start RX FIFO drain by DMA
+    RX_STATE_DRAIN,                     // LPM0 until drained, split into packets
+    RX_STATE_QUEUE,                     // hand pool to the uplink ring
+    RX_STATE_RELAY,                     // start a relay frame
+    RX_STATE_BEACON,                    // master: start a time beacon
+    RX_STATE_TX_WAKE,                   // LPM while the wake-up preamble goes out
+    RX_STATE_TX_END,                    // LPM until the frame is sent
+    RX_STATE_ACK                        // LPM in RX until the relay ACK
+} rxState_t;
+
+// What a transmission started by radioSendFrame carries
+typedef enum {
+    RADIO_TX_ACK,                       // relay ACK, nothing follows
+    RADIO_TX_RELAY,                     // relay frame, RX for its ACK follows
+    RADIO_TX_BEACON                     // master's time beacon
+} radioTx_t;
+
+static uint16 major = 1;                // major number
+static uint16 minor = 1;                // minor number
+
+static uint32 uiMyStID = 1;             // My Station ID Default(0x01)
+static uint32 uiToStID = 0;             // To Station ID Master=0 Slave=1->
+static uint8 uiRTtype = 0;              // 0=920, 1=BLE
+static uint8 uiLog = 0xFF;              // ID:Log
+unsigned long long timerCount_1000 = 0; // UNIX Time Stamp (UTC)
+unsigned long long timerCount_50 = 0;   // not use
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static volatile uint8 packetSemaphore;
+static volatile uint8 dmaSemaphore;
+static volatile uint8 radioTimerSemaphore;
+static uint8  packetSemaphoreTX;
+static uint32 packetCounter = 0;
+
+// Display items, refreshed by displayTask. The 50 ms tick wakes the main
+// loop while a change waits for its frame
+static uint8 displayProfile;
+static uint8 displayCount;
+static volatile uint8 displayWake;
+
+// start add 2015.11.11 nishiyama
+static byte save_list[LIST_SIZE] = {0};
+static word save_list_start = 0;
+static word save_list_end = 0;
+//static byte save_list_tag[LIST_SIZE_TAG] = {0};
+static byte ble_list[SIZE_GET_BLE] = {0};
+static word ble_list_start = 0;
+static word ble_list_end = 0;
+
+static byte log_list[SIZE_LOG_LIST] = {0};
+static word log_list_start = 0;
+static word log_list_end = 0;
+
+static uint8 rxFifoBuf[RX_FIFO_SIZE];
+static rxPacket_t rxPool[RX_FIFO_POOL_SIZE];
+static uint8 rxPoolCount;
+static rxPacket_t uplinkPacket;
+static uint8 uplinkSeq;
+static rxPacket_t tagSummaryPacket;
+static uint32 tickTime;
+static uint8 sniffFlags;
+static uint8 phyRequest = PHY_PROFILE_COUNT;   // none pending
+static uint8 chanRequest = CHAN_NONE;
+static uint8 relayRequest;
+static uint8 relayAwaitAck;
+static uint8 relayTxFrame[RELAY_FRAME_MAX];
+static uint8 relayAckFrame[RELAY_ACK_LEN];
+static radioTx_t radioTxKind;
+static uint8 *radioTxFrame;             // written once the wake-up preamble is out
+static uint8 radioTxLen;
+static uint8 radioExchange;             // a transmission or ACK wait is on
+static rxPacket_t relayPacket;
+static uint32 rxOversize;               // longer than an uplink record
+static volatile timeStamp_t rxSyncStamp[RX_STAMP_SLOTS];   // local time
+static volatile uint8 rxSyncCount;      // sync edges since rxStampTake
+static timeStamp_t rxStamps[RX_STAMP_SLOTS];    // oldest first
+static uint8 rxStampCount;
+static uint16 rxSpiStart;               // radio SPI time of a FIFO drain
+static volatile uint16 rxSpiEnd;
+static frameDecoder_t downlinkDecoder;
+static uint32 downlinkTime;             // seconds, last gateway frame
+static uint8 syncRequest;
+static uint8 syncFrame[SYNC_BEACON_MAX];
+static rxPacket_t syncStatusPacket;
+static uint8 tdmaMap[TDMA_MAP_LEN];
+static rxPacket_t tdmaStatusPacket;
+static unsigned char downlinkBuf[SIZE_DOWNLINK_BUF];
+static uint8 txBuf[LEN_STATION_DATA] = {0};
+static uint8 txBytes;
+static uint16 ui16TXCounter = 0;
+unsigned long long uartStartCounter = 0;
+static uint8 tx_counter = 0;
+static uint8 txBuffer[PKTLEN + 2] = {0};
+unsigned char uartRxBuf2[LEN_STATION_DATA] = {0};
+static uint16 transmit_size = 0;
+static uint16 error_log_size = 0;
+// Initialize packet buffer of size PKTLEN + 1
+static uint32 rx_counter = 0;
+
+static byte uartRxBufA0[SIZE_UART_BUFFER] = {0};
+static byte uartRxBufA1[SIZE_UART_BUFFER] = {0};
+static byte uartRxBufA2[SIZE_UART_BUFFER] = {0};
+static uint16 uartRxBufA0_cnt_start = 0;
+static uint16 uartRxBufA0_cnt_end = 0;
+static uint16 uartRxBufA1_cnt_start = 0;
+static uint16 uartRxBufA1_cnt_end = 0;
+static uint16 uartRxBufA2_cnt_start = 0;
+static uint16 uartRxBufA2_cnt_end = 0;
+
+// for Ring Buffer
+typedef char ELEM;        // 
+ELEM ringbuff[LEN_STATION_DATA]; // 
+int front;                // 
+int rear;                 // 
+
+// UART Port Configuration parameters and registers
+UARTConfig cnf;
+static unsigned char uartTxBuf[SIZE_UART_TX_BUF];
+USCIUARTRegs uartUsciRegs;
+USARTUARTRegs uartUsartRegs;
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+// System
+static void initMCU(void);
+static void registerConfig(void);
+
+// 920MHz
+static void calibrateRCOsc(void);
+static void initRX(void);
+static void initTX(void);
+static void runRX(void);
+static uint8 sleepUntil(volatile uint8 *pSemaphore);
+static uint8 uplinkReady(void);
+static void uplinkTask(void);
+static uint8 uplinkPut(const rxPacket_t *pPacket);
+static uint8 uplinkRoom(uint8 len);
+static uint8 uplinkLinkUp(void);
+static uint32 getSeconds(void);
+static uint16 getTicks50(void);
+static uint32 getClockSeconds(uint16 count);
+static void getTime(timeStamp_t *pStamp);
+static uint16 getFioTime(void);
+static void rxStampTake(void);
+static void rxStampLocal(uint8 index, uint8 count, timeStamp_t *pLocal);
+static void rxStampAssign(rxPacket_t *pPacket, uint8 index, uint8 count);
+static void syncApply(void);
+static uint8 syncReady(void);
+static uint8 txSlotOpen(void);
+static void tdmaTask(void);
+static void fioTask(void);
+static void queryTask(void);
+static uint8 downlinkReady(void);
+static void downlinkTask(void);
+static uint8 tickReady(void);
+static void tickTask(void);
+static void metricsTake(uint8 code);
+static void scanTask(void);
+static uint8 relayReady(void);
+static void relayTask(void);
+static uint8 relayDeliver(const uint8 *pRecord, uint8 origin, uint8 hops);
+static rxState_t radioSendFrame(radioTx_t kind, uint8 *pFrame, uint8 len, uint8 wakeMs);
+static void radioWaitPacket(uint8 timeoutMs);
+static uint8 radioSleep(void);
+static void radioExchangeEnd(const timeStamp_t *pStart);
+static void radioTimerStart(uint16 delay);
+static void radioTimerStop(void);
+static void radioIdle(void);
+static uint8 sampleNoise(int8 *pRssi);
+static void sniffApply(uint8 flags);
+static void radioSetProfile(uint8 profile);
+static void radioSetChannel(uint8 channel);
+static uint8 tagSummaryEmit(const tagSummary_t *pSummary);
+static void radioRxDmaDone(rfStatus_t status);
+static void runTX(void);
+static void finTX(void);
+static void radioTxISR(void);
+static int8 getRSSI(void);
+static int8 getPacketRSSI(const rxPacket_t *pPacket, int8 lastRssi);
+static void displayInit(void);
+static void displayTask(void);
+
+// Original Function
+static void createPacket(uint8 randBuffer[]);
+static uint8 MakeTransmitData(uint8 *, uint8);
+static void saveTransmitData(uint8 *);
+static void calcTransmitSize(void);
+static void makeLog(uint8, uint8 *);
+
+// UART
+static void initUART(void);
+static void init_uart(void);
+//static void uart_transmit(void);
+static int uart_transmit(uint8_t *, uint16);
+static void sendUart(uint8_t *, uint16);
+
+// i2c
+static void init_i2c(void);
+static void write_i2c(unsigned char, unsigned char);
+
+// Timer
+static void initTimer(void);
+static void initSyncCapture(void);
+
+
+/*******************************************************************************
+*   @fn         main
+*
+*   @brief      Runs the main routine
+*
+*   @param      none
+*
+*   @return     none
+*/
+void main(void) {
+
+    // Initialize MCU and peripherals
+    initMCU();
+
+    // Write radio registers
+    registerConfig();
+
+    // Enter runRX, never coming back
+    runRX();
+}
+
+
+/*******************************************************************************
+*   @fn         runRX
+*
+*   @brief      Puts radio in RX Sniff Mode and waits for packets. Received
+*               packets are queued in the uplink ring and the radio is
+*               re-armed at once; uplinkTask forwards them to the gateway and
+*               updates the LCD while the radio is sniffing. The MCU sleeps in
+*               LPM between events and is woken by the end-of-packet edge on
+*               GPIO2 or by the UART finishing a frame. Packets are stamped
+*               with the time of their sync word edge, latched by Timer A0.
+*               With RELAY_ENABLE the
+*               station also exchanges relay frames with its neighbours, see
+*               cc1200_rx_sniff_mode_relay.h, and with SYNC_ENABLE the master
+*               sends time beacons that the other stations follow, see
+*               cc1200_rx_sniff_mode_sync.h. With TDMA_ENABLE both go out
+*               only in the station's own slot, see cc1200_rx_sniff_mode_tdma.h.
+*               The MCU sleeps through these exchanges as well, Timer A0 CCR1
+*               ends the wake-up preamble and bounds the waits for the end of
+*               the frame and for the ACK.
+*               Counters and histograms of the receive path and the uplink
+*               go to the gateway as metrics snapshots, see
+*               cc1200_rx_sniff_mode_metrics.h
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void runRX(void) {
+
+    uint8 rxBytes = 0;
+    uint8 marcState;
+    int8 rssi = 0;
+    uint8 i;
+    uint8 txLen;
+    uint8 ackLen;
+    timeStamp_t stamp;
+    timeStamp_t txStart;
+    const uint8 *pExtra;
+    const rxFifoStats_t *pFifoStats;
+    uint32 fifoLost;
+    uint32 fifoCrc;
+    rxState_t rxState = RX_STATE_ARM;
+
+    // Screen, sent from here on by displayTask
+    displayInit();
+    displayTask();
+
+    // Tune and calibrate radio, manual calibration from here on
+    scanInit(0);
+    chanInit();
+    chanSet(scanGetChannel(), 0);
+
+    // Calibrate the RCOSC
+    calibrateRCOsc();
+    
+    // UART config
+    initUART();
+    
+    initTimer();
+
+    // GPIO2 edges are captured by Timer A0, see Timer_A1
+    initSyncCapture();
+
+    timeInit();
+
+    rxFifoInit();
+
+    rxRingInit();
+
+    if(FLOG_ENABLE) {
+        fioInit();
+        flogInit();
+        queryInit((uint8)uiMyStID);
+    }
+
+    tagAggInit(TAG_AGG_WINDOW);
+
+    worCtrlInit();
+
+    relayInit((uint8)uiMyStID, (uint8)uiToStID);
+
+    syncInit((uint8)uiMyStID, getSeconds());
+
+    tdmaInit((uint8)uiMyStID);
+
+    metricsInit((uint8)uiMyStID);
+
+    // Infinite loop
+    while(TRUE) {
+
+        switch(rxState) {
+
+        case RX_STATE_ARM:
+            // A relay frame whose ACK did not come is retried later
+            if(relayAwaitAck) {
+                relayAckTimeout(getTicks50());
+                relayAwaitAck = FALSE;
+            }
+
+            // Set radio in RX Sniff Mode
+            trxSpiCmdStrobe(CC120X_SWOR);
+            rxState = RX_STATE_SLEEP;
+            break;
+
+        case RX_STATE_SLEEP:
+            // Forward queued packets until the end-of-packet interrupt.
+            // Profile switches, sniff retunes, relay transmissions and
+            // beacons only while no packet is waiting to be read. Flash
+            // log commands never wait and are queued at any time
+            tickTask();
+            scanTask();
+            relayTask();
+            downlinkTask();
+            tdmaTask();
+            fioTask();
+            queryTask();
+            displayTask();
+            if((phyRequest < PHY_PROFILE_COUNT) &&
+               (packetSemaphore != ISR_ACTION_REQUIRED)) {
+                radioSetProfile(phyRequest);
+                phyRequest = PHY_PROFILE_COUNT;
+            }
+            if((chanRequest != CHAN_NONE) &&
+               (packetSemaphore != ISR_ACTION_REQUIRED)) {
+                radioSetChannel(chanRequest);
+                chanRequest = CHAN_NONE;
+            }
+            if(sniffFlags && (packetSemaphore != ISR_ACTION_REQUIRED)) {
+                sniffApply(sniffFlags);
+                sniffFlags = 0;
+            }
+            if(FLOG_ENABLE && flogReady(getSeconds())) {
+                flogTask(getSeconds());
+            }
+            if(relayRequest && (packetSemaphore != ISR_ACTION_REQUIRED)) {
+                relayRequest = FALSE;
+                rxState = RX_STATE_RELAY;
+                break;
+            }
+            if(syncReady() && (packetSemaphore != ISR_ACTION_REQUIRED)) {
+                syncRequest = FALSE;
+                rxState = RX_STATE_BEACON;
+                break;
+            }
+            uplinkTask();
+            if(sleepUntil(&packetSemaphore) == ISR_ACTION_REQUIRED) {
+                rxState = RX_STATE_READ;
+            }
+            break;
+
+        case RX_STATE_READ:
+            // Sync word times of the packets about to be read
+            rxStampTake();
+            rxSpiStart = getFioTime();
+
+            // Radio is in IDLE, or in RX_FIFO_ERR if the FIFO overflowed.
+            // Complete packets ahead of the overflow point are still valid
+            cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+            if ((marcState & MARC_STATE_BM) == MARC_STATE_RX_FIFO_ERR) {
+                rxFifoCountOverflow();
+                metricsCount(METRICS_FIFO_OVERFLOWS);
+            }
+
+            // Drain the whole FIFO, it may hold more than one packet
+            cc120xSpiReadReg(CC120X_NUM_RXBYTES, &rxBytes, 1);
+            if (rxBytes > RX_FIFO_SIZE) {
+                rxBytes = RX_FIFO_SIZE;
+            }
+            if (rxBytes > 0) {
+                // FIFO is moved by DMA, radioRxDmaDone signals the end
+                cc120xSpiReadRxFifoDma( rxFifoBuf, rxBytes, &radioRxDmaDone );
+                rxState = RX_STATE_DRAIN;
+            } else {
+                // Aborted reception (e.g. length filter), nothing to report
+                worCtrlCountWakeup(0, 0);
+                trxSpiCmdStrobe(CC120X_SFRX);
+                rxState = RX_STATE_ARM;
+            }
+            break;
+
+        case RX_STATE_DRAIN:
+            while(sleepUntil(&dmaSemaphore) != ISR_ACTION_REQUIRED) {
+                tickTask();
+                scanTask();
+                relayTask();
+                downlinkTask();
+                tdmaTask();
+                fioTask();
+                queryTask();
+                displayTask();
+                if(FLOG_ENABLE && flogReady(getSeconds())) {
+                    flogTask(getSeconds());
+                }
+                uplinkTask();
+            }
+
+#if !RSSI_FROM_STATUS
+            // RSSI setting, channel level after the packet
+            rssi = getRSSI();
+#endif
+
+            // Flush whatever is left, this also leaves RX_FIFO_ERR
+            trxSpiCmdStrobe(CC120X_SFRX);
+
+            // Split into packets, incomplete or oversize ones are counted.
+            // Drops other than CRC failures are packets lost to load
+            pFifoStats = rxFifoGetStats();
+            fifoCrc = pFifoStats->radioCrcErrors + pFifoStats->frameCrcErrors;
+            fifoLost = pFifoStats->droppedPackets - fifoCrc;
+            rxPoolCount = rxFifoParse(rxFifoBuf, rxBytes, rxPool, RX_FIFO_POOL_SIZE);
+            fifoCrc = pFifoStats->radioCrcErrors + pFifoStats->frameCrcErrors
+                    - fifoCrc;
+            fifoLost = pFifoStats->droppedPackets - pFifoStats->radioCrcErrors
+                     - pFifoStats->frameCrcErrors - fifoLost;
+            worCtrlCountWakeup(rxPoolCount, (uint8)fifoLost);
+            scanCountCrcErrors(chanGetCurrent(), (uint8)fifoCrc);
+            metricsAdd(METRICS_RX_PACKETS, rxPoolCount);
+            metricsAdd(METRICS_RX_CRC_ERRORS, fifoCrc);
+            metricsAdd(METRICS_FIFO_LOST, fifoLost);
+            if (rxPoolCount > 0) {
+                metricsHist(METRICS_HIST_SPI, (uint16)(rxSpiEnd - rxSpiStart) / rxPoolCount);
+            }
+            rxState = (rxPoolCount > 0) ? RX_STATE_QUEUE : RX_STATE_ARM;
+            break;
+
+        case RX_STATE_QUEUE:
+            // Ring full: the packet is dropped and counted, RX never waits.
+            // Tag packets are folded into their tag's summary instead, or
+            // collected for the next hop on a relay slave. Relay frames are
+            // answered with an ACK, the sender is listening for it.
+            // Time beacons update the clock fit and the TDMA slot map
+            ackLen = 0;
+            for (i = 0; i < rxPoolCount; i++) {
+#if RSSI_FROM_STATUS
+                rssi = getPacketRSSI(&rxPool[i], rssi);
+#endif
+                rxPool[i].channel = chanGetCurrent();
+                rxStampAssign(&rxPool[i], i, rxPoolCount);
+                scanCountPacket(rxPool[i].channel);
+                if (RELAY_ENABLE && relayIsFrame(rxPool[i].data, rxPool[i].len)) {
+                    // Records delivered from the frame carry its arrival time
+                    relayPacket.stamp = rxPool[i].stamp;
+                    txLen = relayReceive(rxPool[i].data, rxPool[i].len, getTicks50(),
+                                          relayAckFrame, uplinkRoom(RELAY_RECORD_LEN),
+                                          &relayDeliver);
+                    if (txLen > 0) {
+                        ackLen = txLen;
+                    }
+                    continue;
+                }
+                if (SYNC_ENABLE && syncIsBeacon(rxPool[i].data, rxPool[i].len)) {
+                    rxStampLocal(i, rxPoolCount, &stamp);
+                    if (syncReceive(rxPool[i].data, rxPool[i].len, &stamp)) {
+                        syncApply();
+                    }
+                    if (TDMA_ENABLE) {
+                        txLen = syncBeaconExtra(rxPool[i].data, rxPool[i].len, &pExtra);
+                        tdmaApplyMap(pExtra, txLen);
+                    }
+                    continue;
+                }
+                if (rxPool[i].len > RX_FIFO_STATION_LEN) {
+                    rxOversize++;
+                    continue;
+                }
+
+                rxPool[i].data[0] = (uint8)rssi;
+                if (RELAY_ENABLE && !relayIsMaster() && (rxPool[i].len == TAG_PKT_LEN)) {
+                    relayAddRecord(rxPool[i].data, getTicks50());
+                } else if ((TAG_AGG_WINDOW == 0) || (rxPool[i].len != TAG_PKT_LEN) ||
+                           !tagAggUpdate(rxPool[i].data, rssi, getSeconds(), &tagSummaryEmit)) {
+                    // Not folded into a tag summary, the tag table passes
+                    // packets on when it is full
+                    uplinkPut(&rxPool[i]);
+                }
+            }
+
+            // The ACK goes out once the pool is handed on, well within the
+            // sender's ACK timeout. Of two relay frames in one pool only the
+            // later one is answered, the other is sent again
+            if (ackLen > 0) {
+                rxState = radioSendFrame(RADIO_TX_ACK, relayAckFrame, ackLen, 0);
+            } else {
+                rxState = RX_STATE_ARM;
+            }
+            break;
+
+        case RX_STATE_RELAY:
+            // Out of sniff mode: wake the next hop with a long preamble,
+            // then stay in RX for its ACK. An ACK is read like any packet
+            // and the attempt is closed in RX_STATE_ARM. With TDMA the
+            // exchange is the slot's time on air
+            txLen = relayNextTx(getTicks50(), relayTxFrame);
+            if (txLen == 0) {
+                rxState = RX_STATE_SLEEP;
+                break;
+            }
+            getTime(&txStart);
+            relayAwaitAck = TRUE;
+            rxState = radioSendFrame(RADIO_TX_RELAY, relayTxFrame, txLen, RELAY_WAKE_MS);
+            break;
+
+        case RX_STATE_BEACON:
+            // Wake the slaves with a long preamble like a relay frame. The
+            // sync word of the beacon is latched by the capture and its
+            // time goes out with the next beacon. With TDMA it also carries
+            // the slot map
+            txLen = TDMA_ENABLE ? tdmaGetMap(tdmaMap) : 0;
+            txLen = syncBuildBeacon(syncFrame, getSeconds(), tdmaMap, txLen);
+            getTime(&txStart);
+            rxState = radioSendFrame(RADIO_TX_BEACON, syncFrame, txLen, RELAY_WAKE_MS);
+            break;
+
+        case RX_STATE_TX_WAKE:
+            // The radio sends preamble from an empty TX FIFO until CCR1
+            // fires, then the frame is written and goes out behind it
+            radioSleep();
+            cc120xSpiWriteTxFifo(radioTxFrame, radioTxLen);
+            radioTimerStart(RADIO_MS_FRAC(RELAY_TX_TIMEOUT_MS));
+            rxState = RX_STATE_TX_END;
+            break;
+
+        case RX_STATE_TX_END:
+            // GPIO2 marks the end of the frame, the radio is then in IDLE.
+            // A relay frame is followed by RX for the ACK, the sync word
+            // time of a beacon goes out with the next one
+            if (radioSleep() != ISR_ACTION_REQUIRED) {
+                radioIdle();
+                trxSpiCmdStrobe(CC120X_SFTX);
+            } else if (radioTxKind == RADIO_TX_RELAY) {
+                radioWaitPacket(RELAY_ACK_TIMEOUT_MS);
+                rxState = RX_STATE_ACK;
+                break;
+            } else if (radioTxKind == RADIO_TX_BEACON) {
+                rxStampTake();
+                if (rxStampCount > 0) {
+                    timeToUtc(&rxStamps[rxStampCount - 1], &stamp);
+                    syncBeaconSent(&stamp);
+                }
+            }
+            radioExchangeEnd(&txStart);
+            rxState = RX_STATE_ARM;
+            break;
+
+        case RX_STATE_ACK:
+            if (radioSleep() == ISR_ACTION_REQUIRED) {
+                rxState = RX_STATE_READ;
+            } else {
+                radioIdle();
+                trxSpiCmdStrobe(CC120X_SFRX);
+                rxState = RX_STATE_ARM;
+            }
+            radioExchangeEnd(&txStart);
+            break;
+
+        default:
+            rxState = RX_STATE_ARM;
+            break;
+        }
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         sleepUntil
+*
+*   @brief      Sleeps until an ISR sets the given semaphore. The flag is
+*               tested with interrupts disabled and the sleep re-enables them
+*               atomically, so an event between test and sleep is not lost.
+*               LPM3 is used when nothing needs SMCLK, otherwise LPM0 keeps
+*               the gateway UART (USCI_A1) and the radio SPI DMA running.
+*               Returns early when the uplink can send the next packet, a
+*               new second has started, the scan dwell time is up, a relay
+*               frame or beacon can be sent, the radio timer of a relay
+*               exchange has fired, the gateway has sent a command,
+*               the flash log has a page to write, a log query has a page to
+*               read, the flash queue has a command to start or poll or a
+*               display frame is due. Flash and LCD transfers on the shared
+*               SPI bus (USCI_B2 interrupt) need SMCLK as well
+*
+*   @param      pSemaphore - flag set to ISR_ACTION_REQUIRED by an ISR
+*
+*   @return     ISR_ACTION_REQUIRED if the semaphore was taken,
+*               ISR_IDLE if woken for the uplink
+*/
+static uint8 sleepUntil(volatile uint8 *pSemaphore) {
+
+    __disable_interrupt();
+    while(*pSemaphore != ISR_ACTION_REQUIRED) {
+        if(uplinkReady() || tickReady() || scanDue(getTicks50()) || relayReady() ||
+           syncReady() || downlinkReady() ||
+           (radioTimerSemaphore == ISR_ACTION_REQUIRED) ||
+           dispDue(getTicks50()) ||
+           (FLOG_ENABLE && (flogReady(getSeconds()) || queryDue() ||
+                            fioReady(getFioTime())))) {
+            __enable_interrupt();
+            return ISR_IDLE;
+        }
+        if((UCA1IE & UCTXIE) || (UCA1STAT & UCBUSY) || trxSpiDmaBusy() ||
+           spiBusBusy()) {
+            __bis_SR_register(LPM0_bits + GIE);
+        } else {
+            __bis_SR_register(LPM3_bits + GIE);
+        }
+        __disable_interrupt();
+    }
+
+    // Clear semaphore flag
+    *pSemaphore = ISR_IDLE;
+    __enable_interrupt();
+    return ISR_ACTION_REQUIRED;
+}
+
+
+/*******************************************************************************
+*   @fn         uplinkReady
+*
+*   @brief      Checks whether uplinkTask can make progress: a packet is
+*               queued in the ring or can be had from a metrics snapshot, a
+*               log query or the flash log, the
+*               gateway is there and the gateway UART TX ring has room for a
+*               frame
+*
+*   @param      none
+*
+*   @return     TRUE if uplinkTask has work to do
+*/
+static uint8 uplinkReady(void) {
+
+    return ((rxRingCount() > 0) || metricsAvailable() ||
+            (FLOG_ENABLE && (queryAvailable() || flogAvailable()))) &&
+           uplinkLinkUp() &&
+           (uartTxBufFree(&cnf) >= SIZE_UPLINK_FRAME);
+}
+
+
+/*******************************************************************************
+*   @fn         uplinkTask
+*
+*   @brief      Consumer side of the uplink ring. Moves queued packets to
+*               the gateway UART TX ring, with channel and arrival time
+*               appended, while it has room and counts them on the display.
+*               Pages of a metrics snapshot and results of a
+*               log query come next, then the flash log is replayed once the
+*               ring is empty, its records are older than any that arrived
+*               since. With FLOG_HISTORY records sent from the ring are
+*               logged as sent. The time from arrival to the UART of records
+*               from the ring goes to the latency histogram. Never waits,
+*               the UART ISR wakes the main loop when the TX ring has drained
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void uplinkTask(void) {
+
+    uint8 record[SIZE_UPLINK_RECORD];
+    uint8 len;
+    timeStamp_t now;
+
+    while(uplinkReady()) {
+
+        if(rxRingGet(&uplinkPacket)) {
+            if(FLOG_HISTORY) {
+                flogAppend(&uplinkPacket, getSeconds(), TRUE);
+            }
+            getTime(&now);
+            timeToUtc(&now, &now);
+            metricsHistTime(METRICS_HIST_LATENCY, &uplinkPacket.stamp, &now);
+        } else if(!metricsGet(&uplinkPacket) &&
+                  (!FLOG_ENABLE || (!queryGet(&uplinkPacket) && !flogGet(&uplinkPacket)))) {
+            break;
+        }
+
+        memcpy(record, uplinkPacket.data, uplinkPacket.len);
+        len = uplinkPacket.len;
+#if UPLINK_CHANNEL_LEN > 0
+        record[len++] = uplinkPacket.channel;
+#endif
+        len += timeSerialize(&uplinkPacket.stamp, &record[len]);
+        uart_transmit(record, len);
+        metricsCount(METRICS_UPLINK_RECORDS);
+
+        dispSetInt(displayCount, (int32)++packetCounter);
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         uplinkPut
+*
+*   @brief      Producer side of the uplink. With FLOG_ENABLE a record goes
+*               to the flash log instead of the ring while the log holds
+*               older records, the ring is backed up or the gateway is gone.
+*               Drops are counted in the metrics
+*
+*   @param      pPacket - record, len, data, channel and stamp
+*
+*   @return     TRUE if queued, FALSE if dropped
+*/
+static uint8 uplinkPut(const rxPacket_t *pPacket) {
+
+    if(FLOG_ENABLE && (flogPending() || !uplinkLinkUp() ||
+                       (rxRingCount() >= UPLINK_SPILL_LEVEL))) {
+        if(flogAppend(pPacket, getSeconds(), FALSE)) {
+            return TRUE;
+        }
+    }
+    if(rxRingPut(pPacket)) {
+        return TRUE;
+    }
+    metricsCount(METRICS_QUEUE_DROPS);
+    return FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         uplinkRoom
+*
+*   @brief      Counts the records uplinkPut takes at least before it drops
+*               one: the free ring slots and, with FLOG_ENABLE, what the log
+*               buffers hold
+*
+*   @param      len - record bytes
+*
+*   @return     records, at most 255
+*/
+static uint8 uplinkRoom(uint8 len) {
+
+    uint16 room = RX_RING_SLOTS - rxRingCount();
+
+    if(FLOG_ENABLE) {
+        room += flogRoom(len);
+    }
+    return (room > 0xFF) ? 0xFF : (uint8)room;
+}
+
+
+/*******************************************************************************
+*   @fn         uplinkLinkUp
+*
+*   @brief      Checks whether the gateway is there. With UPLINK_LINK_TIMEOUT
+*               it must have sent a downlink frame within that many seconds
+*
+*   @param      none
+*
+*   @return     TRUE if records may be sent to the gateway
+*/
+static uint8 uplinkLinkUp(void) {
+
+    return !FLOG_ENABLE || (UPLINK_LINK_TIMEOUT == 0) ||
+           ((getSeconds() - downlinkTime) < UPLINK_LINK_TIMEOUT);
+}
+
+
+/*******************************************************************************
+*   @fn         getSeconds
+*
+*   @brief      Reads the 1 s tick of Timer A0 without tearing
+*
+*   @param      none
+*
+*   @return     seconds since start-up
+*/
+static uint32 getSeconds(void) {
+
+    uint16 intState;
+    uint32 now;
+
+    intState = __get_interrupt_state();
+    __disable_interrupt();
+    now = (uint32)timerCount_1000;
+    __set_interrupt_state(intState);
+    return now;
+}
+
+
+/*******************************************************************************
+*   @fn         getTicks50
+*
+*   @brief      Reads the 50 ms tick of Timer B0 without tearing
+*
+*   @param      none
+*
+*   @return     ticks since start-up, wrapping
+*/
+static uint16 getTicks50(void) {
+
+    uint16 intState;
+    uint16 now;
+
+    intState = __get_interrupt_state();
+    __disable_interrupt();
+    now = (uint16)timerCount_50;
+    __set_interrupt_state(intState);
+    return now;
+}
+
+
+/*******************************************************************************
+*   @fn         getClockSeconds
+*
+*   @brief      Seconds of the Timer A0 period that holds a count, which may
+*               be the current count or an earlier capture. Called with
+*               interrupts disabled. A wrap whose interrupt is still pending
+*               is counted here, a capture above the current count was taken
+*               before the last wrap
+*
+*   @param      count - TA0R value at the moment of interest
+*
+*   @return     seconds since start-up
+*/
+static uint32 getClockSeconds(uint16 count) {
+
+    uint32 sec;
+    uint16 now;
+
+    sec = (uint32)timerCount_1000;
+    do {
+        now = TA0R;
+    } while(now != TA0R);
+    if((TA0CCTL0 & CCIFG) && (now < TIME_FRAC_HZ / 2)) {
+        sec++;
+    }
+    if(count > now) {
+        sec--;
+    }
+    return sec;
+}
+
+
+/*******************************************************************************
+*   @fn         getTime
+*
+*   @brief      Reads the local clock, seconds and Timer A0 count
+*
+*   @param      pStamp - output, local time
+*
+*   @return     none
+*/
+static void getTime(timeStamp_t *pStamp) {
+
+    uint16 intState;
+    uint16 count;
+
+    intState = __get_interrupt_state();
+    __disable_interrupt();
+    do {
+        count = TA0R;
+    } while(count != TA0R);
+    pStamp->sec = getClockSeconds(count);
+    pStamp->frac = count;
+    __set_interrupt_state(intState);
+}
+
+
+/*******************************************************************************
+*   @fn         getFioTime
+*
+*   @brief      Reads the local clock in 1/32768 s, wrapping every 2 s, the
+*               time base of the flash queue, of the SPI bus counters and
+*               of the radio SPI time. Also called from the USCI_B2 and the
+*               DMA interrupt
+*
+*   @param      none
+*
+*   @return     time
+*/
+static uint16 getFioTime(void) {
+
+    timeStamp_t local;
+
+    getTime(&local);
+    return (uint16)((local.sec << TIME_FRAC_BITS) | local.frac);
+}
+
+
+/*******************************************************************************
+*   @fn         rxStampTake
+*
+*   @brief      Moves the sync word times latched since the last call to
+*               rxStamps, oldest first. Only the last RX_STAMP_SLOTS are kept
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void rxStampTake(void) {
+
+    uint8 first;
+    uint8 i;
+
+    __disable_interrupt();
+    rxStampCount = (rxSyncCount < RX_STAMP_SLOTS) ? rxSyncCount : RX_STAMP_SLOTS;
+    first = (uint8)(rxSyncCount - rxStampCount);
+    for(i = 0; i < rxStampCount; i++) {
+        rxStamps[i] = rxSyncStamp[(uint8)(first + i) % RX_STAMP_SLOTS];
+    }
+    rxSyncCount = 0;
+    __enable_interrupt();
+}
+
+
+/*******************************************************************************
+*   @fn         rxStampLocal
+*
+*   @brief      Local time of the sync word of one packet of a FIFO drain.
+*               Packets and sync edges are matched from the last one
+*               backwards, so a packet dropped by the parser only shifts the
+*               stamps of those before it. Without a latched edge the current
+*               time is used
+*
+*   @param      index  - position of the packet in the pool
+*   @param      count  - packets in the pool
+*   @param      pLocal - output, local time
+*
+*   @return     none
+*/
+static void rxStampLocal(uint8 index, uint8 count, timeStamp_t *pLocal) {
+
+    int16 slot;
+
+    if(rxStampCount == 0) {
+        getTime(pLocal);
+    } else {
+        slot = (int16)rxStampCount - count + index;
+        *pLocal = rxStamps[(slot < 0) ? 0 : slot];
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         rxStampAssign
+*
+*   @brief      Stamps one packet of a FIFO drain with the UTC time of its
+*               sync word
+*
+*   @param      pPacket - packet from rxFifoParse
+*   @param      index   - its position in the pool
+*   @param      count   - packets in the pool
+*
+*   @return     none
+*/
+static void rxStampAssign(rxPacket_t *pPacket, uint8 index, uint8 count) {
+
+    timeStamp_t local;
+
+    rxStampLocal(index, count, &local);
+    timeToUtc(&local, &pPacket->stamp);
+}
+
+
+/*******************************************************************************
+*   @fn         syncApply
+*
+*   @brief      Slave: moves the clock onto the new fit of the master's
+*               beacons and reports the sync error in a status record for
+*               the uplink. A UTC time from this station's own gateway is
+*               replaced by the master's
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void syncApply(void) {
+
+    timeStamp_t refLocal;
+    timeStamp_t refMaster;
+    int32 skew;
+
+    syncGetModel(&refLocal, &refMaster, &skew);
+    timeSetModel(&refLocal, &refMaster, skew);
+
+    syncStatusPacket.len = syncBuildStatus(syncStatusPacket.data);
+    syncStatusPacket.channel = chanGetCurrent();
+    getTime(&syncStatusPacket.stamp);
+    timeToUtc(&syncStatusPacket.stamp, &syncStatusPacket.stamp);
+    uplinkPut(&syncStatusPacket);
+}
+
+
+/*******************************************************************************
+*   @fn         syncReady
+*
+*   @brief      Checks whether the master's beacon is due and may go out now
+*
+*   @param      none
+*
+*   @return     TRUE if RX_STATE_BEACON should run
+*/
+static uint8 syncReady(void) {
+
+    return syncRequest && txSlotOpen();
+}
+
+
+/*******************************************************************************
+*   @fn         txSlotOpen
+*
+*   @brief      Checks whether this station may start a transmission. Not
+*               while an exchange is on the air, with TDMA only in its own
+*               slot and only once its clock follows the master's
+*
+*   @param      none
+*
+*   @return     TRUE if relay frames and beacons may be sent
+*/
+static uint8 txSlotOpen(void) {
+
+    timeStamp_t now;
+
+    if(radioExchange) {
+        return FALSE;
+    }
+    if(!TDMA_ENABLE) {
+        return TRUE;
+    }
+    if(!syncIsSynced()) {
+        return FALSE;
+    }
+    getTime(&now);
+    timeToUtc(&now, &now);
+    return tdmaTxOpen(&now);
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaTask
+*
+*   @brief      Closes TDMA superframes and queues their status record for
+*               the uplink, starts the wait of queued relay traffic and sets
+*               Timer A0 CCR3 to wake the main loop when the own slot opens.
+*               CCR3 fires once per Timer A0 period at that count, each pass
+*               here moves it on
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void tdmaTask(void) {
+
+    timeStamp_t local;
+    timeStamp_t now;
+    timeStamp_t start;
+
+    if(!TDMA_ENABLE) {
+        return;
+    }
+
+    getTime(&local);
+    timeToUtc(&local, &now);
+    if(tdmaTick(&now)) {
+        tdmaStatusPacket.len = tdmaBuildStatus(tdmaStatusPacket.data);
+        tdmaStatusPacket.channel = chanGetCurrent();
+        tdmaStatusPacket.stamp = now;
+        uplinkPut(&tdmaStatusPacket);
+    }
+    if(relayDue(getTicks50())) {
+        tdmaWait(&now);
+    }
+
+    if(syncIsSynced() && tdmaNextOpen(&now, &start)) {
+        timeFromUtc(&start, &local);
+        TA0CCR3 = local.frac;
+        TA0CCTL3 = CCIE;
+    } else {
+        TA0CCTL3 = 0;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         fioTask
+*
+*   @brief      Moves the flash queue on and sets Timer A0 CCR4 to wake the
+*               main loop for the next status poll of a program or erase.
+*               The end of a transfer wakes it from the USCI_B2 interrupt
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void fioTask(void) {
+
+    uint16 now;
+    uint16 delay;
+
+    if(!FLOG_ENABLE) {
+        return;
+    }
+
+    now = getFioTime();
+    delay = fioPoll(now);
+    if(delay > 0) {
+        TA0CCR4 = (now + delay) & TIME_FRAC_BM;
+        TA0CCTL4 = CCIE;
+    } else {
+        TA0CCTL4 = 0;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         queryTask
+*
+*   @brief      Moves a query of the flash log on, its reads complete in
+*               fioTask
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void queryTask(void) {
+
+    timeStamp_t local;
+    timeStamp_t now;
+
+    if(!FLOG_ENABLE || !queryDue()) {
+        return;
+    }
+
+    getTime(&local);
+    timeToUtc(&local, &now);
+    queryPoll(&now);
+}
+
+
+/*******************************************************************************
+*   @fn         downlinkReady
+*
+*   @brief      Checks whether the gateway has sent bytes
+*
+*   @param      none
+*
+*   @return     TRUE if downlinkTask has work to do
+*/
+static uint8 downlinkReady(void) {
+
+    return cnf.rxBytesReceived > 0;
+}
+
+
+/*******************************************************************************
+*   @fn         downlinkTask
+*
+*   @brief      Decodes gateway commands. DOWNLINK_CMD_TIME carries the UTC
+*               time at the end of its frame and sets the epoch; the frame is
+*               taken as arriving when this task picks it up.
+*               DOWNLINK_CMD_SLOTS sets the TDMA slot map, on the master it
+*               goes out with the next beacon. DOWNLINK_CMD_QUERY starts a
+*               query of the flash log, see cc1200_rx_sniff_mode_query.h.
+*               DOWNLINK_CMD_METRICS sends a metrics snapshot. Bytes read
+*               and frames that fail to decode are counted in the metrics
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void downlinkTask(void) {
+
+    uint8 bytes[SIZE_DOWNLINK_BUF];
+    frame_t frame;
+    timeStamp_t local;
+    timeStamp_t utc;
+    uint32 errors = downlinkDecoder.errors;
+    int n;
+    int i;
+
+    if(!downlinkReady()) {
+        return;
+    }
+
+    __disable_interrupt();
+    getTime(&local);
+    n = readRxBytes(&cnf, bytes, sizeof(bytes), 0);
+    __enable_interrupt();
+    metricsAdd(METRICS_UART_RX_BYTES, (uint32)n);
+
+    for(i = 0; i < n; i++) {
+        if(!frameDecodeByte(&downlinkDecoder, bytes[i], &frame)) {
+            continue;
+        }
+        downlinkTime = local.sec;
+        if((frame.len == 1 + TIME_STAMP_LEN) && (frame.data[0] == DOWNLINK_CMD_TIME)) {
+            timeParse(&frame.data[1], &utc);
+            timeSetEpoch(&utc, &local);
+        } else if(TDMA_ENABLE && (frame.len > 0) && (frame.data[0] == DOWNLINK_CMD_SLOTS)) {
+            tdmaSetMap(&frame.data[1], frame.len - 1);
+        } else if(FLOG_ENABLE && (frame.len == DOWNLINK_QUERY_LEN) &&
+                  (frame.data[0] == DOWNLINK_CMD_QUERY)) {
+            timeToUtc(&local, &utc);
+            queryStart(flogGet32(&frame.data[1]), flogGet32(&frame.data[5]),
+                       flogGet32(&frame.data[9]), &utc);
+        } else if((frame.len == 1) && (frame.data[0] == DOWNLINK_CMD_METRICS)) {
+            metricsTake(0);
+        }
+    }
+    metricsAdd(METRICS_DOWNLINK_ERRORS, downlinkDecoder.errors - errors);
+}
+
+
+/*******************************************************************************
+*   @fn         tickReady
+*
+*   @brief      Checks whether a new second has started since the last tick
+*
+*   @param      none
+*
+*   @return     TRUE if tickTask has work to do
+*/
+static uint8 tickReady(void) {
+
+    return getSeconds() != tickTime;
+}
+
+
+/*******************************************************************************
+*   @fn         tickTask
+*
+*   @brief      Once per second: emits the summaries of tags whose window
+*               closed, runs the sniff controller, checks the age of the
+*               synthesizer calibration, schedules the master's time beacon,
+*               takes the metrics snapshot of the heartbeat report
+*               and polls the SELECT key, which steps
+*               to the next PHY profile. Summaries that do not fit the uplink
+*               ring stay in the table and are retried on the next tick.
+*               Radio requests are collected in sniffFlags, chanRequest and
+*               phyRequest and applied from RX_STATE_SLEEP, the radio SPI may
+*               be busy with DMA here
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void tickTask(void) {
+
+    if(!tickReady()) {
+        return;
+    }
+
+    tickTime = getSeconds();
+#if TAG_AGG_WINDOW > 0
+    tagAggExpire(tickTime, &tagSummaryEmit);
+#endif
+    sniffFlags |= worCtrlTick();
+
+    if(chanCalDue((uint16)tickTime)) {
+        chanRequest = chanGetCurrent();
+    }
+
+    if(SYNC_ENABLE && syncBeaconDue(tickTime)) {
+        syncRequest = TRUE;
+    }
+
+    if(metricsReportDue(tickTime)) {
+        metricsTake(CODE_HEARTBEAT);
+    }
+
+    if(bspKeyPushed(BSP_KEY_ALL) == BSP_KEY_SELECT) {
+        phyRequest = (phyGetProfile() + 1) % PHY_PROFILE_COUNT;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         metricsTake
+*
+*   @brief      Takes a metrics snapshot for the uplink. The statistics
+*               kept by the modules are copied into the metrics first
+*
+*   @param      code - CODE_HEARTBEAT, or 0 when the gateway asked for it
+*
+*   @return     none
+*/
+static void metricsTake(uint8 code) {
+
+    const tagAggStats_t *pTag = tagAggGetStats();
+    const fioStats_t *pFio = fioGetStats();
+    const dispStats_t *pDisp = dispGetStats();
+    const worStats_t *pWor = worCtrlGetStats();
+    const chanStats_t *pChan = chanGetStats();
+    const relayStats_t *pRelay = relayGetStats();
+    const scanStats_t *pScan;
+    timeStamp_t now;
+    uint8 i;
+
+    metricsSet(METRICS_BUS_FLASH_TIME, spiBusGetStats(SPI_BUS_CLIENT_FLASH)->ui32BusyTime);
+    metricsSet(METRICS_BUS_LCD_TIME, spiBusGetStats(SPI_BUS_CLIENT_LCD)->ui32BusyTime);
+    metricsSet(METRICS_RING_HIGH_WATER, rxRingGetStats()->highWater);
+    metricsSet(METRICS_TAG_SUMMARIES, pTag->summaries);
+    metricsSet(METRICS_TAG_PASSED, pTag->passed);
+    metricsSet(METRICS_TAG_REFUSED, pTag->emitRefused);
+    metricsSet(METRICS_TAG_HIGH_WATER, pTag->usedHighWater);
+    metricsSet(METRICS_FIO_READS, pFio->reads);
+    metricsSet(METRICS_FIO_PROGRAMS, pFio->programs);
+    metricsSet(METRICS_FIO_ERASES, pFio->erases);
+    metricsSet(METRICS_FIO_ERRORS, pFio->timeouts + pFio->failed);
+    metricsSet(METRICS_FIO_REFUSED, pFio->refused);
+    metricsSet(METRICS_DISP_FRAMES, pDisp->frames);
+    metricsSet(METRICS_DISP_BYTES, pDisp->bytesSent);
+    metricsSet(METRICS_WOR_WAKEUPS, pWor->wakeups);
+    metricsSet(METRICS_WOR_FALSE, pWor->falseWakeups);
+    metricsSet(METRICS_WOR_MISSES, pWor->misses);
+    metricsSet(METRICS_WOR_RETUNES, pWor->retunes);
+    metricsSet(METRICS_WOR_SETTINGS, ((uint32)pWor->event0 << 16) | pWor->pqt);
+    metricsSet(METRICS_WOR_DUTY, pWor->dutyPermille);
+    metricsSet(METRICS_CHAN_CACHED, pChan->cached);
+    metricsSet(METRICS_CHAN_CALIBRATED, pChan->calibrated);
+    metricsSet(METRICS_CHAN_EXPIRED, pChan->expired);
+    if(CHAN_MEASURE) {
+        metricsSet(METRICS_CHAN_CACHED_US, ((uint32)pChan->lastCachedUs << 16) | pChan->maxCachedUs);
+        metricsSet(METRICS_CHAN_CAL_US, ((uint32)pChan->lastCalibratedUs << 16) | pChan->maxCalibratedUs);
+    }
+    metricsSet(METRICS_RELAY_QUEUED, pRelay->recordsQueued);
+    metricsSet(METRICS_RELAY_REFUSED, pRelay->recordsRefused);
+    metricsSet(METRICS_RELAY_SENT, pRelay->framesSent);
+    metricsSet(METRICS_RELAY_RETRIES, pRelay->retries);
+    metricsSet(METRICS_RELAY_ACKED, pRelay->framesAcked);
+    metricsSet(METRICS_RELAY_DROPPED, pRelay->framesDropped);
+    metricsSet(METRICS_RELAY_RECEIVED, pRelay->framesReceived);
+    metricsSet(METRICS_RELAY_FORWARDED, pRelay->framesForwarded);
+    metricsSet(METRICS_RELAY_DELIVERED, pRelay->recordsDelivered);
+    metricsSet(METRICS_RELAY_LAT_SUM, pRelay->latencySum);
+    metricsSet(METRICS_RELAY_LAT_COUNT, pRelay->latencyCount);
+    metricsSet(METRICS_RELAY_LAT_MAX, pRelay->latencyMax);
+    for(i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+        pScan = scanGetStats(i);
+        metricsSet(METRICS_SCAN_VISITS(i), pScan->visits);
+        metricsSet(METRICS_SCAN_PACKETS(i), pScan->packets);
+        metricsSet(METRICS_SCAN_CRC(i), pScan->crcErrors);
+        metricsSet(METRICS_SCAN_NOISE(i), ((uint32)pScan->channel << 8) | (uint8)pScan->noiseFloor);
+    }
+    getTime(&now);
+    timeToUtc(&now, &now);
+    metricsSnapshot(code, &now);
+}
+
+
+/*******************************************************************************
+*   @fn         scanTask
+*
+*   @brief      Moves to the next channel of the scan list once the current
+*               channel's dwell time is up. The switch is applied from
+*               RX_STATE_SLEEP through chanRequest
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void scanTask(void) {
+
+    uint16 now = getTicks50();
+
+    if(scanDue(now)) {
+        chanRequest = scanNext(now);
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         relayReady
+*
+*   @brief      Checks whether relayTask has work to do that it has not
+*               already handed to RX_STATE_SLEEP
+*
+*   @param      none
+*
+*   @return     TRUE if relayTask should run
+*/
+static uint8 relayReady(void) {
+
+    return !relayRequest && relayDue(getTicks50()) && txSlotOpen();
+}
+
+
+/*******************************************************************************
+*   @fn         relayTask
+*
+*   @brief      Queues the relay frame being collected once its hold time is
+*               over and requests a transmission when the head of the forward
+*               queue is due and the station may transmit. The frame is sent
+*               from RX_STATE_SLEEP
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void relayTask(void) {
+
+    uint16 now = getTicks50();
+
+    relayTick(now);
+    if(relayDue(now) && txSlotOpen()) {
+        relayRequest = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         relayDeliver
+*
+*   @brief      Master: queues a tag record that arrived over the relay like
+*               a tag packet received here, folded into its tag's summary or
+*               raw when the tag table passes it on
+*
+*   @param      pRecord - tag packet, RSSI at the origin in byte 0
+*   @param      origin  - station that received it
+*   @param      hops    - relay hops it travelled
+*
+*   @return     TRUE if queued, FALSE if the uplink ring is full
+*/
+static uint8 relayDeliver(const uint8 *pRecord, uint8 origin, uint8 hops) {
+
+    if((TAG_AGG_WINDOW > 0) && tagAggUpdate(pRecord, (int8)pRecord[0], getSeconds(), &tagSummaryEmit)) {
+        return TRUE;
+    }
+
+    // relayPacket.stamp is the frame's arrival, set in RX_STATE_QUEUE
+    relayPacket.len = RELAY_RECORD_LEN;
+    memcpy(relayPacket.data, pRecord, RELAY_RECORD_LEN);
+    relayPacket.channel = CHAN_NONE;
+    return uplinkPut(&relayPacket);
+}
+
+
+/*******************************************************************************
+*   @fn         radioSendFrame
+*
+*   @brief      Leaves sniff mode and starts sending one packet. With wakeMs
+*               the radio enters TX with an empty FIFO and sends preamble
+*               until RX_STATE_TX_WAKE writes the frame, so a sniffing
+*               receiver is woken. RX_STATE_TX_END then waits for GPIO2 to
+*               mark the end of the packet; the radio is then in IDLE. No
+*               relay frame or beacon is started until radioExchangeEnd
+*
+*   @param      kind   - RADIO_TX_ACK, RADIO_TX_RELAY or RADIO_TX_BEACON
+*   @param      pFrame - packet, length byte first, kept until it is sent
+*   @param      len    - bytes in pFrame
+*   @param      wakeMs - preamble time before the frame, 0 for none
+*
+*   @return     state that continues the transmission
+*/
+static rxState_t radioSendFrame(radioTx_t kind, uint8 *pFrame, uint8 len, uint8 wakeMs) {
+
+    radioIdle();
+    trxSpiCmdStrobe(CC120X_SFTX);
+
+    __disable_interrupt();
+    TA0CCTL2 &= ~(CCIFG + COV);
+    packetSemaphore = ISR_IDLE;
+    rxSyncCount = 0;
+    __enable_interrupt();
+
+    radioTxKind = kind;
+    radioExchange = TRUE;
+    if(wakeMs > 0) {
+        radioTxFrame = pFrame;
+        radioTxLen = len;
+        trxSpiCmdStrobe(CC120X_STX);
+        radioTimerStart(RADIO_MS_FRAC(wakeMs));
+        return RX_STATE_TX_WAKE;
+    }
+
+    cc120xSpiWriteTxFifo(pFrame, len);
+    trxSpiCmdStrobe(CC120X_STX);
+    radioTimerStart(RADIO_MS_FRAC(RELAY_TX_TIMEOUT_MS));
+    return RX_STATE_TX_END;
+}
+
+
+/*******************************************************************************
+*   @fn         radioWaitPacket
+*
+*   @brief      Starts listening in RX, without sniffing, for a packet.
+*               RX_STATE_ACK waits for its end-of-packet edge until
+*               timeoutMs is over
+*
+*   @param      timeoutMs - listen time
+*
+*   @return     none
+*/
+static void radioWaitPacket(uint8 timeoutMs) {
+
+    trxSpiCmdStrobe(CC120X_SRX);
+    radioTimerStart(RADIO_MS_FRAC(timeoutMs));
+}
+
+
+/*******************************************************************************
+*   @fn         radioSleep
+*
+*   @brief      Sleeps through a step of a relay exchange, serving the other
+*               tasks like RX_STATE_DRAIN, until the end-of-packet edge or
+*               until the radio timer fires
+*
+*   @param      none
+*
+*   @return     ISR_ACTION_REQUIRED if the packet edge came, the timer is
+*               stopped then, ISR_IDLE if the timer fired
+*/
+static uint8 radioSleep(void) {
+
+    while(sleepUntil(&packetSemaphore) != ISR_ACTION_REQUIRED) {
+        if(radioTimerSemaphore == ISR_ACTION_REQUIRED) {
+            radioTimerSemaphore = ISR_IDLE;
+            return ISR_IDLE;
+        }
+        tickTask();
+        scanTask();
+        relayTask();
+        downlinkTask();
+        tdmaTask();
+        fioTask();
+        queryTask();
+        displayTask();
+        if(FLOG_ENABLE && flogReady(getSeconds())) {
+            flogTask(getSeconds());
+        }
+        uplinkTask();
+    }
+    radioTimerStop();
+    return ISR_ACTION_REQUIRED;
+}
 
 
-/*
- * revision:
- * 2015/11/20 01/01 First
- * 2015/11/25 01/02 Add UART To GW
- * 2015/12/16 01/03 Add UART From BLE(NORDIC)
- */
-typedef unsigned char byte;
-typedef unsigned int word;
+/*******************************************************************************
+*   @fn         radioExchangeEnd
+*
+*   @brief      Closes a transmission and, for relay frames and beacons,
+*               adds its time on air to the TDMA superframe
+*
+*   @param      pStart - local time the exchange started
+*
+*   @return     none
+*/
+static void radioExchangeEnd(const timeStamp_t *pStart) {
+
+    timeStamp_t start;
+    timeStamp_t end;
+
+    radioTimerStop();
+    radioExchange = FALSE;
+    if(TDMA_ENABLE && (radioTxKind != RADIO_TX_ACK)) {
+        getTime(&end);
+        timeToUtc(pStart, &start);
+        timeToUtc(&end, &end);
+        tdmaTxDone(&start, &end, radioTxKind == RADIO_TX_RELAY);
+    }
+}
 
-static uint16 major = 1;                // major number
-static uint16 minor = 1;                // minor number
 
-static uint32 uiMyStID = 1;             // My Station ID Default(0x01)
-static uint32 uiToStID = 0;             // To Station ID Master=0 Slave=1->
-static uint8 uiRTtype = 0;              // 0=920, 1=BLE
-static uint8 uiLog = 0xFF;              // ID:Log
-unsigned long long timerCount_1000 = 0; // UNIX Time Stamp (UTC)
-unsigned long long timerCount_50 = 0;   // not use
+/*******************************************************************************
+*   @fn         radioTimerStart
+*
+*   @brief      Sets Timer A0 CCR1 to fire after delay. Timer A0 counts ACLK
+*               up to CCR0, once per second
+*
+*   @param      delay - 1/32768 s, below one second
+*
+*   @return     none
+*/
+static void radioTimerStart(uint16 delay) {
+
+    __disable_interrupt();
+    radioTimerSemaphore = ISR_IDLE;
+    TA0CCR1 = (getFioTime() + delay) & TIME_FRAC_BM;
+    TA0CCTL1 = CCIE;
+    __enable_interrupt();
+}
 
 
 /*******************************************************************************
-* LOCAL VARIABLES
+*   @fn         radioTimerStop
+*
+*   @brief      Stops Timer A0 CCR1 and drops a pending expiry
+*
+*   @param      none
+*
+*   @return     none
 */
-static uint8  packetSemaphore;
-static uint8  packetSemaphoreTX;
-static uint32 packetCounter = 0;
+static void radioTimerStop(void) {
 
-// start add 2015.11.11 nishiyama
-static byte save_list[LIST_SIZE] = {0};
-static word save_list_start = 0;
-static word save_list_end = 0;
-//static byte save_list_tag[LIST_SIZE_TAG] = {0};
-static byte ble_list[SIZE_GET_BLE] = {0};
-static word ble_list_start = 0;
-static word ble_list_end = 0;
+    __disable_interrupt();
+    TA0CCTL1 = 0;
+    radioTimerSemaphore = ISR_IDLE;
+    __enable_interrupt();
+}
 
-static byte log_list[SIZE_LOG_LIST] = {0};
-static word log_list_start = 0;
-static word log_list_end = 0;
 
-static uint8 rxBuffer[LEN_STATION_DATA] = {0};
-static uint8 rxBytes;
-static uint8 txBuf[LEN_STATION_DATA] = {0};
-static uint8 txBytes;
-static uint16 ui16TXCounter = 0;
-unsigned long long uartStartCounter = 0;
-static uint8 tx_counter = 0;
-static uint8 txBuffer[PKTLEN + 2] = {0};
-unsigned char uartRxBuf2[LEN_STATION_DATA] = {0};
-static uint16 transmit_size = 0;
-static uint16 error_log_size = 0;
-// Initialize packet buffer of size PKTLEN + 1
-static uint32 rx_counter = 0;
+/*******************************************************************************
+*   @fn         radioIdle
+*
+*   @brief      Strobes IDLE and waits until the radio is there
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void radioIdle(void) {
 
-static byte uartRxBufA0[SIZE_UART_BUFFER] = {0};
-static byte uartRxBufA1[SIZE_UART_BUFFER] = {0};
-static byte uartRxBufA2[SIZE_UART_BUFFER] = {0};
-static uint16 uartRxBufA0_cnt_start = 0;
-static uint16 uartRxBufA0_cnt_end = 0;
-static uint16 uartRxBufA1_cnt_start = 0;
-static uint16 uartRxBufA1_cnt_end = 0;
-static uint16 uartRxBufA2_cnt_start = 0;
-static uint16 uartRxBufA2_cnt_end = 0;
+    uint8 marcState;
 
-// for Ring Buffer
-typedef char ELEM;        // 
-ELEM ringbuff[LEN_STATION_DATA]; // 
-int front;                // 
-int rear;                 // 
+    trxSpiCmdStrobe(CC120X_SIDLE);
+    do {
+        cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+    } while (marcState != MARC_STATE_IDLE);
+}
 
-// UART Port Configuration parameters and registers
-UARTConfig cnf;
-USCIUARTRegs uartUsciRegs;
-USARTUARTRegs uartUsartRegs;
 
 /*******************************************************************************
-* STATIC FUNCTIONS
+*   @fn         sniffApply
+*
+*   @brief      Writes the sniff controller's setting to the radio and/or
+*               calibrates the RCOSC. The radio is taken out of sniff mode
+*               for a few hundred microseconds; a packet arriving just then
+*               is lost and its end-of-packet edge discarded
+*
+*   @param      flags - WOR_CTRL_APPLY, WOR_CTRL_CALIBRATE
+*
+*   @return     none
 */
-// System
-static void initMCU(void);
-static void registerConfig(void);
+static void sniffApply(uint8 flags) {
 
-// 920MHz
-static void radioRxISR(void);
-static void calibrateRCOsc(void);
-static void initRX(void);
-static void initTX(void);
-static void runRX(void);
-static void runTX(void);
-static void finTX(void);
-static void radioTxISR(void);
-static int8 getRSSI(void);
-static void updateLcd(void);
+    const worStats_t *pWor = worCtrlGetStats();
+    uint8 marcState;
+    uint8 temp;
 
-// Original Function
-static void createPacket(uint8 randBuffer[]);
-static uint8 judgeParity(uint8 *, uint8);
-static uint8 MakeParity(uint8 *);
-static uint8 MakeTransmitData(uint8 *, uint8);
-static void MakeSlaveDataFromTag(uint8 *);
-static void MakeSlaveDataFromSlave(uint8 *);
-static void MakeMasterDataFromSlave(uint8 *);
-static void saveTransmitData(uint8 *);
-static uint8 judgeToID(uint8 *, uint8);
-static uint8 chkRXdataAndMakeTXdata(uint8 *, uint8);
-static void calcTransmitSize(void);
-static void makeLog(uint8, uint8 *);
+    trxSpiCmdStrobe(CC120X_SIDLE);
+    do {
+        cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+    } while (marcState != MARC_STATE_IDLE);
+    trxSpiCmdStrobe(CC120X_SFRX);
+
+    if(flags & WOR_CTRL_APPLY) {
+        temp = HI_UINT16(pWor->event0);
+        cc120xSpiWriteReg(CC120X_WOR_EVENT0_MSB, &temp, 1);
+        temp = LO_UINT16(pWor->event0);
+        cc120xSpiWriteReg(CC120X_WOR_EVENT0_LSB, &temp, 1);
+
+        cc120xSpiReadReg(CC120X_PREAMBLE_CFG0, &temp, 1);
+        temp = (temp & 0xF0) | (pWor->pqt & 0x0F);
+        cc120xSpiWriteReg(CC120X_PREAMBLE_CFG0, &temp, 1);
+    }
 
-// UART
-static void initUART(void);
-static void init_uart(void);
-//static void uart_transmit(void);
-static void uart_transmit(uint8_t *, uint16);
-static void sendUart(uint8_t *, uint16);
+    if(flags & WOR_CTRL_CALIBRATE) {
+        calibrateRCOsc();
+    }
 
-// i2c
-static void init_i2c(void);
-static void write_i2c(unsigned char, unsigned char);
+    __disable_interrupt();
+    TA0CCTL2 &= ~(CCIFG + COV);
+    packetSemaphore = ISR_IDLE;
+    rxSyncCount = 0;
+    __enable_interrupt();
 
-// Timer
-static void initTimer(void);
+    trxSpiCmdStrobe(CC120X_SWOR);
+}
 
 
 /*******************************************************************************
-*   @fn         main
+*   @fn         radioSetProfile
 *
-*   @brief      Runs the main routine
+*   @brief      Switches the PHY profile: reset and burst write, the channel
+*               is tuned again with an empty calibration cache, the RCOSC is
+*               calibrated, then the sniff controller setting is restored and
+*               sniff mode re-armed
 *
-*   @param      none
+*   @param      profile - PHY_PROFILE_xxx
 *
 *   @return     none
 */
-void main(void) {
+static void radioSetProfile(uint8 profile) {
 
-    // Initialize MCU and peripherals
-    initMCU();
+    uint8 channel = chanGetCurrent();
 
-    // Write radio registers
-    registerConfig();
+    if(!phyWriteProfile(profile)) {
+        return;
+    }
 
-    // Enter runRX, never coming back
-    runRX();
+    chanInit();
+    chanSet(channel, (uint16)getSeconds());
+
+    // SRES also reset WOR_EVENT0 and PQT
+    sniffApply(WOR_CTRL_APPLY | WOR_CTRL_CALIBRATE);
+    dispSetText(displayProfile, phyGetName(phyGetProfile()));
 }
 
 
 /*******************************************************************************
-*   @fn         runRX
+*   @fn         radioSetChannel
 *
-*   @brief      Puts radio in RX Sniff Mode and waits for packets. A packet
-*               counter is incremented for each packet received and the LCD is
-*               updated
+*   @brief      Leaves sniff mode, tunes to a channel from the calibration
+*               cache (or calibrates it when the entry is missing or too old)
+*               and re-arms sniff mode. When scanning, the channel's noise
+*               floor is sampled on the way
 *
-*   @param      none
+*   @param      channel - CHAN_FIRST..CHAN_LAST
 *
 *   @return     none
 */
-static void runRX(void) {
+static void radioSetChannel(uint8 channel) {
 
-//    uint8 rxBuffer[32] = {0};
-    uint8 rxBytes;
-    uint8 rxBytes2;
     uint8 marcState;
-    unsigned long long tc_backup = 0;
-    
-    int cnt = 0;
+#if SCAN_CHANNEL_COUNT > 1
+    int8 rssi;
+#endif
 
-    // Connect ISR function to GPIO2
-    ioPinIntRegister(IO_PIN_PORT_1, GPIO2, &radioRxISR);
+    trxSpiCmdStrobe(CC120X_SIDLE);
+    do {
+        cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+    } while (marcState != MARC_STATE_IDLE);
 
-    // Interrupt on falling edge
-    ioPinIntTypeSet(IO_PIN_PORT_1, GPIO2, IO_PIN_RISING_EDGE);
+    chanSet(channel, (uint16)getSeconds());
+#if SCAN_CHANNEL_COUNT > 1
+    if(sampleNoise(&rssi)) {
+        scanCountNoise(channel, rssi);
+    }
+#endif
+    sniffApply(0);
+}
 
-    // Clear ISR flag
-    ioPinIntClear(IO_PIN_PORT_1, GPIO2);
 
-    // Enable interrupt
-    ioPinIntEnable(IO_PIN_PORT_1, GPIO2);
+/*******************************************************************************
+*   @fn         sampleNoise
+*
+*   @brief      Measures the channel level with no packet expected: RX until
+*               RSSI is valid, then back to IDLE
+*
+*   @param      pRssi - RSSI in dBm
+*
+*   @return     TRUE if *pRssi was set, FALSE if RSSI did not become valid
+*/
+static uint8 sampleNoise(int8 *pRssi) {
 
-    // Update LCD
-    updateLcd();
+    uint8 rssi0 = 0;
+    uint8 rssi1;
+    uint8 marcState;
+    uint8 n;
 
-    // Calibrate radio
-    trxSpiCmdStrobe(CC120X_SCAL);
+    trxSpiCmdStrobe(CC120X_SRX);
+    for(n = 0; (n < NOISE_SAMPLE_POLLS) && !(rssi0 & 0x01); n++) {
+        cc120xSpiReadReg(CC120X_RSSI0, &rssi0, 1);
+    }
+    if(rssi0 & 0x01) {
+        cc120xSpiReadReg(CC120X_RSSI1, &rssi1, 1);
+        *pRssi = (int8)((int16)((int8)rssi1) - RSSI_OFFSET);
+    }
 
-    // Wait for calibration to be done (radio back in IDLE state)
+    trxSpiCmdStrobe(CC120X_SIDLE);
     do {
         cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
-    } while (marcState != 0x41);
-
-    // Calibrate the RCOSC
-    calibrateRCOsc();
-    
-    // UART config
-    initUART();
-    
-    initTimer();
-
-    // Infinite loop
-    while(TRUE) {
-
-        // Set radio in RX Sniff Mode
-        trxSpiCmdStrobe(CC120X_SWOR);
-
-        // Wait for packet to be received
-        while(packetSemaphore != ISR_ACTION_REQUIRED);
-    
-        // Clear semaphore flag
-        packetSemaphore = ISR_IDLE;
+    } while (marcState != MARC_STATE_IDLE);
 
-        // Read number of bytes in RX FIFO
-        rxBytes = 0;
-        tc_backup = timerCount_50;
-        do {
-            cc120xSpiReadReg(CC120X_NUM_RXBYTES, &rxBytes, 1);
-            __delay_cycles(8000);
-            cc120xSpiReadReg(CC120X_NUM_RXBYTES, &rxBytes2, 1);
-//        } while ((rxBytes<16) && ((timerCount_50 - tc_backup) < 6));
-        } while (rxBytes!=rxBytes2);
-        
-        rxBytes = rxBytes2;
-        if ( rxBytes > 2 ){
-            rxBytes -= 2;
-        }
+    return rssi0 & 0x01;
+}
 
-        // Read all the bytes in the RX FIFO
-        memset( rxBuffer, 0, sizeof( rxBuffer ) );
-        tc_backup = timerCount_1000;
-        do {
-            cc120xSpiReadRxFifo( rxBuffer, rxBytes );
-        } while ((rxBuffer[0]==0) && ((timerCount_50 - tc_backup) < 6));
 
-        // RSSI setting
-        rxBuffer[0] = getRSSI();
+/*******************************************************************************
+*   @fn         tagSummaryEmit
+*
+*   @brief      Queues one tag summary record for the uplink
+*
+*   @param      pSummary - closed window of one tag
+*
+*   @return     TRUE if queued, FALSE if the uplink ring is full
+*/
+static uint8 tagSummaryEmit(const tagSummary_t *pSummary) {
 
-        // ASCII convert
-        uart_transmit(rxBuffer, rxBytes);
-        
-        // Update LCD
-        updateLcd();
-        
+    if(!FLOG_ENABLE && (rxRingCount() >= RX_RING_SLOTS)) {
+        return FALSE;
     }
+
+    tagSummaryPacket.len = tagAggSerialize(pSummary, tagSummaryPacket.data);
+    tagSummaryPacket.channel = CHAN_NONE;   // may span several channels
+    getTime(&tagSummaryPacket.stamp);       // time the window closed
+    timeToUtc(&tagSummaryPacket.stamp, &tagSummaryPacket.stamp);
+    return uplinkPut(&tagSummaryPacket);
 }
 
 
@@ -339,6 +2014,28 @@ int8 getRSSI()
 }
 
 
+/*******************************************************************************
+*   @fn         getPacketRSSI
+*
+*   @brief      RSSI of one packet from the status bytes appended to the RX
+*               FIFO (PKT_CFG1.APPEND_STATUS). Measured during the packet and
+*               costs no SPI transaction
+*
+*   @param      pPacket  - received packet
+*   @param      lastRssi - value returned when the radio had no valid RSSI
+*
+*   @return     RSSI in dBm
+*/
+static int8 getPacketRSSI(const rxPacket_t *pPacket, int8 lastRssi)
+{
+  if(pPacket->status[0] == RSSI_INVALID)
+  {
+    return lastRssi;
+  }
+  return (int8)((int16)((int8)pPacket->status[0]) - RSSI_OFFSET);
+}
+
+
 /*******************************************************************************
 *   @fn         calibrateRcOsc
 *
@@ -372,22 +2069,20 @@ static void calibrateRCOsc(void) {
 
 
 /*******************************************************************************
-*   @fn         radioRxISR
+*   @fn         radioRxDmaDone
 *
-*   @brief      ISR for packet handling in RX. Sets packet semaphore
-*               and clears interrupt flag
+*   @brief      Called from the DMA ISR when the RX FIFO drain is complete.
+*               CS_N is already released at this point. Ends the radio SPI
+*               time of the drain
 *
-*   @param      none
+*   @param      status - chip status byte of the FIFO access
 *
 *   @return     none
 */
-static void radioRxISR(void) {
-
-    // Set packet semaphore
-    packetSemaphore = ISR_ACTION_REQUIRED;
+static void radioRxDmaDone(rfStatus_t status) {
 
-    // Clear ISR flag
-    ioPinIntClear(IO_PIN_PORT_1, GPIO2);
+    rxSpiEnd = getFioTime();
+    dmaSemaphore = ISR_ACTION_REQUIRED;
 }
 
 
@@ -411,17 +2106,27 @@ static void initMCU(void) {
     // Init buttons
     bspKeyInit(BSP_KEY_MODE_POLL);
 
-    // Initialize SPI interface to LCD (shared with SPI flash)
+    // Initialize SPI interface to LCD (shared with SPI flash), flash
+    // transfers go first on the bus
     bspIoSpiInit(BSP_FLASH_LCD_SPI, BSP_FLASH_LCD_SPI_SPD);
+    spiBusInit(&getFioTime);
 
     // Init LCD
     lcdInit();
 
+    // Power up the SPI flash for the store-and-forward log
+    if(FLOG_ENABLE) {
+        flashInit();
+    }
+
     // Instantiate transceiver RF SPI interface to SCLK ~ 4 MHz
     // Input parameter is clockDivider
     // SCLK frequency = SMCLK/clockDivider
     trxRfSpiInterfaceInit(2);
 
+    // DMA channels for RX/TX FIFO bursts
+    trxRfSpiDmaInit();
+
     // Enable global interrupt
     _BIS_SR(GIE);
 }
@@ -430,8 +2135,8 @@ static void initMCU(void) {
 /*******************************************************************************
 *   @fn         registerConfig
 *
-*   @brief      Write register settings as given by SmartRF Studio found in
-*               cc1200_rx_sniff_mode_reg_config.h
+*   @brief      Resets the radio and writes the default PHY profile, see
+*               cc1200_rx_sniff_mode_phy.h
 *
 *   @param      none
 *
@@ -439,41 +2144,49 @@ static void initMCU(void) {
 */
 static void registerConfig(void) {
 
-    uint8 writeByte;
+    phyWriteProfile(PHY_PROFILE_DEFAULT);
+}
 
-    // Reset radio
-    trxSpiCmdStrobe(CC120X_SRES);
 
-    // Write registers to radio
-    for(uint16 i = 0;
-        i < (sizeof(preferredSettings)/sizeof(registerSetting_t)); i++) {
-        writeByte = preferredSettings[i].data;
-        cc120xSpiWriteReg(preferredSettings[i].addr, &writeByte, 1);
-    }
+/*******************************************************************************
+*   @fn         displayInit
+*
+*   @brief      Sets up the screen: title, PHY profile, packets sent to the
+*               gateway and the RX bar
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void displayInit(void) {
+
+    dispInit(DISP_FRAME_TICKS);
+    dispText(0, eLcdPage0, "RX Sniff Mode");
+    displayProfile = dispText(0, eLcdPage1, phyGetName(phyGetProfile()));
+    dispHLine(7);
+    dispText(0, eLcdPage3, "Received OK:");
+    displayCount = dispInt(70, eLcdPage4, (int32)packetCounter);
+    dispText(0, eLcdPage7, "RX");
+    dispHLine(55);
+    dispInvert(eLcdPage7);
 }
 
 
 /*******************************************************************************
-*   @fn         updateLcd
+*   @fn         displayTask
 *
-*   @brief      Updates LCD buffer and sends buffer to LCD module
+*   @brief      Queues the changed parts of the screen on the SPI bus, at
+*               most DISP_FPS times a second. Queued flash transfers go
+*               first, the end of each transfer wakes the main loop
 *
 *   @param      none
 *
 *   @return     none
 */
-static void updateLcd(void) {
+static void displayTask(void) {
 
-    // Update LDC buffer and send to screen
-    lcdBufferClear(0);
-    lcdBufferPrintString(0, "RX Sniff Mode", 0, eLcdPage0);
-    lcdBufferSetHLine(0, 0, LCD_COLS - 1, 7);
-    lcdBufferPrintString(0, "Received OK:", 0, eLcdPage3);
-    lcdBufferPrintInt(0, packetCounter++, 70, eLcdPage4);
-    lcdBufferPrintString(0, "RX", 0, eLcdPage7);
-    lcdBufferSetHLine(0, 0, LCD_COLS - 1, 55);
-    lcdBufferInvertPage(0, 0, LCD_COLS, eLcdPage7);
-    lcdSendBuffer(0);
+    dispRefresh(getTicks50());
+    displayWake = dispDirty();
 }
 
 
@@ -494,8 +2207,7 @@ void initTimer(void)
 
   TA0CCTL0 &= ~CCIE;                    // Disable timer Interrupt  
   TA0CCR0 = 32767;                      // PWM Period
-  TA0CCTL1 = OUTMOD_3;                  // TACCR1 set/reset
-  TA0CCR1 = 1;                          // TACCR1 PWM Duty Cycle   
+  TA0CCTL1 = 0;                         // TACCR1 radio timer, see radioTimerStart
   TA0CTL = TASSEL_1 + MC_1;             // ACLK, up mode
   TA0CCTL0 = CCIE;                      // TA0CCR0 interrupt enabled
 
@@ -508,6 +2220,30 @@ void initTimer(void)
 }
 
 
+/*******************************************************************************
+*   @fn         initSyncCapture
+*
+*   @brief      Routes GPIO2 to Timer A0 CCR2 (P1.3 = TA0.2, CCI2A). GPIO2 is
+*               PKT_SYNC_RXTX (IOCFG2 = 0x06): it asserts on the sync word and
+*               de-asserts once the whole packet is in the RX FIFO. Both edges
+*               are captured, the rising one stamps the packet and the falling
+*               one sets the packet semaphore, so NUM_RXBYTES is final when
+*               the main loop reads it. With P1SEL set the port interrupt of
+*               the pin is off
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void initSyncCapture(void)
+{
+  P1DIR &= ~GPIO2;
+  P1SEL |= GPIO2;
+  rxSyncCount = 0;
+  TA0CCTL2 = CM_3 + CCIS_0 + SCS + CAP + CCIE;  // both edges, synchronized
+}
+
+
 /*******************************************************************************
 *   @fn         Initialize UART port
 *
@@ -525,9 +2261,6 @@ void initUART(void)
    *
    ********************************/
 
-    // Buffers to be used by UART Driver
-    unsigned char uartTxBuf[2000];
-
     initUartDriver();
 
     // Configure UART Module on USCIA1
@@ -554,7 +2287,14 @@ void initUART(void)
             // Failed to initialize UART for some reason
             __no_operation();
     }
+    // TX ring owned by this file, frames that do not fit are dropped
+    cnf.txBlocking = 0;
     setUartTxBuffer(&cnf, uartTxBuf, sizeof(uartTxBuf));
+
+    // Gateway commands, the driver writes one byte past rxBufLen
+    setUartRxBuffer(&cnf, downlinkBuf, sizeof(downlinkBuf) - 1);
+    frameDecoderInit(&downlinkDecoder);
+    enableUartRx(&cnf);
     __enable_interrupt(); // Enable Global Interrupts
     
     // Send the string hello using interrupt driven
@@ -566,32 +2306,57 @@ void initUART(void)
 /*******************************************************************************
 *   @fn         uart_transmit
 *
-*   @brief      Transmit data (UART)
+*   @brief      Transmit data (UART). The frame is queued behind any frame
+*               still being sent. With UPLINK_FORMAT_COBS the packet is sent
+*               as a binary frame with a sequence number that advances even
+*               when the frame is dropped, so the gateway can count losses.
+*               Bytes sent and frames dropped are counted in the metrics
 *
-*   @param      none
+*   @param      pData - packet, length byte first
+*   @param      len   - bytes in pData
 *
-*   @return     none
+*   @return     UART_SUCCESS, or UART_TX_BUF_FULL if the frame was dropped
 */
-static void uart_transmit(uint8* pData, uint16 len) 
+static int uart_transmit(uint8* pData, uint16 len) 
 {
+#if UPLINK_FORMAT == UPLINK_FORMAT_COBS
+  uint8 c[FRAME_MAX_WIRE];
+  uint8 n;
+  int ret;
+
+  n = frameEncode( uplinkSeq++, pData, (uint8)len, c );
+  if ( n == 0 )
+  {
+    return UART_INSUFFICIENT_TX_BUF;
+  }
+  ret = uartSendDataInt( &cnf, c, n );
+#else
   // ASCII convert
-  char dat[256] = {0};
   char ch[] = "0123456789ABCDEF";
-  char c[62] = {0};
+  char c[SIZE_UPLINK_FRAME] = {0};
   int16 j = 0;
-//  c[60] = '\r';
-//  c[61] = '\n';
+  uint16 n = len*2+2;
+  int ret;
   
-  memcpy( dat, pData, len );
   for ( j=0; j<len; j++ )
   {
-    c[j*2] = ch[(rxBuffer[j]>>4)&0x0f];
-    c[j*2+1] = ch[rxBuffer[j]&0x0f];
+    c[j*2] = ch[(pData[j]>>4)&0x0f];
+    c[j*2+1] = ch[pData[j]&0x0f];
   }
   c[len*2  ] = '\r';
   c[len*2+1] = '\n';
   
-  uartSendDataInt( &cnf, c, len*2+2 );
+  ret = uartSendDataInt( &cnf, (unsigned char *)c, n );
+#endif
+  if ( ret == UART_SUCCESS )
+  {
+    metricsAdd( METRICS_UART_TX_BYTES, n );
+  }
+  else
+  {
+    metricsCount( METRICS_UART_TX_DROPS );
+  }
+  return ret;
 }
 
 
@@ -623,6 +2388,58 @@ void sendUart(uint8* pData, uint16 len)
 __interrupt void Timer_A0(void)
 {
   timerCount_1000++;
+
+  // Let the main loop run its 1 s tick (tag windows, sniff controller)
+  __low_power_mode_off_on_exit();
+}
+
+
+/*******************************************************************************
+*   @fn         Timer A0 CCR1-4
+*
+*   @brief      CCR1 compare: a step of a relay exchange timed out, sets the
+*               radio timer semaphore and wakes the main loop. GPIO2 edge
+*               captured by CCR2. Sync word: the count and its
+*               second are latched for the packet. End of packet: sets the
+*               packet semaphore and wakes the main loop. CCR3 compare: the
+*               TDMA slot opens, CCR4 compare: the flash is due for a status
+*               poll, both wake the main loop
+*
+*   @param      none
+*
+*   @return     none
+*/
+#pragma vector=TIMER0_A1_VECTOR
+__interrupt void Timer_A1(void)
+{
+    uint16 count;
+    uint8 slot;
+
+    switch(__even_in_range(TA0IV, 14)) {
+    case 2:                             // CCR1
+        TA0CCTL1 = 0;
+        radioTimerSemaphore = ISR_ACTION_REQUIRED;
+        __low_power_mode_off_on_exit();
+        break;
+    case 4:                             // CCR2
+        count = TA0CCR2;
+        if(TA0CCTL2 & CCI) {
+            slot = rxSyncCount % RX_STAMP_SLOTS;
+            rxSyncStamp[slot].sec = getClockSeconds(count);
+            rxSyncStamp[slot].frac = count;
+            rxSyncCount++;
+        } else {
+            packetSemaphore = ISR_ACTION_REQUIRED;
+            __low_power_mode_off_on_exit();
+        }
+        break;
+    case 6:                             // CCR3
+    case 8:                             // CCR4
+        __low_power_mode_off_on_exit();
+        break;
+    default:
+        break;
+    }
 }
 
 
@@ -639,4 +2456,14 @@ __interrupt void Timer_A0(void)
 __interrupt void Timer_B0(void)
 {
     timerCount_50++;
+
+#if (SCAN_CHANNEL_COUNT > 1) || RELAY_ENABLE
+    // Let the main loop check the scan dwell time and the relay queue
+    __low_power_mode_off_on_exit();
+#else
+    // Let the main loop send a display frame
+    if(displayWake) {
+        __low_power_mode_off_on_exit();
+    }
+#endif
 }
@@ -0,0 +1,251 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_scan.c
+//! @brief      Channel scanning, see cc1200_rx_sniff_mode_scan.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_scan.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#if (SCAN_DWELL_MIN < 1) || (SCAN_DWELL_MIN > SCAN_DWELL_INIT) || \
+    (SCAN_DWELL_INIT > SCAN_DWELL_MAX) || (SCAN_DWELL_MAX > 255)
+#error "Scan dwell bounds must satisfy 1 <= MIN <= INIT <= MAX <= 255"
+#endif
+
+#define SCAN_NOISE_SHIFT        3       // noise floor average over ~8 samples
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static const uint8 scanChannels[] = { SCAN_CHANNEL_LIST };
+typedef char scanListCheck[(sizeof(scanChannels) == SCAN_CHANNEL_COUNT) ? 1 : -1];
+
+static scanStats_t scanStats[SCAN_CHANNEL_COUNT];
+static int16 scanNoiseAcc[SCAN_CHANNEL_COUNT];  // noise floor << SCAN_NOISE_SHIFT
+static uint8 scanIndex;
+static uint16 scanVisitStart;
+static uint32 scanVisitPackets;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static scanStats_t *scanFind(uint8 channel);
+
+
+/*******************************************************************************
+*   @fn         scanInit
+*
+*   @brief      Starts a visit on the first channel of the list
+*
+*   @param      now - Timer B0 ticks
+*
+*   @return     none
+*/
+void scanInit(uint16 now) {
+
+    uint8 i;
+
+    memset(scanStats, 0, sizeof(scanStats));
+    for(i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+        scanStats[i].channel = scanChannels[i];
+        scanStats[i].dwell = SCAN_DWELL_INIT;
+        scanStats[i].noiseFloor = SCAN_NOISE_NONE;
+    }
+
+    scanIndex = 0;
+    scanVisitStart = now;
+    scanVisitPackets = 0;
+    scanStats[0].visits = 1;
+}
+
+
+/*******************************************************************************
+*   @fn         scanGetChannel
+*
+*   @brief      Returns the channel of the current visit
+*
+*   @param      none
+*
+*   @return     channel
+*/
+uint8 scanGetChannel(void) {
+
+    return scanStats[scanIndex].channel;
+}
+
+
+/*******************************************************************************
+*   @fn         scanDue
+*
+*   @brief      Checks whether the current visit has used up its dwell time
+*
+*   @param      now - Timer B0 ticks
+*
+*   @return     TRUE if scanNext should be called, never with one channel
+*/
+uint8 scanDue(uint16 now) {
+
+    return (SCAN_CHANNEL_COUNT > 1) &&
+           ((uint16)(now - scanVisitStart) >= scanStats[scanIndex].dwell);
+}
+
+
+/*******************************************************************************
+*   @fn         scanNext
+*
+*   @brief      Ends the current visit, adapts its channel's dwell time and
+*               starts a visit on the next channel of the list
+*
+*   @param      now - Timer B0 ticks
+*
+*   @return     channel to tune to
+*/
+uint8 scanNext(uint16 now) {
+
+    scanStats_t *pStats = &scanStats[scanIndex];
+    uint16 dwell = pStats->dwell;
+
+    if(scanVisitPackets > 0) {
+        dwell += dwell / 2 + 1;
+    } else {
+        dwell -= dwell / 4;
+    }
+    if(dwell < SCAN_DWELL_MIN) {
+        dwell = SCAN_DWELL_MIN;
+    }
+    if(dwell > SCAN_DWELL_MAX) {
+        dwell = SCAN_DWELL_MAX;
+    }
+    pStats->dwell = (uint8)dwell;
+
+    if(++scanIndex >= SCAN_CHANNEL_COUNT) {
+        scanIndex = 0;
+    }
+    scanVisitStart = now;
+    scanVisitPackets = 0;
+    scanStats[scanIndex].visits++;
+    return scanStats[scanIndex].channel;
+}
+
+
+/*******************************************************************************
+*   @fn         scanCountPacket
+*
+*   @brief      Counts a packet received on a channel
+*
+*   @param      channel - channel the radio was tuned to
+*
+*   @return     none
+*/
+void scanCountPacket(uint8 channel) {
+
+    scanStats_t *pStats = scanFind(channel);
+
+    if(pStats == NULL) {
+        return;
+    }
+    pStats->packets++;
+    if(pStats == &scanStats[scanIndex]) {
+        scanVisitPackets++;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         scanCountCrcErrors
+*
+*   @brief      Counts packets dropped for a bad CRC on a channel
+*
+*   @param      channel - channel the radio was tuned to
+*   @param      errors  - number of packets
+*
+*   @return     none
+*/
+void scanCountCrcErrors(uint8 channel, uint8 errors) {
+
+    scanStats_t *pStats = scanFind(channel);
+
+    if(pStats != NULL) {
+        pStats->crcErrors += errors;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         scanCountNoise
+*
+*   @brief      Adds an RSSI sample taken with no packet on the air to the
+*               channel's noise floor average
+*
+*   @param      channel - channel sampled
+*   @param      rssi    - dBm
+*
+*   @return     none
+*/
+void scanCountNoise(uint8 channel, int8 rssi) {
+
+    scanStats_t *pStats = scanFind(channel);
+    int16 *pAcc;
+
+    if(pStats == NULL) {
+        return;
+    }
+    pAcc = &scanNoiseAcc[pStats - scanStats];
+
+    if(pStats->noiseFloor == SCAN_NOISE_NONE) {
+        *pAcc = (int16)rssi << SCAN_NOISE_SHIFT;
+    } else {
+        *pAcc += rssi - (*pAcc >> SCAN_NOISE_SHIFT);
+    }
+    pStats->noiseFloor = (int8)(*pAcc >> SCAN_NOISE_SHIFT);
+}
+
+
+/*******************************************************************************
+*   @fn         scanGetStats
+*
+*   @brief      Returns the counters of one entry of the channel list
+*
+*   @param      index - 0..SCAN_CHANNEL_COUNT-1
+*
+*   @return     pointer to the statistics, NULL past the end of the list
+*/
+const scanStats_t *scanGetStats(uint8 index) {
+
+    if(index >= SCAN_CHANNEL_COUNT) {
+        return NULL;
+    }
+    return &scanStats[index];
+}
+
+
+/*******************************************************************************
+*   @fn         scanFind
+*
+*   @brief      Looks up a channel in the list
+*
+*   @param      channel - channel number
+*
+*   @return     its statistics, NULL if the channel is not scanned
+*/
+static scanStats_t *scanFind(uint8 channel) {
+
+    uint8 i;
+
+    for(i = 0; i < SCAN_CHANNEL_COUNT; i++) {
+        if(scanStats[i].channel == channel) {
+            return &scanStats[i];
+        }
+    }
+    return NULL;
+}
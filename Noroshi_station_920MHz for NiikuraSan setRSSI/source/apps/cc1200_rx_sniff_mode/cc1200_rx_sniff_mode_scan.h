@@ -0,0 +1,84 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_scan.h
+//! @brief      Channel scanning for the sniff mode receiver. Rotates through
+//!             SCAN_CHANNEL_LIST, staying on each channel for its own dwell
+//!             time: a visit that received packets lengthens the channel's
+//!             dwell by half, a silent one shortens it by a quarter, within
+//!             SCAN_DWELL_MIN..SCAN_DWELL_MAX. Keeps per-channel packet, CRC
+//!             error and noise floor counters. Decides only, the caller
+//!             tunes the radio. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_SCAN_H
+#define CC1200_RX_SNIFF_MODE_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_chan.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// Channels to scan, override both in the project options, e.g.
+// SCAN_CHANNEL_LIST=24,33,38 and SCAN_CHANNEL_COUNT=3. One channel turns
+// scanning off and keeps the single-channel record format
+#ifndef SCAN_CHANNEL_LIST
+#define SCAN_CHANNEL_LIST       CHAN_DEFAULT
+#define SCAN_CHANNEL_COUNT      1
+#endif
+#ifndef SCAN_CHANNEL_COUNT
+#error "Set SCAN_CHANNEL_COUNT to the length of SCAN_CHANNEL_LIST"
+#endif
+
+// Dwell times in Timer B0 ticks of 50 ms. A dwell should cover several
+// sniff periods and the tags' transmit interval
+#define SCAN_TICK_MS            50
+#ifndef SCAN_DWELL_MIN
+#define SCAN_DWELL_MIN          4       // 200 ms
+#endif
+#ifndef SCAN_DWELL_MAX
+#define SCAN_DWELL_MAX          40      // 2 s
+#endif
+#define SCAN_DWELL_INIT         10      // 500 ms
+
+#define SCAN_NOISE_NONE         -128    // no noise sample yet
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint8  channel;
+    uint8  dwell;                       // current dwell, 50 ms ticks
+    uint32 visits;
+    uint32 packets;
+    uint32 crcErrors;
+    int8   noiseFloor;                  // dBm, average of entry samples
+} scanStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void scanInit(uint16 now);
+uint8 scanGetChannel(void);
+uint8 scanDue(uint16 now);
+uint8 scanNext(uint16 now);
+void scanCountPacket(uint8 channel);
+void scanCountCrcErrors(uint8 channel, uint8 errors);
+void scanCountNoise(uint8 channel, int8 rssi);
+const scanStats_t *scanGetStats(uint8 index);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,480 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_sync.c
+//! @brief      Time synchronization between stations, see
+//!             cc1200_rx_sniff_mode_sync.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_sync.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+// The fit works on local times relative to the newest pair in units of
+// 2^SYNC_X_SHIFT fractions (~1 ms), so its sums stay within 64 bits
+#define SYNC_X_SHIFT            5
+#if SYNC_PERIOD * SYNC_POINTS > 256
+#error "Sync fit span too long for the fixed point, shorten SYNC_PERIOD"
+#endif
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint8 valid;
+    uint8 seq;
+    signed long long local;             // 1/32768 s
+} syncRx_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint8 syncMyId;
+
+// Master
+static uint8 syncSeq;
+static uint8 syncPrevSeq;               // last beacon sent
+static uint8 syncPrevValid;
+static timeStamp_t syncPrevTime;        // master time at its sync word
+static uint32 syncLastBeacon;           // seconds
+
+// Slave: beacon captures, pairs (local, master - local) and the fit
+static syncRx_t syncRx[SYNC_RX_SLOTS];
+static uint8 syncRxNext;
+static signed long long syncX[SYNC_POINTS];
+static signed long long syncY[SYNC_POINTS];
+static uint8 syncCount;
+static uint8 syncNext;
+static uint8 syncNoEpoch;               // master time is its uptime
+static uint8 syncFitValid;
+static signed long long syncRefLocal;
+static signed long long syncRefOffset;
+static int32 syncSkew;                  // TIME_SKEW_BITS fixed point
+
+static syncStats_t syncStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void syncAddPair(signed long long local, signed long long master);
+static void syncFit(void);
+static void syncFromFrac(signed long long t, timeStamp_t *pStamp);
+
+
+/*******************************************************************************
+*   @fn         syncInit
+*
+*   @brief      Resets beacon state and the fit
+*
+*   @param      myId - this station's ID, SYNC_MASTER_ID sends beacons
+*   @param      now  - seconds
+*
+*   @return     none
+*/
+void syncInit(uint8 myId, uint32 now) {
+
+    syncMyId = myId;
+    syncSeq = 0;
+    syncPrevValid = FALSE;
+    syncLastBeacon = now;
+    memset(syncRx, 0, sizeof(syncRx));
+    syncRxNext = 0;
+    syncCount = 0;
+    syncNext = 0;
+    syncFitValid = FALSE;
+    syncSkew = 0;
+    memset(&syncStats, 0, sizeof(syncStats));
+}
+
+
+/*******************************************************************************
+*   @fn         syncIsMaster
+*
+*   @brief      Checks whether this station sends the beacons
+*
+*   @param      none
+*
+*   @return     TRUE for the master
+*/
+uint8 syncIsMaster(void) {
+
+    return syncMyId == SYNC_MASTER_ID;
+}
+
+
+/*******************************************************************************
+*   @fn         syncIsSynced
+*
+*   @brief      Checks whether this station's clock is on the master's time
+*
+*   @param      none
+*
+*   @return     TRUE for the master and for a slave with a fit
+*/
+uint8 syncIsSynced(void) {
+
+    return syncIsMaster() || syncFitValid;
+}
+
+
+/*******************************************************************************
+*   @fn         syncBeaconDue
+*
+*   @brief      Checks whether the master should send a beacon
+*
+*   @param      now - seconds
+*
+*   @return     TRUE if syncBuildBeacon should be called
+*/
+uint8 syncBeaconDue(uint32 now) {
+
+    return syncIsMaster() && ((now - syncLastBeacon) >= SYNC_PERIOD);
+}
+
+
+/*******************************************************************************
+*   @fn         syncBuildBeacon
+*
+*   @brief      Builds the next beacon. It carries the time of the last
+*               beacon that syncBeaconSent confirmed
+*
+*   @param      pFrame   - output, SYNC_BEACON_MAX bytes
+*   @param      now      - seconds
+*   @param      pExtra   - bytes appended for other modules, may be NULL
+*   @param      extraLen - bytes in pExtra, at most SYNC_EXTRA_MAX
+*
+*   @return     bytes in pFrame
+*/
+uint8 syncBuildBeacon(uint8 *pFrame, uint32 now, const uint8 *pExtra, uint8 extraLen) {
+
+    uint8 len;
+
+    if(extraLen > SYNC_EXTRA_MAX) {
+        extraLen = 0;
+    }
+    len = SYNC_BEACON_LEN + extraLen;
+
+    memset(pFrame, 0, len);
+    pFrame[0] = len - 1;
+    pFrame[SYNC_POS_TYPE] = SYNC_TYPE_BEACON;
+    pFrame[SYNC_POS_SRC] = syncMyId;
+    pFrame[SYNC_POS_SEQ] = syncSeq;
+    if(syncPrevValid) {
+        pFrame[SYNC_POS_PREV] = syncPrevSeq;
+        pFrame[SYNC_POS_FLAGS] = SYNC_FLAG_TIME;
+        timeSerialize(&syncPrevTime, &pFrame[SYNC_POS_TIME]);
+    }
+    if(extraLen > 0) {
+        memcpy(&pFrame[SYNC_POS_EXTRA], pExtra, extraLen);
+    }
+    crc16Append(pFrame, len - CRC16_LEN);
+
+    syncLastBeacon = now;
+    return len;
+}
+
+
+/*******************************************************************************
+*   @fn         syncBeaconSent
+*
+*   @brief      Master: the beacon from syncBuildBeacon went out. Its time is
+*               sent with the next beacon
+*
+*   @param      pTime - master time (timeToUtc) at the beacon's sync word
+*
+*   @return     none
+*/
+void syncBeaconSent(const timeStamp_t *pTime) {
+
+    syncPrevSeq = syncSeq++;
+    syncPrevTime = *pTime;
+    syncPrevValid = TRUE;
+    syncStats.beaconsSent++;
+}
+
+
+/*******************************************************************************
+*   @fn         syncIsBeacon
+*
+*   @brief      Tells beacons from other packets by type byte and length
+*
+*   @param      pData - packet, length byte first
+*   @param      len   - bytes in pData
+*
+*   @return     TRUE for a beacon
+*/
+uint8 syncIsBeacon(const uint8 *pData, uint8 len) {
+
+    return (len >= SYNC_BEACON_LEN) && (len <= SYNC_BEACON_MAX) &&
+           (pData[0] == len - 1) && (pData[SYNC_POS_TYPE] == SYNC_TYPE_BEACON);
+}
+
+
+/*******************************************************************************
+*   @fn         syncBeaconExtra
+*
+*   @brief      Finds the extra bytes of a valid beacon from the master
+*
+*   @param      pData   - beacon, length byte first
+*   @param      len     - bytes in pData
+*   @param      ppExtra - output, first extra byte
+*
+*   @return     extra bytes, 0 if none or the beacon is not valid
+*/
+uint8 syncBeaconExtra(const uint8 *pData, uint8 len, const uint8 **ppExtra) {
+
+    if(!syncIsBeacon(pData, len) || (pData[SYNC_POS_SRC] != SYNC_MASTER_ID) ||
+       !crc16Check(pData, len)) {
+        return 0;
+    }
+    *ppExtra = &pData[SYNC_POS_EXTRA];
+    return len - SYNC_BEACON_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         syncReceive
+*
+*   @brief      Slave: keeps the capture of a master beacon and, when the
+*               beacon carries the master's time of an earlier one still
+*               kept, adds that pair and fits again
+*
+*   @param      pData  - beacon, length byte first
+*   @param      len    - bytes in pData
+*   @param      pLocal - local time of its sync word
+*
+*   @return     TRUE if the fit changed, apply it with syncGetModel
+*/
+uint8 syncReceive(const uint8 *pData, uint8 len, const timeStamp_t *pLocal) {
+
+    timeStamp_t master;
+    uint8 i;
+
+    if(syncIsMaster() || !syncIsBeacon(pData, len) ||
+       (pData[SYNC_POS_SRC] != SYNC_MASTER_ID)) {
+        return FALSE;
+    }
+    if(!crc16Check(pData, len)) {
+        syncStats.badBeacons++;
+        return FALSE;
+    }
+    syncStats.beaconsReceived++;
+
+    syncRx[syncRxNext].valid = TRUE;
+    syncRx[syncRxNext].seq = pData[SYNC_POS_SEQ];
+    syncRx[syncRxNext].local = timeToFrac(pLocal) - SYNC_RX_DELAY_FRAC;
+    syncRxNext = (syncRxNext + 1) % SYNC_RX_SLOTS;
+
+    if(!(pData[SYNC_POS_FLAGS] & SYNC_FLAG_TIME)) {
+        return FALSE;
+    }
+    for(i = 0; i < SYNC_RX_SLOTS; i++) {
+        if(syncRx[i].valid && (syncRx[i].seq == pData[SYNC_POS_PREV])) {
+            break;
+        }
+    }
+    if(i == SYNC_RX_SLOTS) {
+        return FALSE;
+    }
+
+    timeParse(&pData[SYNC_POS_TIME], &master);
+    syncNoEpoch = (master.frac & TIME_FRAC_NO_EPOCH) != 0;
+    syncAddPair(syncRx[i].local, timeToFrac(&master));
+    syncRx[i].valid = FALSE;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         syncGetModel
+*
+*   @brief      Returns the fit in the form timeSetModel takes
+*
+*   @param      pRefLocal  - output, local time of the reference point
+*   @param      pRefMaster - output, master time there, TIME_FRAC_NO_EPOCH
+*                            set when the master has no UTC
+*   @param      pSkew      - output, TIME_SKEW_BITS fixed point
+*
+*   @return     none
+*/
+void syncGetModel(timeStamp_t *pRefLocal, timeStamp_t *pRefMaster, int32 *pSkew) {
+
+    syncFromFrac(syncRefLocal, pRefLocal);
+    syncFromFrac(syncRefLocal + syncRefOffset, pRefMaster);
+    if(syncNoEpoch) {
+        pRefMaster->frac |= TIME_FRAC_NO_EPOCH;
+    }
+    *pSkew = syncSkew;
+}
+
+
+/*******************************************************************************
+*   @fn         syncBuildStatus
+*
+*   @brief      Writes the status record: last sync error, fitted skew and
+*               the pairs in the fit
+*
+*   @param      pOut - output, SYNC_STATUS_LEN bytes
+*
+*   @return     SYNC_STATUS_LEN
+*/
+uint8 syncBuildStatus(uint8 *pOut) {
+
+    uint32 error = (uint32)syncStats.lastErrorUs;
+    uint32 skew = (uint32)syncStats.skewPpb;
+
+    pOut[0] = SYNC_STATUS_LEN - 1;
+    pOut[SYNC_POS_TYPE] = SYNC_TYPE_STATUS;
+    pOut[SYNC_POS_SRC] = syncMyId;
+    pOut[SYNC_POS_ERROR] = (uint8)(error >> 24);
+    pOut[SYNC_POS_ERROR + 1] = (uint8)(error >> 16);
+    pOut[SYNC_POS_ERROR + 2] = (uint8)(error >> 8);
+    pOut[SYNC_POS_ERROR + 3] = (uint8)error;
+    pOut[SYNC_POS_SKEW] = (uint8)(skew >> 24);
+    pOut[SYNC_POS_SKEW + 1] = (uint8)(skew >> 16);
+    pOut[SYNC_POS_SKEW + 2] = (uint8)(skew >> 8);
+    pOut[SYNC_POS_SKEW + 3] = (uint8)skew;
+    pOut[SYNC_POS_POINTS] = syncCount;
+    return SYNC_STATUS_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         syncGetStats
+*
+*   @brief      Returns the sync counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const syncStats_t *syncGetStats(void) {
+
+    return &syncStats;
+}
+
+
+/*******************************************************************************
+*   @fn         syncAddPair
+*
+*   @brief      Compares a pair with the current fit, then adds it. A pair
+*               beyond SYNC_RESET_FRAC starts a new fit
+*
+*   @param      local  - local time of a beacon's sync word
+*   @param      master - master time of the same sync word
+*
+*   @return     none
+*/
+static void syncAddPair(signed long long local, signed long long master) {
+
+    signed long long offset = master - local;
+    signed long long error;
+    uint32 absUs;
+
+    if(syncFitValid) {
+        error = offset - (syncRefOffset +
+                          (((local - syncRefLocal) * syncSkew) >> TIME_SKEW_BITS));
+        if((error > SYNC_RESET_FRAC) || (error < -SYNC_RESET_FRAC)) {
+            syncCount = 0;
+            syncNext = 0;
+            syncStats.resets++;
+            syncStats.maxErrorUs = 0;
+        } else {
+            syncStats.lastErrorUs = (int32)(error * 15625 / 512);   // 1e6 / 32768
+            absUs = (uint32)((syncStats.lastErrorUs < 0) ? -syncStats.lastErrorUs
+                                                         : syncStats.lastErrorUs);
+            if(absUs > syncStats.maxErrorUs) {
+                syncStats.maxErrorUs = absUs;
+            }
+            syncStats.errorSumUs += absUs;
+            syncStats.errorCount++;
+        }
+    }
+
+    syncX[syncNext] = local;
+    syncY[syncNext] = offset;
+    syncNext = (syncNext + 1) % SYNC_POINTS;
+    if(syncCount < SYNC_POINTS) {
+        syncCount++;
+    }
+    syncStats.pairs++;
+    syncStats.points = syncCount;
+    syncFit();
+}
+
+
+/*******************************************************************************
+*   @fn         syncFit
+*
+*   @brief      Least squares line through the pairs, offset against local
+*               time. Times are taken relative to the newest pair; the slope
+*               is the skew, the line's value at the newest pair the offset
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void syncFit(void) {
+
+    uint8 newest = (syncNext + SYNC_POINTS - 1) % SYNC_POINTS;
+    signed long long sx = 0;             // sum of dx, 1/32768 s
+    signed long long sX = 0;             // sum of dx >> SYNC_X_SHIFT
+    signed long long sy = 0;
+    signed long long sXX = 0;
+    signed long long sXy = 0;
+    signed long long num;
+    signed long long den;
+    signed long long dx;
+    signed long long dy;
+    signed long long n = syncCount;
+    uint8 i;
+
+    for(i = 0; i < syncCount; i++) {
+        dx = syncX[i] - syncX[newest];
+        dy = syncY[i] - syncY[newest];
+        sx += dx;
+        sX += dx >> SYNC_X_SHIFT;
+        sy += dy;
+        sXX += (dx >> SYNC_X_SHIFT) * (dx >> SYNC_X_SHIFT);
+        sXy += (dx >> SYNC_X_SHIFT) * dy;
+    }
+
+    num = n * sXy - sX * sy;
+    den = n * sXX - sX * sX;
+    if((syncCount >= 2) && (den > 0)) {
+        syncSkew = (int32)((num << (TIME_SKEW_BITS - SYNC_X_SHIFT)) / den);
+    } else if(syncCount < 2) {
+        syncSkew = 0;
+    }
+
+    syncRefLocal = syncX[newest];
+    syncRefOffset = syncY[newest] + (sy - ((sx * syncSkew) >> TIME_SKEW_BITS)) / n;
+    syncFitValid = TRUE;
+    syncStats.skewPpb = (int32)(((signed long long)syncSkew * 1000000000) >> TIME_SKEW_BITS);
+}
+
+
+/*******************************************************************************
+*   @fn         syncFromFrac
+*
+*   @brief      Count of 1/32768 s as a stamp
+*
+*   @param      t      - fractions, not negative
+*   @param      pStamp - output
+*
+*   @return     none
+*/
+static void syncFromFrac(signed long long t, timeStamp_t *pStamp) {
+
+    pStamp->sec = (uint32)(t >> TIME_FRAC_BITS);
+    pStamp->frac = (uint16)(t & TIME_FRAC_BM);
+}
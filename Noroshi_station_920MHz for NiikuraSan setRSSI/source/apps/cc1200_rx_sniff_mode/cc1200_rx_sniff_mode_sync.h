@@ -0,0 +1,121 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_sync.h
+//! @brief      Time synchronization between stations. The master (station
+//!             ID 0) broadcasts a beacon every SYNC_PERIOD seconds; each
+//!             beacon carries the master's time at the sync word of the
+//!             previous one, which both sides latched in hardware. A slave
+//!             pairs that time with its own capture of the same sync word
+//!             and fits offset and skew of its clock to the last SYNC_POINTS
+//!             pairs by least squares in fixed point. Before each fit the
+//!             new pair is compared with the old fit; that difference is the
+//!             sync error reported. A beacon can carry up to SYNC_EXTRA_MAX
+//!             bytes for other modules, e.g. the TDMA slot map. Decides only,
+//!             the caller drives the radio and applies the fit with
+//!             timeSetModel. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_SYNC_H
+#define CC1200_RX_SNIFF_MODE_SYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_time.h"
+#include "cc1200_rx_sniff_mode_crc.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// SYNC_ENABLE = 1 makes the master send beacons and the slaves follow them
+#ifndef SYNC_ENABLE
+#define SYNC_ENABLE             0
+#endif
+#define SYNC_MASTER_ID          0       // as RELAY_MASTER_ID
+
+#ifndef SYNC_PERIOD
+#define SYNC_PERIOD             16      // seconds between beacons
+#endif
+#define SYNC_POINTS             8       // pairs in the fit, ~2 min
+#define SYNC_RX_SLOTS           4       // beacon captures kept for pairing
+
+// A pair further than this from the fit restarts it, the master's time
+// jumped (new UTC from its gateway) or the pair is bogus
+#define SYNC_RESET_FRAC         (TIME_FRAC_HZ / 10)
+
+// Sync word capture delay of the receiver against the transmitter, in
+// 1/32768 s. Calibrate against a wired reference
+#ifndef SYNC_RX_DELAY_FRAC
+#define SYNC_RX_DELAY_FRAC      0
+#endif
+
+// Beacon layout, byte 0 is the length byte. TIME is the master's time at
+// the sync word of beacon PREV, valid with SYNC_FLAG_TIME. EXTRA bytes may
+// follow and the frame ends with a CRC-16 over the bytes before it
+#define SYNC_POS_TYPE           1
+#define SYNC_POS_SRC            2
+#define SYNC_POS_SEQ            3
+#define SYNC_POS_PREV           4
+#define SYNC_POS_FLAGS          5
+#define SYNC_POS_TIME           6       // TIME_STAMP_LEN bytes
+#define SYNC_POS_EXTRA          (SYNC_POS_TIME + TIME_STAMP_LEN)
+#define SYNC_EXTRA_MAX          16
+#define SYNC_BEACON_LEN         (SYNC_POS_EXTRA + CRC16_LEN)   // no extra bytes
+#define SYNC_BEACON_MAX         (SYNC_BEACON_LEN + SYNC_EXTRA_MAX)
+
+#define SYNC_TYPE_BEACON        0xB5
+#define SYNC_FLAG_TIME          0x01
+
+// Status record for the uplink, sent by a slave after each fit
+#define SYNC_TYPE_STATUS        0xB6
+#define SYNC_POS_ERROR          3       // 4 bytes big endian, us
+#define SYNC_POS_SKEW           7       // 4 bytes big endian, ppb
+#define SYNC_POS_POINTS         11
+#define SYNC_STATUS_LEN         12
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 beaconsSent;                 // master
+    uint32 beaconsReceived;             // slave, valid beacons of the master
+    uint32 badBeacons;                  // CRC-16 mismatch
+    uint32 pairs;                       // pairs added to the fit
+    uint32 resets;                      // fits restarted by an outlier
+    int32  lastErrorUs;                 // new pair against the old fit
+    uint32 maxErrorUs;                  // largest |lastErrorUs| since the reset
+    uint32 errorSumUs;                  // sum of |lastErrorUs|, for the mean
+    uint32 errorCount;
+    int32  skewPpb;                     // local clock rate error, fitted
+    uint8  points;                      // pairs in the fit
+} syncStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void syncInit(uint8 myId, uint32 now);
+uint8 syncIsMaster(void);
+uint8 syncBeaconDue(uint32 now);
+uint8 syncIsSynced(void);
+uint8 syncBuildBeacon(uint8 *pFrame, uint32 now, const uint8 *pExtra, uint8 extraLen);
+void syncBeaconSent(const timeStamp_t *pTime);
+uint8 syncIsBeacon(const uint8 *pData, uint8 len);
+uint8 syncReceive(const uint8 *pData, uint8 len, const timeStamp_t *pLocal);
+uint8 syncBeaconExtra(const uint8 *pData, uint8 len, const uint8 **ppExtra);
+void syncGetModel(timeStamp_t *pRefLocal, timeStamp_t *pRefMaster, int32 *pSkew);
+uint8 syncBuildStatus(uint8 *pOut);
+const syncStats_t *syncGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
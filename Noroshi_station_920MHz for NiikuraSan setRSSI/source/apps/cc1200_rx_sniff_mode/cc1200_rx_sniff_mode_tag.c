@@ -0,0 +1,348 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_tag.c
+//! @brief      Per-tag aggregation, see cc1200_rx_sniff_mode_tag.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_tag.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#define TAG_TABLE_MASK          (TAG_TABLE_SIZE - 1)
+#define TAG_HASH_MULT           2654435761UL        // Knuth, 2^32 / golden ratio
+
+#if TAG_MAX_PROBE > TAG_TABLE_SIZE
+#error "TAG_MAX_PROBE must not exceed TAG_TABLE_SIZE"
+#endif
+
+
+/*******************************************************************************
+* TYPEDEFS
+*/
+typedef struct {
+    uint32 id;
+    int32  rssiSum;
+    uint32 firstSeen;
+    uint32 lastSeen;
+    uint16 count;
+    int8   rssiMin;
+    int8   rssiMax;
+    uint8  sensor[TAG_SENSOR_LEN];
+    uint8  used;
+} tagEntry_t;
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static tagEntry_t tagTable[TAG_TABLE_SIZE];
+static uint16 tagWindow;
+static tagAggStats_t tagAggStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static uint8 tagHash(uint32 id);
+static void tagStart(tagEntry_t *pEntry, uint32 id, const uint8 *pPkt, int8 rssi, uint32 now);
+static uint8 tagEmit(const tagEntry_t *pEntry, tagEmit_t pfnEmit);
+static void tagDelete(uint8 i);
+
+
+/*******************************************************************************
+*   @fn         tagAggInit
+*
+*   @brief      Empties the table and clears the counters
+*
+*   @param      window - aggregation window in seconds, at least 1
+*
+*   @return     none
+*/
+void tagAggInit(uint16 window) {
+
+    memset(tagTable, 0, sizeof(tagTable));
+    memset(&tagAggStats, 0, sizeof(tagAggStats));
+    tagWindow = (window > 0) ? window : 1;
+}
+
+
+/*******************************************************************************
+*   @fn         tagAggUpdate
+*
+*   @brief      Folds one tag packet into the table. The TagID is looked up
+*               by linear probing from its hash slot, at most TAG_MAX_PROBE
+*               slots. A tag whose window has closed is emitted and restarted
+*               with this packet. The packet is not taken, and the caller
+*               forwards it raw, when all probed slots hold other tags, or
+*               when a window that has to close first cannot be emitted; the
+*               entry then stays for tagAggExpire to retry, so no sample is
+*               lost in the table
+*
+*   @param      pPkt    - tag packet, TAG_PKT_LEN bytes
+*   @param      rssi    - packet RSSI in dBm
+*   @param      now     - current time in seconds
+*   @param      pfnEmit - receives closed summaries
+*
+*   @return     TRUE if the packet was folded in, FALSE if the caller has
+*               to forward it
+*/
+uint8 tagAggUpdate(const uint8 *pPkt, int8 rssi, uint32 now, tagEmit_t pfnEmit) {
+
+    uint32 id;
+    uint8  slot;
+    uint8  i;
+    tagEntry_t *pEntry;
+
+    id = ((uint32)pPkt[TAG_POS_ID] << 24) | ((uint32)pPkt[TAG_POS_ID + 1] << 16) |
+         ((uint32)pPkt[TAG_POS_ID + 2] << 8) | pPkt[TAG_POS_ID + 3];
+
+    tagAggStats.updates++;
+    slot = tagHash(id);
+
+    for(i = 0; i < TAG_MAX_PROBE; i++) {
+        pEntry = &tagTable[slot];
+
+        if(!pEntry->used) {
+            tagStart(pEntry, id, pPkt, rssi, now);
+            if(++tagAggStats.used > tagAggStats.usedHighWater) {
+                tagAggStats.usedHighWater = tagAggStats.used;
+            }
+            return TRUE;
+        }
+
+        if(pEntry->id == id) {
+            // Close the window when it is over or the count would wrap
+            if(((now - pEntry->firstSeen) >= tagWindow) || (pEntry->count == 0xFFFF)) {
+                if(!tagEmit(pEntry, pfnEmit)) {
+                    break;
+                }
+                tagStart(pEntry, id, pPkt, rssi, now);
+                return TRUE;
+            }
+            pEntry->count++;
+            pEntry->rssiSum += rssi;
+            if(rssi < pEntry->rssiMin) {
+                pEntry->rssiMin = rssi;
+            }
+            if(rssi > pEntry->rssiMax) {
+                pEntry->rssiMax = rssi;
+            }
+            memcpy(pEntry->sensor, &pPkt[TAG_POS_SENSOR], TAG_SENSOR_LEN);
+            pEntry->lastSeen = now;
+            return TRUE;
+        }
+
+        slot = (slot + 1) & TAG_TABLE_MASK;
+    }
+
+    tagAggStats.passed++;
+    return FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         tagAggExpire
+*
+*   @brief      Emits and frees every entry whose window has closed. Stops
+*               early when the emit callback refuses a record, the entry is
+*               kept and retried on the next call
+*
+*   @param      now     - current time in seconds
+*   @param      pfnEmit - receives closed summaries
+*
+*   @return     number of summaries emitted
+*/
+uint8 tagAggExpire(uint32 now, tagEmit_t pfnEmit) {
+
+    uint16 i = 0;
+    uint8  n = 0;
+
+    while(i < TAG_TABLE_SIZE) {
+        if(tagTable[i].used && ((now - tagTable[i].firstSeen) >= tagWindow)) {
+            if(!tagEmit(&tagTable[i], pfnEmit)) {
+                break;
+            }
+            n++;
+
+            // The deletion may shift another entry into this slot, look again
+            tagDelete((uint8)i);
+            continue;
+        }
+        i++;
+    }
+    return n;
+}
+
+
+/*******************************************************************************
+*   @fn         tagAggSerialize
+*
+*   @brief      Writes a summary in the uplink packet layout: byte 0 holds
+*               the mean RSSI, then TagID and sensor fields as in a tag
+*               packet, followed by count, min/max RSSI and first/last seen.
+*               A window of one packet is written as that tag packet, the
+*               statistics would only repeat it at twice the size
+*
+*   @param      pSummary - summary to write
+*   @param      pOut     - output, TAG_SUMMARY_LEN bytes
+*
+*   @return     number of bytes written, TAG_PKT_LEN or TAG_SUMMARY_LEN
+*/
+uint8 tagAggSerialize(const tagSummary_t *pSummary, uint8 *pOut) {
+
+    pOut[0] = (uint8)pSummary->rssiMean;
+    pOut[TAG_POS_ID]     = BREAK_UINT32(pSummary->id, 3);
+    pOut[TAG_POS_ID + 1] = BREAK_UINT32(pSummary->id, 2);
+    pOut[TAG_POS_ID + 2] = BREAK_UINT32(pSummary->id, 1);
+    pOut[TAG_POS_ID + 3] = BREAK_UINT32(pSummary->id, 0);
+    memcpy(&pOut[TAG_POS_SENSOR], pSummary->sensor, TAG_SENSOR_LEN);
+    if(pSummary->count == 1) {
+        return TAG_PKT_LEN;
+    }
+    pOut[TAG_POS_COUNT]     = HI_UINT16(pSummary->count);
+    pOut[TAG_POS_COUNT + 1] = LO_UINT16(pSummary->count);
+    pOut[TAG_POS_RSSI_MIN]  = (uint8)pSummary->rssiMin;
+    pOut[TAG_POS_RSSI_MAX]  = (uint8)pSummary->rssiMax;
+    pOut[TAG_POS_FIRST_SEEN]     = BREAK_UINT32(pSummary->firstSeen, 3);
+    pOut[TAG_POS_FIRST_SEEN + 1] = BREAK_UINT32(pSummary->firstSeen, 2);
+    pOut[TAG_POS_FIRST_SEEN + 2] = BREAK_UINT32(pSummary->firstSeen, 1);
+    pOut[TAG_POS_FIRST_SEEN + 3] = BREAK_UINT32(pSummary->firstSeen, 0);
+    pOut[TAG_POS_LAST_SEEN]      = BREAK_UINT32(pSummary->lastSeen, 3);
+    pOut[TAG_POS_LAST_SEEN + 1]  = BREAK_UINT32(pSummary->lastSeen, 2);
+    pOut[TAG_POS_LAST_SEEN + 2]  = BREAK_UINT32(pSummary->lastSeen, 1);
+    pOut[TAG_POS_LAST_SEEN + 3]  = BREAK_UINT32(pSummary->lastSeen, 0);
+    return TAG_SUMMARY_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         tagAggGetStats
+*
+*   @brief      Returns the aggregation counters
+*
+*   @param      none
+*
+*   @return     pointer to the counters
+*/
+const tagAggStats_t *tagAggGetStats(void) {
+
+    return &tagAggStats;
+}
+
+
+/*******************************************************************************
+*   @fn         tagHash
+*
+*   @brief      Multiplicative hash of the TagID to a table slot
+*
+*   @param      id - TagID
+*
+*   @return     home slot
+*/
+static uint8 tagHash(uint32 id) {
+
+    // Masked, uint32 is wider than 32 bits on a 64-bit host
+    return (uint8)(((id * TAG_HASH_MULT) >> (32 - TAG_TABLE_BITS)) & TAG_TABLE_MASK);
+}
+
+
+/*******************************************************************************
+*   @fn         tagStart
+*
+*   @brief      Opens a new window for a tag with its first packet
+*
+*   @param      pEntry - slot to fill
+*   @param      id     - TagID
+*   @param      pPkt   - tag packet
+*   @param      rssi   - packet RSSI in dBm
+*   @param      now    - current time in seconds
+*
+*   @return     none
+*/
+static void tagStart(tagEntry_t *pEntry, uint32 id, const uint8 *pPkt, int8 rssi, uint32 now) {
+
+    pEntry->id = id;
+    pEntry->rssiSum = rssi;
+    pEntry->firstSeen = now;
+    pEntry->lastSeen = now;
+    pEntry->count = 1;
+    pEntry->rssiMin = rssi;
+    pEntry->rssiMax = rssi;
+    memcpy(pEntry->sensor, &pPkt[TAG_POS_SENSOR], TAG_SENSOR_LEN);
+    pEntry->used = TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         tagEmit
+*
+*   @brief      Builds the summary of an entry and hands it to the callback
+*
+*   @param      pEntry  - entry to summarize
+*   @param      pfnEmit - callback, may be NULL
+*
+*   @return     TRUE if the callback took the record
+*/
+static uint8 tagEmit(const tagEntry_t *pEntry, tagEmit_t pfnEmit) {
+
+    tagSummary_t summary;
+
+    summary.id = pEntry->id;
+    summary.count = pEntry->count;
+    summary.rssiMin = pEntry->rssiMin;
+    summary.rssiMax = pEntry->rssiMax;
+    summary.rssiMean = (int8)(pEntry->rssiSum / (int32)pEntry->count);
+    memcpy(summary.sensor, pEntry->sensor, TAG_SENSOR_LEN);
+    summary.firstSeen = pEntry->firstSeen;
+    summary.lastSeen = pEntry->lastSeen;
+
+    if(pfnEmit && pfnEmit(&summary)) {
+        tagAggStats.summaries++;
+        return TRUE;
+    }
+    tagAggStats.emitRefused++;
+    return FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         tagDelete
+*
+*   @brief      Frees a slot with backward-shift deletion: following entries
+*               of the probe chain move up so lookups never need tombstones
+*               and no probe distance grows
+*
+*   @param      i - slot to free
+*
+*   @return     none
+*/
+static void tagDelete(uint8 i) {
+
+    uint8 j = i;
+    uint8 home;
+
+    tagTable[i].used = FALSE;
+    tagAggStats.used--;
+
+    while(TRUE) {
+        j = (j + 1) & TAG_TABLE_MASK;
+        if(!tagTable[j].used) {
+            break;
+        }
+
+        // Entry j may fill the hole unless its home lies cyclically in (i, j]
+        home = tagHash(tagTable[j].id);
+        if(((j - home) & TAG_TABLE_MASK) >= ((j - i) & TAG_TABLE_MASK)) {
+            tagTable[i] = tagTable[j];
+            tagTable[j].used = FALSE;
+            i = j;
+        }
+    }
+}
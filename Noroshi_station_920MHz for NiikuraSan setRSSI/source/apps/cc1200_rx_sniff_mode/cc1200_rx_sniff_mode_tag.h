@@ -0,0 +1,98 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_tag.h
+//! @brief      Per-tag aggregation. Packets from the same TagID are folded
+//!             into one entry of a fixed size open-addressing table and one
+//!             summary record per tag is emitted when its window closes.
+//!             When the probed region of the table is full the packet is
+//!             left to the caller, which forwards it as it is: closing
+//!             entries early to make room would send a summary of one or
+//!             two packets in place of each raw one, a bigger uplink than
+//!             no aggregation at all. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_TAG_H
+#define CC1200_RX_SNIFF_MODE_TAG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// Tag packet layout, byte 0 is the length byte (RSSI once received)
+#define TAG_POS_ID              1       // TagID, 4 bytes big endian
+#define TAG_ID_LEN              4
+#define TAG_POS_SENSOR          (TAG_POS_ID + TAG_ID_LEN)
+#define TAG_SENSOR_LEN          8       // last sensor fields, kept verbatim
+#define TAG_PKT_LEN             (TAG_POS_SENSOR + TAG_SENSOR_LEN)
+
+// Summary record: tag packet layout followed by the window statistics
+#define TAG_POS_COUNT           TAG_PKT_LEN         // 2 bytes
+#define TAG_POS_RSSI_MIN        (TAG_POS_COUNT + 2)
+#define TAG_POS_RSSI_MAX        (TAG_POS_RSSI_MIN + 1)
+#define TAG_POS_FIRST_SEEN      (TAG_POS_RSSI_MAX + 1) // 4 bytes, seconds
+#define TAG_POS_LAST_SEEN       (TAG_POS_FIRST_SEEN + 4)
+#define TAG_SUMMARY_LEN         (TAG_POS_LAST_SEEN + 4)
+
+// 128 entries of 30 bytes, 3.75 KB of the MSP430's 16 KB RAM; 8 doubles
+// that for sites with more tags. Tags beyond what the table holds go up
+// raw, see tagAggUpdate
+#ifndef TAG_TABLE_BITS
+#define TAG_TABLE_BITS          7
+#endif
+#if TAG_TABLE_BITS > 8
+#error "TAG_TABLE_BITS above 8 does not fit the 8 bit slot index"
+#endif
+#define TAG_TABLE_SIZE          (1 << TAG_TABLE_BITS)
+#define TAG_MAX_PROBE           8       // slots searched before passing a packet on
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 id;
+    uint16 count;
+    int8   rssiMin;
+    int8   rssiMax;
+    int8   rssiMean;
+    uint8  sensor[TAG_SENSOR_LEN];
+    uint32 firstSeen;
+    uint32 lastSeen;
+} tagSummary_t;
+
+typedef struct {
+    uint32 updates;                     // packets handed to tagAggUpdate
+    uint32 summaries;                   // records accepted by the emit callback
+    uint32 passed;                      // packets left to the caller
+    uint32 emitRefused;                 // records the emit callback refused, kept
+    uint16 used;                        // occupied entries
+    uint16 usedHighWater;
+} tagAggStats_t;
+
+// Returns TRUE if the record was taken, FALSE if it has to be dropped or retried
+typedef uint8 (*tagEmit_t)(const tagSummary_t *pSummary);
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void tagAggInit(uint16 window);
+uint8 tagAggUpdate(const uint8 *pPkt, int8 rssi, uint32 now, tagEmit_t pfnEmit);
+uint8 tagAggExpire(uint32 now, tagEmit_t pfnEmit);
+uint8 tagAggSerialize(const tagSummary_t *pSummary, uint8 *pOut);
+const tagAggStats_t *tagAggGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,429 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_tdma.c
+//! @brief      Time slots for relay traffic, see cc1200_rx_sniff_mode_tdma.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_tdma.h"
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static uint8 tdmaMyId;
+static uint8 tdmaOwner[TDMA_SLOTS];
+static uint8 tdmaVersion;
+
+// Current superframe: time on air, longest wait, transmissions
+static uint8 tdmaSfValid;
+static signed long long tdmaSf;
+static uint32 tdmaSfAir;                // 1/32768 s
+static uint32 tdmaSfLatency;            // 1/32768 s
+static uint8 tdmaSfFrames;
+static uint8 tdmaWaiting;               // traffic waits for the slot
+static signed long long tdmaWaitStart;
+
+// Superframes since the last status record
+static uint8 tdmaWinCount;
+static uint32 tdmaWinUtilSum;
+static uint16 tdmaWinUtilMax;
+static uint16 tdmaWinLatencyMax;
+static uint8 tdmaWinSlots;
+static uint8 tdmaWinFrames;
+
+static tdmaStats_t tdmaStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void tdmaClose(signed long long sfEnd);
+static uint16 tdmaToMs(uint32 frac);
+
+
+/*******************************************************************************
+*   @fn         tdmaInit
+*
+*   @brief      Sets the default slot map, slot n to station n, and clears
+*               the measurements
+*
+*   @param      myId - this station's ID
+*
+*   @return     none
+*/
+void tdmaInit(uint8 myId) {
+
+    uint8 i;
+
+    tdmaMyId = myId;
+    for(i = 0; i < TDMA_SLOTS; i++) {
+        tdmaOwner[i] = i;
+    }
+    tdmaOwner[TDMA_MASTER_SLOT] = SYNC_MASTER_ID;
+    tdmaVersion = 0;
+
+    tdmaSfValid = FALSE;
+    tdmaSfAir = 0;
+    tdmaSfLatency = 0;
+    tdmaSfFrames = 0;
+    tdmaWaiting = FALSE;
+    tdmaWinCount = 0;
+    tdmaWinUtilSum = 0;
+    tdmaWinUtilMax = 0;
+    tdmaWinLatencyMax = 0;
+    tdmaWinSlots = 0;
+    tdmaWinFrames = 0;
+    memset(&tdmaStats, 0, sizeof(tdmaStats));
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaSetMap
+*
+*   @brief      Master: takes a slot map from the gateway. Slot 0 stays the
+*               master's. A changed map gets a new version, which the slaves
+*               take over from the next beacon
+*
+*   @param      pOwners - station ID per slot, TDMA_OWNER_NONE for a free slot
+*   @param      len     - bytes in pOwners, must be TDMA_SLOTS
+*
+*   @return     TRUE if the map changed
+*/
+uint8 tdmaSetMap(const uint8 *pOwners, uint8 len) {
+
+    uint8 owners[TDMA_SLOTS];
+
+    if(len != TDMA_SLOTS) {
+        return FALSE;
+    }
+    memcpy(owners, pOwners, TDMA_SLOTS);
+    owners[TDMA_MASTER_SLOT] = SYNC_MASTER_ID;
+    if(memcmp(owners, tdmaOwner, TDMA_SLOTS) == 0) {
+        return FALSE;
+    }
+
+    memcpy(tdmaOwner, owners, TDMA_SLOTS);
+    tdmaVersion++;
+    tdmaStats.version = tdmaVersion;
+    tdmaStats.mapUpdates++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaGetMap
+*
+*   @brief      Master: writes the slot map for the beacon
+*
+*   @param      pOut - output, TDMA_MAP_LEN bytes
+*
+*   @return     TDMA_MAP_LEN
+*/
+uint8 tdmaGetMap(uint8 *pOut) {
+
+    pOut[0] = tdmaVersion;
+    memcpy(&pOut[1], tdmaOwner, TDMA_SLOTS);
+    return TDMA_MAP_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaApplyMap
+*
+*   @brief      Slave: takes over the master's slot map from a beacon when
+*               its version differs from the one in use
+*
+*   @param      pMap - slot map written by tdmaGetMap
+*   @param      len  - bytes in pMap
+*
+*   @return     TRUE if the map changed
+*/
+uint8 tdmaApplyMap(const uint8 *pMap, uint8 len) {
+
+    if((len != TDMA_MAP_LEN) || (pMap[0] == tdmaVersion)) {
+        return FALSE;
+    }
+
+    tdmaVersion = pMap[0];
+    memcpy(tdmaOwner, &pMap[1], TDMA_SLOTS);
+    tdmaOwner[TDMA_MASTER_SLOT] = SYNC_MASTER_ID;
+    tdmaStats.version = tdmaVersion;
+    tdmaStats.mapUpdates++;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaTxOpen
+*
+*   @brief      Checks whether a transmission may start now: the current slot
+*               is this station's, past the guard and with room for the
+*               longest exchange
+*
+*   @param      pNow - master time (timeToUtc)
+*
+*   @return     TRUE if the station may transmit
+*/
+uint8 tdmaTxOpen(const timeStamp_t *pNow) {
+
+    signed long long t = timeToFrac(pNow);
+    uint32 offset;
+    uint16 inSlot;
+
+    offset = (uint32)(t % TDMA_SUPERFRAME_FRAC);
+    inSlot = (uint16)(offset % TDMA_SLOT_FRAC);
+    return (tdmaOwner[offset / TDMA_SLOT_FRAC] == tdmaMyId) &&
+           (inSlot >= TDMA_GUARD_FRAC) &&
+           (inSlot <= TDMA_SLOT_FRAC - TDMA_TX_FRAC);
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaNextOpen
+*
+*   @brief      Finds the next time a transmission may start, the end of
+*               the guard of this station's next slot
+*
+*   @param      pNow   - master time (timeToUtc)
+*   @param      pStart - output, master time
+*
+*   @return     TRUE if found, FALSE if the station owns no slot
+*/
+uint8 tdmaNextOpen(const timeStamp_t *pNow, timeStamp_t *pStart) {
+
+    signed long long t = timeToFrac(pNow);
+    signed long long slot;
+    signed long long start;
+    uint8 i;
+
+    slot = t / TDMA_SLOT_FRAC;
+    for(i = 0; i <= TDMA_SLOTS; i++, slot++) {
+        start = slot * TDMA_SLOT_FRAC + TDMA_GUARD_FRAC;
+        if((tdmaOwner[(uint8)(slot % TDMA_SLOTS)] == tdmaMyId) && (start > t)) {
+            pStart->sec = (uint32)(start >> TIME_FRAC_BITS);
+            pStart->frac = (uint16)(start & TIME_FRAC_BM);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaWait
+*
+*   @brief      Traffic is ready to go. The wait for the slot starts with the
+*               first call and ends with the next tdmaTxDone for traffic
+*
+*   @param      pNow - master time (timeToUtc)
+*
+*   @return     none
+*/
+void tdmaWait(const timeStamp_t *pNow) {
+
+    if(!tdmaWaiting) {
+        tdmaWaitStart = timeToFrac(pNow);
+        tdmaWaiting = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaTxDone
+*
+*   @brief      A transmission started in the slot is over. Its time on air,
+*               ACK wait included, is added to the superframe
+*
+*   @param      pStart  - master time at the start
+*   @param      pEnd    - master time at the end
+*   @param      traffic - TRUE for a relay frame, ends the wait
+*
+*   @return     none
+*/
+void tdmaTxDone(const timeStamp_t *pStart, const timeStamp_t *pEnd, uint8 traffic) {
+
+    signed long long start = timeToFrac(pStart);
+    signed long long d;
+
+    d = timeToFrac(pEnd) - start;
+    if((d > 0) && (d < (signed long long)TDMA_SUPERFRAME_FRAC)) {
+        tdmaSfAir += (uint32)d;
+    }
+    tdmaSfFrames++;
+    tdmaStats.frames++;
+
+    if(traffic && tdmaWaiting) {
+        d = start - tdmaWaitStart;
+        if((d > 0) && ((uint32)d > tdmaSfLatency)) {
+            tdmaSfLatency = (uint32)d;
+        }
+        tdmaWaiting = FALSE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaTick
+*
+*   @brief      Closes the superframe once the master time has moved on. A
+*               frame still waiting counts with its wait so far. After
+*               TDMA_REPORT_SF superframes a status record is due. A step of
+*               the clock back restarts the superframe
+*
+*   @param      pNow - master time (timeToUtc)
+*
+*   @return     TRUE if tdmaBuildStatus should be called
+*/
+uint8 tdmaTick(const timeStamp_t *pNow) {
+
+    signed long long sf = timeToFrac(pNow) / TDMA_SUPERFRAME_FRAC;
+
+    if(!tdmaSfValid || (sf < tdmaSf)) {
+        tdmaSf = sf;
+        tdmaSfValid = TRUE;
+        return FALSE;
+    }
+    if(sf == tdmaSf) {
+        return FALSE;
+    }
+
+    tdmaClose((tdmaSf + 1) * TDMA_SUPERFRAME_FRAC);
+    tdmaStats.superframes += (uint32)(sf - tdmaSf - 1);
+    tdmaSf = sf;
+    return tdmaWinCount >= TDMA_REPORT_SF;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaBuildStatus
+*
+*   @brief      Writes the status record over the superframes since the last
+*               one: mean and peak utilization, longest wait for the slot,
+*               superframes with a transmission and transmissions
+*
+*   @param      pOut - output, TDMA_STATUS_LEN bytes
+*
+*   @return     TDMA_STATUS_LEN
+*/
+uint8 tdmaBuildStatus(uint8 *pOut) {
+
+    uint16 avg = 0;
+
+    if(tdmaWinCount > 0) {
+        avg = (uint16)(tdmaWinUtilSum / tdmaWinCount);
+    }
+
+    pOut[0] = TDMA_STATUS_LEN - 1;
+    pOut[TDMA_POS_TYPE] = TDMA_TYPE_STATUS;
+    pOut[TDMA_POS_SRC] = tdmaMyId;
+    pOut[TDMA_POS_UTIL_AVG] = HI_UINT16(avg);
+    pOut[TDMA_POS_UTIL_AVG + 1] = LO_UINT16(avg);
+    pOut[TDMA_POS_UTIL_MAX] = HI_UINT16(tdmaWinUtilMax);
+    pOut[TDMA_POS_UTIL_MAX + 1] = LO_UINT16(tdmaWinUtilMax);
+    pOut[TDMA_POS_LATENCY_MAX] = HI_UINT16(tdmaWinLatencyMax);
+    pOut[TDMA_POS_LATENCY_MAX + 1] = LO_UINT16(tdmaWinLatencyMax);
+    pOut[TDMA_POS_SLOTS_USED] = tdmaWinSlots;
+    pOut[TDMA_POS_FRAMES] = tdmaWinFrames;
+
+    tdmaWinCount = 0;
+    tdmaWinUtilSum = 0;
+    tdmaWinUtilMax = 0;
+    tdmaWinLatencyMax = 0;
+    tdmaWinSlots = 0;
+    tdmaWinFrames = 0;
+    return TDMA_STATUS_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaGetStats
+*
+*   @brief      Returns the TDMA counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const tdmaStats_t *tdmaGetStats(void) {
+
+    return &tdmaStats;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaClose
+*
+*   @brief      Moves the measurements of the current superframe into the
+*               statistics and the status window
+*
+*   @param      sfEnd - master time at the end of the superframe, 1/32768 s
+*
+*   @return     none
+*/
+static void tdmaClose(signed long long sfEnd) {
+
+    uint16 util;
+    uint16 latency;
+
+    if(tdmaWaiting && (sfEnd - tdmaWaitStart > (signed long long)tdmaSfLatency)) {
+        tdmaSfLatency = (uint32)(sfEnd - tdmaWaitStart);
+    }
+
+    util = (uint16)((tdmaSfAir * 1000ULL) / TDMA_SUPERFRAME_FRAC);
+    latency = tdmaToMs(tdmaSfLatency);
+
+    tdmaStats.superframes++;
+    tdmaStats.utilLast = util;
+    tdmaStats.latencyLastMs = latency;
+    if(util > tdmaStats.utilMax) {
+        tdmaStats.utilMax = util;
+    }
+    if(latency > tdmaStats.latencyMaxMs) {
+        tdmaStats.latencyMaxMs = latency;
+    }
+    if(tdmaSfFrames > 0) {
+        tdmaStats.slotsUsed++;
+    }
+
+    tdmaWinUtilSum += util;
+    if(util > tdmaWinUtilMax) {
+        tdmaWinUtilMax = util;
+    }
+    if(latency > tdmaWinLatencyMax) {
+        tdmaWinLatencyMax = latency;
+    }
+    if((tdmaSfFrames > 0) && (tdmaWinSlots < 0xFF)) {
+        tdmaWinSlots++;
+    }
+    tdmaWinFrames = ((uint16)tdmaWinFrames + tdmaSfFrames > 0xFF) ?
+                    0xFF : tdmaWinFrames + tdmaSfFrames;
+    if(tdmaWinCount < 0xFF) {
+        tdmaWinCount++;
+    }
+
+    tdmaSfAir = 0;
+    tdmaSfLatency = 0;
+    tdmaSfFrames = 0;
+}
+
+
+/*******************************************************************************
+*   @fn         tdmaToMs
+*
+*   @brief      Fractions to ms, saturated at 0xFFFF
+*
+*   @param      frac - 1/32768 s
+*
+*   @return     ms
+*/
+static uint16 tdmaToMs(uint32 frac) {
+
+    uint32 ms = (uint32)(((unsigned long long)frac * 1000) >> TIME_FRAC_BITS);
+
+    return (ms > 0xFFFF) ? 0xFFFF : (uint16)ms;
+}
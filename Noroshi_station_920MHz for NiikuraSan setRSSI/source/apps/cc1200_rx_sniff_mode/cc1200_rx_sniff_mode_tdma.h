@@ -0,0 +1,123 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_tdma.h
+//! @brief      Time slots for relay traffic. On the master's clock (see
+//!             cc1200_rx_sniff_mode_sync.h) time is cut into superframes of
+//!             TDMA_SLOTS slots and each slot belongs to one station ID. A
+//!             station starts a transmission only inside its own slot, after
+//!             a guard for the sync error and early enough that the longest
+//!             exchange (wake-up preamble, frame, ACK wait) ends in the slot.
+//!             Slot 0 belongs to the master and carries its beacons. The
+//!             gateway sets the slot map at the master, which passes it on
+//!             in its beacons. Per superframe the station measures its time
+//!             on air and the longest wait of a frame for its slot. Decides
+//!             only, the caller drives the radio. Builds under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_TDMA_H
+#define CC1200_RX_SNIFF_MODE_TDMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+#include "cc1200_rx_sniff_mode_time.h"
+#include "cc1200_rx_sniff_mode_sync.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// TDMA_ENABLE = 1 sends relay frames and beacons only in the own slot.
+// Needs SYNC_ENABLE
+#ifndef TDMA_ENABLE
+#define TDMA_ENABLE             0
+#endif
+#if TDMA_ENABLE && !SYNC_ENABLE
+#error "TDMA needs the synchronized clock, set SYNC_ENABLE"
+#endif
+
+// Slots of 1/32768 s. The default superframe of 8 x 125 ms is 1 s
+#ifndef TDMA_SLOTS
+#define TDMA_SLOTS              8
+#endif
+#ifndef TDMA_SLOT_FRAC
+#define TDMA_SLOT_FRAC          4096
+#endif
+#define TDMA_SUPERFRAME_FRAC    ((uint32)TDMA_SLOTS * TDMA_SLOT_FRAC)
+
+// No transmission in the first TDMA_GUARD_FRAC of a slot, ~1 ms for the
+// sync error and the wake-up. The last start leaves TDMA_TX_FRAC for the
+// longest exchange: 16 ms preamble, 30 ms for the frame to go out, 20 ms
+// for the ACK. rx.c checks it against its timeouts
+#define TDMA_GUARD_FRAC         33
+#define TDMA_TX_FRAC            2294    // 70 ms
+#if TDMA_GUARD_FRAC + TDMA_TX_FRAC > TDMA_SLOT_FRAC
+#error "TDMA slot too short for one relay exchange"
+#endif
+
+#define TDMA_MASTER_SLOT        0       // always SYNC_MASTER_ID
+#define TDMA_OWNER_NONE         0xFF    // nobody sends in the slot
+
+// Slot map as carried in the beacon extra and in the gateway command:
+// version, then the owner of each slot
+#define TDMA_MAP_LEN            (1 + TDMA_SLOTS)
+#if TDMA_MAP_LEN > SYNC_EXTRA_MAX
+#error "TDMA slot map does not fit a beacon"
+#endif
+
+// Status record for the uplink, every TDMA_REPORT_SF superframes. UTIL is
+// the time on air in permille of a superframe, LATENCY the longest wait
+// of a frame for its slot in ms
+#define TDMA_REPORT_SF          16
+#define TDMA_TYPE_STATUS        0xB7
+#define TDMA_POS_TYPE           1
+#define TDMA_POS_SRC            2
+#define TDMA_POS_UTIL_AVG       3       // 2 bytes big endian
+#define TDMA_POS_UTIL_MAX       5       // 2 bytes big endian
+#define TDMA_POS_LATENCY_MAX    7       // 2 bytes big endian
+#define TDMA_POS_SLOTS_USED     9
+#define TDMA_POS_FRAMES         10
+#define TDMA_STATUS_LEN         11
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 superframes;
+    uint32 slotsUsed;                   // superframes with a transmission
+    uint32 frames;                      // transmissions started in the slot
+    uint32 mapUpdates;                  // slot maps taken over
+    uint16 utilLast;                    // permille, last superframe
+    uint16 utilMax;
+    uint16 latencyLastMs;               // longest wait, last superframe
+    uint16 latencyMaxMs;
+    uint8  version;                     // of the slot map in use
+} tdmaStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void tdmaInit(uint8 myId);
+uint8 tdmaSetMap(const uint8 *pOwners, uint8 len);
+uint8 tdmaGetMap(uint8 *pOut);
+uint8 tdmaApplyMap(const uint8 *pMap, uint8 len);
+uint8 tdmaTxOpen(const timeStamp_t *pNow);
+uint8 tdmaNextOpen(const timeStamp_t *pNow, timeStamp_t *pStart);
+void tdmaWait(const timeStamp_t *pNow);
+void tdmaTxDone(const timeStamp_t *pStart, const timeStamp_t *pEnd, uint8 traffic);
+uint8 tdmaTick(const timeStamp_t *pNow);
+uint8 tdmaBuildStatus(uint8 *pOut);
+const tdmaStats_t *tdmaGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
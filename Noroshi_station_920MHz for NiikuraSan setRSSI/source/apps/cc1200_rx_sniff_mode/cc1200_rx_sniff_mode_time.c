@@ -0,0 +1,275 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_time.c
+//! @brief      Packet timestamps, see cc1200_rx_sniff_mode_time.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_time.h"
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+// UTC = refUtc + d + d * skew, d = local - refLocal, in 1/32768 s
+static signed long long timeRefLocal;
+static signed long long timeRefUtc;
+static int32 timeSkew;
+static uint8 timeEpochValid;
+static uint8 timeNoEpoch;               // refUtc is the master's uptime
+static timeStats_t timeStats;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static signed long long timeMap(signed long long local);
+
+
+/*******************************************************************************
+*   @fn         timeInit
+*
+*   @brief      Forgets the UTC time, stamps are local until the gateway
+*               sends it
+*
+*   @param      none
+*
+*   @return     none
+*/
+void timeInit(void) {
+
+    timeRefLocal = 0;
+    timeRefUtc = 0;
+    timeSkew = 0;
+    timeEpochValid = FALSE;
+    timeNoEpoch = FALSE;
+    memset(&timeStats, 0, sizeof(timeStats));
+}
+
+
+/*******************************************************************************
+*   @fn         timeSetEpoch
+*
+*   @brief      Sets the UTC time. The offset is kept in fractions, so the
+*               sub-second phase of the gateway's time is taken over as well
+*
+*   @param      pUtc   - UTC time sent by the gateway
+*   @param      pLocal - local time when it arrived
+*
+*   @return     none
+*/
+void timeSetEpoch(const timeStamp_t *pUtc, const timeStamp_t *pLocal) {
+
+    timeSetModel(pLocal, pUtc, 0);
+    timeStats.epochSets++;
+}
+
+
+/*******************************************************************************
+*   @fn         timeSetModel
+*
+*   @brief      Sets the UTC time and the rate error of the local clock. A
+*               reference UTC time with TIME_FRAC_NO_EPOCH set is another
+*               station's uptime, stamps then keep the flag
+*
+*   @param      pRefLocal - local time of the reference point
+*   @param      pRefUtc   - UTC time at that point
+*   @param      skew      - (UTC rate / local rate) - 1, TIME_SKEW_BITS fixed point
+*
+*   @return     none
+*/
+void timeSetModel(const timeStamp_t *pRefLocal, const timeStamp_t *pRefUtc, int32 skew) {
+
+    timeStamp_t before;
+
+    if(timeEpochValid) {
+        timeToUtc(pRefLocal, &before);
+        timeStats.lastStep = (int32)(timeToFrac(pRefUtc) - timeToFrac(&before));
+    } else {
+        timeStats.lastStep = 0;
+    }
+
+    timeRefLocal = timeToFrac(pRefLocal);
+    timeRefUtc = timeToFrac(pRefUtc);
+    timeSkew = skew;
+    timeNoEpoch = (pRefUtc->frac & TIME_FRAC_NO_EPOCH) != 0;
+    timeEpochValid = TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         timeHasEpoch
+*
+*   @brief      Checks whether the gateway has sent the UTC time
+*
+*   @param      none
+*
+*   @return     TRUE if stamps are UTC
+*/
+uint8 timeHasEpoch(void) {
+
+    return timeEpochValid && !timeNoEpoch;
+}
+
+
+/*******************************************************************************
+*   @fn         timeToUtc
+*
+*   @brief      Converts a local stamp to UTC. Without the UTC time the
+*               local stamp is returned with TIME_FRAC_NO_EPOCH set, so is a
+*               stamp on the uptime of a master without UTC
+*
+*   @param      pLocal - seconds since start-up and Timer A0 count
+*   @param      pUtc   - output, may be pLocal
+*
+*   @return     none
+*/
+void timeToUtc(const timeStamp_t *pLocal, timeStamp_t *pUtc) {
+
+    unsigned long long t;
+
+    if(!timeEpochValid) {
+        pUtc->sec = pLocal->sec;
+        pUtc->frac = (pLocal->frac & TIME_FRAC_BM) | TIME_FRAC_NO_EPOCH;
+        return;
+    }
+
+    t = (unsigned long long)timeMap(timeToFrac(pLocal));
+    pUtc->sec = (uint32)(t >> TIME_FRAC_BITS);
+    pUtc->frac = (uint16)(t & TIME_FRAC_BM);
+    if(timeNoEpoch) {
+        pUtc->frac |= TIME_FRAC_NO_EPOCH;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         timeFromUtc
+*
+*   @brief      Converts a UTC time back to the local clock: the first local
+*               tick timeToUtc puts at or after it, so a wake-up set from it
+*               is never early. Without the UTC time the stamp is taken as
+*               local already
+*
+*   @param      pUtc   - UTC time, flags ignored
+*   @param      pLocal - output, may be pUtc
+*
+*   @return     none
+*/
+void timeFromUtc(const timeStamp_t *pUtc, timeStamp_t *pLocal) {
+
+    signed long long utc;
+    signed long long d;
+    signed long long t;
+
+    if(!timeEpochValid) {
+        pLocal->sec = pUtc->sec;
+        pLocal->frac = pUtc->frac & TIME_FRAC_BM;
+        return;
+    }
+
+    // First order of the skew, then a tick or two to undo the rounding
+    utc = timeToFrac(pUtc);
+    d = utc - timeRefUtc;
+    t = timeRefLocal + d - ((d * timeSkew) >> TIME_SKEW_BITS);
+    while(timeMap(t) < utc) {
+        t++;
+    }
+    while(timeMap(t - 1) >= utc) {
+        t--;
+    }
+    pLocal->sec = (uint32)(t >> TIME_FRAC_BITS);
+    pLocal->frac = (uint16)(t & TIME_FRAC_BM);
+}
+
+
+/*******************************************************************************
+*   @fn         timeSerialize
+*
+*   @brief      Writes a stamp in the uplink format
+*
+*   @param      pStamp - stamp
+*   @param      pOut   - output, TIME_STAMP_LEN bytes
+*
+*   @return     TIME_STAMP_LEN
+*/
+uint8 timeSerialize(const timeStamp_t *pStamp, uint8 *pOut) {
+
+    pOut[0] = (uint8)(pStamp->sec >> 24);
+    pOut[1] = (uint8)(pStamp->sec >> 16);
+    pOut[2] = (uint8)(pStamp->sec >> 8);
+    pOut[3] = (uint8)pStamp->sec;
+    pOut[4] = HI_UINT16(pStamp->frac);
+    pOut[5] = LO_UINT16(pStamp->frac);
+    return TIME_STAMP_LEN;
+}
+
+
+/*******************************************************************************
+*   @fn         timeParse
+*
+*   @brief      Reads a stamp written by timeSerialize
+*
+*   @param      pIn    - TIME_STAMP_LEN bytes
+*   @param      pStamp - output
+*
+*   @return     none
+*/
+void timeParse(const uint8 *pIn, timeStamp_t *pStamp) {
+
+    pStamp->sec = ((uint32)pIn[0] << 24) | ((uint32)pIn[1] << 16) |
+                  ((uint32)pIn[2] << 8) | pIn[3];
+    pStamp->frac = BUILD_UINT16(pIn[5], pIn[4]);
+}
+
+
+/*******************************************************************************
+*   @fn         timeGetStats
+*
+*   @brief      Returns the epoch counters
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const timeStats_t *timeGetStats(void) {
+
+    return &timeStats;
+}
+
+
+/*******************************************************************************
+*   @fn         timeToFrac
+*
+*   @brief      Stamp as one count of 1/32768 s, flags dropped, for
+*               differences and ordering of stamps
+*
+*   @param      pStamp - stamp
+*
+*   @return     fractions
+*/
+signed long long timeToFrac(const timeStamp_t *pStamp) {
+
+    return ((signed long long)pStamp->sec << TIME_FRAC_BITS) + (pStamp->frac & TIME_FRAC_BM);
+}
+
+
+/*******************************************************************************
+*   @fn         timeMap
+*
+*   @brief      Local time to UTC by the current model
+*
+*   @param      local - 1/32768 s
+*
+*   @return     UTC, 1/32768 s
+*/
+static signed long long timeMap(signed long long local) {
+
+    signed long long d = local - timeRefLocal;
+
+    return timeRefUtc + d + ((d * timeSkew) >> TIME_SKEW_BITS);
+}
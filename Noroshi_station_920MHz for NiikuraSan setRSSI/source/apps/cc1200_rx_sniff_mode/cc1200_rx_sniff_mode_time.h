@@ -0,0 +1,74 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_time.h
+//! @brief      Packet timestamps. The station clock counts seconds since
+//!             start-up and fractions of 1/32768 s, the Timer A0 count within
+//!             the second. Once the gateway has sent the UTC time, local
+//!             stamps are moved onto UTC by a fixed offset, before that they
+//!             are passed on with TIME_FRAC_NO_EPOCH set. A station that
+//!             follows the master's time beacons replaces the offset by the
+//!             offset and skew fitted in cc1200_rx_sniff_mode_sync.c. Builds
+//!             under gcc on Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_TIME_H
+#define CC1200_RX_SNIFF_MODE_TIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+#define TIME_FRAC_HZ            32768   // ACLK, Timer A0 counts per second
+#define TIME_FRAC_BITS          15
+#define TIME_FRAC_BM            0x7FFF
+#define TIME_FRAC_NO_EPOCH      0x8000  // frac flag, sec is local uptime
+
+// Serialized stamp: seconds (4 bytes) and fraction (2 bytes), big endian
+#define TIME_STAMP_LEN          6
+
+// Skew of the local clock, fixed point: 1 << TIME_SKEW_BITS is a rate error of 1
+#define TIME_SKEW_BITS          30
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 sec;
+    uint16 frac;                        // 1/TIME_FRAC_HZ s, plus flags
+} timeStamp_t;
+
+typedef struct {
+    uint32 epochSets;                   // UTC times accepted from the gateway
+    int32  lastStep;                    // correction at the last update, 1/32768 s
+} timeStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void timeInit(void);
+void timeSetEpoch(const timeStamp_t *pUtc, const timeStamp_t *pLocal);
+void timeSetModel(const timeStamp_t *pRefLocal, const timeStamp_t *pRefUtc, int32 skew);
+uint8 timeHasEpoch(void);
+void timeToUtc(const timeStamp_t *pLocal, timeStamp_t *pUtc);
+void timeFromUtc(const timeStamp_t *pUtc, timeStamp_t *pLocal);
+uint8 timeSerialize(const timeStamp_t *pStamp, uint8 *pOut);
+void timeParse(const uint8 *pIn, timeStamp_t *pStamp);
+const timeStats_t *timeGetStats(void);
+signed long long timeToFrac(const timeStamp_t *pStamp);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -51,7 +51,10 @@
 #include "bsp_key.h"
 #include "io_pin_int.h"
 #include "bsp_led.h"
-#include "cc1200_rx_sniff_mode_reg_config.h"
+#include "cc1200_rx_sniff_mode_phy.h"
+#include "cc1200_rx_sniff_mode_csma.h"
+#include "cc1200_rx_sniff_mode_fifo.h"
+#include "cc1200_rx_sniff_mode_crc.h"
 
 
 /*******************************************************************************
@@ -59,19 +62,82 @@
 */
 #define ISR_ACTION_REQUIRED     1
 #define ISR_IDLE                0
-#define PKTLEN                  30 // 1 < PKTLEN < 126
+// Station frames, the longest packet the receiver takes, see
+// cc1200_rx_sniff_mode_fifo.h. Sealed with their CRC-16 for receivers
+// built with RX_FIFO_FRAME_CRC
+#define PKTLEN                  (RX_FIFO_STATION_LEN - 1)  // length byte not counted
+#if (PKTLEN + 1 != RX_FIFO_STATION_LEN) || (PKTLEN < 3) || (PKTLEN > 125)
+#error "TX packets must be station frames of RX_FIFO_STATION_LEN bytes"
+#endif
 
 #define GPIO3                   0x04
 #define GPIO2                   0x08
 #define GPIO0                   0x80
 
+#define MARC_STATE_BM           0x1F
+#define MARC_STATE_IDLE         0x41
+#define MARC_STATE_TX           0x13
+#define MARC_STATE_TX_END       0x14
+#define MARC_STATE_RXTX_SWITCH  0x15
+
+// Clear channel assessment: PKT_CFG2.CCA_MODE = 001, STX only enters TX
+// while RSSI is below AGC_CS_THR, otherwise the radio stays in RX
+#define PKT_CFG2_CCA_MODE_BM    0x1C
+#define PKT_CFG2_CCA_RSSI_THR   0x04
+#define RNDGEN_EN               0x80
+#define RSSI_OFFSET             84      // as the receiver, see RX source
+#ifndef CCA_THR_DBM
+#define CCA_THR_DBM             -80     // ARIB STD-T108 carrier sense level
+#endif
+#ifndef CCA_SENSE_US
+#define CCA_SENSE_US            128     // listen time once RSSI is valid
+#endif
+#define CCA_RSSI_POLLS          50      // RSSI0 reads before giving up
+#define CCA_TX_POLLS            20      // MARCSTATE reads for the RX-TX turn
+#define CYCLES_PER_US           8       // MCLK 8 MHz
+
+// Latest start of a queued packet, it is dropped afterwards
+#define TX_DEADLINE_TICKS       (CSMA_TICK_HZ / 2)
+
+// RFEND_CFG0.TXOFF_MODE, the state after a packet. TX keeps the radio on
+// air, sending preamble until the next packet is in the TX FIFO
+#define RFEND_CFG0_TXOFF_BM     0x30
+#define RFEND_CFG0_TXOFF_IDLE   0x00
+#define RFEND_CFG0_TXOFF_TX     0x20
+#define IOCFG_PKT_SYNC_RXTX     0x06    // falls at the end of each packet
+
+// Packets sent back to back after one clear channel assessment. 16 packets
+// of PKTLEN bytes take ~55 ms at 100 kbps, well inside the ARIB STD-T108
+// limit on one transmission
+#ifndef TX_BURST_MAX
+#define TX_BURST_MAX            16
+#endif
+#define TX_FIFO_AHEAD           2       // packet on air plus one preloaded
+#define TX_DONE_TIMEOUT_TICKS   (CSMA_TICK_HZ / 20)     // 50 ms without GPIO0
+
 
 /*******************************************************************************
 * LOCAL VARIABLES
 */
-static uint8  packetSemaphore;
 static uint32 packetCounter = 0;
 
+// Back-to-back transmission, see runTX
+static volatile uint8 txDoneCount;      // packets finished, from radioTxISR
+static uint8  txOnAir;                  // packets in the TX FIFO or on air
+static uint8  txBurstLen;               // packets started in this burst
+static uint8  txChained;                // TXOFF_MODE = TX
+static uint8  txHeld;                   // TXOFF_MODE was TX in this burst
+static uint8  txStream;                 // SELECT: keep the queue full
+static uint16 txLastDone;               // ticks, last progress of the burst
+
+// Throughput, packets completed per second
+static uint32 txSent;
+static uint32 txBursts;
+static uint32 txWindowSent;
+static uint16 txWindowStart;
+static uint16 txPps;
+static uint8  txLcdDirty;
+
 
 /*******************************************************************************
 * STATIC FUNCTIONS
@@ -79,6 +145,17 @@ static uint32 packetCounter = 0;
 static void initMCU(void);
 static void registerConfig(void);
 static void runTX(void);
+static void initCca(void);
+static uint8 txCcaStart(uint8 *pPkt, uint8 len);
+static void txQueuePacket(uint16 now);
+static void txBurstStart(uint16 now);
+static void txBurstTask(uint16 now);
+static void txBurstEnd(void);
+static void txSetOffMode(uint8 mode);
+static void txSleep(void);
+static void txRateTask(uint16 now);
+static void initTickTimer(void);
+static uint16 getTicks(void);
 static void createPacket(uint8 randBuffer[]);
 static void radioTxISR(void);
 static void updateLcd(void);
@@ -110,9 +187,15 @@ void main(void) {
 /*******************************************************************************
 *   @fn         runTX
 *
-*   @brief      Transmits a packet every time a button is pushed. A packet
-*               counter is incremented for each packet sent and the LCD is
-*               updated
+*   @brief      Queues a packet every time a button is pushed, SELECT toggles
+*               a stream that keeps the queue full. After the CSMA backoff
+*               and a clear channel assessment, see
+*               cc1200_rx_sniff_mode_csma.h, the queued packets are sent
+*               back to back: while one packet is on air the next one is
+*               preloaded into the TX FIFO, and the end of each packet on
+*               GPIO0 wakes the loop to load the following one. The LCD
+*               shows the packets sent and the packets per second, it is
+*               redrawn at most once a second between bursts
 *
 *   @param      none
 *
@@ -121,9 +204,8 @@ void main(void) {
 static void runTX(void) {
 
     static uint8 marcState;
-
-    // Initialize packet buffer of size PKTLEN + 1
-    uint8 txBuffer[PKTLEN + 1];
+    uint8 temp;
+    uint8 key;
 
     // Connect ISR function to GPIO0
     ioPinIntRegister(IO_PIN_PORT_1, GPIO0, &radioTxISR);
@@ -137,6 +219,10 @@ static void runTX(void) {
     // Enable interrupt
     ioPinIntEnable(IO_PIN_PORT_1, GPIO0);
 
+    // Not every PHY profile sets GPIO0, the bursts count its edges
+    temp = IOCFG_PKT_SYNC_RXTX;
+    cc120xSpiWriteReg(CC120X_IOCFG0, &temp, 1);
+
     // Update LCD
     updateLcd();
 
@@ -146,40 +232,421 @@ static void runTX(void) {
     // Wait for calibration to be done (radio back in IDLE state)
     do {
         cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
-    } while (marcState != 0x41);
+    } while (marcState != MARC_STATE_IDLE);
+
+    // Scheduler time base and carrier sense
+    initTickTimer();
+    initCca();
+    txWindowStart = getTicks();
 
     // Infinite loop
     while(TRUE) {
 
-        // Wait for button push
-        while(!bspKeyPushed(BSP_KEY_ALL));
+        // Queue a packet on button push. Keys are polled, only between
+        // bursts does the debounce wait matter
+        key = bspKeyPushed(BSP_KEY_ALL);
+        if(key == BSP_KEY_SELECT) {
+            txStream = !txStream;
+            txLcdDirty = TRUE;
+        } else if(key) {
+            txQueuePacket(getTicks());
+        }
+        while(txStream && (csmaQueueCount() < CSMA_QUEUE_SLOTS)) {
+            txQueuePacket(getTicks());
+        }
+
+        if(txOnAir > 0) {
+            // Count finished packets and preload the next, then sleep until
+            // the radio ends a packet
+            txBurstTask(getTicks());
+            if(txOnAir > 0) {
+                txSleep();
+            }
+        } else if(csmaDue(getTicks())) {
+            // Assess the channel and start a burst with the most urgent packet
+            txBurstStart(getTicks());
+        }
+
+        txRateTask(getTicks());
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         txQueuePacket
+*
+*   @brief      Creates a packet and hands it to the CSMA scheduler
+*
+*   @param      now - ticks
+*
+*   @return     none
+*/
+static void txQueuePacket(uint16 now) {
+
+    // Initialize packet buffer of size PKTLEN + 1
+    uint8 txBuffer[PKTLEN + 1];
+
+    // Create a random packet with PKTLEN + 2 byte packet counter + n x random bytes
+    createPacket(txBuffer);
+    csmaQueuePut(txBuffer, sizeof(txBuffer), now + TX_DEADLINE_TICKS, now);
+}
+
+
+/*******************************************************************************
+*   @fn         txBurstStart
+*
+*   @brief      One channel access. When more packets wait behind the first,
+*               TXOFF_MODE is set to TX before the assessment so that the
+*               radio stays on air after the first packet and the burst
+*               holds the channel
+*
+*   @param      now - ticks
+*
+*   @return     none
+*/
+static void txBurstStart(uint16 now) {
+
+    uint8 txPacket[CSMA_PKT_MAX];
+    uint8 len;
+    uint8 chained;
+
+    len = csmaNext(now, txPacket);
+    if(len == 0) {
+        return;
+    }
+
+    chained = (TX_BURST_MAX > 1) && (csmaQueueCount() > 1);
+    if(chained) {
+        txSetOffMode(RFEND_CFG0_TXOFF_TX);
+    }
+
+    if(!txCcaStart(txPacket, len)) {
+        if(chained) {
+            txSetOffMode(RFEND_CFG0_TXOFF_IDLE);
+        }
+        csmaDone(CSMA_BUSY, getTicks());
+        return;
+    }
+    csmaDone(CSMA_SENT, getTicks());
+
+    txOnAir = 1;
+    txBurstLen = 1;
+    txChained = chained;
+    txHeld = chained;
+    txLastDone = getTicks();
+    txBursts++;
+}
+
+
+/*******************************************************************************
+*   @fn         txBurstTask
+*
+*   @brief      Accounts for the packets radioTxISR saw finish and keeps one
+*               packet preloaded behind the one on air. When there is nothing
+*               left to load, TXOFF_MODE goes back to IDLE so the radio stops
+*               after the last packet
+*
+*   @param      now - ticks
+*
+*   @return     none
+*/
+static void txBurstTask(uint16 now) {
+
+    uint8 txPacket[CSMA_PKT_MAX];
+    uint8 done;
+    uint8 len;
+
+    __disable_interrupt();
+    done = txDoneCount;
+    txDoneCount = 0;
+    __enable_interrupt();
+
+    if(done > txOnAir) {
+        done = txOnAir;
+    }
+    if(done > 0) {
+        txOnAir -= done;
+        txSent += done;
+        txWindowSent += done;
+        txLastDone = now;
+    } else if((uint16)(now - txLastDone) > TX_DONE_TIMEOUT_TICKS) {
+        // No end of packet seen, give the burst up
+        txOnAir = 0;
+        txChained = FALSE;
+        txHeld = TRUE;
+    }
+
+    while(txChained && (txOnAir < TX_FIFO_AHEAD) && (txBurstLen < TX_BURST_MAX)) {
+        len = csmaTake(now, txPacket);
+        if(len == 0) {
+            break;
+        }
+        cc120xSpiWriteTxFifo(txPacket, len);
+        txOnAir++;
+        txBurstLen++;
+    }
+
+    if(txChained && (txOnAir == 1)) {
+        // Last packet on air, stop after it
+        txSetOffMode(RFEND_CFG0_TXOFF_IDLE);
+        txChained = FALSE;
+    }
+
+    if(txOnAir == 0) {
+        // The last packet may have ended before TXOFF_MODE was written back,
+        // the radio then sends preamble from an empty FIFO
+        if(txHeld) {
+            txBurstEnd();
+        }
+        txLcdDirty = TRUE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         txBurstEnd
+*
+*   @brief      Takes the radio out of TX and restores TXOFF_MODE
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void txBurstEnd(void) {
+
+    uint8 marcState;
+
+    trxSpiCmdStrobe(CC120X_SIDLE);
+    do {
+        cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+    } while (marcState != MARC_STATE_IDLE);
+    trxSpiCmdStrobe(CC120X_SFTX);
+    txSetOffMode(RFEND_CFG0_TXOFF_IDLE);
+    txChained = FALSE;
+    txHeld = FALSE;
+}
+
+
+/*******************************************************************************
+*   @fn         txSetOffMode
+*
+*   @brief      Writes RFEND_CFG0.TXOFF_MODE, keeping the profile's other bits
+*
+*   @param      mode - RFEND_CFG0_TXOFF_IDLE or RFEND_CFG0_TXOFF_TX
+*
+*   @return     none
+*/
+static void txSetOffMode(uint8 mode) {
+
+    uint8 temp;
 
-        // Create a random packet with PKTLEN + 2 byte packet counter + n x random bytes
-        createPacket(txBuffer);
+    cc120xSpiReadReg(CC120X_RFEND_CFG0, &temp, 1);
+    temp = (temp & ~RFEND_CFG0_TXOFF_BM) | mode;
+    cc120xSpiWriteReg(CC120X_RFEND_CFG0, &temp, 1);
+}
+
+
+/*******************************************************************************
+*   @fn         txSleep
+*
+*   @brief      Sleeps until radioTxISR reports the end of a packet. Timer A0
+*               CCR1 bounds the sleep to TX_DONE_TIMEOUT_TICKS in case the
+*               edge is missed
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void txSleep(void) {
+
+    __disable_interrupt();
+    if(txDoneCount == 0) {
+        TA0CCR1 = getTicks() + TX_DONE_TIMEOUT_TICKS;
+        TA0CCTL1 = CCIE;
+        __bis_SR_register(LPM3_bits + GIE);
+        __disable_interrupt();
+        TA0CCTL1 = 0;
+    }
+    __enable_interrupt();
+}
 
-        // Write packet to TX FIFO
-        cc120xSpiWriteTxFifo(txBuffer, sizeof(txBuffer));
 
-        // Strobe TX to send packet
-        trxSpiCmdStrobe(CC120X_STX);
+/*******************************************************************************
+*   @fn         txRateTask
+*
+*   @brief      Closes the one second throughput window and redraws the LCD
+*               when something changed and no burst is running
+*
+*   @param      now - ticks
+*
+*   @return     none
+*/
+static void txRateTask(uint16 now) {
 
-        // Wait for packet to be sent
-        while(packetSemaphore != ISR_ACTION_REQUIRED);
+    if((uint16)(now - txWindowStart) < CSMA_TICK_HZ) {
+        return;
+    }
 
-        // Clear semaphore flag
-        packetSemaphore = ISR_IDLE;
+    if((uint16)txWindowSent != txPps) {
+        txPps = (uint16)txWindowSent;
+        txLcdDirty = TRUE;
+    }
+    txWindowSent = 0;
+    txWindowStart += CSMA_TICK_HZ;
+    if((uint16)(now - txWindowStart) >= CSMA_TICK_HZ) {
+        // A long stall, restart the window
+        txWindowStart = now;
+    }
 
-        // Update LCD
+    if(txLcdDirty && (txOnAir == 0)) {
         updateLcd();
+        txLcdDirty = FALSE;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         initCca
+*
+*   @brief      Turns on clear channel assessment with the CCA_THR_DBM
+*               threshold and seeds the backoff generator from the radio's
+*               random number generator, which needs RX to run
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void initCca(void) {
+
+    uint8 temp;
+    uint8 rssi0 = 0;
+    uint8 n;
+    uint16 seed;
+
+    cc120xSpiReadReg(CC120X_PKT_CFG2, &temp, 1);
+    temp = (temp & ~PKT_CFG2_CCA_MODE_BM) | PKT_CFG2_CCA_RSSI_THR;
+    cc120xSpiWriteReg(CC120X_PKT_CFG2, &temp, 1);
+
+    temp = (uint8)(CCA_THR_DBM + RSSI_OFFSET);
+    cc120xSpiWriteReg(CC120X_AGC_CS_THR, &temp, 1);
+
+    temp = RNDGEN_EN;
+    cc120xSpiWriteReg(CC120X_RNDGEN, &temp, 1);
+    trxSpiCmdStrobe(CC120X_SRX);
+    for(n = 0; (n < CCA_RSSI_POLLS) && !(rssi0 & 0x01); n++) {
+        cc120xSpiReadReg(CC120X_RSSI0, &rssi0, 1);
+    }
+    cc120xSpiReadReg(CC120X_RNDGEN, &temp, 1);
+    seed = (uint16)(temp & 0x7F) << 7;
+    __delay_cycles(CCA_SENSE_US * CYCLES_PER_US);
+    cc120xSpiReadReg(CC120X_RNDGEN, &temp, 1);
+    seed |= temp & 0x7F;
+    trxSpiCmdStrobe(CC120X_SIDLE);
+
+    csmaInit(seed ^ getTicks(), getTicks());
+}
+
+
+/*******************************************************************************
+*   @fn         txCcaStart
+*
+*   @brief      One transmission attempt. The packet is written to the TX
+*               FIFO, the radio listens until RSSI is valid plus CCA_SENSE_US
+*               and STX is strobed; the radio only moves to TX when the
+*               channel is clear. Returns once the radio is in TX, the end of
+*               the packet is reported by radioTxISR
+*
+*   @param      pPkt - packet, length byte first
+*   @param      len  - bytes in pPkt
+*
+*   @return     TRUE if on air, FALSE if the channel was busy
+*/
+static uint8 txCcaStart(uint8 *pPkt, uint8 len) {
+
+    uint8 rssi0 = 0;
+    uint8 marcState = 0;
+    uint8 n;
+
+    trxSpiCmdStrobe(CC120X_SFTX);
+    cc120xSpiWriteTxFifo(pPkt, len);
+
+    trxSpiCmdStrobe(CC120X_SRX);
+    for(n = 0; (n < CCA_RSSI_POLLS) && !(rssi0 & 0x01); n++) {
+        cc120xSpiReadReg(CC120X_RSSI0, &rssi0, 1);
+    }
+    __delay_cycles(CCA_SENSE_US * CYCLES_PER_US);
+
+    trxSpiCmdStrobe(CC120X_STX);
+    for(n = 0; n < CCA_TX_POLLS; n++) {
+        cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+        marcState &= MARC_STATE_BM;
+        if((marcState == MARC_STATE_TX) || (marcState == MARC_STATE_TX_END) ||
+           (marcState == MARC_STATE_RXTX_SWITCH)) {
+            break;
+        }
+    }
+
+    if(n == CCA_TX_POLLS) {
+        // Carrier sensed, still in RX
+        trxSpiCmdStrobe(CC120X_SIDLE);
+        do {
+            cc120xSpiReadReg(CC120X_MARCSTATE, &marcState, 1);
+        } while (marcState != MARC_STATE_IDLE);
+        trxSpiCmdStrobe(CC120X_SFRX);
+        trxSpiCmdStrobe(CC120X_SFTX);
+        return FALSE;
     }
+
+    // A sync word heard while listening may have raised GPIO0, only the
+    // end of our own packet counts
+    txDoneCount = 0;
+    return TRUE;
+}
+
+
+/*******************************************************************************
+*   @fn         initTickTimer
+*
+*   @brief      Timer A0 counts ACLK / 32 continuously, the CSMA time base
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void initTickTimer(void) {
+
+    TA0EX0 = TAIDEX_3;                  // /4
+    TA0CTL = TASSEL_1 + ID_3 + MC_2 + TACLR;    // ACLK /8, continuous
+}
+
+
+/*******************************************************************************
+*   @fn         getTicks
+*
+*   @brief      Reads Timer A0. It runs from ACLK, asynchronous to MCLK, so
+*               the count is read until two reads agree
+*
+*   @param      none
+*
+*   @return     ticks of 1/CSMA_TICK_HZ s, wrapping
+*/
+static uint16 getTicks(void) {
+
+    uint16 ticks;
+
+    do {
+        ticks = TA0R;
+    } while(ticks != TA0R);
+    return ticks;
 }
 
 
 /*******************************************************************************
 * @fn          radioTxISR
 *
-* @brief       ISR for packet handling in TX. Sets packet semaphore
-*              and clears interrupt flag
+* @brief       ISR for packet handling in TX. Counts the finished packet
+*              and clears interrupt flag, the Port 1 dispatcher wakes the
+*              main loop
 *
 * @param       none
 *
@@ -187,14 +654,37 @@ static void runTX(void) {
 */
 static void radioTxISR(void) {
 
-    // Set packet semaphore
-    packetSemaphore = ISR_ACTION_REQUIRED;
+    // Count the packet, runTX loads the next one
+    txDoneCount++;
 
     // Clear ISR flag
     ioPinIntClear(IO_PIN_PORT_1, GPIO0);
 }
 
 
+/*******************************************************************************
+*   @fn         Timer A0 CCR1
+*
+*   @brief      End of txSleep's timeout, wakes the main loop
+*
+*   @param      none
+*
+*   @return     none
+*/
+#pragma vector=TIMER0_A1_VECTOR
+__interrupt void Timer_A1(void)
+{
+    switch(__even_in_range(TA0IV, 14)) {
+    case 2:                             // CCR1
+        TA0CCTL1 = 0;
+        __low_power_mode_off_on_exit();
+        break;
+    default:
+        break;
+    }
+}
+
+
 /*******************************************************************************
 *   @fn         initMCU
 *
@@ -234,8 +724,8 @@ static void initMCU(void) {
 /*******************************************************************************
 *   @fn         registerConfig
 *
-*   @brief      Write register settings as given by SmartRF Studio found in
-*               cc1200_rx_sniff_mode_reg_config.h
+*   @brief      Resets the radio and writes the default PHY profile, see
+*               cc1200_rx_sniff_mode_phy.h
 *
 *   @param      none
 *
@@ -243,17 +733,7 @@ static void initMCU(void) {
 */
 static void registerConfig(void) {
 
-    uint8 writeByte;
-
-    // Reset radio
-    trxSpiCmdStrobe(CC120X_SRES);
-
-    // Write registers to radio
-    for(uint16 i = 0;
-        i < (sizeof(preferredSettings)/sizeof(registerSetting_t)); i++) {
-        writeByte = preferredSettings[i].data;
-        cc120xSpiWriteReg(preferredSettings[i].addr, &writeByte, 1);
-    }
+    phyWriteProfile(PHY_PROFILE_DEFAULT);
 }
 
 
@@ -262,7 +742,9 @@ static void registerConfig(void) {
 *
 *   @brief      This function is called before a packet is transmitted. It fills
 *               the txBuffer with a packet consisting of a length byte, two
-*               bytes packet counter and n random bytes
+*               bytes packet counter and n random bytes. With
+*               RX_FIFO_FRAME_CRC it is a station frame and the last two
+*               bytes are its CRC-16, at RX_FIFO_POS_CRC
 *
 *               The packet format is as follows:
 *               |--------------------------------------------------------------|
@@ -281,18 +763,25 @@ static void createPacket(uint8 txBuffer[]) {
     txBuffer[0] = PKTLEN;                         // Length byte
     txBuffer[1] = (uint8) (packetCounter >> 8);   // MSB of packetCounter
     txBuffer[2] = (uint8) packetCounter;          // LSB of packetCounter
+    packetCounter++;
 
     // Fill rest of buffer with random bytes
     for(uint8 i = 3; i < (PKTLEN + 1); i++) {
         txBuffer[i] = (uint8)rand();
     }
+
+    if(RX_FIFO_FRAME_CRC) {
+        crc16Append(txBuffer, RX_FIFO_POS_CRC);
+    }
 }
 
 
 /*******************************************************************************
 *   @fn         updateLcd
 *
-*   @brief      Updates LCD buffer and sends bufer to LCD module
+*   @brief      Updates LCD buffer and sends bufer to LCD module: the
+*               packets sent and the CSMA busy channel assessments,
+*               backoffs and packets given up
 *
 *   @param      none
 *
@@ -300,13 +789,25 @@ static void createPacket(uint8 txBuffer[]) {
 */
 static void updateLcd(void) {
 
+    const csmaStats_t *pCsma = csmaGetStats();
+
     // Update LDC buffer and send to screen
     lcdBufferClear(0);
     lcdBufferPrintString(0, "RX Sniff Mode", 0, eLcdPage0);
     lcdBufferSetHLine(0, 0, LCD_COLS - 1, 7);
-    lcdBufferPrintString(0, "Sent packets:", 0, eLcdPage3);
-    lcdBufferPrintInt(0, packetCounter++, 80, eLcdPage3);
-    lcdBufferPrintString(0, "TX" , 0, eLcdPage7);
+    lcdBufferPrintString(0, "Sent packets:", 0, eLcdPage1);
+    lcdBufferPrintInt(0, txSent, 80, eLcdPage1);
+    lcdBufferPrintString(0, "Packets/s:", 0, eLcdPage2);
+    lcdBufferPrintInt(0, txPps, 80, eLcdPage2);
+    lcdBufferPrintString(0, "Bursts:", 0, eLcdPage3);
+    lcdBufferPrintInt(0, txBursts, 80, eLcdPage3);
+    lcdBufferPrintString(0, "CCA busy:", 0, eLcdPage4);
+    lcdBufferPrintInt(0, pCsma->ccaBusy, 80, eLcdPage4);
+    lcdBufferPrintString(0, "Backoffs:", 0, eLcdPage5);
+    lcdBufferPrintInt(0, pCsma->backoffs, 80, eLcdPage5);
+    lcdBufferPrintString(0, "Access fail:", 0, eLcdPage6);
+    lcdBufferPrintInt(0, pCsma->accessFailures, 80, eLcdPage6);
+    lcdBufferPrintString(0, txStream ? "TX stream" : "TX" , 0, eLcdPage7);
     lcdBufferSetHLine(0, 0, LCD_COLS - 1, 55);
     lcdBufferInvertPage(0, 0, LCD_COLS, eLcdPage7);
     lcdSendBuffer(0);
@@ -0,0 +1,188 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_wor.c
+//! @brief      Adaptive sniff mode controller, see cc1200_rx_sniff_mode_wor.h
+//
+//*****************************************************************************/
+
+
+/*******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "cc1200_rx_sniff_mode_wor.h"
+
+
+/*******************************************************************************
+* DEFINES
+*/
+#if (WOR_EVENT0_MIN > WOR_EVENT0_DEFAULT) || (WOR_EVENT0_DEFAULT > WOR_EVENT0_MAX)
+#error "WOR_EVENT0_DEFAULT must lie within WOR_EVENT0_MIN..WOR_EVENT0_MAX"
+#endif
+
+
+/*******************************************************************************
+* LOCAL VARIABLES
+*/
+static worStats_t worStats;
+static uint16 epochPackets;
+static uint16 epochMisses;
+static uint16 epochFalse;
+static uint16 epochTime;
+static uint16 calTime;
+
+
+/*******************************************************************************
+* STATIC FUNCTIONS
+*/
+static void updateDuty(void);
+
+
+/*******************************************************************************
+*   @fn         worCtrlInit
+*
+*   @brief      Starts from the default period and threshold, which are the
+*               values registerConfig() leaves in the radio
+*
+*   @param      none
+*
+*   @return     none
+*/
+void worCtrlInit(void) {
+
+    memset(&worStats, 0, sizeof(worStats));
+    worStats.event0 = WOR_EVENT0_DEFAULT;
+    worStats.pqt = WOR_PQT_DEFAULT;
+    updateDuty();
+
+    epochPackets = 0;
+    epochMisses = 0;
+    epochFalse = 0;
+    epochTime = 0;
+    calTime = 0;
+}
+
+
+/*******************************************************************************
+*   @fn         worCtrlCountWakeup
+*
+*   @brief      Records the outcome of one end-of-packet wake-up
+*
+*   @param      packets - packets delivered by this wake-up
+*   @param      misses  - packets lost (FIFO overflow, truncated, pool full)
+*
+*   @return     none
+*/
+void worCtrlCountWakeup(uint8 packets, uint8 misses) {
+
+    worStats.wakeups++;
+    worStats.packets += packets;
+    worStats.misses += misses;
+
+    if(epochPackets < 0xFFFF - packets) {
+        epochPackets += packets;
+    }
+    if(epochMisses < 0xFFFF - misses) {
+        epochMisses += misses;
+    }
+    if((packets == 0) && (misses == 0) && (epochFalse < 0xFFFF)) {
+        worStats.falseWakeups++;
+        epochFalse++;
+    }
+}
+
+
+/*******************************************************************************
+*   @fn         worCtrlTick
+*
+*   @brief      Call once per second. At the end of each epoch:
+*               - losses: shorten the period by 1/4, listen more often
+*               - no traffic at all: lengthen it by 1/8, save current
+*               - noise wake-ups outnumber packets: raise the PQT
+*               - losses without noise: lower the PQT again
+*               The period never leaves WOR_EVENT0_MIN..WOR_EVENT0_MAX
+*
+*   @param      none
+*
+*   @return     WOR_CTRL_APPLY and/or WOR_CTRL_CALIBRATE, 0 if nothing to do
+*/
+uint8 worCtrlTick(void) {
+
+    uint8  flags = 0;
+    uint16 event0 = worStats.event0;
+    uint8  pqt = worStats.pqt;
+
+    if(++calTime >= WOR_RCOSC_CAL_PERIOD) {
+        calTime = 0;
+        worStats.rcoscCals++;
+        flags |= WOR_CTRL_CALIBRATE;
+    }
+
+    if(++epochTime < WOR_EPOCH) {
+        return flags;
+    }
+
+    if(epochMisses > 0) {
+        event0 -= event0 / 4;
+    } else if((epochPackets == 0) && (epochFalse == 0)) {
+        event0 += event0 / 8;
+    }
+    if(event0 < WOR_EVENT0_MIN) {
+        event0 = WOR_EVENT0_MIN;
+    }
+    if(event0 > WOR_EVENT0_MAX) {
+        event0 = WOR_EVENT0_MAX;
+    }
+
+    if((epochFalse > epochPackets) && (pqt < WOR_PQT_MAX)) {
+        pqt++;
+    } else if((epochMisses > 0) && (epochFalse == 0) && (pqt > WOR_PQT_MIN)) {
+        pqt--;
+    }
+
+    if((event0 != worStats.event0) || (pqt != worStats.pqt)) {
+        worStats.event0 = event0;
+        worStats.pqt = pqt;
+        worStats.retunes++;
+        updateDuty();
+        flags |= WOR_CTRL_APPLY;
+    }
+
+    epochPackets = 0;
+    epochMisses = 0;
+    epochFalse = 0;
+    epochTime = 0;
+    return flags;
+}
+
+
+/*******************************************************************************
+*   @fn         worCtrlGetStats
+*
+*   @brief      Returns the wake-up counters and the current setting
+*
+*   @param      none
+*
+*   @return     pointer to the statistics
+*/
+const worStats_t *worCtrlGetStats(void) {
+
+    return &worStats;
+}
+
+
+/*******************************************************************************
+*   @fn         updateDuty
+*
+*   @brief      Estimates the RX duty cycle of the current period from the
+*               nominal RX time per sniff event
+*
+*   @param      none
+*
+*   @return     none
+*/
+static void updateDuty(void) {
+
+    uint32 periodUs = ((uint32)worStats.event0 * WOR_RCOSC_PERIOD_NS) / 1000;
+
+    worStats.dutyPermille = (uint16)(((uint32)WOR_RX_ON_US * 1000) / periodUs);
+}
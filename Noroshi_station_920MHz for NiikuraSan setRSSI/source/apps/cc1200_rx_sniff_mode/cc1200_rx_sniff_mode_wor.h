@@ -0,0 +1,82 @@
+//******************************************************************************
+//! @file       cc1200_rx_sniff_mode_wor.h
+//! @brief      Adaptive sniff mode (eWOR) controller. Counts wake-ups,
+//!             packets and losses, and once per epoch moves the WOR_EVENT0
+//!             period and the preamble quality threshold (PQT) within
+//!             configured bounds. Also schedules periodic RCOSC calibration.
+//!             Decides only, the caller writes the radio. Builds under gcc on
+//!             Linux.
+//
+//*****************************************************************************/
+
+#ifndef CC1200_RX_SNIFF_MODE_WOR_H
+#define CC1200_RX_SNIFF_MODE_WOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/******************************************************************************
+ * INCLUDES
+ */
+#include "hal_types.h"
+#include "hal_defs.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ */
+// EVENT0 in RCOSC periods (32 kHz, WOR_RES = 0): 440 = 13.75 ms, reset value.
+// WOR_EVENT0_MAX must stay below the tag preamble duration, a longer sniff
+// interval sleeps through whole packets and those losses are never seen
+#ifndef WOR_EVENT0_MIN
+#define WOR_EVENT0_MIN          220
+#endif
+#ifndef WOR_EVENT0_MAX
+#define WOR_EVENT0_MAX          440
+#endif
+#define WOR_EVENT0_DEFAULT      440
+
+// PREAMBLE_CFG0.PQT, higher rejects more noise wake-ups
+#define WOR_PQT_MIN             0x08
+#define WOR_PQT_MAX             0x0C
+#define WOR_PQT_DEFAULT         0x0A
+
+#define WOR_EPOCH               10      // seconds between decisions
+#define WOR_RCOSC_CAL_PERIOD    300     // seconds between RCOSC calibrations
+#define WOR_RX_ON_US            400     // estimated RX time per sniff event
+#define WOR_RCOSC_PERIOD_NS     31250   // 1 / 32 kHz
+
+// worCtrlTick() result flags
+#define WOR_CTRL_APPLY          0x01    // new EVENT0/PQT, write to the radio
+#define WOR_CTRL_CALIBRATE      0x02    // calibrate the RCOSC
+
+
+/******************************************************************************
+ * TYPEDEFS
+ */
+typedef struct {
+    uint32 wakeups;                     // end-of-packet interrupts
+    uint32 packets;                     // packets delivered
+    uint32 misses;                      // packets lost to overflow or load
+    uint32 falseWakeups;                // wake-ups that delivered nothing
+    uint32 retunes;                     // settings written to the radio
+    uint32 rcoscCals;
+    uint16 event0;                      // current WOR_EVENT0
+    uint8  pqt;                         // current PQT
+    uint16 dutyPermille;                // estimated RX duty cycle, 1/1000
+} worStats_t;
+
+
+/******************************************************************************
+ * PROTOTYPES
+ */
+void worCtrlInit(void);
+void worCtrlCountWakeup(uint8 packets, uint8 misses);
+uint8 worCtrlTick(void);
+const worStats_t *worCtrlGetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
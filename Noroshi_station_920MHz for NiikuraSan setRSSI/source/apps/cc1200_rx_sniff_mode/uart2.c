@@ -278,8 +278,10 @@ void initBufferDefaults(UARTConfig * prtInf)
 	prtInf->rxBufLen = 0;
 
 	prtInf->rxBytesReceived = 0;
-	prtInf->txBytesToSend = 0;
+	prtInf->txBufHead = 0;
 	prtInf->txBufCtr = 0;
+	prtInf->txFramesDropped = 0;
+	prtInf->txBytesDropped = 0;
 }
 
 /*!
@@ -527,6 +529,8 @@ void setUartTxBuffer(UARTConfig * prtInf, unsigned char * buf, int bufLen)
 {
 	prtInf->txBuf = buf;
 	prtInf->txBufLen = bufLen;
+	prtInf->txBufHead = 0;
+	prtInf->txBufCtr = 0;
 
 	int i = 0;
 	for(i = 0; i < bufLen; i++)
@@ -558,12 +562,45 @@ void setUartRxBuffer(UARTConfig * prtInf, unsigned char * buf, int bufLen)
 }
 
 /*!
- * \brief Sends len number of bytes from the buffer using the specified
- * UART using interrupt driven.
+ * \brief Returns the free space in the UART TX ring
+ *
+ * One byte of the buffer is kept unused to tell a full ring from an empty one,
+ * so at most bufLen - 1 bytes can be queued.
+ *
+ * @param prtInf is a pointer to the UART configuration
+ *
+ * \return number of bytes uartSendDataInt can queue without waiting
+ *
+ */
+int uartTxBufFree(UARTConfig * prtInf)
+{
+	int used;
+
+	if(prtInf->txBufLen == 0)
+	{
+		return 0;
+	}
+
+	used = prtInf->txBufHead - prtInf->txBufCtr;
+	if(used < 0)
+	{
+		used += prtInf->txBufLen;
+	}
+	return prtInf->txBufLen - 1 - used;
+}
+
+/*!
+ * \brief Queues len number of bytes from the buffer for interrupt driven
+ * transmission on the specified UART.
+ *
+ * The bytes are appended to the TX ring set with setUartTxBuffer, behind any
+ * frame still being sent. TX Interrupts are enabled if the ring was idle and
+ * each time that the UART TX Buffer is empty the next queued byte is sent.
  *
- * TX Interrupts are enabled and each time that the UART TX Buffer is empty
- * and there is more data to send, data is sent. Once the byte is sent, another
- * interrupt is triggered, until all bytes in the buffer sent.
+ * A frame is queued whole or not at all. When the ring has no room the frame
+ * is dropped and counted in txFramesDropped/txBytesDropped, unless txBlocking
+ * is set, in which case the call waits for the ISR to make room. Blocking
+ * must not be used with interrupts disabled.
  *
  * @param prtInf is a pointer to the UART configuration
  * @param buf is a pointer to the buffer containing the bytes to be sent.
@@ -574,49 +611,68 @@ void setUartRxBuffer(UARTConfig * prtInf, unsigned char * buf, int bufLen)
  */
 int uartSendDataInt(UARTConfig * prtInf,unsigned char * buf, int len)
 {
-	if(len > prtInf->txBufLen )
+	int head = prtInf->txBufHead;
+	int i = 0;
+
+	if(len > prtInf->txBufLen - 1)
 	{
+		prtInf->txFramesDropped++;
+		prtInf->txBytesDropped += len;
 		return UART_INSUFFICIENT_TX_BUF;
 	}
 
-	int i = 0;
+	while(uartTxBufFree(prtInf) < len)
+	{
+		if(!prtInf->txBlocking)
+		{
+			prtInf->txFramesDropped++;
+			prtInf->txBytesDropped += len;
+			return UART_TX_BUF_FULL;
+		}
+	}
+
 	for(i = 0; i < len; i++)
 	{
-		prtInf->txBuf[i] = buf[i];
+		prtInf->txBuf[head] = buf[i];
+		if(++head == prtInf->txBufLen)
+		{
+			head = 0;
+		}
 	}
 
+	// Publish the frame, the ISR only reads up to txBufHead
+	prtInf->txBufHead = head;
+
 #if defined(__MSP430_HAS_USCI__) || defined(__MSP430_HAS_USCI_A0__) || defined(__MSP430_HAS_USCI_A1__) || defined(__MSP430_HAS_USCI_A2__)
-	// Send the first byte. Since UART interrupt is enabled, it will be called once the byte is sent and will
-	// send the rest of the bytes
+	// Start the ISR if it is idle. Otherwise it picks up the new bytes itself
 	if(prtInf->moduleName == USCI_A0 || prtInf->moduleName == USCI_A1 || prtInf->moduleName == USCI_A2)
 	{
-		prtInf->txBytesToSend = len;
-		prtInf->txBufCtr = 0;
-
-		// Enable TX IE
-		*prtInf->usciRegs->IFG_REG &= ~UCTXIFG;
-		*prtInf->usciRegs->IE_REG |= UCTXIE;
+		if(!(*prtInf->usciRegs->IE_REG & UCTXIE))
+		{
+			// Enable TX IE
+			*prtInf->usciRegs->IFG_REG &= ~UCTXIFG;
+			*prtInf->usciRegs->IE_REG |= UCTXIE;
 
-		// Trigger the TX IFG. This will cause the Interrupt Vector to be called
-		// which will send the data one byte at a time at each interrupt trigger.
-		*prtInf->usciRegs->IFG_REG |= UCTXIFG;
+			// Trigger the TX IFG. This will cause the Interrupt Vector to be called
+			// which will send the data one byte at a time at each interrupt trigger.
+			*prtInf->usciRegs->IFG_REG |= UCTXIFG;
+		}
 	}
 #endif
 
 #if defined(__MSP430_HAS_UART0__) || defined(__MSP430_HAS_UART1__)
 	if(prtInf->moduleName == USART_0|| prtInf->moduleName == USART_1)
 	{
-		prtInf->txBytesToSend = len;
-		prtInf->txBufCtr = 0;
-
-		// Clear TX IFG and Enable TX IE
-		*prtInf->usartRegs->IFG_REG &= ~ prtInf->usartRegs->TXIFGFlag;
-		*prtInf->usartRegs->IE_REG |= prtInf->usartRegs->TXIE;
-
-		// Trigger the TX IFG. This will cause the Interrupt Vector to be called
-		// which will send the data one byte at a time at each interrupt trigger.
-		*prtInf->usartRegs->IFG_REG |= prtInf->usartRegs->TXIFGFlag;
+		if(!(*prtInf->usartRegs->IE_REG & prtInf->usartRegs->TXIE))
+		{
+			// Clear TX IFG and Enable TX IE
+			*prtInf->usartRegs->IFG_REG &= ~ prtInf->usartRegs->TXIFGFlag;
+			*prtInf->usartRegs->IE_REG |= prtInf->usartRegs->TXIE;
 
+			// Trigger the TX IFG. This will cause the Interrupt Vector to be called
+			// which will send the data one byte at a time at each interrupt trigger.
+			*prtInf->usartRegs->IFG_REG |= prtInf->usartRegs->TXIFGFlag;
+		}
 	}
 #endif
 
@@ -649,18 +705,20 @@ void enableUartRx(UARTConfig * prtInf)
 #pragma vector=USART0TX_VECTOR
 __interrupt void usart0_tx (void)
 {
-	// Send data if the buffer has bytes to send
-	if(prtInfList[USART_0]->txBytesToSend > 0)
+	// Send the next queued byte, stop once the TX ring is empty
+	if(prtInfList[USART_0]->txBufCtr != prtInfList[USART_0]->txBufHead)
 	{
 		*prtInfList[USART_0]->usciRegs->TX_BUF = prtInfList[USART_0]->txBuf[prtInfList[USART_0]->txBufCtr];
-		prtInfList[USART_0]->txBufCtr++;
-
-		// If we've sent all the bytes, set counter to 0 to stop the sending
-		if(prtInfList[USART_0]->txBufCtr == prtInfList[USART_0]->txBytesToSend)
+		if(++prtInfList[USART_0]->txBufCtr == prtInfList[USART_0]->txBufLen)
 		{
 		  prtInfList[USART_0]->txBufCtr = 0;
 		}
 	}
+	else
+	{
+		// Disable TX IE
+		*prtInfList[USART_0]->usartRegs->IE_REG &= ~prtInfList[USART_0]->usartRegs->TXIE;
+	}
 }
 
 
@@ -686,18 +744,20 @@ __interrupt void usart0_rx (void)
 #pragma vector=USART1TX_VECTOR
 __interrupt void usart1_tx (void)
 {
-	// Send data if the buffer has bytes to send
-	if(prtInfList[USART_1]->txBytesToSend > 0)
+	// Send the next queued byte, stop once the TX ring is empty
+	if(prtInfList[USART_1]->txBufCtr != prtInfList[USART_1]->txBufHead)
 	{
 		*prtInfList[USART_1]->usciRegs->TX_BUF = prtInfList[USART_1]->txBuf[prtInfList[USART_1]->txBufCtr];
-		prtInfList[USART_1]->txBufCtr++;
-
-		// If we've sent all the bytes, set counter to 0 to stop the sending
-		if(prtInfList[USART_1]->txBufCtr == prtInfList[USART_1]->txBytesToSend)
+		if(++prtInfList[USART_1]->txBufCtr == prtInfList[USART_1]->txBufLen)
 		{
 		  prtInfList[USART_1]->txBufCtr = 0;
 		}
 	}
+	else
+	{
+		// Disable TX IE
+		*prtInfList[USART_1]->usartRegs->IE_REG &= ~prtInfList[USART_1]->usartRegs->TXIE;
+	}
 }
 
 
@@ -737,24 +797,23 @@ __interrupt void USCI_A0_ISR(void)
 		  }
 		break;
 	  case 4:                                   // Vector 4 - TXIFG
-		  // Send data if the buffer has bytes to send
-		  if(prtInfList[USCI_A0]->txBytesToSend > 0)
+		  // Send the next queued byte, stop once the TX ring is empty
+		  if(prtInfList[USCI_A0]->txBufCtr != prtInfList[USCI_A0]->txBufHead)
 		  {
 			  *prtInfList[USCI_A0]->usciRegs->TX_BUF = prtInfList[USCI_A0]->txBuf[prtInfList[USCI_A0]->txBufCtr];
-			  prtInfList[USCI_A0]->txBufCtr++;
-
-			  // If we've sent all the bytes, set counter to 0 to stop the sending
-			  if(prtInfList[USCI_A0]->txBufCtr == prtInfList[USCI_A0]->txBytesToSend)
+			  if(++prtInfList[USCI_A0]->txBufCtr == prtInfList[USCI_A0]->txBufLen)
 			  {
 				  prtInfList[USCI_A0]->txBufCtr = 0;
-
-				  // Disable TX IE
-				  *prtInfList[USCI_A0]->usciRegs->IE_REG &= ~UCTXIE;
-
-				  // Clear TX IFG
-				  *prtInfList[USCI_A0]->usciRegs->IFG_REG &= ~UCTXIFG;
 			  }
 		  }
+		  else
+		  {
+			  // Disable TX IE
+			  *prtInfList[USCI_A0]->usciRegs->IE_REG &= ~UCTXIE;
+
+			  // Clear TX IFG
+			  *prtInfList[USCI_A0]->usciRegs->IFG_REG &= ~UCTXIFG;
+		  }
 		  break;
 	  default: break;
 	}
@@ -780,24 +839,23 @@ __interrupt void USCI_A1_ISR(void)
 		  }
 		break;
 	  case 4:
-		  // Send data if the buffer has bytes to send
-		  if(prtInfList[USCI_A1]->txBytesToSend > 0)
+		  // Send the next queued byte, stop once the TX ring is empty
+		  if(prtInfList[USCI_A1]->txBufCtr != prtInfList[USCI_A1]->txBufHead)
 		  {
 			  *prtInfList[USCI_A1]->usciRegs->TX_BUF = prtInfList[USCI_A1]->txBuf[prtInfList[USCI_A1]->txBufCtr];
-			  prtInfList[USCI_A1]->txBufCtr++;
-
-			  // If we've sent all the bytes, set counter to 0 to stop the sending
-			  if(prtInfList[USCI_A1]->txBufCtr == prtInfList[USCI_A1]->txBytesToSend)
+			  if(++prtInfList[USCI_A1]->txBufCtr == prtInfList[USCI_A1]->txBufLen)
 			  {
 				  prtInfList[USCI_A1]->txBufCtr = 0;
-
-				  // Disable TX IE
-				  *prtInfList[USCI_A1]->usciRegs->IE_REG &= ~UCTXIE;
-
-				  // Clear TX IFG
-				  *prtInfList[USCI_A1]->usciRegs->IFG_REG &= ~UCTXIFG;
 			  }
 		  }
+		  else
+		  {
+			  // Disable TX IE
+			  *prtInfList[USCI_A1]->usciRegs->IE_REG &= ~UCTXIE;
+
+			  // Clear TX IFG
+			  *prtInfList[USCI_A1]->usciRegs->IFG_REG &= ~UCTXIFG;
+		  }
 		  break;                             // Vector 4 - TXIFG
 	  default: break;
 	}
@@ -823,23 +881,23 @@ __interrupt void USCI_A2_ISR(void)
 		  }
 		break;
 	  case 4:
-		  if(prtInfList[USCI_A2]->txBytesToSend > 0)
+		  // Send the next queued byte, stop once the TX ring is empty
+		  if(prtInfList[USCI_A2]->txBufCtr != prtInfList[USCI_A2]->txBufHead)
 		  {
 			  *prtInfList[USCI_A2]->usciRegs->TX_BUF = prtInfList[USCI_A2]->txBuf[prtInfList[USCI_A2]->txBufCtr];
-			  prtInfList[USCI_A2]->txBufCtr++;
-
-			  // If we've sent all the bytes, set counter to 0 to stop the sending
-			  if(prtInfList[USCI_A2]->txBufCtr == prtInfList[USCI_A2]->txBytesToSend)
+			  if(++prtInfList[USCI_A2]->txBufCtr == prtInfList[USCI_A2]->txBufLen)
 			  {
 				  prtInfList[USCI_A2]->txBufCtr = 0;
-
-				  // Disable TX IE
-				  *prtInfList[USCI_A2]->usciRegs->IE_REG &= ~UCTXIE;
-
-				  // Clear TX IFG
-				  *prtInfList[USCI_A2]->usciRegs->IFG_REG &= ~UCTXIFG;
 			  }
 		  }
+		  else
+		  {
+			  // Disable TX IE
+			  *prtInfList[USCI_A2]->usciRegs->IE_REG &= ~UCTXIE;
+
+			  // Clear TX IFG
+			  *prtInfList[USCI_A2]->usciRegs->IFG_REG &= ~UCTXIFG;
+		  }
 		  break;                             // Vector 4 - TXIFG
 	  default: break;
 	}
@@ -50,7 +50,8 @@ enum UART_ERR_CODES
 	UART_BAD_CLK_SOURCE,
 	UART_INSUFFICIENT_TX_BUF,
 	UART_INSUFFICIENT_RX_BUF,
-	UART_BAD_PORT_SELECTED
+	UART_BAD_PORT_SELECTED,
+	UART_TX_BUF_FULL
 };
 
 typedef enum
@@ -143,8 +144,11 @@ typedef struct
 	int txBufLen;
 	int rxBufLen;
 	int rxBytesReceived;
-	int txBytesToSend;
-	int txBufCtr;
+	volatile int txBufHead;       /**< TX ring write index, advanced by uartSendDataInt  */
+	volatile int txBufCtr;        /**< TX ring read index, advanced by the TX ISR  */
+	char txBlocking;              /**< Nonzero: wait for room instead of dropping the frame  */
+	unsigned long txFramesDropped; /**< Frames refused because the TX ring was full  */
+	unsigned long txBytesDropped; /**< Bytes of those frames  */
 } UARTConfig;
 
 
@@ -161,6 +165,7 @@ void setUartTxBuffer(UARTConfig * prtInf, unsigned char * buf, int bufLen);
 void setUartRxBuffer(UARTConfig * prtInf, unsigned char * buf, int bufLen);
 void initUartDriver();
 int uartSendDataInt(UARTConfig * prtInf,unsigned char * buf, int len);
+int uartTxBufFree(UARTConfig * prtInf);
 void enableUartRx(UARTConfig * prtInf);
 int numUartBytesReceived(UARTConfig * prtInf);
 unsigned char * getUartRxBufferData(UARTConfig * prtInf);
@@ -122,6 +122,17 @@ extern "C"
 #define FLASH_SECTOR_3                  3
 
 
+/******************************************************************************
+* TYPEDEFS
+*/
+//
+//! Called from the SPI interrupt when a flashReadStart(),
+//! flashPageProgramStart(), flashPageWriteStart() or
+//! flashSubSectorEraseStart() transfer has ended
+//
+typedef void (*flashCallback_t)(void);
+
+
 /******************************************************************************
 * FUNCTION PROTOTYPES
 */
@@ -135,12 +146,25 @@ uint32_t flashRead(uint32_t ui32Addr, uint8_t *pui8Data,
                         uint32_t ui32Bytes);
 uint32_t flashPageWrite(uint16_t ui16Page, uint8_t *pui8Data,
                              uint16_t ui16Bytes);
+uint32_t flashPageProgram(uint16_t ui16Page, uint8_t *pui8Data,
+                               uint16_t ui16Bytes);
 
 uint8_t flashPageErase(uint16_t ui16Page);
 uint8_t flashSubSectorErase(uint8_t ui16SubSector);
 uint8_t flashSectorErase(uint8_t ui8Sector);
 uint8_t flashBulkErase(void);
 
+uint8_t flashReadStart(uint32_t ui32Addr, uint8_t *pui8Data,
+                       uint16_t ui16Bytes, flashCallback_t pfnDone);
+uint8_t flashPageProgramStart(uint16_t ui16Page, uint8_t *pui8Data,
+                              uint16_t ui16Bytes, flashCallback_t pfnDone);
+uint8_t flashPageWriteStart(uint16_t ui16Page, uint8_t *pui8Data,
+                            uint16_t ui16Bytes, flashCallback_t pfnDone);
+uint8_t flashSubSectorEraseStart(uint8_t ui8SubSector,
+                                 flashCallback_t pfnDone);
+uint8_t flashWriteInProgress(void);
+uint8_t flashTransferBusy(void);
+
 void flashDeepPowerDownEnable(void);
 void flashDeepPowerDownDisable(void);
 
@@ -49,6 +49,7 @@
 */
 #include "bsp.h"
 #include "flash_m25pex0.h"
+#include "spi_bus.h"
 
 
 /******************************************************************************
@@ -82,8 +83,14 @@
 /******************************************************************************
 * MACROS
 */
-#define FLASH_SPI_BEGIN()           (FLASH_CS_N_OUT &= ~(BSP_FLASH_CS_N))
-#define FLASH_SPI_END()             (FLASH_CS_N_OUT |= BSP_FLASH_CS_N)
+//
+//! Blocking sequences hold the SPI bus, shared with the LCD, see spi_bus.h
+//
+#define FLASH_SPI_BEGIN()           do{ spiBusAcquire(SPI_BUS_CLIENT_FLASH);\
+                                        FLASH_CS_N_OUT &= ~(BSP_FLASH_CS_N);}\
+                                    while(0)
+#define FLASH_SPI_END()             do{ FLASH_CS_N_OUT |= BSP_FLASH_CS_N;\
+                                        spiBusRelease();} while(0)
 
 //
 //! Clear RX flag, TX is cleared upon buffer write
@@ -104,6 +111,13 @@
 * LOCAL VARIABLES AND FUNCTION PROTOTYPES
 */
 static uint8_t flashErase(uint8_t ui8Cmd, uint32_t ui32Addr);
+static uint8_t flashTransferStart(uint8_t ui8Cmd, uint32_t ui32Addr,
+                                  uint8_t *pui8Data, uint16_t ui16Bytes,
+                                  uint8_t ui8Read, flashCallback_t pfnDone);
+
+static void flashSelect(uint8_t ui8On);
+
+#define FLASH_XFER_HDR_LEN      4       //!< Instruction and 3 address bytes
 
 
 /******************************************************************************
@@ -454,6 +468,90 @@ flashPageWrite(uint16_t ui16Page, uint8_t *pui8Data, uint16_t ui16Bytes)
 }
 
 
+/**************************************************************************//**
+* @brief    Program bytes into an erased SPI flash page. Unlike
+*           flashPageWrite() the page is not erased first, so bits can only
+*           be cleared, but the program time is ~0.8 ms instead of ~11 ms.
+*           Use on pages erased with flashSubSectorErase() or similar.
+*
+* @param    ui16Page      SPI flash page to program [0-1023]
+* @param    pui8Data     Pointer to buffer with data
+* @param    ui16Bytes     Number of bytes to program [1-256]
+*
+* @return   Returns number of bytes programmed to the external flash
+******************************************************************************/
+uint32_t
+flashPageProgram(uint16_t ui16Page, uint8_t *pui8Data, uint16_t ui16Bytes)
+{
+    uint32_t ui32Cnt;
+    uint8_t ui8Status;
+
+    if((ui16Bytes == 0) || (ui16Bytes > 256))
+    {
+        return (0);
+    }
+
+    //
+    // Assert CSn and send enable write command
+    //
+    FLASH_SPI_BEGIN();
+    FLASH_SPI_TX(FLASH_INSTR_WREN);
+    FLASH_SPI_WAIT_RXRDY();
+    FLASH_SPI_END();
+
+    //
+    // Start program sequence
+    //
+    FLASH_SPI_BEGIN();
+    FLASH_SPI_TX(FLASH_INSTR_PP);
+    FLASH_SPI_WAIT_RXRDY();
+
+    //
+    // Address
+    //
+    FLASH_SPI_TX((uint8_t)(ui16Page >> 8));
+    FLASH_SPI_WAIT_RXRDY();
+    FLASH_SPI_TX((uint8_t)(ui16Page));
+    FLASH_SPI_WAIT_RXRDY();
+    FLASH_SPI_TX((uint8_t)(0x00));
+    FLASH_SPI_WAIT_RXRDY();
+
+    //
+    // Transfer the data
+    //
+    for(ui32Cnt = 0; ui32Cnt < ui16Bytes; ui32Cnt++)
+    {
+        FLASH_SPI_TX(pui8Data[ui32Cnt]);
+        FLASH_SPI_WAIT_RXRDY();
+    }
+
+    //
+    // Deassert CSn
+    //
+    FLASH_SPI_END();
+
+    //
+    // Assert CSn and wait for program to finish
+    //
+    FLASH_SPI_BEGIN();
+    FLASH_SPI_TX(FLASH_INSTR_RDSR);
+    FLASH_SPI_WAIT_RXRDY();
+    do
+    {
+        FLASH_SPI_TX(FLASH_SPI_DUMMY);
+        FLASH_SPI_WAIT_RXRDY();
+        ui8Status = FLASH_SPI_RX();
+    }
+    while(ui8Status & FLASH_STATUS_WIP_BM);
+
+    //
+    // Deassert CSn and return number of bytes programmed
+    //
+    FLASH_SPI_END();
+    return (ui32Cnt);
+}
+
+
 /**************************************************************************//**
 * @brief    Function erases the flash page specified by \e ui8Page. The function
 *           does not return until the erase process has completed, or the
@@ -526,6 +624,138 @@ flashBulkErase(void)
 }
 
 
+/**************************************************************************//**
+* @brief    Queues a read of bytes from SPI flash on the SPI bus and returns
+*           at once. The bytes are moved by the USCI_B2 interrupt, one per
+*           interrupt, and \e pfnDone is called from the interrupt after
+*           the last one, see spi_bus.h. Flash transfers go before queued
+*           LCD transfers.
+*
+* @param    ui32Addr      SPI flash start address
+* @param    pui8Data      Pointer to buffer to put read bytes
+* @param    ui16Bytes     Number of bytes to read [1-65535]
+* @param    pfnDone       Called from the interrupt when done, or NULL
+*
+* @return   Returns 0 when queued
+* @return   Returns 1 if the bus queue is full or \e ui16Bytes is 0
+******************************************************************************/
+uint8_t
+flashReadStart(uint32_t ui32Addr, uint8_t *pui8Data, uint16_t ui16Bytes,
+               flashCallback_t pfnDone)
+{
+    if(ui16Bytes == 0)
+    {
+        return (1);
+    }
+    return (flashTransferStart(FLASH_INSTR_READ, ui32Addr, pui8Data,
+                               ui16Bytes, 1, pfnDone));
+}
+
+
+/**************************************************************************//**
+* @brief    Queues programming bytes into an erased SPI flash page, like
+*           flashPageProgram(), and returns at once. A write enable and
+*           the bytes are moved by the USCI_B2 interrupt and \e pfnDone is
+*           called from the interrupt once they are sent. The flash then
+*           programs for ~0.8 ms (5 ms max), poll flashWriteInProgress() for
+*           the end.
+*           \e pui8Data must stay valid until \e pfnDone.
+*
+* @param    ui16Page      SPI flash page to program [0-1023]
+* @param    pui8Data      Pointer to buffer with data
+* @param    ui16Bytes     Number of bytes to program [1-256]
+* @param    pfnDone       Called from the interrupt when sent, or NULL
+*
+* @return   Returns 0 when queued
+* @return   Returns 1 if the bus queue is full or \e ui16Bytes is invalid
+******************************************************************************/
+uint8_t
+flashPageProgramStart(uint16_t ui16Page, uint8_t *pui8Data,
+                      uint16_t ui16Bytes, flashCallback_t pfnDone)
+{
+    if((ui16Bytes == 0) || (ui16Bytes > 256))
+    {
+        return (1);
+    }
+    return (flashTransferStart(FLASH_INSTR_PP, FLASH_PAGE_TO_ADDR(ui16Page),
+                               pui8Data, ui16Bytes, 0, pfnDone));
+}
+
+
+/**************************************************************************//**
+* @brief    Queues writing bytes to an SPI flash page, like flashPageWrite(),
+*           and returns at once. As flashPageProgramStart(), the flash then
+*           erases and programs the page for ~11 ms (25 ms max).
+*
+* @param    ui16Page      SPI flash page to write to [0-1023]
+* @param    pui8Data      Pointer to buffer with data
+* @param    ui16Bytes     Number of bytes to write [1-256]
+* @param    pfnDone       Called from the interrupt when sent, or NULL
+*
+* @return   Returns 0 when queued
+* @return   Returns 1 if the bus queue is full or \e ui16Bytes is invalid
+******************************************************************************/
+uint8_t
+flashPageWriteStart(uint16_t ui16Page, uint8_t *pui8Data, uint16_t ui16Bytes,
+                    flashCallback_t pfnDone)
+{
+    if((ui16Bytes == 0) || (ui16Bytes > 256))
+    {
+        return (1);
+    }
+    return (flashTransferStart(FLASH_INSTR_PW, FLASH_PAGE_TO_ADDR(ui16Page),
+                               pui8Data, ui16Bytes, 0, pfnDone));
+}
+
+
+/**************************************************************************//**
+* @brief    Queues the erase of the sub-sector specified by
+*           \e ui8SubSector and returns at once, unlike
+*           flashSubSectorErase(). The erase starts once the instruction is
+*           sent, \e pfnDone is called from the interrupt then, and
+*           takes ~50 ms (150 ms max), poll flashWriteInProgress() for the
+*           end.
+*
+* @param    ui8SubSector     Sub-sector to erase [0-63]
+* @param    pfnDone          Called from the interrupt when sent, or NULL
+*
+* @return   Returns 0 when queued
+* @return   Returns 1 if the bus queue is full
+******************************************************************************/
+uint8_t
+flashSubSectorEraseStart(uint8_t ui8SubSector, flashCallback_t pfnDone)
+{
+    return (flashTransferStart(FLASH_INSTR_SSE,
+                               FLASH_SUBSECTOR_TO_ADDR(ui8SubSector),
+                               0, 0, 0, pfnDone));
+}
+
+
+/**************************************************************************//**
+* @brief    Reads the status register once to tell whether a program, write
+*           or erase is still running in the flash.
+*
+* @return   Returns 1 while the flash is busy, 0 when it is ready
+******************************************************************************/
+uint8_t
+flashWriteInProgress(void)
+{
+    return ((flashStatusGet() & FLASH_STATUS_WIP_BM) ? 1 : 0);
+}
+
+
+/**************************************************************************//**
+* @brief    Tells whether flash transfers are queued or on the SPI bus.
+*
+* @return   Returns 1 until the last queued transfer has ended
+******************************************************************************/
+uint8_t
+flashTransferBusy(void)
+{
+    return (spiBusPending(SPI_BUS_CLIENT_FLASH) ? 1 : 0);
+}
+
+
 /**************************************************************************//**
 * @brief    Puts flash device into deep power-down mode. The flash device
 *           must be released from deep power-down using flashPowerDownDisable()
@@ -656,6 +886,62 @@ flashErase(uint8_t ui8Cmd, uint32_t ui32Addr)
 }
 
 
+static uint8_t
+flashTransferStart(uint8_t ui8Cmd, uint32_t ui32Addr, uint8_t *pui8Data,
+                   uint16_t ui16Bytes, uint8_t ui8Read, flashCallback_t pfnDone)
+{
+    static const uint8_t ui8Wren = FLASH_INSTR_WREN;
+    uint8_t pui8Hdr[FLASH_XFER_HDR_LEN];
+    uint16_t ui16IntState;
+    uint8_t ui8Status = 1;
+
+    pui8Hdr[0] = ui8Cmd;
+    pui8Hdr[1] = (uint8_t)(ui32Addr >> 16);
+    pui8Hdr[2] = (uint8_t)(ui32Addr >> 8);
+    pui8Hdr[3] = (uint8_t)(ui32Addr);
+
+    //
+    // Program, write and erase need the Write Enable bit set just before,
+    // queue both or none
+    //
+    ui16IntState = __get_interrupt_state();
+    __disable_interrupt();
+    if(spiBusFree(SPI_BUS_CLIENT_FLASH) >= (ui8Read ? 1 : 2))
+    {
+        if(!ui8Read)
+        {
+            spiBusSubmit(SPI_BUS_CLIENT_FLASH, &flashSelect, &ui8Wren, 1,
+                         0, 0, 0, 0);
+        }
+        ui8Status = spiBusSubmit(SPI_BUS_CLIENT_FLASH, &flashSelect, pui8Hdr,
+                                 FLASH_XFER_HDR_LEN,
+                                 ui8Read ? 0 : pui8Data,
+                                 ui8Read ? pui8Data : 0,
+                                 ui16Bytes, pfnDone);
+    }
+    __set_interrupt_state(ui16IntState);
+    return (ui8Status);
+}
+
+
+//
+// Chip select for queued transfers, called by the SPI bus with interrupts
+// disabled
+//
+static void
+flashSelect(uint8_t ui8On)
+{
+    if(ui8On)
+    {
+        FLASH_CS_N_OUT &= ~(BSP_FLASH_CS_N);
+    }
+    else
+    {
+        FLASH_CS_N_OUT |= BSP_FLASH_CS_N;
+    }
+}
+
+
 /**************************************************************************//**
 * Close the Doxygen group.
 * @}
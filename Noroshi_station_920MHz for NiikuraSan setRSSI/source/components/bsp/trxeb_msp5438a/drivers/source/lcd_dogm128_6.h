@@ -136,6 +136,11 @@ typedef enum
 }
 tLcdYLimit;
 
+//
+// Called from the SPI interrupt when a lcdSendPageStart() transfer has ended
+//
+typedef void (*lcdCallback_t)(void);
+
 /******************************************************************************
 * EXTERNAL VARIABLES
 */
@@ -165,6 +170,9 @@ extern void lcdSendBuffer(const char *pcBuffer);
 extern void lcdSendBufferPart(const char *pcBuffer, uint8_t ui8XFrom,
                               uint8_t ui8XTo, tLcdPage iPageFrom,
                               tLcdPage iPageTo);
+extern uint8_t lcdSendPageStart(const char *pcBuffer, uint8_t ui8XFrom,
+                                uint8_t ui8XTo, tLcdPage iPage,
+                                lcdCallback_t pfnDone);
 extern void lcdGotoXY(uint8_t ui8X, uint8_t ui8Y);
 extern void lcdSetContrast(uint8_t ui8Contrast);
 
@@ -49,6 +49,7 @@
 */
 #include "bsp.h"
 #include "lcd_dogm128_6.h"
+#include "spi_bus.h"
 
 
 /******************************************************************************
@@ -76,11 +77,15 @@
 //! Condition for SPI transmission to be completed.
 #define LCD_TX_BUSY()           (UCB2STAT & UCBUSY)
 
-//! Macro for asserting LCD CSn (set low)
-#define LCD_SPI_BEGIN()         (LCD_CS_A0_OUT &= ~(BSP_LCD_CS_N))
+//! Macro for holding the SPI bus (shared with the flash) and asserting LCD
+//! CSn (set low)
+#define LCD_SPI_BEGIN()         do{ spiBusAcquire(SPI_BUS_CLIENT_LCD);        \
+                                    LCD_CS_A0_OUT &= ~(BSP_LCD_CS_N);}        \
+                                while(0)
 
-//! Macro for deasserting LCD CSn (set high)
-#define LCD_SPI_END()           (LCD_CS_A0_OUT |= BSP_LCD_CS_N)
+//! Macro for deasserting LCD CSn (set high) and releasing the SPI bus
+#define LCD_SPI_END()           do{ LCD_CS_A0_OUT |= BSP_LCD_CS_N;            \
+                                    spiBusRelease();} while(0)
 
 //! Macro for setting LCD mode signal low (command)
 #define LCD_MODE_SET_CMD()      (LCD_CS_A0_OUT &= ~BSP_LCD_MODE)
@@ -123,6 +128,8 @@ static const char lcdInitCmd[] =
  * LOCAL FUNCTION PROTOTYPES
  */
 static void lcdSendArray(char* pcArray, uint16_t ui16Size);
+static void lcdSelectCmd(uint8_t ui8On);
+static void lcdSelectData(uint8_t ui8On);
 
 
 /**************************************************************************//**
@@ -299,6 +306,58 @@ lcdSendData(const char *pcCmd, uint16_t ui16Len)
 }
 
 
+/**************************************************************************//**
+* @brief    Queues sending columns \e ui8XFrom to \e ui8XTo of one page of
+*           \e pcBuffer on the SPI bus and returns at once, see spi_bus.h.
+*           The bytes are moved by the USCI_B2 interrupt, after queued
+*           flash transfers, and \e pfnDone is called from the interrupt
+*           after the last. The page in \e pcBuffer must not change until
+*           then.
+*
+* @param    pcBuffer    Pointer to buffer to send, NULL for the default one
+* @param    ui8XFrom    Lowest x-position (column) to send
+* @param    ui8XTo      Highest x-position (column) to send
+* @param    iPage       Page to send
+* @param    pfnDone     Called from the interrupt when sent, or NULL
+*
+* @return   Returns 0 when queued
+* @return   Returns 1 if the bus queue is full
+******************************************************************************/
+uint8_t
+lcdSendPageStart(const char *pcBuffer, uint8_t ui8XFrom, uint8_t ui8XTo,
+                 tLcdPage iPage, lcdCallback_t pfnDone)
+{
+    uint8_t pui8Cmd[3];
+
+#ifndef LCD_NO_DEFAULT_BUFFER
+    if(!pcBuffer)
+    {
+        pcBuffer = lcdDefaultBuffer;
+    }
+#endif // LCD_NO_DEFAULT_BUFFER
+
+    //
+    // Only the main loop queues LCD transfers, the two places stay free
+    //
+    if((ui8XFrom > ui8XTo) || (spiBusFree(SPI_BUS_CLIENT_LCD) < 2))
+    {
+        return (1);
+    }
+
+    //
+    // Set pointer as lcdGotoXY(), then the data
+    //
+    pui8Cmd[0] = 0xB0 + iPage;
+    pui8Cmd[1] = 0x10 + (ui8XFrom >> 4);
+    pui8Cmd[2] = 0x00 + (ui8XFrom & 0x0F);
+    spiBusSubmit(SPI_BUS_CLIENT_LCD, &lcdSelectCmd, pui8Cmd, 3, 0, 0, 0, 0);
+    spiBusSubmit(SPI_BUS_CLIENT_LCD, &lcdSelectData, 0, 0,
+                 (const uint8_t *)&pcBuffer[iPage * LCD_COLS + ui8XFrom], 0,
+                 ui8XTo - ui8XFrom + 1, pfnDone);
+    return (0);
+}
+
+
 /**************************************************************************//**
 * @brief    Function updates the LCD display by creating an animated transition
 *           between two displays. Two animations exists, \b LCD_SLIDE_LEFT and
@@ -465,6 +524,39 @@ lcdSendArray(char* pcArray, uint16_t ui16Size)
 }
 
 
+//
+// Chip select and mode for queued transfers, called by the SPI bus with
+// interrupts disabled
+//
+static void
+lcdSelectCmd(uint8_t ui8On)
+{
+    if(ui8On)
+    {
+        LCD_CS_A0_OUT &= ~(BSP_LCD_CS_N | BSP_LCD_MODE);
+    }
+    else
+    {
+        LCD_CS_A0_OUT |= BSP_LCD_CS_N;
+    }
+}
+
+
+static void
+lcdSelectData(uint8_t ui8On)
+{
+    if(ui8On)
+    {
+        LCD_MODE_SET_DATA();
+        LCD_CS_A0_OUT &= ~(BSP_LCD_CS_N);
+    }
+    else
+    {
+        LCD_CS_A0_OUT |= BSP_LCD_CS_N;
+    }
+}
+
+
 /**************************************************************************//**
 * Close the Doxygen group.
 * @}
@@ -0,0 +1,113 @@
+//*****************************************************************************
+//! @file       spi_bus.h
+//! @brief      Arbiter of the SPI bus shared by the SPI flash and the LCD
+//!             (BSP_FLASH_LCD_SPI, USCI_B2). Each client has a queue of
+//!             transactions: chip select, up to SPI_BUS_HDR_MAX command
+//!             bytes, then data sent from or read into a buffer. The bus
+//!             runs one transaction at a time, moved one byte per USCI_B2
+//!             RX interrupt, and at the end of each starts the oldest
+//!             transaction of the highest priority client, so a queued
+//!             flash access waits for at most the LCD transaction on the
+//!             bus. The F5438A has no DMA trigger for USCI_B2, the
+//!             interrupt takes the place of a DMA transfer.
+//!
+//!             Short blocking sequences, status reads or driver set-up,
+//!             hold the bus with spiBusAcquire() and spiBusRelease(). Only
+//!             the main loop may hold the bus, interrupts queue.
+//!
+//!             Per client the bus counts transactions, bytes, the time on
+//!             the bus and the time queued, in the units of the time source
+//!             given to spiBusInit(). Utilization is the time on the bus
+//!             over the time elapsed.
+//
+//****************************************************************************/
+#ifndef __SPI_BUS_H__
+#define __SPI_BUS_H__
+
+
+/******************************************************************************
+* If building with a C++ compiler, make all of the definitions in this header
+* have a C binding.
+******************************************************************************/
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/******************************************************************************
+* INCLUDES
+*/
+#include <stdint.h>
+
+
+/******************************************************************************
+* DEFINES
+*/
+//
+// Clients, by priority, lower number first
+//
+#define SPI_BUS_CLIENT_FLASH            0
+#define SPI_BUS_CLIENT_LCD              1
+#define SPI_BUS_CLIENTS                 2
+
+#ifndef SPI_BUS_QUEUE_LEN
+#define SPI_BUS_QUEUE_LEN               4   //!< Transactions per client
+#endif
+#define SPI_BUS_HDR_MAX                 4   //!< Command bytes per transaction
+#define SPI_BUS_DUMMY                   0x00
+
+
+/******************************************************************************
+* TYPEDEFS
+*/
+//
+//! Asserts (1) or deasserts (0) the client's chip select and mode pins
+//
+typedef void (*spiBusSelect_t)(uint8_t ui8On);
+
+//
+//! Called from the SPI interrupt when a transaction has ended
+//
+typedef void (*spiBusCallback_t)(void);
+
+//
+//! Time source, a free running count, e.g. 1/32768 s
+//
+typedef uint16_t (*spiBusTime_t)(void);
+
+typedef struct
+{
+    uint32_t ui32Xfers;             //!< Transactions, queued or held
+    uint32_t ui32Bytes;
+    uint32_t ui32BusyTime;          //!< Time on the bus, held time included
+    uint32_t ui32WaitTime;          //!< Time queued before the bus was free
+    uint16_t ui16WaitMax;
+    uint16_t ui16Refused;           //!< Queue full
+    uint8_t ui8DepthMax;
+} spiBusStats_t;
+
+
+/******************************************************************************
+* FUNCTION PROTOTYPES
+*/
+void spiBusInit(spiBusTime_t pfnNow);
+uint8_t spiBusSubmit(uint8_t ui8Client, spiBusSelect_t pfnSelect,
+                     const uint8_t *pui8Hdr, uint8_t ui8HdrLen,
+                     const uint8_t *pui8Tx, uint8_t *pui8Rx,
+                     uint16_t ui16Len, spiBusCallback_t pfnDone);
+uint8_t spiBusFree(uint8_t ui8Client);
+uint8_t spiBusPending(uint8_t ui8Client);
+uint8_t spiBusBusy(void);
+void spiBusAcquire(uint8_t ui8Client);
+void spiBusRelease(void);
+const spiBusStats_t *spiBusGetStats(uint8_t ui8Client);
+
+
+/******************************************************************************
+* Mark the end of the C bindings section for C++ compilers.
+******************************************************************************/
+#ifdef __cplusplus
+}
+#endif
+#endif /* #ifndef __SPI_BUS_H__ */
@@ -0,0 +1,477 @@
+//*****************************************************************************
+//! @file       spi_bus_trxeb.c
+//! @brief      TrxEB implementation of the arbiter of the SPI bus shared by
+//!             the SPI flash and the LCD, see spi_bus.h
+//
+//****************************************************************************/
+#ifndef SPI_BUS_EXCLUDE
+
+
+/**************************************************************************//**
+* @addtogroup spi_bus_api
+* @{
+******************************************************************************/
+
+
+/******************************************************************************
+* INCLUDES
+*/
+#include <string.h>
+#include "bsp.h"
+#include "spi_bus.h"
+
+
+/******************************************************************************
+* MACROS
+*/
+//
+//! Clear RX flag, TX is cleared upon buffer write
+//
+#define SPI_BUS_TX(x)           do{ UCB2IFG &= ~UCRXIFG; UCB2TXBUF = (x);}\
+                                while(0)
+#define SPI_BUS_RX()            UCB2RXBUF
+
+
+/******************************************************************************
+* TYPEDEFS
+*/
+typedef struct
+{
+    spiBusSelect_t pfnSelect;
+    const uint8_t *pui8Tx;          //!< NULL sends SPI_BUS_DUMMY
+    uint8_t *pui8Rx;                //!< NULL drops the received bytes
+    spiBusCallback_t pfnDone;
+    uint16_t ui16Len;               //!< Data bytes after the header
+    uint16_t ui16Queued;            //!< Time when queued
+    uint8_t pui8Hdr[SPI_BUS_HDR_MAX];
+    uint8_t ui8HdrLen;
+} spiBusXfer_t;
+
+
+/******************************************************************************
+* LOCAL VARIABLES AND FUNCTION PROTOTYPES
+*/
+//
+// Queues, the transaction on the bus stays at the head of its queue until
+// its last byte
+//
+static spiBusXfer_t pSpiBusQueue[SPI_BUS_CLIENTS][SPI_BUS_QUEUE_LEN];
+static uint8_t pui8SpiBusHead[SPI_BUS_CLIENTS];
+static volatile uint8_t pui8SpiBusCount[SPI_BUS_CLIENTS];
+
+//
+// Bus owner: a queued transaction, or a client holding the bus. All zero,
+// the state before spiBusInit(), is an idle bus
+//
+static volatile uint8_t ui8SpiBusActive;
+static uint8_t ui8SpiBusOwner;
+static uint8_t ui8SpiBusHeld;
+static uint16_t ui16SpiBusCnt;
+static uint16_t ui16SpiBusEnd;
+static uint16_t ui16SpiBusStart;
+
+static spiBusTime_t pfnSpiBusNow;
+static spiBusStats_t pSpiBusStats[SPI_BUS_CLIENTS];
+
+static uint16_t spiBusTime(void);
+static void spiBusNext(void);
+static uint8_t spiBusByte(void);
+__interrupt void spiBusIsr(void);
+
+
+/******************************************************************************
+* FUNCTIONS
+*/
+/**************************************************************************//**
+* @brief    Empties the queues and clears the counters. The SPI interface
+*           must be set up with bspIoSpiInit() and no transaction may be
+*           running. Without this call the bus works, but counts no time.
+*
+* @param    pfnNow        Time source for the counters, or NULL
+*
+* @return   None
+******************************************************************************/
+void
+spiBusInit(spiBusTime_t pfnNow)
+{
+    uint8_t ui8Client;
+
+    UCB2IE &= ~UCRXIE;
+    for(ui8Client = 0; ui8Client < SPI_BUS_CLIENTS; ui8Client++)
+    {
+        pui8SpiBusHead[ui8Client] = 0;
+        pui8SpiBusCount[ui8Client] = 0;
+        memset(&pSpiBusStats[ui8Client], 0, sizeof(spiBusStats_t));
+    }
+    ui8SpiBusActive = 0;
+    ui8SpiBusHeld = 0;
+    pfnSpiBusNow = pfnNow;
+}
+
+
+/**************************************************************************//**
+* @brief    Queues a transaction and returns at once. It starts as soon as
+*           the bus is free and no transaction of a client with higher
+*           priority waits. The bytes are moved by the USCI_B2 interrupt
+*           and \e pfnDone is called from the interrupt after the last,
+*           with chip select released. May be called from an interrupt.
+*
+* @param    ui8Client     SPI_BUS_CLIENT_x
+* @param    pfnSelect     Chip select of the device
+* @param    pui8Hdr       Command bytes, copied, or NULL
+* @param    ui8HdrLen     Number of command bytes [0-SPI_BUS_HDR_MAX]
+* @param    pui8Tx        Data bytes to send, or NULL to send dummy bytes
+* @param    pui8Rx        Buffer for the bytes read during the data, or NULL
+* @param    ui16Len       Number of data bytes
+* @param    pfnDone       Called from the interrupt when done, or NULL
+*
+* @return   Returns 0 when queued
+* @return   Returns 1 if the queue is full or the transaction is empty
+******************************************************************************/
+uint8_t
+spiBusSubmit(uint8_t ui8Client, spiBusSelect_t pfnSelect,
+             const uint8_t *pui8Hdr, uint8_t ui8HdrLen,
+             const uint8_t *pui8Tx, uint8_t *pui8Rx,
+             uint16_t ui16Len, spiBusCallback_t pfnDone)
+{
+    spiBusXfer_t *pXfer;
+    uint16_t ui16IntState;
+    uint8_t ui8Cnt;
+
+    if((ui8Client >= SPI_BUS_CLIENTS) || (ui8HdrLen > SPI_BUS_HDR_MAX) ||
+       ((ui8HdrLen == 0) && (ui16Len == 0)))
+    {
+        return (1);
+    }
+
+    ui16IntState = __get_interrupt_state();
+    __disable_interrupt();
+    ui8Cnt = pui8SpiBusCount[ui8Client];
+    if(ui8Cnt >= SPI_BUS_QUEUE_LEN)
+    {
+        pSpiBusStats[ui8Client].ui16Refused++;
+        __set_interrupt_state(ui16IntState);
+        return (1);
+    }
+
+    pXfer = &pSpiBusQueue[ui8Client][(pui8SpiBusHead[ui8Client] + ui8Cnt) %
+                                     SPI_BUS_QUEUE_LEN];
+    pXfer->pfnSelect = pfnSelect;
+    if(ui8HdrLen)
+    {
+        memcpy(pXfer->pui8Hdr, pui8Hdr, ui8HdrLen);
+    }
+    pXfer->ui8HdrLen = ui8HdrLen;
+    pXfer->pui8Tx = pui8Tx;
+    pXfer->pui8Rx = pui8Rx;
+    pXfer->ui16Len = ui16Len;
+    pXfer->pfnDone = pfnDone;
+    pXfer->ui16Queued = spiBusTime();
+    pui8SpiBusCount[ui8Client] = ++ui8Cnt;
+    if(ui8Cnt > pSpiBusStats[ui8Client].ui8DepthMax)
+    {
+        pSpiBusStats[ui8Client].ui8DepthMax = ui8Cnt;
+    }
+
+    spiBusNext();
+    __set_interrupt_state(ui16IntState);
+    return (0);
+}
+
+
+/**************************************************************************//**
+* @brief    Free places in a client's queue, for a caller that needs to
+*           queue several transactions at once.
+*
+* @param    ui8Client     SPI_BUS_CLIENT_x
+*
+* @return   Returns the number of transactions that can be queued
+******************************************************************************/
+uint8_t
+spiBusFree(uint8_t ui8Client)
+{
+    return (SPI_BUS_QUEUE_LEN - pui8SpiBusCount[ui8Client]);
+}
+
+
+/**************************************************************************//**
+* @brief    Transactions of a client not yet ended, queued or on the bus.
+*
+* @param    ui8Client     SPI_BUS_CLIENT_x
+*
+* @return   Returns the number of transactions
+******************************************************************************/
+uint8_t
+spiBusPending(uint8_t ui8Client)
+{
+    return (pui8SpiBusCount[ui8Client]);
+}
+
+
+/**************************************************************************//**
+* @brief    Tells whether the bus is in use, transactions are running or
+*           queued or a client holds it. SMCLK must run while it is.
+*
+* @return   Returns 1 while the bus is in use
+******************************************************************************/
+uint8_t
+spiBusBusy(void)
+{
+    uint8_t ui8Client;
+
+    if(ui8SpiBusActive)
+    {
+        return (1);
+    }
+    for(ui8Client = 0; ui8Client < SPI_BUS_CLIENTS; ui8Client++)
+    {
+        if(pui8SpiBusCount[ui8Client])
+        {
+            return (1);
+        }
+    }
+    return (0);
+}
+
+
+/**************************************************************************//**
+* @brief    Waits for the end of the transaction on the bus and holds the
+*           bus for the caller's blocking SPI accesses. Queued transactions
+*           wait until spiBusRelease(). With interrupts disabled the bytes
+*           of the running transaction are moved here instead of in the
+*           interrupt. Main loop only, the bus cannot be held twice.
+*
+* @param    ui8Client     SPI_BUS_CLIENT_x, for the counters
+*
+* @return   None
+******************************************************************************/
+void
+spiBusAcquire(uint8_t ui8Client)
+{
+    uint16_t ui16IntState;
+
+    ui16IntState = __get_interrupt_state();
+    __disable_interrupt();
+    while(ui8SpiBusActive)
+    {
+        if(ui16IntState & GIE)
+        {
+            //
+            // Let the interrupt move the bytes, it is taken after the
+            // instruction that follows the enable
+            //
+            __set_interrupt_state(ui16IntState);
+            __no_operation();
+            __disable_interrupt();
+        }
+        else if(UCB2IFG & UCRXIFG)
+        {
+            spiBusByte();
+        }
+    }
+
+    ui8SpiBusActive = 1;
+    ui8SpiBusHeld = 1;
+    ui8SpiBusOwner = ui8Client;
+    ui16SpiBusStart = spiBusTime();
+    pSpiBusStats[ui8Client].ui32Xfers++;
+    __set_interrupt_state(ui16IntState);
+}
+
+
+/**************************************************************************//**
+* @brief    Releases the bus held with spiBusAcquire() and starts the next
+*           queued transaction. Does nothing if the bus is not held.
+*
+* @return   None
+******************************************************************************/
+void
+spiBusRelease(void)
+{
+    uint16_t ui16IntState;
+
+    ui16IntState = __get_interrupt_state();
+    __disable_interrupt();
+    if(ui8SpiBusHeld)
+    {
+        pSpiBusStats[ui8SpiBusOwner].ui32BusyTime +=
+            (uint16_t)(spiBusTime() - ui16SpiBusStart);
+        ui8SpiBusHeld = 0;
+        ui8SpiBusActive = 0;
+        spiBusNext();
+    }
+    __set_interrupt_state(ui16IntState);
+}
+
+
+/**************************************************************************//**
+* @brief    Returns the bus counters of a client. The busy time over the
+*           time elapsed is the share of the bus the client used.
+*
+* @param    ui8Client     SPI_BUS_CLIENT_x
+*
+* @return   Returns a pointer to the counters
+******************************************************************************/
+const spiBusStats_t *
+spiBusGetStats(uint8_t ui8Client)
+{
+    return (&pSpiBusStats[ui8Client]);
+}
+
+
+/******************************************************************************
+* LOCAL FUNCTIONS
+*/
+static uint16_t
+spiBusTime(void)
+{
+    return (pfnSpiBusNow ? (*pfnSpiBusNow)() : 0);
+}
+
+
+//
+// Starts the oldest transaction of the client with the highest priority if
+// the bus is free. Called with interrupts disabled.
+//
+static void
+spiBusNext(void)
+{
+    spiBusXfer_t *pXfer;
+    spiBusStats_t *pStats;
+    uint16_t ui16Wait;
+    uint8_t ui8Client;
+
+    if(ui8SpiBusActive)
+    {
+        return;
+    }
+    for(ui8Client = 0; ui8Client < SPI_BUS_CLIENTS; ui8Client++)
+    {
+        if(pui8SpiBusCount[ui8Client])
+        {
+            break;
+        }
+    }
+    if(ui8Client == SPI_BUS_CLIENTS)
+    {
+        return;
+    }
+
+    pXfer = &pSpiBusQueue[ui8Client][pui8SpiBusHead[ui8Client]];
+    ui16SpiBusStart = spiBusTime();
+    ui16Wait = ui16SpiBusStart - pXfer->ui16Queued;
+    pStats = &pSpiBusStats[ui8Client];
+    pStats->ui32WaitTime += ui16Wait;
+    if(ui16Wait > pStats->ui16WaitMax)
+    {
+        pStats->ui16WaitMax = ui16Wait;
+    }
+
+    ui8SpiBusActive = 1;
+    ui8SpiBusOwner = ui8Client;
+    ui16SpiBusCnt = 0;
+    ui16SpiBusEnd = pXfer->ui8HdrLen + pXfer->ui16Len;
+
+    //
+    // Select the device and send the first byte, the interrupt sends the
+    // rest
+    //
+    (*pXfer->pfnSelect)(1);
+    SPI_BUS_TX(pXfer->ui8HdrLen ? pXfer->pui8Hdr[0] :
+               (pXfer->pui8Tx ? pXfer->pui8Tx[0] : SPI_BUS_DUMMY));
+    UCB2IE |= UCRXIE;
+}
+
+
+//
+// A byte of the transaction on the bus has been exchanged: keep it if
+// reading and send the next one, or end the transaction after the last and
+// start the next one. Called with interrupts disabled, returns 1 when a
+// transaction ended.
+//
+static uint8_t
+spiBusByte(void)
+{
+    spiBusXfer_t *pXfer;
+    spiBusStats_t *pStats;
+    spiBusCallback_t pfnDone;
+    uint8_t ui8Client = ui8SpiBusOwner;
+    uint8_t ui8HdrLen;
+    uint8_t ui8Rx;
+    uint16_t ui16Cnt;
+
+    ui8Rx = SPI_BUS_RX();
+    pXfer = &pSpiBusQueue[ui8Client][pui8SpiBusHead[ui8Client]];
+    ui8HdrLen = pXfer->ui8HdrLen;
+    ui16Cnt = ui16SpiBusCnt;
+    if(pXfer->pui8Rx && (ui16Cnt >= ui8HdrLen))
+    {
+        pXfer->pui8Rx[ui16Cnt - ui8HdrLen] = ui8Rx;
+    }
+    ui16SpiBusCnt = ++ui16Cnt;
+
+    if(ui16Cnt < ui8HdrLen)
+    {
+        SPI_BUS_TX(pXfer->pui8Hdr[ui16Cnt]);
+        return (0);
+    }
+    if(ui16Cnt < ui16SpiBusEnd)
+    {
+        SPI_BUS_TX(pXfer->pui8Tx ? pXfer->pui8Tx[ui16Cnt - ui8HdrLen] :
+                   SPI_BUS_DUMMY);
+        return (0);
+    }
+
+    UCB2IE &= ~UCRXIE;
+    (*pXfer->pfnSelect)(0);
+    pStats = &pSpiBusStats[ui8Client];
+    pStats->ui32Xfers++;
+    pStats->ui32Bytes += ui16Cnt;
+    pStats->ui32BusyTime += (uint16_t)(spiBusTime() - ui16SpiBusStart);
+
+    //
+    // Remove it before the callback, which may queue the next one
+    //
+    pfnDone = pXfer->pfnDone;
+    pui8SpiBusHead[ui8Client] = (pui8SpiBusHead[ui8Client] + 1) %
+                                SPI_BUS_QUEUE_LEN;
+    pui8SpiBusCount[ui8Client]--;
+    ui8SpiBusActive = 0;
+    if(pfnDone)
+    {
+        (*pfnDone)();
+    }
+    spiBusNext();
+    return (1);
+}
+
+
+/**************************************************************************//**
+* @brief    USCI_B2 interrupt. Moves one byte of the transaction on the bus
+*           and leaves low power mode when a transaction has ended.
+*
+* @return   None
+******************************************************************************/
+#pragma vector=USCI_B2_VECTOR
+__interrupt void
+spiBusIsr(void)
+{
+    switch(__even_in_range(UCB2IV, 4))
+    {
+    case 2:                             // Vector 2 - RXIFG
+        if(spiBusByte())
+        {
+            __low_power_mode_off_on_exit();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+
+/**************************************************************************//**
+* Close the Doxygen group.
+* @}
+******************************************************************************/
+#endif // #ifndef SPI_BUS_EXCLUDE
@@ -169,6 +169,54 @@ rfStatus_t cc120xSpiReadRxFifo(uint8 * pData, uint8 len)
   return (rc);
 }
 
+/*******************************************************************************
+ * @fn          cc120xSpiWriteTxFifoDma
+ *
+ * @brief       Write pData to radio transmit FIFO using DMA. Returns once the
+ *              header byte is sent; pfnDone is called from the DMA ISR when
+ *              all bytes are written.
+ *
+ * input parameters
+ *
+ * @param       *pData  - pointer to data array that is written to TX FIFO
+ * @param       len     - Length of data array to be written
+ * @param       pfnDone - completion callback, may be NULL
+ *
+ * output parameters
+ *
+ * @return      rfStatus_t
+ */
+rfStatus_t cc120xSpiWriteTxFifoDma(uint8 *pData, uint8 len, trxDmaCallback_t pfnDone)
+{
+  uint8 rc;
+  rc = trx8BitRegAccessDma(0x00,CC120X_BURST_TXFIFO, pData, len, pfnDone);
+  return (rc);
+}
+
+/*******************************************************************************
+ * @fn          cc120xSpiReadRxFifoDma
+ *
+ * @brief       Reads RX FIFO values to pData array using DMA. Returns once
+ *              the header byte is sent; pfnDone is called from the DMA ISR
+ *              when all bytes are in pData.
+ *
+ * input parameters
+ *
+ * @param       *pData  - pointer to data array where RX FIFO bytes are saved
+ * @param       len     - number of bytes to read from the RX FIFO
+ * @param       pfnDone - completion callback, may be NULL
+ *
+ * output parameters
+ *
+ * @return      rfStatus_t
+ */
+rfStatus_t cc120xSpiReadRxFifoDma(uint8 *pData, uint8 len, trxDmaCallback_t pfnDone)
+{
+  uint8 rc;
+  rc = trx8BitRegAccessDma(0x00,CC120X_BURST_RXFIFO, pData, len, pfnDone);
+  return (rc);
+}
+
 /******************************************************************************
  * @fn      cc120xGetTxStatus(void)
  *          
@@ -323,6 +323,8 @@ rfStatus_t cc120xGetRxStatus(void);
 rfStatus_t cc120xSpiWriteReg(uint16 addr, uint8 *data, uint8 len);
 rfStatus_t cc120xSpiWriteTxFifo(uint8 *pWriteData, uint8 len);
 rfStatus_t cc120xSpiReadRxFifo(uint8 *pReadData, uint8 len);
+rfStatus_t cc120xSpiWriteTxFifoDma(uint8 *pWriteData, uint8 len, trxDmaCallback_t pfnDone);
+rfStatus_t cc120xSpiReadRxFifoDma(uint8 *pReadData, uint8 len, trxDmaCallback_t pfnDone);
 
 #ifdef  __cplusplus
 }
@@ -44,13 +44,24 @@
 #include "hal_types.h"
 #include "hal_defs.h"
 #include "hal_spi_rf_trxeb.h"
+#include "dma.h"
 
 
 
+/******************************************************************************
+ * LOCAL VARIABLES
+ */
+static volatile uint8 trxDmaActive = 0;
+static trxDmaCallback_t pfnTrxDmaDone = NULL;
+static rfStatus_t trxDmaStatus;
+static uint8 trxDmaDummy;
+
+
 /******************************************************************************
  * LOCAL FUNCTIONS
  */
 static void trxReadWriteBurstSingle(uint8 addr,uint8 *pData,uint16 len) ;
+static void trxReadWriteBurstDma(uint8 addr,uint8 *pData,uint16 len) ;
 
 
 /******************************************************************************
@@ -264,6 +275,110 @@ rfStatus_t trxSpiCmdStrobe(uint8 cmd)
     return(rc);
 }
 
+/******************************************************************************
+ * @fn          trxRfSpiDmaInit
+ *
+ * @brief       Sets up the two DMA channels used by trx8BitRegAccessDma. The
+ *              RX channel moves UCB0RXBUF to memory and the TX channel moves
+ *              memory to UCB0TXBUF, one byte per USCI flag. Must be called
+ *              after trxRfSpiInterfaceInit.
+ *
+ * input parameters
+ *
+ * @param       none
+ *
+ * output parameters
+ *
+ * @return      void
+ */
+void trxRfSpiDmaInit(void)
+{
+  DMA_initParam param = {0};
+
+  /* Do not let a DMA cycle split a CPU read-modify-write (USCI errata) */
+  DMA_disableTransferDuringReadModifyWrite();
+
+  param.channelSelect       = TRXEM_DMA_RX_CHANNEL;
+  param.transferModeSelect  = DMA_TRANSFER_SINGLE;
+  param.transferSize        = 0;
+  param.triggerSourceSelect = TRXEM_DMA_RX_TRIGGER;
+  param.transferUnitSelect  = DMA_SIZE_SRCBYTE_DSTBYTE;
+  param.triggerTypeSelect   = DMA_TRIGGER_RISINGEDGE;
+  DMA_init(&param);
+  DMA_setSrcAddress(TRXEM_DMA_RX_CHANNEL, (uint32)(uintptr_t)&UCB0RXBUF,
+                    DMA_DIRECTION_UNCHANGED);
+
+  param.channelSelect       = TRXEM_DMA_TX_CHANNEL;
+  param.triggerSourceSelect = TRXEM_DMA_TX_TRIGGER;
+  DMA_init(&param);
+  DMA_setDstAddress(TRXEM_DMA_TX_CHANNEL, (uint32)(uintptr_t)&UCB0TXBUF,
+                    DMA_DIRECTION_UNCHANGED);
+  return;
+}
+
+/*******************************************************************************
+ * @fn          trx8BitRegAccessDma
+ *
+ * @brief       Same access as trx8BitRegAccess, but the data phase is moved
+ *              by DMA. The address byte is sent blocking, then the function
+ *              returns with CS_N still low. When the last byte has been
+ *              clocked in, the DMA ISR releases CS_N and calls pfnDone.
+ *              No other radio SPI access may be started before that, see
+ *              trxSpiDmaBusy. SMCLK must stay on (LPM0 at most) meanwhile.
+ *
+ * input parameters
+ *
+ * @param       accessType - Same as trx8BitRegAccess
+ * @param       addrByte   - address byte of register.
+ * @param       pData      - data array, must stay valid until pfnDone
+ * @param       len        - Length of array to be read(TX)/written(RX)
+ * @param       pfnDone    - completion callback, called from ISR. May be NULL
+ *
+ * output parameters
+ *
+ * @return      chip status
+ */
+rfStatus_t trx8BitRegAccessDma(uint8 accessType, uint8 addrByte, uint8 *pData,
+                               uint16 len, trxDmaCallback_t pfnDone)
+{
+  uint8 readValue;
+
+  trxDmaActive = 1;
+  pfnTrxDmaDone = pfnDone;
+
+  /* Pull CS_N low and wait for SO to go low before communication starts */
+  TRXEM_SPI_BEGIN();
+  while(TRXEM_PORT_IN & TRXEM_SPI_MISO_PIN);
+  /* send register address byte */
+  TRXEM_SPI_TX(accessType|addrByte);
+  TRXEM_SPI_WAIT_DONE();
+  /* Storing chip status, this also clears UCRXIFG */
+  readValue = TRXEM_SPI_RX();
+  trxDmaStatus = readValue;
+  trxReadWriteBurstDma(accessType|addrByte,pData,len);
+  /* return the status byte value */
+  return(readValue);
+}
+
+/*******************************************************************************
+ * @fn          trxSpiDmaBusy
+ *
+ * @brief       Returns non-zero while a DMA access started by
+ *              trx8BitRegAccessDma is in progress.
+ *
+ * input parameters
+ *
+ * @param       none
+ *
+ * output parameters
+ *
+ * @return      1 if busy, 0 otherwise
+ */
+uint8 trxSpiDmaBusy(void)
+{
+  return(trxDmaActive);
+}
+
 /*******************************************************************************
  * @fn          trxReadWriteBurstSingle
  *
@@ -335,4 +450,93 @@ static void trxReadWriteBurstSingle(uint8 addr,uint8 *pData,uint16 len)
     }
   }
   return;
-}
\ No newline at end of file
+}
+
+/*******************************************************************************
+ * @fn          trxReadWriteBurstDma
+ *
+ * @brief       DMA counterpart of trxReadWriteBurstSingle. Both channels
+ *              always run len transfers so that completion is signalled by
+ *              the RX channel once the last byte is clocked in. On reads the
+ *              TX channel repeats a 0x00 dummy byte, on writes the RX channel
+ *              discards into a dummy byte.
+ *
+ * input parameters
+ *
+ * @param       none
+ *
+ * output parameters
+ *
+ * @return      void
+ */
+static void trxReadWriteBurstDma(uint8 addr,uint8 *pData,uint16 len)
+{
+  if(!(addr&RADIO_BURST_ACCESS))
+  {
+    len = 1;
+  }
+
+  DMA_setTransferSize(TRXEM_DMA_RX_CHANNEL, len);
+  DMA_setTransferSize(TRXEM_DMA_TX_CHANNEL, len);
+
+  if(addr&RADIO_READ_ACCESS)
+  {
+    trxDmaDummy = 0;
+    DMA_setDstAddress(TRXEM_DMA_RX_CHANNEL, (uint32)(uintptr_t)pData,
+                      DMA_DIRECTION_INCREMENT);
+    DMA_setSrcAddress(TRXEM_DMA_TX_CHANNEL, (uint32)(uintptr_t)&trxDmaDummy,
+                      DMA_DIRECTION_UNCHANGED);
+  }
+  else
+  {
+    DMA_setDstAddress(TRXEM_DMA_RX_CHANNEL, (uint32)(uintptr_t)&trxDmaDummy,
+                      DMA_DIRECTION_UNCHANGED);
+    DMA_setSrcAddress(TRXEM_DMA_TX_CHANNEL, (uint32)(uintptr_t)pData,
+                      DMA_DIRECTION_INCREMENT);
+  }
+
+  DMA_clearInterrupt(TRXEM_DMA_RX_CHANNEL);
+  DMA_enableInterrupt(TRXEM_DMA_RX_CHANNEL);
+  DMA_enableTransfers(TRXEM_DMA_RX_CHANNEL);
+  DMA_enableTransfers(TRXEM_DMA_TX_CHANNEL);
+
+  /* UCTXIFG is already set, so re-raise it to give the TX channel its edge */
+  UCB0IFG &= ~UCTXIFG;
+  UCB0IFG |= UCTXIFG;
+  return;
+}
+
+/*******************************************************************************
+ * @fn          trxDmaIsr
+ *
+ * @brief       DMA interrupt. Channel 0 completing means the last byte of a
+ *              trx8BitRegAccessDma access has been received: release CS_N,
+ *              report the status byte and leave low power mode.
+ *
+ * input parameters
+ *
+ * @param       none
+ *
+ * output parameters
+ *
+ * @return      void
+ */
+#pragma vector=DMA_VECTOR
+__interrupt void trxDmaIsr(void)
+{
+  switch(__even_in_range(DMAIV,16))
+  {
+    case 2:                                   /* Vector 2 - DMA0IFG */
+      DMA_disableInterrupt(TRXEM_DMA_RX_CHANNEL);
+      TRXEM_SPI_END();
+      trxDmaActive = 0;
+      if(pfnTrxDmaDone != NULL)
+      {
+        (*pfnTrxDmaDone)(trxDmaStatus);
+      }
+      __low_power_mode_off_on_exit();
+      break;
+    default:
+      break;
+  }
+}
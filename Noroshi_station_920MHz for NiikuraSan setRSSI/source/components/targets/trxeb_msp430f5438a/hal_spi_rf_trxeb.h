@@ -70,6 +70,13 @@ extern "C" {
 #define RF_RESET_N_PIN       BIT0
 
 
+/* DMA channels used for burst transfers on USCI_B0 (F5438A trigger map) */
+#define TRXEM_DMA_RX_CHANNEL DMA_CHANNEL_0
+#define TRXEM_DMA_TX_CHANNEL DMA_CHANNEL_1
+#define TRXEM_DMA_RX_TRIGGER DMA_TRIGGERSOURCE_18  /* UCB0RXIFG */
+#define TRXEM_DMA_TX_TRIGGER DMA_TRIGGERSOURCE_19  /* UCB0TXIFG */
+
+
 #define RADIO_BURST_ACCESS   0x40
 #define RADIO_SINGLE_ACCESS  0x00
 #define RADIO_READ_ACCESS    0x80
@@ -115,6 +122,9 @@ typedef struct
 
 typedef uint8 rfStatus_t;
 
+/* Called from the DMA ISR with the chip status byte of the access */
+typedef void (*trxDmaCallback_t)(rfStatus_t status);
+
 /******************************************************************************
  * PROTOTYPES
  */
@@ -126,6 +136,11 @@ rfStatus_t trxSpiCmdStrobe(uint8 cmd);
 /* CC112X specific prototype function */
 rfStatus_t trx16BitRegAccess(uint8 accessType, uint8 extAddr, uint8 regAddr, uint8 *pData, uint8 len);
 
+/* DMA burst access, completes asynchronously through pfnDone */
+void trxRfSpiDmaInit(void);
+rfStatus_t trx8BitRegAccessDma(uint8 accessType, uint8 addrByte, uint8 *pData, uint16 len, trxDmaCallback_t pfnDone);
+uint8 trxSpiDmaBusy(void);
+
 #ifdef  __cplusplus
 }
 #endif